@@ -0,0 +1,145 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by the Okular developers                           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include <QSet>
+#include <QTest>
+
+#include <climits>
+
+#include "../core/allocatedpixmapcache_p.h"
+#include "../core/observer.h"
+
+class PinningObserver : public Okular::DocumentObserver
+{
+public:
+    bool canUnloadPixmap(int page) const override
+    {
+        return !pinnedPages.contains(page);
+    }
+
+    QSet<int> pinnedPages;
+};
+
+class AllocatedPixmapCacheTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testMemoryAccounting();
+    void testFarthest();
+    void testUnloadableOnly();
+    void testTakeAllByObserver();
+    void benchmarkEviction10k();
+
+private:
+    PinningObserver m_observer;
+    PinningObserver m_otherObserver;
+};
+
+void AllocatedPixmapCacheTest::testMemoryAccounting()
+{
+    Okular::AllocatedPixmapCache cache;
+    cache.insert(new AllocatedPixmap(&m_observer, 0, 100));
+    cache.insert(new AllocatedPixmap(&m_observer, 1, 200));
+    cache.insert(new AllocatedPixmap(&m_otherObserver, 0, 400));
+    QCOMPARE(cache.count(), 3);
+    QCOMPARE(cache.totalMemory(), qulonglong(700));
+
+    // replacing the pixmap of a page drops the memory of the old one
+    cache.insert(new AllocatedPixmap(&m_observer, 1, 50));
+    QCOMPARE(cache.count(), 3);
+    QCOMPARE(cache.totalMemory(), qulonglong(550));
+
+    AllocatedPixmap *p = cache.take(&m_otherObserver, 0);
+    QVERIFY(p);
+    QCOMPARE(p->memory, qulonglong(400));
+    delete p;
+    QVERIFY(!cache.take(&m_otherObserver, 0));
+    QCOMPARE(cache.totalMemory(), qulonglong(150));
+
+    cache.clear();
+    QVERIFY(cache.isEmpty());
+    QCOMPARE(cache.totalMemory(), qulonglong(0));
+}
+
+void AllocatedPixmapCacheTest::testFarthest()
+{
+    Okular::AllocatedPixmapCache cache;
+    for (int page = 0; page < 20; ++page)
+        cache.insert(new AllocatedPixmap(&m_observer, page, 1));
+    cache.insert(new AllocatedPixmap(&m_otherObserver, 25, 1));
+
+    QCOMPARE(cache.farthest(18)->page, 0);
+    QCOMPARE(cache.farthest(2)->page, 25);
+    QCOMPARE(cache.farthest(2, false, &m_observer)->page, 19);
+
+    // evicting from the viewport outwards always picks the farthest remaining page
+    int lastDistance = INT_MAX;
+    while (AllocatedPixmap *p = cache.takeFarthest(10, false, &m_observer)) {
+        const int distance = qAbs(p->page - 10);
+        QVERIFY(distance <= lastDistance);
+        lastDistance = distance;
+        delete p;
+    }
+    QCOMPARE(lastDistance, 0);
+    QCOMPARE(cache.count(), 1);
+    QCOMPARE(cache.totalMemory(), qulonglong(1));
+}
+
+void AllocatedPixmapCacheTest::testUnloadableOnly()
+{
+    Okular::AllocatedPixmapCache cache;
+    for (int page = 0; page < 10; ++page)
+        cache.insert(new AllocatedPixmap(&m_observer, page, 1));
+
+    m_observer.pinnedPages = {0, 1, 9};
+    QCOMPARE(cache.farthest(5)->page, 0);
+    QCOMPARE(cache.farthest(5, true)->page, 2);
+
+    m_observer.pinnedPages = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+    QVERIFY(!cache.farthest(5, true));
+    QVERIFY(!cache.takeFarthest(5, true));
+    QCOMPARE(cache.count(), 10);
+
+    m_observer.pinnedPages.clear();
+}
+
+void AllocatedPixmapCacheTest::testTakeAllByObserver()
+{
+    Okular::AllocatedPixmapCache cache;
+    for (int page = 0; page < 10; ++page) {
+        cache.insert(new AllocatedPixmap(&m_observer, page, 10));
+        cache.insert(new AllocatedPixmap(&m_otherObserver, page, 1));
+    }
+
+    const QList<AllocatedPixmap *> taken = cache.takeAll(&m_observer);
+    QCOMPARE(taken.count(), 10);
+    qDeleteAll(taken);
+    QCOMPARE(cache.count(), 10);
+    QCOMPARE(cache.totalMemory(), qulonglong(10));
+    QVERIFY(!cache.find(&m_observer, 3));
+    QVERIFY(cache.find(&m_otherObserver, 3));
+}
+
+void AllocatedPixmapCacheTest::benchmarkEviction10k()
+{
+    const int pixmapCount = 10000;
+
+    QBENCHMARK {
+        Okular::AllocatedPixmapCache cache;
+        for (int page = 0; page < pixmapCount; ++page)
+            cache.insert(new AllocatedPixmap(&m_observer, page, 4 * 1024 * 1024));
+        // evict half of the cache while the viewport moves, as done by DocumentPrivate::cleanupPixmapMemory
+        for (int i = 0; i < pixmapCount / 2; ++i)
+            delete cache.takeFarthest(i, true);
+    }
+}
+
+QTEST_MAIN(AllocatedPixmapCacheTest)
+#include "allocatedpixmapcachetest.moc"
@@ -0,0 +1,136 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by the Okular developers                           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include <QRandomGenerator>
+#include <QTest>
+
+#include "../part/colortransforms.h"
+
+#include <functional>
+
+typedef std::function<void(QImage *, ColorTransforms::Implementation)> Transform;
+Q_DECLARE_METATYPE(Transform)
+
+class ColorTransformsTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testSameResult_data();
+    void testSameResult();
+    void benchmarkTransform_data();
+    void benchmarkTransform();
+
+private:
+    static void addTransforms();
+    static QImage randomImage(int width, int height);
+    static QImage pageImage(int width, int height);
+};
+
+void ColorTransformsTest::addTransforms()
+{
+    QTest::newRow("recolor") << Transform([](QImage *image, ColorTransforms::Implementation implementation) { ColorTransforms::recolor(image, QColor(20, 200, 60), QColor(30, 10, 80), implementation); });
+    QTest::newRow("blackWhite") << Transform([](QImage *image, ColorTransforms::Implementation implementation) { ColorTransforms::blackWhite(image, 4, 100, implementation); });
+    QTest::newRow("blackWhite no contrast") << Transform([](QImage *image, ColorTransforms::Implementation implementation) { ColorTransforms::blackWhite(image, 2, 0, implementation); });
+    QTest::newRow("invertLightness") << Transform([](QImage *image, ColorTransforms::Implementation implementation) { ColorTransforms::invertLightness(image, implementation); });
+    QTest::newRow("invertLuma") << Transform([](QImage *image, ColorTransforms::Implementation implementation) { ColorTransforms::invertLuma(image, 0.2126, 0.7152, 0.0722, implementation); });
+    QTest::newRow("invertLuma symmetric") << Transform([](QImage *image, ColorTransforms::Implementation implementation) { ColorTransforms::invertLuma(image, 0.3333, 0.3334, 0.3333, implementation); });
+    QTest::newRow("hueShiftPositive") << Transform([](QImage *image, ColorTransforms::Implementation implementation) { ColorTransforms::hueShiftPositive(image, implementation); });
+    QTest::newRow("hueShiftNegative") << Transform([](QImage *image, ColorTransforms::Implementation implementation) { ColorTransforms::hueShiftNegative(image, implementation); });
+}
+
+QImage ColorTransformsTest::randomImage(int width, int height)
+{
+    QImage image(width, height, QImage::Format_ARGB32_Premultiplied);
+    QRandomGenerator random(42);
+    QRgb *data = reinterpret_cast<QRgb *>(image.bits());
+    const int pixels = width * height;
+    for (int i = 0; i < pixels; ++i) {
+        // every gray level, then random colors
+        if (i < 256)
+            data[i] = qRgb(i, i, i);
+        else
+            data[i] = random.generate();
+    }
+    return image;
+}
+
+QImage ColorTransformsTest::pageImage(int width, int height)
+{
+    // mostly paper, with dark text and a few colored areas
+    QImage image(width, height, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::white);
+    QRandomGenerator random(42);
+    for (int y = 0; y < height; y += 3) {
+        QRgb *line = reinterpret_cast<QRgb *>(image.scanLine(y));
+        for (int x = 0; x < width; ++x) {
+            const quint32 value = random.bounded(100);
+            if (value < 20)
+                line[x] = qRgb(value, value, value);
+            else if (value < 22)
+                line[x] = qRgb(200, 30 + value, 40);
+        }
+    }
+    return image;
+}
+
+void ColorTransformsTest::testSameResult_data()
+{
+    QTest::addColumn<Transform>("transform");
+    addTransforms();
+}
+
+void ColorTransformsTest::testSameResult()
+{
+    QFETCH(Transform, transform);
+
+    // an odd size, so the pixels left over by the vectorized loops are tested too
+    const QImage image = randomImage(301, 217);
+
+    QImage reference = image;
+    transform(&reference, ColorTransforms::Reference);
+    QImage optimized = image;
+    transform(&optimized, ColorTransforms::Optimized);
+
+    QCOMPARE(optimized.format(), reference.format());
+    QCOMPARE(optimized, reference);
+}
+
+void ColorTransformsTest::benchmarkTransform_data()
+{
+    QTest::addColumn<Transform>("transform");
+    QTest::addColumn<bool>("optimized");
+
+    const QList<QPair<QByteArray, Transform>> transforms = {
+        {"recolor", [](QImage *image, ColorTransforms::Implementation implementation) { ColorTransforms::recolor(image, Qt::white, Qt::black, implementation); }},
+        {"blackWhite", [](QImage *image, ColorTransforms::Implementation implementation) { ColorTransforms::blackWhite(image, 4, 100, implementation); }},
+        {"invertLightness", [](QImage *image, ColorTransforms::Implementation implementation) { ColorTransforms::invertLightness(image, implementation); }},
+        {"invertLuma", [](QImage *image, ColorTransforms::Implementation implementation) { ColorTransforms::invertLuma(image, 0.2126, 0.7152, 0.0722, implementation); }},
+        {"hueShiftPositive", [](QImage *image, ColorTransforms::Implementation implementation) { ColorTransforms::hueShiftPositive(image, implementation); }},
+    };
+    for (const QPair<QByteArray, Transform> &transform : transforms) {
+        QTest::newRow((transform.first + " reference").constData()) << transform.second << false;
+        QTest::newRow((transform.first + " optimized").constData()) << transform.second << true;
+    }
+}
+
+void ColorTransformsTest::benchmarkTransform()
+{
+    QFETCH(Transform, transform);
+    QFETCH(bool, optimized);
+
+    // a page filling a 4K screen
+    QImage image = pageImage(2160, 3054);
+    QBENCHMARK {
+        transform(&image, optimized ? ColorTransforms::Optimized : ColorTransforms::Reference);
+    }
+}
+
+QTEST_MAIN(ColorTransformsTest)
+#include "colortransformstest.moc"
@@ -0,0 +1,211 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by the Okular developers                           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include <QPainter>
+#include <QPixmap>
+#include <QTest>
+
+#include "../core/compressedpixmapcache_p.h"
+#include "../core/observer.h"
+
+class CompressedPixmapCacheTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testRoundTrip_data();
+    void testRoundTrip();
+    void testSizeAndRotationMismatch();
+    void testBudget();
+    void testRemove();
+    void testStatistics();
+    void benchmarkEvictAndRestore();
+
+private:
+    static QImage pageImage(int width, int height, const QColor &ink)
+    {
+        QImage image(width, height, QImage::Format_ARGB32_Premultiplied);
+        image.fill(Qt::white);
+        QPainter painter(&image);
+        painter.setPen(Qt::NoPen);
+        for (int y = 10; y < height - 10; y += 12)
+            painter.fillRect(QRect(10, y, width - 20 - (y % 50), 6), ink);
+        return image;
+    }
+
+    Okular::DocumentObserver m_observer;
+};
+
+void CompressedPixmapCacheTest::testRoundTrip_data()
+{
+    QTest::addColumn<QColor>("ink");
+
+    QTest::newRow("black and white") << QColor(Qt::black);
+    QTest::newRow("grayscale") << QColor(128, 128, 128);
+    QTest::newRow("color") << QColor(Qt::red);
+}
+
+void CompressedPixmapCacheTest::testRoundTrip()
+{
+    QFETCH(QColor, ink);
+
+    const QImage image = pageImage(300, 400, ink);
+    Okular::CompressedPixmapCache cache;
+    cache.setMaxMemory(16 * 1024 * 1024);
+    QVERIFY(cache.insert(&m_observer, 3, QPixmap::fromImage(image), Okular::Rotation0));
+    QCOMPARE(cache.count(), 1);
+    cache.waitForCompressions();
+    QVERIFY(cache.totalMemory() > 0);
+    QVERIFY(cache.totalMemory() < cache.uncompressedMemory());
+
+    QVERIFY(cache.contains(&m_observer, 3, 300, 400, Okular::Rotation0));
+    QPixmap *pixmap = cache.take(&m_observer, 3, 300, 400, Okular::Rotation0);
+    QVERIFY(pixmap);
+    QCOMPARE(pixmap->toImage().convertToFormat(image.format()), image);
+    delete pixmap;
+
+    QCOMPARE(cache.hits(), quint64(1));
+    QCOMPARE(cache.count(), 0);
+    QCOMPARE(cache.totalMemory(), qulonglong(0));
+}
+
+void CompressedPixmapCacheTest::testSizeAndRotationMismatch()
+{
+    Okular::CompressedPixmapCache cache;
+    cache.setMaxMemory(16 * 1024 * 1024);
+    cache.insert(&m_observer, 0, QPixmap::fromImage(pageImage(100, 200, Qt::black)), Okular::Rotation90);
+
+    QVERIFY(!cache.contains(&m_observer, 0, 100, 200, Okular::Rotation0));
+    QVERIFY(!cache.contains(&m_observer, 0, 200, 400, Okular::Rotation90));
+    QVERIFY(!cache.contains(&m_observer, 1, 100, 200, Okular::Rotation90));
+    QVERIFY(cache.contains(&m_observer, 0, 100, 200, Okular::Rotation90));
+
+    // a stale pixmap is dropped when taken
+    QVERIFY(!cache.take(&m_observer, 0, 200, 400, Okular::Rotation90));
+    QCOMPARE(cache.count(), 0);
+    QCOMPARE(cache.hits(), quint64(0));
+
+    cache.recordMiss();
+    QCOMPARE(cache.misses(), quint64(1));
+}
+
+void CompressedPixmapCacheTest::testBudget()
+{
+    Okular::CompressedPixmapCache cache;
+    QVERIFY(!cache.insert(&m_observer, 0, QPixmap::fromImage(pageImage(100, 100, Qt::red)), Okular::Rotation0));
+
+    cache.setMaxMemory(1024 * 1024);
+    for (int page = 0; page < 50; ++page)
+        cache.insert(&m_observer, page, QPixmap::fromImage(pageImage(400, 400, QColor(page * 5, 0, 0))), Okular::Rotation0);
+    QVERIFY(cache.totalMemory() <= cache.maxMemory());
+    cache.waitForCompressions();
+    QVERIFY(cache.totalMemory() <= cache.maxMemory());
+    // the most recently stored page is kept
+    QVERIFY(cache.contains(&m_observer, 49, 400, 400, Okular::Rotation0));
+
+    const qulonglong before = cache.totalMemory();
+    cache.setMaxMemory(before / 2);
+    QVERIFY(cache.totalMemory() <= before / 2);
+    QVERIFY(cache.contains(&m_observer, 49, 400, 400, Okular::Rotation0));
+    QVERIFY(!cache.contains(&m_observer, 0, 400, 400, Okular::Rotation0));
+
+    cache.setMaxMemory(0);
+    QCOMPARE(cache.count(), 0);
+    QCOMPARE(cache.totalMemory(), qulonglong(0));
+    QCOMPARE(cache.uncompressedMemory(), qulonglong(0));
+}
+
+void CompressedPixmapCacheTest::testRemove()
+{
+    Okular::DocumentObserver otherObserver;
+    Okular::CompressedPixmapCache cache;
+    cache.setMaxMemory(16 * 1024 * 1024);
+    for (int page = 0; page < 4; ++page) {
+        cache.insert(&m_observer, page, QPixmap::fromImage(pageImage(64, 64, Qt::black)), Okular::Rotation0);
+        cache.insert(&otherObserver, page, QPixmap::fromImage(pageImage(64, 64, Qt::black)), Okular::Rotation0);
+    }
+    QCOMPARE(cache.count(), 8);
+
+    cache.removePage(2);
+    QCOMPARE(cache.count(), 6);
+    QVERIFY(!cache.contains(&otherObserver, 2, 64, 64, Okular::Rotation0));
+
+    cache.remove(&otherObserver);
+    QCOMPARE(cache.count(), 3);
+
+    cache.remove(&m_observer, 0);
+    QCOMPARE(cache.count(), 2);
+
+    cache.clear();
+    QCOMPARE(cache.count(), 0);
+    QCOMPARE(cache.totalMemory(), qulonglong(0));
+}
+
+void CompressedPixmapCacheTest::testStatistics()
+{
+    Okular::CompressedPixmapCache cache;
+    cache.setMaxMemory(16 * 1024 * 1024);
+
+    // render and evict 10 pages, as done by DocumentPrivate::sendGeneratorPixmapRequest and cleanupPixmapMemory
+    for (int page = 0; page < 10; ++page) {
+        cache.recordMiss();
+        QVERIFY(cache.insert(&m_observer, page, QPixmap::fromImage(pageImage(200, 300, Qt::black)), Okular::Rotation0));
+    }
+    // the first pages can be taken back even before their compression is done
+    QPixmap *pixmap = cache.take(&m_observer, 0, 200, 300, Okular::Rotation0);
+    QVERIFY(pixmap);
+    QCOMPARE(pixmap->toImage().convertToFormat(QImage::Format_ARGB32_Premultiplied), pageImage(200, 300, Qt::black));
+    delete pixmap;
+
+    cache.waitForCompressions();
+    QCOMPARE(cache.count(), 9);
+    QCOMPARE(cache.uncompressedMemory(), qulonglong(9 * 200 * 300 * 4));
+    // black and white pages are stored with one bit per pixel before being compressed
+    QVERIFY(cache.totalMemory() < cache.uncompressedMemory() / 32);
+
+    // visit them all again, and a page that was never evicted
+    for (int page = 1; page < 10; ++page) {
+        pixmap = cache.take(&m_observer, page, 200, 300, Okular::Rotation0);
+        QVERIFY(pixmap);
+        delete pixmap;
+    }
+    QVERIFY(!cache.take(&m_observer, 10, 200, 300, Okular::Rotation0));
+    cache.recordMiss();
+
+    QCOMPARE(cache.hits(), quint64(10));
+    QCOMPARE(cache.misses(), quint64(11));
+    QCOMPARE(cache.count(), 0);
+    QCOMPARE(cache.totalMemory(), qulonglong(0));
+    QCOMPARE(cache.uncompressedMemory(), qulonglong(0));
+}
+
+void CompressedPixmapCacheTest::benchmarkEvictAndRestore()
+{
+    // an A4 page at 150 dpi
+    const QPixmap pixmap = QPixmap::fromImage(pageImage(1240, 1754, QColor(64, 64, 64)));
+    Okular::CompressedPixmapCache cache;
+    cache.setMaxMemory(64 * 1024 * 1024);
+
+    quint64 restored = 0;
+    QBENCHMARK {
+        cache.insert(&m_observer, 0, pixmap, Okular::Rotation0);
+        cache.waitForCompressions();
+        QPixmap *restoredPixmap = cache.take(&m_observer, 0, 1240, 1754, Okular::Rotation0);
+        QVERIFY(restoredPixmap);
+        delete restoredPixmap;
+        ++restored;
+    }
+
+    QCOMPARE(cache.hits(), restored);
+    QCOMPARE(cache.misses(), quint64(0));
+    QCOMPARE(cache.totalMemory(), qulonglong(0));
+}
+
+QTEST_MAIN(CompressedPixmapCacheTest)
+#include "compressedpixmapcachetest.moc"
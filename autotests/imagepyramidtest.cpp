@@ -0,0 +1,134 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by the Okular developers                           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include <QPainter>
+#include <QTest>
+
+#include "../core/imagepyramid.h"
+
+class ImagePyramidTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testEmpty();
+    void testLevels();
+    void testScaledSize_data();
+    void testScaledSize();
+    void testTiles();
+    void testLargeImage();
+
+private:
+    // left half red, right half blue
+    static QImage twoColorImage(int width, int height)
+    {
+        QImage image(width, height, QImage::Format_RGB32);
+        image.fill(Qt::blue);
+        QPainter painter(&image);
+        painter.fillRect(0, 0, width / 2, height, Qt::red);
+        return image;
+    }
+};
+
+void ImagePyramidTest::testEmpty()
+{
+    Okular::ImagePyramid pyramid;
+    QCOMPARE(pyramid.levelCount(), 0);
+    QVERIFY(pyramid.image().isNull());
+    QVERIFY(pyramid.level(0).isNull());
+    QVERIFY(pyramid.scaled(QSize(10, 10)).isNull());
+
+    pyramid.setImage(twoColorImage(4, 4));
+    QVERIFY(pyramid.scaled(QSize(0, 10)).isNull());
+
+    pyramid.setImage(QImage());
+    QCOMPARE(pyramid.levelCount(), 0);
+}
+
+void ImagePyramidTest::testLevels()
+{
+    Okular::ImagePyramid pyramid;
+    pyramid.setImage(twoColorImage(100, 30));
+
+    // 100x30, 50x15, 25x7, 12x3, 6x1, 3x1, 1x1
+    QCOMPARE(pyramid.levelCount(), 7);
+    QCOMPARE(pyramid.level(0).size(), QSize(100, 30));
+    QCOMPARE(pyramid.level(1).size(), QSize(50, 15));
+    QCOMPARE(pyramid.level(4).size(), QSize(6, 1));
+    QCOMPARE(pyramid.level(6).size(), QSize(1, 1));
+    QVERIFY(pyramid.level(7).isNull());
+
+    const QImage level = pyramid.level(2);
+    QCOMPARE(level.pixel(1, 3), qRgb(255, 0, 0));
+    QCOMPARE(level.pixel(23, 3), qRgb(0, 0, 255));
+}
+
+void ImagePyramidTest::testScaledSize_data()
+{
+    QTest::addColumn<QSize>("size");
+
+    QTest::newRow("same size") << QSize(400, 200);
+    QTest::newRow("level size") << QSize(100, 50);
+    QTest::newRow("between levels") << QSize(70, 40);
+    QTest::newRow("thumbnail") << QSize(12, 6);
+    QTest::newRow("zoomed in") << QSize(1000, 500);
+    QTest::newRow("other aspect ratio") << QSize(30, 150);
+}
+
+void ImagePyramidTest::testScaledSize()
+{
+    QFETCH(QSize, size);
+
+    Okular::ImagePyramid pyramid;
+    pyramid.setImage(twoColorImage(400, 200));
+
+    const QImage scaled = pyramid.scaled(size);
+    QCOMPARE(scaled.size(), size);
+    QCOMPARE(scaled.pixel(0, size.height() / 2), qRgb(255, 0, 0));
+    QCOMPARE(scaled.pixel(size.width() - 1, size.height() / 2), qRgb(0, 0, 255));
+}
+
+void ImagePyramidTest::testTiles()
+{
+    Okular::ImagePyramid pyramid;
+    pyramid.setImage(twoColorImage(400, 200));
+
+    const QSize size(160, 80);
+    const QRect left(0, 0, 40, 80);
+    const QRect right(120, 20, 40, 40);
+
+    const QImage leftTile = pyramid.scaled(size, left);
+    QCOMPARE(leftTile.size(), left.size());
+    QCOMPARE(leftTile.pixel(20, 40), qRgb(255, 0, 0));
+
+    const QImage rightTile = pyramid.scaled(size, right);
+    QCOMPARE(rightTile.size(), right.size());
+    QCOMPARE(rightTile.pixel(20, 20), qRgb(0, 0, 255));
+
+    // at the size of a level, tiles are plain copies of it
+    const QRect rect(10, 5, 30, 20);
+    QCOMPARE(pyramid.scaled(QSize(100, 50), rect), pyramid.level(2).copy(rect));
+}
+
+void ImagePyramidTest::testLargeImage()
+{
+    Okular::ImagePyramid pyramid;
+    pyramid.setImage(twoColorImage(4096, 2048));
+
+    // thumbnails must not need to scale the whole image every time
+    QImage thumbnail;
+    QBENCHMARK {
+        thumbnail = pyramid.scaled(QSize(100, 100));
+    }
+    QCOMPARE(thumbnail.size(), QSize(100, 100));
+    QCOMPARE(thumbnail.pixel(10, 50), qRgb(255, 0, 0));
+}
+
+QTEST_MAIN(ImagePyramidTest)
+#include "imagepyramidtest.moc"
@@ -0,0 +1,202 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by the Okular developers                           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include <QTest>
+
+#include "../core/generator.h"
+#include "../core/observer.h"
+#include "../core/pixmaprequestqueue_p.h"
+
+class PixmapRequestQueueTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testPriorityOrder();
+    void testDistanceOrder();
+    void testTakeByPage();
+    void testTakeByObserver();
+    void testRemove();
+    void testSkipTop();
+    void benchmarkQueue10k();
+
+private:
+    static Okular::PixmapRequest *newRequest(Okular::DocumentObserver *observer, int page, int priority)
+    {
+        return new Okular::PixmapRequest(observer, page, 100, 100, priority, Okular::PixmapRequest::Asynchronous);
+    }
+
+    Okular::DocumentObserver m_observer;
+    Okular::DocumentObserver m_otherObserver;
+};
+
+void PixmapRequestQueueTest::testPriorityOrder()
+{
+    Okular::PixmapRequestQueue queue;
+    queue.setViewportPage(2);
+    queue.push(newRequest(&m_observer, 0, 4));
+    queue.push(newRequest(&m_observer, 3, 1));
+    queue.push(newRequest(&m_observer, 2, 2));
+    queue.push(newRequest(&m_observer, 1, 1));
+
+    QCOMPARE(queue.count(), 4);
+
+    // priority first; pages 3 and 1 have the same priority and distance: oldest first
+    const QList<int> expectedPages = {3, 1, 2, 0};
+    for (int expectedPage : expectedPages) {
+        Okular::PixmapRequest *request = queue.pop();
+        QVERIFY(request);
+        QCOMPARE(request->pageNumber(), expectedPage);
+        delete request;
+    }
+    QVERIFY(queue.isEmpty());
+    QVERIFY(!queue.pop());
+}
+
+void PixmapRequestQueueTest::testDistanceOrder()
+{
+    Okular::PixmapRequestQueue queue;
+    queue.setViewportPage(10);
+    for (int page = 0; page < 20; ++page)
+        queue.push(newRequest(&m_observer, page, 1));
+
+    QCOMPARE(queue.top()->pageNumber(), 10);
+
+    // moving the viewport reorders what is already queued
+    queue.setViewportPage(2);
+    QCOMPARE(queue.top()->pageNumber(), 2);
+
+    int lastDistance = 0;
+    while (!queue.isEmpty()) {
+        Okular::PixmapRequest *request = queue.pop();
+        const int distance = qAbs(request->pageNumber() - 2);
+        QVERIFY(distance >= lastDistance);
+        lastDistance = distance;
+        delete request;
+    }
+}
+
+void PixmapRequestQueueTest::testTakeByPage()
+{
+    Okular::PixmapRequestQueue queue;
+    for (int page = 0; page < 10; ++page) {
+        queue.push(newRequest(&m_observer, page, 1));
+        queue.push(newRequest(&m_otherObserver, page, 1));
+    }
+
+    QVERIFY(queue.contains(&m_observer, 5));
+    const QList<Okular::PixmapRequest *> taken = queue.take(&m_observer, 5);
+    QCOMPARE(taken.count(), 1);
+    QCOMPARE(taken.first()->pageNumber(), 5);
+    QVERIFY(!queue.contains(&m_observer, 5));
+    QVERIFY(queue.contains(&m_otherObserver, 5));
+    QCOMPARE(queue.count(), 19);
+    qDeleteAll(taken);
+    qDeleteAll(queue.takeAll());
+    QVERIFY(queue.isEmpty());
+}
+
+void PixmapRequestQueueTest::testTakeByObserver()
+{
+    Okular::PixmapRequestQueue queue;
+    for (int page = 0; page < 10; ++page) {
+        queue.push(newRequest(&m_observer, page, page % 3));
+        queue.push(newRequest(&m_otherObserver, page, page % 3));
+    }
+
+    const QList<Okular::PixmapRequest *> taken = queue.take(&m_observer);
+    QCOMPARE(taken.count(), 10);
+    qDeleteAll(taken);
+
+    int lastPriority = 0;
+    while (!queue.isEmpty()) {
+        Okular::PixmapRequest *request = queue.pop();
+        QCOMPARE(request->observer(), &m_otherObserver);
+        QVERIFY(request->priority() >= lastPriority);
+        lastPriority = request->priority();
+        delete request;
+    }
+}
+
+void PixmapRequestQueueTest::testRemove()
+{
+    Okular::PixmapRequestQueue queue;
+    QList<Okular::PixmapRequest *> requests;
+    for (int page = 0; page < 50; ++page) {
+        requests << newRequest(&m_observer, page, (page * 7) % 5);
+        queue.push(requests.last());
+    }
+
+    // remove every other request, the heap must stay consistent
+    for (int i = 0; i < requests.count(); i += 2) {
+        QVERIFY(queue.remove(requests.at(i)));
+        QVERIFY(!queue.remove(requests.at(i)));
+    }
+    QCOMPARE(queue.count(), 25);
+
+    int lastPriority = 0;
+    while (!queue.isEmpty()) {
+        Okular::PixmapRequest *request = queue.pop();
+        QVERIFY(request->pageNumber() % 2 == 1);
+        QVERIFY(request->priority() >= lastPriority);
+        lastPriority = request->priority();
+    }
+    qDeleteAll(requests);
+}
+
+void PixmapRequestQueueTest::testSkipTop()
+{
+    Okular::PixmapRequestQueue queue;
+    queue.setViewportPage(0);
+    for (int page = 0; page < 4; ++page)
+        queue.push(newRequest(&m_observer, page, 1));
+
+    // pages being generated are skipped while looking for one to send
+    queue.skipTop();
+    queue.skipTop();
+    QCOMPARE(queue.top()->pageNumber(), 2);
+    QCOMPARE(queue.count(), 2);
+    QVERIFY(queue.contains(&m_observer, 0));
+
+    // and keep their place once they are back
+    queue.restoreSkipped();
+    QCOMPARE(queue.count(), 4);
+    for (int page = 0; page < 4; ++page) {
+        Okular::PixmapRequest *request = queue.pop();
+        QCOMPARE(request->pageNumber(), page);
+        delete request;
+    }
+    QVERIFY(queue.isEmpty());
+}
+
+void PixmapRequestQueueTest::benchmarkQueue10k()
+{
+    const int requestCount = 10000;
+    QList<Okular::PixmapRequest *> requests;
+    requests.reserve(requestCount);
+    for (int page = 0; page < requestCount; ++page)
+        requests << newRequest(&m_observer, page, 1 + page % 4);
+
+    QBENCHMARK {
+        Okular::PixmapRequestQueue queue;
+        queue.setViewportPage(requestCount / 2);
+        for (Okular::PixmapRequest *request : qAsConst(requests))
+            queue.push(request);
+        // dedup lookups as done by Document::requestPixmaps
+        for (int page = 0; page < requestCount; page += 10)
+            queue.take(&m_observer, page);
+        while (!queue.isEmpty())
+            queue.pop();
+    }
+
+    qDeleteAll(requests);
+}
+
+QTEST_MAIN(PixmapRequestQueueTest)
+#include "pixmaprequestqueuetest.moc"
@@ -0,0 +1,154 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by the Okular developers                           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include <QAtomicInt>
+#include <QSet>
+#include <QTest>
+#include <QThread>
+
+#include "../core/printpipeline.h"
+
+class PrintPipelineTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testOrder_data();
+    void testOrder();
+    void testQueueDepth();
+    void testCancel();
+    void testEmpty();
+
+private:
+    static QImage pageImage(int pageNumber)
+    {
+        QImage image(1, 1, QImage::Format_RGB32);
+        image.setPixel(0, 0, pageNumber);
+        return image;
+    }
+};
+
+void PrintPipelineTest::testOrder_data()
+{
+    QTest::addColumn<int>("threads");
+    QTest::addColumn<int>("depth");
+
+    QTest::newRow("one thread") << 1 << 1;
+    QTest::newRow("four threads") << 4 << 8;
+    QTest::newRow("more threads than depth") << 8 << 2;
+}
+
+void PrintPipelineTest::testOrder()
+{
+    QFETCH(int, threads);
+    QFETCH(int, depth);
+
+    QList<int> pageNumbers;
+    for (int i = 40; i > 0; i -= 3)
+        pageNumbers << i;
+
+    // later pages are faster to render, so they are ready before the earlier ones
+    Okular::PrintPipeline pipeline([](int pageNumber) {
+        QThread::usleep(pageNumber * 50);
+        return pageImage(pageNumber);
+    });
+    pipeline.setThreadCount(threads);
+    pipeline.setQueueDepth(depth);
+    QCOMPARE(pipeline.threadCount(), threads);
+    QCOMPARE(pipeline.queueDepth(), depth);
+
+    QList<int> painted;
+    QList<int> images;
+    QSet<QThread *> threadsPainting;
+    const bool completed = pipeline.run(pageNumbers, [&](int pageNumber, const QImage &image) {
+        painted << pageNumber;
+        images << int(image.pixel(0, 0) & 0xffffff);
+        threadsPainting << QThread::currentThread();
+        return true;
+    });
+
+    QVERIFY(completed);
+    QCOMPARE(painted, pageNumbers);
+    QCOMPARE(images, pageNumbers);
+    QCOMPARE(threadsPainting, QSet<QThread *>() << QThread::currentThread());
+}
+
+void PrintPipelineTest::testQueueDepth()
+{
+    const int depth = 3;
+    QAtomicInt rendered;
+    int maxAhead = 0;
+
+    Okular::PrintPipeline pipeline([&rendered](int pageNumber) {
+        rendered.fetchAndAddOrdered(1);
+        return pageImage(pageNumber);
+    });
+    pipeline.setThreadCount(4);
+    pipeline.setQueueDepth(depth);
+
+    QList<int> pageNumbers;
+    for (int i = 1; i <= 50; ++i)
+        pageNumbers << i;
+
+    int painted = 0;
+    pipeline.run(pageNumbers, [&](int, const QImage &) {
+        // slow painting lets the renderers fill the queue
+        QThread::msleep(2);
+        ++painted;
+        maxAhead = qMax(maxAhead, rendered.loadAcquire() - painted);
+        return true;
+    });
+
+    QCOMPARE(painted, pageNumbers.count());
+    QCOMPARE(rendered.loadAcquire(), pageNumbers.count());
+    QVERIFY(maxAhead <= depth);
+}
+
+void PrintPipelineTest::testCancel()
+{
+    QAtomicInt rendered;
+
+    Okular::PrintPipeline pipeline([&rendered](int pageNumber) {
+        rendered.fetchAndAddOrdered(1);
+        return pageImage(pageNumber);
+    });
+    pipeline.setThreadCount(2);
+    pipeline.setQueueDepth(2);
+
+    QList<int> pageNumbers;
+    for (int i = 1; i <= 100; ++i)
+        pageNumbers << i;
+
+    QList<int> painted;
+    const bool completed = pipeline.run(pageNumbers, [&](int pageNumber, const QImage &) {
+        painted << pageNumber;
+        return pageNumber < 5;
+    });
+
+    QVERIFY(!completed);
+    QCOMPARE(painted, QList<int>() << 1 << 2 << 3 << 4 << 5);
+    // nothing beyond the queue was rendered
+    QVERIFY(rendered.loadAcquire() <= 5 + 2);
+}
+
+void PrintPipelineTest::testEmpty()
+{
+    Okular::PrintPipeline pipeline([](int pageNumber) { return pageImage(pageNumber); });
+    pipeline.setThreadCount(2);
+
+    bool called = false;
+    QVERIFY(pipeline.run(QList<int>(), [&called](int, const QImage &) {
+        called = true;
+        return true;
+    }));
+    QVERIFY(!called);
+}
+
+QTEST_MAIN(PrintPipelineTest)
+#include "printpipelinetest.moc"
@@ -0,0 +1,194 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by the Okular developers                           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include <QPainter>
+#include <QTest>
+
+#include "../part/scaledpixmapcache.h"
+
+class ScaledPixmapCacheTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testSameResult();
+    void testExactSize();
+    void testOtherSource();
+    void testPagesInTurn();
+    void testNonIntegerScale_data();
+    void testNonIntegerScale();
+    void benchmarkPaint_data();
+    void benchmarkPaint();
+
+private:
+    // every pixel a different color
+    static QPixmap patternPixmap(int width, int height)
+    {
+        QImage image(width, height, QImage::Format_RGB32);
+        for (int y = 0; y < height; ++y)
+            for (int x = 0; x < width; ++x)
+                image.setPixel(x, y, qRgb(x % 256, y % 256, (x / 256) * 16 + y / 256));
+        return QPixmap::fromImage(image);
+    }
+
+    // a page with some lines of text
+    static QPixmap pagePixmap(int width, int height)
+    {
+        QPixmap pixmap(width, height);
+        pixmap.fill(Qt::white);
+        QPainter painter(&pixmap);
+        for (int y = height / 10; y < height * 9 / 10; y += 20)
+            painter.fillRect(width / 10, y, width * 8 / 10, 10, Qt::black);
+        return pixmap;
+    }
+};
+
+void ScaledPixmapCacheTest::testSameResult()
+{
+    ScaledPixmapCache cache(64 * 1024);
+    const QPixmap source = patternPixmap(100, 150);
+    const QSize size(200, 300);
+    const QRect region(20, 40, 60, 80);
+    const QImage expected = source.scaled(size).copy(region).toImage();
+
+    // scaling only the region, then scaling and caching the whole page, then from the cache
+    for (int i = 0; i < 3; ++i) {
+        const QPixmap scaled = cache.scaledRegion(source, size, region);
+        QCOMPARE(scaled.size(), region.size());
+        QCOMPARE(scaled.toImage().convertToFormat(expected.format()), expected);
+    }
+
+    // other regions of the cached page
+    const QRect otherRegion(150, 0, 50, 300);
+    QCOMPARE(cache.scaledRegion(source, size, otherRegion).toImage().convertToFormat(expected.format()), source.scaled(size).copy(otherRegion).toImage());
+}
+
+void ScaledPixmapCacheTest::testExactSize()
+{
+    ScaledPixmapCache cache(64 * 1024);
+    const QPixmap source = patternPixmap(100, 150);
+    const QRect region(10, 20, 30, 40);
+    QCOMPARE(cache.scaledRegion(source, source.size(), region).toImage(), source.copy(region).toImage());
+}
+
+void ScaledPixmapCacheTest::testOtherSource()
+{
+    ScaledPixmapCache cache(64 * 1024);
+    const QSize size(200, 300);
+    const QRect region(0, 0, 200, 300);
+
+    QPixmap source(100, 150);
+    source.fill(Qt::red);
+    cache.scaledRegion(source, size, region);
+    QCOMPARE(cache.scaledRegion(source, size, region).toImage().pixel(100, 150), qRgb(255, 0, 0));
+
+    // a new pixmap of the page is not confused with the cached one
+    source.fill(Qt::blue);
+    QCOMPARE(cache.scaledRegion(source, size, region).toImage().pixel(100, 150), qRgb(0, 0, 255));
+}
+
+void ScaledPixmapCacheTest::testPagesInTurn()
+{
+    ScaledPixmapCache cache(64 * 1024);
+    const QSize size(200, 300);
+    const QRect region(0, 0, 200, 100);
+    QVector<QPixmap> pages;
+    for (int i = 0; i < 3; ++i)
+        pages << patternPixmap(100, 150);
+
+    // the visible pages are painted one after the other, then again when scrolling
+    for (const QPixmap &page : qAsConst(pages)) {
+        cache.scaledRegion(page, size, region);
+        QVERIFY(!cache.contains(page, size));
+    }
+    for (const QPixmap &page : qAsConst(pages)) {
+        cache.scaledRegion(page, size, region);
+        QVERIFY(cache.contains(page, size));
+    }
+}
+
+void ScaledPixmapCacheTest::testNonIntegerScale_data()
+{
+    QTest::addColumn<QSize>("size");
+
+    QTest::newRow("up") << QSize(173, 241);
+    QTest::newRow("up, uneven") << QSize(251, 163);
+    QTest::newRow("down") << QSize(67, 97);
+}
+
+void ScaledPixmapCacheTest::testNonIntegerScale()
+{
+    QFETCH(QSize, size);
+
+    const QPixmap source = patternPixmap(100, 150);
+    const QImage expected = source.scaled(size).toImage();
+
+    // cut the page at uneven boundaries as tiles and painted limits do,
+    // each region is scaled by itself by a cache which can not hold the page
+    ScaledPixmapCache regionCache(0);
+    ScaledPixmapCache pageCache(64 * 1024);
+    const QVector<int> xCuts {0, 1, size.width() / 3, size.width() / 3 + 1, size.width() * 2 / 3 + 1, size.width() - 1, size.width()};
+    const QVector<int> yCuts {0, 1, size.height() / 3, size.height() / 3 + 1, size.height() * 2 / 3 + 1, size.height() - 1, size.height()};
+    for (int i = 0; i + 1 < xCuts.size(); ++i) {
+        for (int j = 0; j + 1 < yCuts.size(); ++j) {
+            const QRect region(QPoint(xCuts[i], yCuts[j]), QPoint(xCuts[i + 1] - 1, yCuts[j + 1] - 1));
+            QCOMPARE(regionCache.scaledRegion(source, size, region).toImage().convertToFormat(expected.format()), expected.copy(region));
+            // scaled by itself, then from the whole page as scaled and cached by the second miss
+            QCOMPARE(pageCache.scaledRegion(source, size, region).toImage().convertToFormat(expected.format()), expected.copy(region));
+        }
+    }
+    QVERIFY(!regionCache.contains(source, size));
+    QVERIFY(pageCache.contains(source, size));
+
+    // a region across the cuts
+    const QRect region(size.width() / 3 - 2, size.height() / 3 - 2, size.width() / 3 + 5, size.height() / 3 + 5);
+    QCOMPARE(regionCache.scaledRegion(source, size, region).toImage().convertToFormat(expected.format()), expected.copy(region));
+}
+
+void ScaledPixmapCacheTest::benchmarkPaint_data()
+{
+    QTest::addColumn<int>("mode");
+
+    QTest::newRow("whole page scaled per paint") << 0;
+    QTest::newRow("cached") << 1;
+    QTest::newRow("new size per paint") << 2;
+}
+
+void ScaledPixmapCacheTest::benchmarkPaint()
+{
+    QFETCH(int, mode);
+
+    // a page rendered for a smaller zoom, painted on a 4K screen while the exact pixmap is generated
+    const QPixmap source = pagePixmap(1224, 1584);
+    const QSize size(2448, 3168);
+    const QRect visible(0, 800, 2160, 1200);
+    ScaledPixmapCache cache(64 * 1024);
+    QPixmap screen(visible.size());
+    QPainter painter(&screen);
+
+    int step = 0;
+    QBENCHMARK {
+        switch (mode) {
+        case 0:
+            painter.drawPixmap(0, 0, source.scaled(size).copy(visible));
+            break;
+        case 1:
+            painter.drawPixmap(0, 0, cache.scaledRegion(source, size, visible));
+            break;
+        case 2:
+            // as in a smooth zoom, no size is painted twice
+            ++step;
+            painter.drawPixmap(0, 0, cache.scaledRegion(source, size + QSize(step, 0), visible));
+            break;
+        }
+    }
+}
+
+QTEST_MAIN(ScaledPixmapCacheTest)
+#include "scaledpixmapcachetest.moc"
@@ -10,12 +10,14 @@
 // clazy:excludeall=qstring-allocations
 
 #include <QMimeDatabase>
+#include <QRegularExpression>
 #include <QSignalSpy>
 #include <QTest>
 
 #include "../core/document.h"
 #include "../core/page.h"
 #include "../core/textpage.h"
+#include "../core/textpage_p.h"
 #include "../settings_core.h"
 
 Q_DECLARE_METATYPE(Okular::Document::SearchStatus)
@@ -53,6 +55,12 @@ private slots:
     void testHyphenAtEndOfPage();
     void testOneColumn();
     void testTwoColumns();
+    void testFindAllText();
+    void testFindAllRegularExpression();
+    void testDenseTextMemory();
+    void benchmarkDenseTextPage();
+    void benchmarkDenseTextPageSearch();
+    void benchmarkDenseTextPageFindAll();
 };
 
 void SearchTest::initTestCase()
@@ -114,8 +122,8 @@ static void createTextPage(const QVector<QString> &text, const QVector<Okular::N
 // the next match is allowed to contain letters from the previous one: currently it is not
 //(as in the majority of browsers, viewers and editors), and therefore "abababa" is considered to
 // contain not three but two occurrences of "aba" (if one starts search from the beginning of the document).
-//   The fourth situation (document="a ba b", search string="a b") demonstrates the case when one TinyTextEntity
-// contains multiple characters that are contained in different matches (namely, the middle "ba" is one TinyTextEntity);
+//   The fourth situation (document="a ba b", search string="a b") demonstrates the case when one entity
+// contains multiple characters that are contained in different matches (namely, the middle "ba" is one entity);
 // in particular, since these matches are side-by-side, this test would detect some off-by-one
 // offset errors.
 
@@ -430,5 +438,156 @@ void SearchTest::testTwoColumns()
     delete page;
 }
 
+void SearchTest::testFindAllText()
+{
+    QVector<QString> text;
+    text << QStringLiteral("a") << QStringLiteral("B") << QStringLiteral("a") << QStringLiteral("b") << QStringLiteral("a") << QStringLiteral("B") << QStringLiteral("a");
+
+    QVector<Okular::NormalizedRect> rect;
+    for (int i = 0; i < text.size(); i++) {
+        rect << Okular::NormalizedRect(0.1 * i, 0.0, 0.1 * (i + 1), 0.1);
+    }
+
+    CREATE_PAGE;
+
+    // the matches do not overlap, as with NextResult
+    QVector<Okular::RegularAreaRect *> matches = tp->findAllText(QStringLiteral("aba"), Qt::CaseInsensitive);
+    QCOMPARE(matches.count(), 2);
+    Okular::RegularAreaRect expected;
+    expected.append(rect[0]);
+    expected.append(rect[1]);
+    expected.append(rect[2]);
+    expected.simplify();
+    QCOMPARE(*matches[0], expected);
+    qDeleteAll(matches);
+
+    matches = tp->findAllText(QStringLiteral("aba"), Qt::CaseSensitive);
+    QCOMPARE(matches.count(), 1);
+    qDeleteAll(matches);
+
+    matches = tp->findAllText(QStringLiteral("c"), Qt::CaseInsensitive);
+    QVERIFY(matches.isEmpty());
+
+    delete page;
+}
+
+void SearchTest::testFindAllRegularExpression()
+{
+    QVector<QString> text;
+    text << QStringLiteral("rev") << QStringLiteral("A12") << QStringLiteral("and") << QStringLiteral("rev") << QStringLiteral("B7") << QStringLiteral("reverse");
+
+    QVector<Okular::NormalizedRect> rect;
+    for (int i = 0; i < text.size(); i++) {
+        rect << Okular::NormalizedRect(0.15 * i, 0.0, 0.15 * i + 0.1, 0.1);
+    }
+
+    CREATE_PAGE;
+
+    // the layout analysis puts spaces between the words
+    QVector<Okular::RegularAreaRect *> matches = tp->findAllText(QRegularExpression(QStringLiteral("rev [A-Z]\\d+")));
+    QCOMPARE(matches.count(), 2);
+    QVERIFY(matches[1]->intersects(rect[3]));
+    QVERIFY(matches[1]->intersects(rect[4]));
+    QVERIFY(!matches[1]->intersects(rect[5]));
+    qDeleteAll(matches);
+
+    // whole words only
+    matches = tp->findAllText(QRegularExpression(QStringLiteral("\\brev\\b")));
+    QCOMPARE(matches.count(), 2);
+    qDeleteAll(matches);
+
+    // empty matches are skipped
+    matches = tp->findAllText(QRegularExpression(QStringLiteral("x*")));
+    QVERIFY(matches.isEmpty());
+
+    delete page;
+}
+
+// A page with 100 lines of 200 characters, as text-heavy documents have
+static void createDenseText(QVector<QString> &text, QVector<Okular::NormalizedRect> &rect)
+{
+    const QString sentence = QStringLiteral("Lorem ipsum dolor sit amet, consectetur adipiscing elit. ");
+
+    for (int line = 0; line < 100; ++line) {
+        for (int column = 0; column < 200; ++column) {
+            text << QString(sentence.at((line * 200 + column) % sentence.length()));
+            rect << Okular::NormalizedRect(column * 0.005, line * 0.01, (column + 1) * 0.005, line * 0.01 + 0.008);
+        }
+    }
+}
+
+void SearchTest::testDenseTextMemory()
+{
+    QVector<QString> text;
+    QVector<Okular::NormalizedRect> rect;
+    createDenseText(text, rect);
+
+    Okular::TextList list;
+    list.reserve(text.size());
+    for (int i = 0; i < text.size(); ++i)
+        list.append(text[i], rect[i]);
+    QCOMPARE(list.count(), text.size());
+
+    // a list slot, a NormalizedRect, the text pointer and the length per entity, heap overhead aside
+    const qint64 entityListBytes = qint64(text.size()) * (sizeof(void *) + sizeof(Okular::NormalizedRect) + sizeof(void *) + sizeof(int));
+    // four float coordinates, an offset and the character, with some room for the growth of the text buffer
+    QVERIFY(list.memoryUsage() <= qint64(text.size()) * 24);
+    QVERIFY(list.memoryUsage() < entityListBytes / 2);
+}
+
+void SearchTest::benchmarkDenseTextPage()
+{
+    QVector<QString> text;
+    QVector<Okular::NormalizedRect> rect;
+    createDenseText(text, rect);
+
+    QBENCHMARK {
+        CREATE_PAGE;
+        delete page;
+    }
+}
+
+void SearchTest::benchmarkDenseTextPageSearch()
+{
+    QVector<QString> text;
+    QVector<Okular::NormalizedRect> rect;
+    createDenseText(text, rect);
+
+    CREATE_PAGE;
+
+    int matches = 0;
+    QBENCHMARK {
+        matches = 0;
+        Okular::RegularAreaRect *result = tp->findText(0, QStringLiteral("dolor"), Okular::FromTop, Qt::CaseInsensitive, nullptr);
+        while (result) {
+            ++matches;
+            delete result;
+            result = tp->findText(0, QStringLiteral("dolor"), Okular::NextResult, Qt::CaseInsensitive, nullptr);
+        }
+    }
+    QVERIFY(matches > 0);
+
+    delete page;
+}
+
+void SearchTest::benchmarkDenseTextPageFindAll()
+{
+    QVector<QString> text;
+    QVector<Okular::NormalizedRect> rect;
+    createDenseText(text, rect);
+
+    CREATE_PAGE;
+
+    QVector<Okular::RegularAreaRect *> matches;
+    QBENCHMARK {
+        qDeleteAll(matches);
+        matches = tp->findAllText(QStringLiteral("dolor"), Qt::CaseInsensitive);
+    }
+    QVERIFY(!matches.isEmpty());
+    qDeleteAll(matches);
+
+    delete page;
+}
+
 QTEST_MAIN(SearchTest)
 #include "searchtest.moc"
@@ -0,0 +1,251 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by the Okular developers                           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+#include <QTest>
+
+#include "../core/textindex_p.h"
+#include "../core/thumbnailcache_p.h"
+
+class TextIndexTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testWords();
+    void testPagesMatching_data();
+    void testPagesMatching();
+    void testHyphenation();
+    void testReplacePage();
+    void testPageMatches();
+    void testText();
+    void testPersistence();
+    void testDocumentChanged();
+    void testCorruptFile_data();
+    void testCorruptFile();
+    void benchmarkPagesMatching();
+
+private:
+    static void writeFile(const QString &fileName, const QByteArray &contents)
+    {
+        QFile file(fileName);
+        QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+        file.write(contents);
+    }
+};
+
+void TextIndexTest::testWords()
+{
+    QCOMPARE(Okular::TextIndex::words(QStringLiteral("  Hello\nWORLD\tﬁne ")), QStringList({QStringLiteral("hello"), QStringLiteral("world"), QStringLiteral("fine")}));
+    QCOMPARE(Okular::TextIndex::words(QStringLiteral(" \n ")), QStringList());
+}
+
+void TextIndexTest::testPagesMatching_data()
+{
+    QTest::addColumn<QString>("query");
+    QTest::addColumn<QVector<int>>("pages");
+
+    QTest::newRow("word") << QStringLiteral("brown") << QVector<int> {0, 2};
+    QTest::newRow("inside a word") << QStringLiteral("row") << QVector<int> {0, 2};
+    QTest::newRow("case") << QStringLiteral("QUICK") << QVector<int> {0, 1};
+    QTest::newRow("phrase") << QStringLiteral("quick brown") << QVector<int> {0};
+    QTest::newRow("partial words") << QStringLiteral("ick brow") << QVector<int> {0};
+    QTest::newRow("three words") << QStringLiteral("quick brown fox") << QVector<int> {0};
+    QTest::newRow("not adjacent") << QStringLiteral("the fox") << QVector<int> {};
+    QTest::newRow("middle word partial") << QStringLiteral("quick row fox") << QVector<int> {};
+    QTest::newRow("missing") << QStringLiteral("zebra") << QVector<int> {};
+    QTest::newRow("spaces only") << QStringLiteral("  ") << QVector<int> {0, 1, 2};
+}
+
+void TextIndexTest::testPagesMatching()
+{
+    QFETCH(QString, query);
+    QFETCH(QVector<int>, pages);
+
+    Okular::TextIndex index;
+    index.addPage(2, QStringLiteral("a brown dog"));
+    index.addPage(0, QStringLiteral("The quick brown fox"));
+    index.addPage(1, QStringLiteral("quick\nsilver"));
+
+    QCOMPARE(index.pageCount(), 3);
+    QCOMPARE(index.pagesMatching(query), pages);
+}
+
+void TextIndexTest::testHyphenation()
+{
+    Okular::TextIndex index;
+    index.addPage(0, QStringLiteral("a hyphen-\nated word"));
+    index.addPage(1, QStringLiteral("well-known facts"));
+
+    // TextPage::findText() may skip the hyphen breaking a word
+    QCOMPARE(index.pagesMatching(QStringLiteral("hyphenated")), QVector<int> {0});
+    QCOMPARE(index.pagesMatching(QStringLiteral("hyphen-ated word")), QVector<int> {0});
+    QCOMPARE(index.pagesMatching(QStringLiteral("a hyphen")), QVector<int> {0});
+    QCOMPARE(index.pagesMatching(QStringLiteral("a hyphenated word")), QVector<int> {0});
+    QCOMPARE(index.pagesMatching(QStringLiteral("wellknown")), QVector<int> {1});
+    QCOMPARE(index.pagesMatching(QStringLiteral("well-known facts")), QVector<int> {1});
+}
+
+void TextIndexTest::testReplacePage()
+{
+    Okular::TextIndex index;
+    index.addPage(0, QStringLiteral("old text"));
+    QVERIFY(index.hasPage(0));
+    QVERIFY(!index.hasPage(1));
+
+    index.addPage(0, QStringLiteral("new text"));
+    QCOMPARE(index.pageCount(), 1);
+    QCOMPARE(index.pagesMatching(QStringLiteral("old")), QVector<int> {});
+    QCOMPARE(index.pagesMatching(QStringLiteral("new text")), QVector<int> {0});
+
+    index.clear();
+    QCOMPARE(index.pageCount(), 0);
+    QCOMPARE(index.wordCount(), 0);
+    QVERIFY(!index.hasPage(0));
+}
+
+void TextIndexTest::testPageMatches()
+{
+    Okular::TextIndex index;
+    index.addPage(0, QStringLiteral("lorem ipsum dolor"));
+
+    QVERIFY(index.pageMatches(0, QStringLiteral("IPSUM")));
+    QVERIFY(index.pageMatches(0, QStringLiteral("rem ipsum do")));
+    QVERIFY(!index.pageMatches(0, QStringLiteral("lorem dolor")));
+    // pages not indexed match nothing
+    QVERIFY(!index.pageMatches(1, QStringLiteral("lorem")));
+}
+
+void TextIndexTest::testText()
+{
+    Okular::TextIndex index;
+    index.addPage(3, QStringLiteral("Some Text\non two lines"));
+    QCOMPARE(index.text(3), QStringLiteral("Some Text\non two lines"));
+    QCOMPARE(index.text(0), QString());
+}
+
+void TextIndexTest::testPersistence()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString documentFileName = dir.filePath(QStringLiteral("document.pdf"));
+    const QString indexFileName = dir.filePath(QStringLiteral("123.document.pdf.textindex"));
+    writeFile(documentFileName, "contents");
+
+    {
+        Okular::TextIndex index;
+        QVERIFY(index.open(indexFileName, documentFileName, 10));
+        QCOMPARE(index.pageCount(), 0);
+        index.addPage(0, QStringLiteral("first page"));
+        index.addPage(7, QStringLiteral("a hyphen-\nated word"));
+        QVERIFY(index.save());
+    }
+    QVERIFY(QFile::exists(indexFileName));
+
+    Okular::TextIndex index;
+    QVERIFY(index.open(indexFileName, documentFileName, 10));
+    QCOMPARE(index.pageCount(), 2);
+    QCOMPARE(index.text(0), QStringLiteral("first page"));
+    QCOMPARE(index.pagesMatching(QStringLiteral("page")), QVector<int> {0});
+    QCOMPARE(index.pagesMatching(QStringLiteral("a hyphenated word")), QVector<int> {7});
+
+    // new pages are added to the ones already stored
+    index.addPage(1, QStringLiteral("second page"));
+    QVERIFY(index.save());
+    QVERIFY(index.open(indexFileName, documentFileName, 10));
+    QCOMPARE(index.pagesMatching(QStringLiteral("page")), QVector<int> ({0, 1}));
+
+    // indexes of documents with less pages are not used
+    QVERIFY(index.open(indexFileName, documentFileName, 5));
+    QCOMPARE(index.pageCount(), 0);
+}
+
+void TextIndexTest::testDocumentChanged()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString documentFileName = dir.filePath(QStringLiteral("document.pdf"));
+    const QString indexFileName = dir.filePath(QStringLiteral("123.document.pdf.textindex"));
+    writeFile(documentFileName, "first version");
+
+    {
+        Okular::TextIndex index;
+        QVERIFY(index.open(indexFileName, documentFileName, 1));
+        index.addPage(0, QStringLiteral("old text"));
+        QVERIFY(index.save());
+    }
+
+    writeFile(documentFileName, "second version");
+
+    Okular::TextIndex index;
+    QVERIFY(index.open(indexFileName, documentFileName, 1));
+    QCOMPARE(index.pageCount(), 0);
+    QVERIFY(index.save());
+    // the stale index is removed
+    QVERIFY(!QFile::exists(indexFileName));
+}
+
+void TextIndexTest::testCorruptFile_data()
+{
+    QTest::addColumn<quint32>("words");
+    QTest::addColumn<qint32>("occurrences");
+
+    QTest::newRow("huge word count") << quint32(0xfffffff0) << qint32(1);
+    QTest::newRow("huge occurrence count") << quint32(1) << qint32(0x7fffffff);
+}
+
+void TextIndexTest::testCorruptFile()
+{
+    QFETCH(quint32, words);
+    QFETCH(qint32, occurrences);
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString documentFileName = dir.filePath(QStringLiteral("document.pdf"));
+    const QString indexFileName = dir.filePath(QStringLiteral("123.document.pdf.textindex"));
+    writeFile(documentFileName, "contents");
+
+    // an index of the right document, with counts that do not fit in the file
+    QFile file(indexFileName);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_12);
+    stream << quint32(0x4f4b5449) << quint32(1) << QFileInfo(documentFileName).lastModified().toMSecsSinceEpoch() << Okular::ThumbnailCache::documentHash(documentFileName);
+    stream << words << QStringLiteral("word") << qint32(1) << qint32(0) << occurrences << quint32(0) << quint32(0);
+    file.close();
+
+    // it is not used, and nothing huge is allocated for it
+    Okular::TextIndex index;
+    QVERIFY(index.open(indexFileName, documentFileName, 1));
+    QCOMPARE(index.pageCount(), 0);
+}
+
+void TextIndexTest::benchmarkPagesMatching()
+{
+    const QStringList vocabulary = {QStringLiteral("alpha"), QStringLiteral("beta"), QStringLiteral("gamma"), QStringLiteral("delta"), QStringLiteral("epsilon"), QStringLiteral("zeta"), QStringLiteral("theta")};
+
+    Okular::TextIndex index;
+    for (int page = 0; page < 2000; ++page) {
+        QStringList words;
+        for (int i = 0; i < 400; ++i)
+            words.append(vocabulary.at((page * 7 + i * i) % vocabulary.count()) + QString::number(i % 50));
+        index.addPage(page, words.join(QLatin1Char(' ')));
+    }
+
+    QBENCHMARK {
+        index.pagesMatching(QStringLiteral("gamma1 delta"));
+    }
+}
+
+QTEST_MAIN(TextIndexTest)
+#include "textindextest.moc"
@@ -0,0 +1,200 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by the Okular developers                           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+#include <QTest>
+
+#include "../core/thumbnailcache_p.h"
+
+class ThumbnailCacheTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void testPersistence();
+    void testDocumentChanged();
+    void testRemove();
+    void testRenderSettingsChanged();
+    void testCorruptFile_data();
+    void testCorruptFile();
+    void testCacheable();
+
+private:
+    void writeDocument(const QByteArray &contents);
+    static QImage thumbnail(int width, int height, QRgb color)
+    {
+        QImage image(width, height, QImage::Format_ARGB32_Premultiplied);
+        image.fill(color);
+        return image;
+    }
+
+    QTemporaryDir m_dir;
+    QString m_documentFileName;
+    QString m_cacheFileName;
+    const QByteArray m_renderSettings = QByteArrayLiteral("antialiased");
+};
+
+void ThumbnailCacheTest::init()
+{
+    QVERIFY(m_dir.isValid());
+    m_documentFileName = m_dir.filePath(QStringLiteral("document.pdf"));
+    m_cacheFileName = m_dir.filePath(QStringLiteral("123.document.pdf.thumbnails"));
+    QFile::remove(m_cacheFileName);
+    writeDocument("first version");
+}
+
+void ThumbnailCacheTest::writeDocument(const QByteArray &contents)
+{
+    QFile file(m_documentFileName);
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    file.write(contents);
+}
+
+void ThumbnailCacheTest::testPersistence()
+{
+    const QImage first = thumbnail(120, 160, qRgb(255, 255, 255));
+    const QImage second = thumbnail(120, 160, qRgb(10, 100, 200));
+
+    {
+        Okular::ThumbnailCache cache;
+        QVERIFY(cache.open(m_cacheFileName, m_documentFileName, m_renderSettings));
+        QCOMPARE(cache.count(), 0);
+        cache.insert(0, first, Okular::Rotation0);
+        cache.insert(7, second, Okular::Rotation90);
+        QCOMPARE(cache.count(), 2);
+        cache.close();
+    }
+    QVERIFY(QFile::exists(m_cacheFileName));
+
+    Okular::ThumbnailCache cache;
+    QVERIFY(cache.open(m_cacheFileName, m_documentFileName, m_renderSettings));
+    QCOMPARE(cache.count(), 2);
+    QVERIFY(cache.contains(0, 120, 160, Okular::Rotation0));
+    QVERIFY(!cache.contains(0, 120, 160, Okular::Rotation90));
+    QVERIFY(!cache.contains(0, 60, 80, Okular::Rotation0));
+    QCOMPARE(cache.image(0, 120, 160, Okular::Rotation0), first);
+    QCOMPARE(cache.image(7, 120, 160, Okular::Rotation90), second);
+
+    // new pixmaps are added to the ones already on disk
+    cache.insert(3, first, Okular::Rotation0);
+    cache.close();
+    QVERIFY(cache.open(m_cacheFileName, m_documentFileName, m_renderSettings));
+    QCOMPARE(cache.count(), 3);
+    QCOMPARE(cache.image(7, 120, 160, Okular::Rotation90), second);
+}
+
+void ThumbnailCacheTest::testDocumentChanged()
+{
+    {
+        Okular::ThumbnailCache cache;
+        QVERIFY(cache.open(m_cacheFileName, m_documentFileName, m_renderSettings));
+        cache.insert(0, thumbnail(50, 50, qRgb(0, 0, 0)), Okular::Rotation0);
+    }
+
+    writeDocument("second version");
+
+    Okular::ThumbnailCache cache;
+    QVERIFY(cache.open(m_cacheFileName, m_documentFileName, m_renderSettings));
+    QCOMPARE(cache.count(), 0);
+    cache.close();
+    // the stale cache is removed
+    QVERIFY(!QFile::exists(m_cacheFileName));
+}
+
+void ThumbnailCacheTest::testRemove()
+{
+    Okular::ThumbnailCache cache;
+    QVERIFY(cache.open(m_cacheFileName, m_documentFileName, m_renderSettings));
+    cache.insert(0, thumbnail(50, 50, qRgb(0, 0, 0)), Okular::Rotation0);
+    cache.insert(1, thumbnail(50, 50, qRgb(0, 0, 0)), Okular::Rotation0);
+    cache.close();
+
+    QVERIFY(cache.open(m_cacheFileName, m_documentFileName, m_renderSettings));
+    cache.remove(1);
+    QCOMPARE(cache.count(), 1);
+    cache.close();
+
+    QVERIFY(cache.open(m_cacheFileName, m_documentFileName, m_renderSettings));
+    QVERIFY(cache.contains(0, 50, 50, Okular::Rotation0));
+    QVERIFY(!cache.contains(1, 50, 50, Okular::Rotation0));
+}
+
+void ThumbnailCacheTest::testRenderSettingsChanged()
+{
+    {
+        Okular::ThumbnailCache cache;
+        QVERIFY(cache.open(m_cacheFileName, m_documentFileName, m_renderSettings));
+        cache.insert(0, thumbnail(50, 50, qRgb(0, 0, 0)), Okular::Rotation0);
+    }
+
+    // pixmaps stored in a session with other settings are not used
+    Okular::ThumbnailCache cache;
+    QVERIFY(cache.open(m_cacheFileName, m_documentFileName, QByteArrayLiteral("aliased")));
+    QCOMPARE(cache.count(), 0);
+
+    // nor the ones of this session once the settings change
+    cache.insert(0, thumbnail(50, 50, qRgb(0, 0, 0)), Okular::Rotation0);
+    cache.setRenderSettings(QByteArrayLiteral("aliased"));
+    QCOMPARE(cache.count(), 1);
+    cache.setRenderSettings(m_renderSettings);
+    QCOMPARE(cache.count(), 0);
+}
+
+void ThumbnailCacheTest::testCorruptFile_data()
+{
+    QTest::addColumn<qint32>("count");
+    QTest::addColumn<qint32>("width");
+    QTest::addColumn<qint32>("format");
+
+    QTest::newRow("huge count") << qint32(0x7fffffff) << qint32(50) << qint32(QImage::Format_Grayscale8);
+    QTest::newRow("huge pixmap") << qint32(1) << qint32(0x7fffffff) << qint32(QImage::Format_Grayscale8);
+    QTest::newRow("invalid format") << qint32(1) << qint32(50) << qint32(0x7fff);
+    QTest::newRow("indexed format") << qint32(1) << qint32(50) << qint32(QImage::Format_Indexed8);
+}
+
+void ThumbnailCacheTest::testCorruptFile()
+{
+    QFETCH(qint32, count);
+    QFETCH(qint32, width);
+    QFETCH(qint32, format);
+
+    // a file for the right document and settings, with a corrupt index
+    QFile file(m_cacheFileName);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_12);
+    stream << quint32(0x4f4b5448) << quint32(2) << QFileInfo(m_documentFileName).lastModified().toMSecsSinceEpoch() << Okular::ThumbnailCache::documentHash(m_documentFileName) << m_renderSettings << count;
+    stream << qint32(0) << width << qint32(50) << qint32(Okular::Rotation0) << format << format << qint32(4);
+    stream.writeRawData("data", 4);
+    file.close();
+
+    Okular::ThumbnailCache cache;
+    QVERIFY(cache.open(m_cacheFileName, m_documentFileName, m_renderSettings));
+    QCOMPARE(cache.count(), 0);
+}
+
+void ThumbnailCacheTest::testCacheable()
+{
+    QVERIFY(Okular::ThumbnailCache::isCacheable(200, 280));
+    QVERIFY(!Okular::ThumbnailCache::isCacheable(2000, 2800));
+    QVERIFY(!Okular::ThumbnailCache::isCacheable(0, 100));
+
+    // closed caches do not store anything
+    Okular::ThumbnailCache cache;
+    cache.insert(0, thumbnail(50, 50, qRgb(0, 0, 0)), Okular::Rotation0);
+    QCOMPARE(cache.count(), 0);
+}
+
+QTEST_MAIN(ThumbnailCacheTest)
+#include "thumbnailcachetest.moc"
@@ -0,0 +1,145 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by the Okular developers                           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include "allocatedpixmapcache_p.h"
+
+#include "observer.h"
+
+using namespace Okular;
+
+AllocatedPixmapCache::AllocatedPixmapCache()
+    : m_count(0)
+    , m_totalMemory(0)
+{
+}
+
+AllocatedPixmapCache::~AllocatedPixmapCache()
+{
+    clear();
+}
+
+bool AllocatedPixmapCache::isEmpty() const
+{
+    return m_count == 0;
+}
+
+int AllocatedPixmapCache::count() const
+{
+    return m_count;
+}
+
+qulonglong AllocatedPixmapCache::totalMemory() const
+{
+    return m_totalMemory;
+}
+
+void AllocatedPixmapCache::insert(AllocatedPixmap *pixmap)
+{
+    delete take(pixmap->observer, pixmap->page);
+
+    m_pixmaps[pixmap->observer].insert(pixmap->page, pixmap);
+    ++m_count;
+    m_totalMemory += pixmap->memory;
+}
+
+AllocatedPixmap *AllocatedPixmapCache::find(DocumentObserver *observer, int page) const
+{
+    const QHash<DocumentObserver *, PageMap>::const_iterator it = m_pixmaps.constFind(observer);
+    if (it == m_pixmaps.constEnd())
+        return nullptr;
+
+    return it->value(page, nullptr);
+}
+
+AllocatedPixmap *AllocatedPixmapCache::take(DocumentObserver *observer, int page)
+{
+    const QHash<DocumentObserver *, PageMap>::iterator it = m_pixmaps.find(observer);
+    if (it == m_pixmaps.end())
+        return nullptr;
+
+    AllocatedPixmap *pixmap = it->take(page);
+    if (!pixmap)
+        return nullptr;
+
+    if (it->isEmpty())
+        m_pixmaps.erase(it);
+
+    --m_count;
+    // can't underflow, the memory of each pixmap is added on insert and removed only once
+    m_totalMemory -= pixmap->memory;
+    return pixmap;
+}
+
+AllocatedPixmap *AllocatedPixmapCache::farthest(int viewportPage, bool unloadableOnly, DocumentObserver *observer) const
+{
+    if (observer) {
+        const QHash<DocumentObserver *, PageMap>::const_iterator it = m_pixmaps.constFind(observer);
+        return it == m_pixmaps.constEnd() ? nullptr : farthestIn(*it, viewportPage, unloadableOnly);
+    }
+
+    AllocatedPixmap *farthestPixmap = nullptr;
+    int maxDistance = -1;
+    for (const PageMap &pages : m_pixmaps) {
+        AllocatedPixmap *p = farthestIn(pages, viewportPage, unloadableOnly);
+        if (p && maxDistance < qAbs(p->page - viewportPage)) {
+            maxDistance = qAbs(p->page - viewportPage);
+            farthestPixmap = p;
+        }
+    }
+    return farthestPixmap;
+}
+
+AllocatedPixmap *AllocatedPixmapCache::takeFarthest(int viewportPage, bool unloadableOnly, DocumentObserver *observer)
+{
+    const AllocatedPixmap *p = farthest(viewportPage, unloadableOnly, observer);
+    return p ? take(p->observer, p->page) : nullptr;
+}
+
+QList<AllocatedPixmap *> AllocatedPixmapCache::takeAll(DocumentObserver *observer)
+{
+    const PageMap pages = m_pixmaps.take(observer);
+    for (const AllocatedPixmap *p : pages)
+        m_totalMemory -= p->memory;
+    m_count -= pages.count();
+    return pages.values();
+}
+
+void AllocatedPixmapCache::clear()
+{
+    for (const PageMap &pages : qAsConst(m_pixmaps))
+        qDeleteAll(pages);
+    m_pixmaps.clear();
+    m_count = 0;
+    m_totalMemory = 0;
+}
+
+AllocatedPixmap *AllocatedPixmapCache::farthestIn(const PageMap &pages, int viewportPage, bool unloadableOnly)
+{
+    if (pages.isEmpty())
+        return nullptr;
+
+    // distances decrease walking from either end towards the viewport page,
+    // so merging both ends visits the pixmaps farthest first
+    PageMap::const_iterator low = pages.constBegin();
+    PageMap::const_iterator high = pages.constEnd();
+    --high;
+    for (int remaining = pages.count(); remaining > 0; --remaining) {
+        const bool fromLow = qAbs(low.key() - viewportPage) >= qAbs(high.key() - viewportPage);
+        AllocatedPixmap *p = fromLow ? low.value() : high.value();
+        if (!unloadableOnly || p->observer->canUnloadPixmap(p->page))
+            return p;
+        if (fromLow)
+            ++low;
+        else
+            --high;
+    }
+    return nullptr;
+}
+
+/* kate: replace-tabs on; indent-width 4; */
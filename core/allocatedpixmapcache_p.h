@@ -0,0 +1,124 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by the Okular developers                           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef _OKULAR_ALLOCATEDPIXMAPCACHE_P_H_
+#define _OKULAR_ALLOCATEDPIXMAPCACHE_P_H_
+
+#include <QHash>
+#include <QList>
+#include <QMap>
+
+#include "okularcore_export.h"
+
+namespace Okular
+{
+class DocumentObserver;
+}
+
+struct AllocatedPixmap {
+    // owner of the page
+    Okular::DocumentObserver *observer;
+    int page;
+    qulonglong memory;
+    // public constructor: initialize data
+    AllocatedPixmap(Okular::DocumentObserver *o, int p, qulonglong m)
+        : observer(o)
+        , page(p)
+        , memory(m)
+    {
+    }
+};
+
+namespace Okular
+{
+/**
+ * The pixmaps a Document keeps in memory, together with the memory they use.
+ *
+ * Pixmaps are indexed by observer and, for each observer, ordered by page
+ * number. Since eviction picks the pixmap farthest from the viewport page,
+ * the candidates of each observer are always at one of the two ends of its
+ * page order, so selecting a victim is O(log n) per observer and moving the
+ * viewport needs no re-keying at all.
+ *
+ * Pixmaps the observer does not allow to unload are skipped walking from the
+ * ends inwards, in decreasing distance order.
+ *
+ * The cache owns the AllocatedPixmap descriptors it contains; the ones taken
+ * out of it must be deleted by the caller.
+ */
+class OKULARCORE_EXPORT AllocatedPixmapCache
+{
+public:
+    AllocatedPixmapCache();
+    ~AllocatedPixmapCache();
+
+    bool isEmpty() const;
+    int count() const;
+
+    /**
+     * Sum of the memory of all the pixmaps in the cache.
+     */
+    qulonglong totalMemory() const;
+
+    /**
+     * Adds @p pixmap to the cache. If there already is a pixmap for the same
+     * page and observer it is replaced and deleted.
+     */
+    void insert(AllocatedPixmap *pixmap);
+
+    /**
+     * Returns the pixmap for @p page of @p observer, or nullptr.
+     */
+    AllocatedPixmap *find(DocumentObserver *observer, int page) const;
+
+    /**
+     * Removes from the cache and returns the pixmap for @p page of @p observer, or nullptr.
+     */
+    AllocatedPixmap *take(DocumentObserver *observer, int page);
+
+    /**
+     * Returns the pixmap farthest from @p viewportPage, or nullptr if there is none.
+     *
+     * If @p unloadableOnly is set only pixmaps whose observer allows to unload
+     * them are considered. If @p observer is set only its pixmaps are considered.
+     */
+    AllocatedPixmap *farthest(int viewportPage, bool unloadableOnly = false, DocumentObserver *observer = nullptr /* any */) const;
+
+    /**
+     * Like farthest(), but the pixmap is also removed from the cache.
+     */
+    AllocatedPixmap *takeFarthest(int viewportPage, bool unloadableOnly = false, DocumentObserver *observer = nullptr /* any */);
+
+    /**
+     * Removes from the cache and returns all the pixmaps of @p observer.
+     */
+    QList<AllocatedPixmap *> takeAll(DocumentObserver *observer);
+
+    /**
+     * Deletes all the pixmaps in the cache.
+     */
+    void clear();
+
+private:
+    typedef QMap<int, AllocatedPixmap *> PageMap;
+
+    static AllocatedPixmap *farthestIn(const PageMap &pages, int viewportPage, bool unloadableOnly);
+
+    QHash<DocumentObserver *, PageMap> m_pixmaps;
+    int m_count;
+    qulonglong m_totalMemory;
+
+    Q_DISABLE_COPY(AllocatedPixmapCache)
+};
+
+}
+
+#endif
+
+/* kate: replace-tabs on; indent-width 4; */
@@ -0,0 +1,355 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by the Okular developers                           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include "compressedpixmapcache_p.h"
+
+#include <QPixmap>
+
+#include <threadweaver/job.h>
+
+#include <cstring>
+
+using namespace Okular;
+
+// fast zlib level, evicted pages have to be compressed before they are needed again
+static const int compressionLevel = 1;
+
+// Returns @p image in the smallest format that holds its pixels without losses
+static QImage reducedImage(const QImage &image)
+{
+    const QImage::Format format = image.format();
+    if (format != QImage::Format_RGB32 && format != QImage::Format_ARGB32 && format != QImage::Format_ARGB32_Premultiplied)
+        return image;
+
+    const QRgb alphaMask = format == QImage::Format_RGB32 ? 0xff000000 : 0;
+    const int width = image.width();
+    const int height = image.height();
+
+    bool gray = true;
+    bool blackAndWhite = true;
+    for (int y = 0; y < height && gray; ++y) {
+        const QRgb *line = reinterpret_cast<const QRgb *>(image.constScanLine(y));
+        for (int x = 0; x < width; ++x) {
+            const QRgb rgb = line[x] | alphaMask;
+            const int value = qRed(rgb);
+            if (qAlpha(rgb) != 255 || qGreen(rgb) != value || qBlue(rgb) != value) {
+                gray = false;
+                break;
+            }
+            if (value != 0 && value != 255)
+                blackAndWhite = false;
+        }
+    }
+
+    if (!gray)
+        return image;
+
+    if (blackAndWhite) {
+        QImage mono(width, height, QImage::Format_Mono);
+        mono.setColorTable({qRgb(0, 0, 0), qRgb(255, 255, 255)});
+        mono.fill(0);
+        for (int y = 0; y < height; ++y) {
+            const QRgb *line = reinterpret_cast<const QRgb *>(image.constScanLine(y));
+            uchar *bits = mono.scanLine(y);
+            for (int x = 0; x < width; ++x) {
+                if (qRed(line[x]))
+                    bits[x >> 3] |= 0x80 >> (x & 7);
+            }
+        }
+        return mono;
+    }
+
+    QImage grayscale(width, height, QImage::Format_Grayscale8);
+    for (int y = 0; y < height; ++y) {
+        const QRgb *line = reinterpret_cast<const QRgb *>(image.constScanLine(y));
+        uchar *bits = grayscale.scanLine(y);
+        for (int x = 0; x < width; ++x)
+            bits[x] = qRed(line[x]);
+    }
+    return grayscale;
+}
+
+class CompressedPixmapCache::CompressionJob : public ThreadWeaver::Job
+{
+public:
+    CompressionJob(const QImage &image, const QSharedPointer<Compression> &compression)
+        : m_image(image)
+        , m_compression(compression)
+    {
+    }
+
+    void run(ThreadWeaver::JobPointer self, ThreadWeaver::Thread *thread) override
+    {
+        Q_UNUSED(self);
+        Q_UNUSED(thread);
+
+        m_compression->data = compressImage(m_image, &m_compression->format);
+        m_compression->done.storeRelease(1);
+    }
+
+private:
+    const QImage m_image;
+    const QSharedPointer<Compression> m_compression;
+};
+
+CompressedPixmapCache::CompressedPixmapCache()
+    : m_maxMemory(0)
+    , m_totalMemory(0)
+    , m_uncompressedMemory(0)
+    , m_hits(0)
+    , m_misses(0)
+{
+    // one thread keeps up with the evictions, more would only hold more images
+    m_weaver.setMaximumNumberOfThreads(1);
+}
+
+CompressedPixmapCache::~CompressedPixmapCache()
+{
+    // the jobs only hold data of their own, the ones not started are not needed
+    m_weaver.dequeue();
+    m_weaver.finish();
+}
+
+void CompressedPixmapCache::setMaxMemory(qulonglong bytes)
+{
+    m_maxMemory = bytes;
+    collectCompressions();
+    trim(m_maxMemory);
+}
+
+qulonglong CompressedPixmapCache::maxMemory() const
+{
+    return m_maxMemory;
+}
+
+bool CompressedPixmapCache::insert(DocumentObserver *observer, int page, const QPixmap &pixmap, Rotation rotation)
+{
+    remove(observer, page);
+    collectCompressions();
+
+    if (m_maxMemory == 0 || pixmap.isNull())
+        return false;
+
+    // QPixmap can only be used from the GUI thread, the compression thread gets an image
+    Entry entry;
+    entry.image = pixmap.toImage();
+    entry.compression = QSharedPointer<Compression>::create();
+    entry.format = entry.image.format();
+    entry.originalFormat = entry.image.format();
+    entry.width = entry.image.width();
+    entry.height = entry.image.height();
+    entry.devicePixelRatio = pixmap.devicePixelRatio();
+    entry.rotation = rotation;
+    entry.uncompressedSize = entry.image.sizeInBytes();
+    entry.memory = entry.uncompressedSize;
+
+    // the size that counts is the compressed one, checked once it is known
+    trim(m_maxMemory > entry.memory ? m_maxMemory - entry.memory : 0);
+
+    const PageKey key(observer, page);
+    entry.recentIt = m_recent.insert(m_recent.end(), key);
+    m_entries.insert(key, entry);
+    m_compressing.insert(key);
+    m_totalMemory += entry.memory;
+    m_uncompressedMemory += entry.uncompressedSize;
+
+    m_weaver.enqueue(ThreadWeaver::JobPointer(new CompressionJob(entry.image, entry.compression)));
+    return true;
+}
+
+bool CompressedPixmapCache::contains(DocumentObserver *observer, int page, int width, int height, Rotation rotation) const
+{
+    const QHash<PageKey, Entry>::const_iterator it = m_entries.constFind(PageKey(observer, page));
+    return it != m_entries.constEnd() && matches(*it, width, height, rotation);
+}
+
+QPixmap *CompressedPixmapCache::take(DocumentObserver *observer, int page, int width, int height, Rotation rotation)
+{
+    const QHash<PageKey, Entry>::iterator it = m_entries.find(PageKey(observer, page));
+    if (it == m_entries.end())
+        return nullptr;
+
+    const Entry entry = *it;
+    removeEntry(it);
+
+    if (!matches(entry, width, height, rotation))
+        return nullptr;
+
+    // a pixmap whose compression was not picked up yet is still there as is
+    const QImage image = entry.compression ? entry.image : uncompressImage(entry.data.constData(), entry.data.size(), entry.width, entry.height, entry.format, entry.originalFormat);
+    if (image.isNull())
+        return nullptr;
+
+    QPixmap *pixmap = new QPixmap(QPixmap::fromImage(image));
+    pixmap->setDevicePixelRatio(entry.devicePixelRatio);
+    ++m_hits;
+    return pixmap;
+}
+
+void CompressedPixmapCache::recordMiss()
+{
+    if (m_maxMemory > 0)
+        ++m_misses;
+}
+
+void CompressedPixmapCache::waitForCompressions()
+{
+    m_weaver.finish();
+    collectCompressions();
+}
+
+void CompressedPixmapCache::remove(DocumentObserver *observer, int page)
+{
+    const QHash<PageKey, Entry>::iterator it = m_entries.find(PageKey(observer, page));
+    if (it != m_entries.end())
+        removeEntry(it);
+}
+
+void CompressedPixmapCache::remove(DocumentObserver *observer)
+{
+    QHash<PageKey, Entry>::iterator it = m_entries.begin();
+    while (it != m_entries.end()) {
+        if (it.key().first == observer) {
+            QHash<PageKey, Entry>::iterator next = it;
+            ++next;
+            removeEntry(it);
+            it = next;
+        } else {
+            ++it;
+        }
+    }
+}
+
+void CompressedPixmapCache::removePage(int page)
+{
+    QHash<PageKey, Entry>::iterator it = m_entries.begin();
+    while (it != m_entries.end()) {
+        if (it.key().second == page) {
+            QHash<PageKey, Entry>::iterator next = it;
+            ++next;
+            removeEntry(it);
+            it = next;
+        } else {
+            ++it;
+        }
+    }
+}
+
+void CompressedPixmapCache::clear()
+{
+    // the results of the running compressions are ignored
+    m_weaver.dequeue();
+    m_entries.clear();
+    m_compressing.clear();
+    m_recent.clear();
+    m_totalMemory = 0;
+    m_uncompressedMemory = 0;
+}
+
+int CompressedPixmapCache::count() const
+{
+    return m_entries.count();
+}
+
+qulonglong CompressedPixmapCache::totalMemory() const
+{
+    return m_totalMemory;
+}
+
+qulonglong CompressedPixmapCache::uncompressedMemory() const
+{
+    return m_uncompressedMemory;
+}
+
+quint64 CompressedPixmapCache::hits() const
+{
+    return m_hits;
+}
+
+quint64 CompressedPixmapCache::misses() const
+{
+    return m_misses;
+}
+
+QByteArray CompressedPixmapCache::compressImage(const QImage &image, QImage::Format *format)
+{
+    const QImage reduced = reducedImage(image);
+    *format = reduced.format();
+    return qCompress(reduced.constBits(), static_cast<int>(reduced.sizeInBytes()), compressionLevel);
+}
+
+QImage CompressedPixmapCache::uncompressImage(const char *data, int size, int width, int height, QImage::Format format, QImage::Format originalFormat)
+{
+    const QByteArray pixels = qUncompress(reinterpret_cast<const uchar *>(data), size);
+    QImage image(width, height, format);
+    if (image.isNull() || pixels.size() != image.sizeInBytes())
+        return QImage();
+
+    std::memcpy(image.bits(), pixels.constData(), pixels.size());
+    if (format == QImage::Format_Mono)
+        image.setColorTable({qRgb(0, 0, 0), qRgb(255, 255, 255)});
+    if (format != originalFormat)
+        image = image.convertToFormat(originalFormat);
+    return image;
+}
+
+bool CompressedPixmapCache::matches(const Entry &entry, int width, int height, Rotation rotation)
+{
+    return entry.width == width && entry.height == height && entry.rotation == rotation;
+}
+
+void CompressedPixmapCache::removeEntry(QHash<PageKey, Entry>::iterator it)
+{
+    m_totalMemory -= it->memory;
+    m_uncompressedMemory -= it->uncompressedSize;
+    m_compressing.remove(it.key());
+    m_recent.erase(it->recentIt);
+    m_entries.erase(it);
+}
+
+void CompressedPixmapCache::trim(qulonglong maxMemory)
+{
+    while (m_totalMemory > maxMemory && !m_recent.isEmpty())
+        removeEntry(m_entries.find(m_recent.first()));
+}
+
+// Replaces the images of the entries whose compression finished with the compressed data
+void CompressedPixmapCache::collectCompressions()
+{
+    if (m_compressing.isEmpty())
+        return;
+
+    bool collected = false;
+    const QSet<PageKey> compressing = m_compressing;
+    for (const PageKey &key : compressing) {
+        const QHash<PageKey, Entry>::iterator it = m_entries.find(key);
+        if (!it->compression->done.loadAcquire())
+            continue;
+
+        if (it->compression->data.isEmpty() || qulonglong(it->compression->data.size()) > m_maxMemory) {
+            removeEntry(it);
+            continue;
+        }
+
+        m_totalMemory -= it->memory;
+        it->data = it->compression->data;
+        it->format = it->compression->format;
+        it->memory = it->data.size();
+        it->image = QImage();
+        it->compression.reset();
+        m_totalMemory += it->memory;
+        m_compressing.remove(key);
+        collected = true;
+    }
+
+    if (collected)
+        trim(m_maxMemory);
+}
+
+/* kate: replace-tabs on; indent-width 4; */
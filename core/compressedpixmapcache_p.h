@@ -0,0 +1,177 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by the Okular developers                           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef _OKULAR_COMPRESSEDPIXMAPCACHE_P_H_
+#define _OKULAR_COMPRESSEDPIXMAPCACHE_P_H_
+
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QHash>
+#include <QImage>
+#include <QLinkedList>
+#include <QPair>
+#include <QSet>
+#include <QSharedPointer>
+
+#include <threadweaver/queue.h>
+
+#include "global.h"
+#include "okularcore_export.h"
+
+class QPixmap;
+
+namespace Okular
+{
+class DocumentObserver;
+
+/**
+ * Second tier of the pixmap cache of a Document.
+ *
+ * Pixmaps evicted from memory by DocumentPrivate::cleanupPixmapMemory are
+ * kept here losslessly compressed, so visiting their page again does not
+ * need a new rendering from the generator. Black and white pages are stored
+ * with one bit per pixel and grayscale pages with one byte per pixel before
+ * being compressed.
+ *
+ * Pixmaps are compressed by a thread of the cache, so evicting them does not
+ * stall the GUI thread. Until its compression is picked up a pixmap is kept
+ * as an image and counts with its uncompressed size.
+ *
+ * There is at most one pixmap for each page and observer. The least recently
+ * stored pixmaps are dropped when the data held exceeds maxMemory().
+ */
+class OKULARCORE_EXPORT CompressedPixmapCache
+{
+public:
+    CompressedPixmapCache();
+    ~CompressedPixmapCache();
+
+    /**
+     * Sets the maximum number of bytes of compressed data, 0 disables the cache.
+     */
+    void setMaxMemory(qulonglong bytes);
+    qulonglong maxMemory() const;
+
+    /**
+     * Stores @p pixmap as the pixmap of @p page of @p observer, rendered with
+     * the given @p rotation, and starts compressing it. Returns whether it was
+     * stored.
+     */
+    bool insert(DocumentObserver *observer, int page, const QPixmap &pixmap, Rotation rotation);
+
+    /**
+     * Returns whether there is a pixmap of @p width x @p height for @p page of
+     * @p observer rendered with @p rotation.
+     */
+    bool contains(DocumentObserver *observer, int page, int width, int height, Rotation rotation) const;
+
+    /**
+     * Removes the pixmap of @p page of @p observer from the cache and returns
+     * it decompressed, or nullptr if there is no such pixmap of @p width x
+     * @p height rendered with @p rotation. The caller owns the returned pixmap.
+     *
+     * A returned pixmap counts as a hit.
+     */
+    QPixmap *take(DocumentObserver *observer, int page, int width, int height, Rotation rotation);
+
+    /**
+     * Counts a pixmap that had to be rendered because it was not in the cache.
+     */
+    void recordMiss();
+
+    /**
+     * Waits for the running compressions and picks up their results.
+     */
+    void waitForCompressions();
+
+    void remove(DocumentObserver *observer, int page);
+    void remove(DocumentObserver *observer);
+    void removePage(int page);
+    void clear();
+
+    int count() const;
+
+    /**
+     * Bytes of data held by the cache, compressed or not compressed yet.
+     */
+    qulonglong totalMemory() const;
+
+    /**
+     * Bytes the pixmaps held by the cache would use uncompressed.
+     */
+    qulonglong uncompressedMemory() const;
+
+    quint64 hits() const;
+    quint64 misses() const;
+
+    /**
+     * Losslessly compresses the pixels of @p image. @p format is set to the
+     * format of the compressed pixels, needed by uncompressImage().
+     */
+    static QByteArray compressImage(const QImage &image, QImage::Format *format);
+
+    /**
+     * Returns the image compressed with compressImage() in @p size bytes of
+     * @p data, converted back to @p originalFormat, or a null image if the
+     * data is not valid.
+     */
+    static QImage uncompressImage(const char *data, int size, int width, int height, QImage::Format format, QImage::Format originalFormat);
+
+private:
+    typedef QPair<DocumentObserver *, int> PageKey;
+
+    // filled in by the compression thread
+    struct Compression {
+        QByteArray data;
+        QImage::Format format;
+        QAtomicInt done;
+    };
+    class CompressionJob;
+
+    struct Entry {
+        // the pixmap while it is being compressed
+        QImage image;
+        QSharedPointer<Compression> compression;
+        QByteArray data;
+        QImage::Format format;
+        QImage::Format originalFormat;
+        int width;
+        int height;
+        qreal devicePixelRatio;
+        Rotation rotation;
+        qulonglong uncompressedSize;
+        // bytes the entry counts in totalMemory()
+        qulonglong memory;
+        QLinkedList<PageKey>::iterator recentIt;
+    };
+
+    static bool matches(const Entry &entry, int width, int height, Rotation rotation);
+    void removeEntry(QHash<PageKey, Entry>::iterator it);
+    void trim(qulonglong maxMemory);
+    void collectCompressions();
+
+    QHash<PageKey, Entry> m_entries;
+    QSet<PageKey> m_compressing;
+    ThreadWeaver::Queue m_weaver;
+    // most recently stored last
+    QLinkedList<PageKey> m_recent;
+    qulonglong m_maxMemory;
+    qulonglong m_totalMemory;
+    qulonglong m_uncompressedMemory;
+    quint64 m_hits;
+    quint64 m_misses;
+
+    Q_DISABLE_COPY(CompressedPixmapCache)
+};
+
+}
+
+#endif
+
+/* kate: replace-tabs on; indent-width 4; */
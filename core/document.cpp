@@ -31,6 +31,7 @@
 
 // qt/kde/system includes
 #include <QApplication>
+#include <QDataStream>
 #include <QDesktopServices>
 #include <QDir>
 #include <QFile>
@@ -107,20 +108,6 @@
 
 using namespace Okular;
 
-struct AllocatedPixmap {
-    // owner of the page
-    DocumentObserver *observer;
-    int page;
-    qulonglong memory;
-    // public constructor: initialize data
-    AllocatedPixmap(DocumentObserver *o, int p, qulonglong m)
-        : observer(o)
-        , page(p)
-        , memory(m)
-    {
-    }
-};
-
 struct ArchiveData {
     ArchiveData()
     {
@@ -140,11 +127,18 @@ struct RunningSearch {
     // fields related to previous searches (used for 'continueSearch')
     QString cachedString;
     Document::SearchType cachedType;
+    // compiled cachedString of a RegularExpression search
+    QRegularExpression cachedRegularExpression;
     Qt::CaseSensitivity cachedCaseSensitivity;
     bool cachedViewportMove : 1;
     bool isCurrentlySearching : 1;
     QColor cachedColor;
     int pagesDone;
+
+    // pages whose text an indexed whole document search is waiting for
+    QSet<int> pagesPending;
+    // pending pages that already have their text, matched one per event loop iteration
+    QList<int> pagesToMatch;
 };
 
 #define foreachObserver(cmd)                                                                                                                                                                                                                   \
@@ -260,29 +254,29 @@ qulonglong DocumentPrivate::calculateMemoryToFree()
 
     switch (SettingsCore::memoryLevel()) {
     case SettingsCore::EnumMemoryLevel::Low:
-        memoryToFree = m_allocatedPixmapsTotalMemory;
+        memoryToFree = m_allocatedPixmaps.totalMemory();
         break;
 
     case SettingsCore::EnumMemoryLevel::Normal: {
         qulonglong thirdTotalMemory = getTotalMemory() / 3;
         qulonglong freeMemory = getFreeMemory();
-        if (m_allocatedPixmapsTotalMemory > thirdTotalMemory)
-            memoryToFree = m_allocatedPixmapsTotalMemory - thirdTotalMemory;
-        if (m_allocatedPixmapsTotalMemory > freeMemory)
-            clipValue = (m_allocatedPixmapsTotalMemory - freeMemory) / 2;
+        if (m_allocatedPixmaps.totalMemory() > thirdTotalMemory)
+            memoryToFree = m_allocatedPixmaps.totalMemory() - thirdTotalMemory;
+        if (m_allocatedPixmaps.totalMemory() > freeMemory)
+            clipValue = (m_allocatedPixmaps.totalMemory() - freeMemory) / 2;
     } break;
 
     case SettingsCore::EnumMemoryLevel::Aggressive: {
         qulonglong freeMemory = getFreeMemory();
-        if (m_allocatedPixmapsTotalMemory > freeMemory)
-            clipValue = (m_allocatedPixmapsTotalMemory - freeMemory) / 2;
+        if (m_allocatedPixmaps.totalMemory() > freeMemory)
+            clipValue = (m_allocatedPixmaps.totalMemory() - freeMemory) / 2;
     } break;
     case SettingsCore::EnumMemoryLevel::Greedy: {
         qulonglong freeSwap;
         qulonglong freeMemory = getFreeMemory(&freeSwap);
         const qulonglong memoryLimit = qMin(qMax(freeMemory, getTotalMemory() / 2), freeMemory + freeSwap);
-        if (m_allocatedPixmapsTotalMemory > memoryLimit)
-            clipValue = (m_allocatedPixmapsTotalMemory - memoryLimit) / 2;
+        if (m_allocatedPixmaps.totalMemory() > memoryLimit)
+            clipValue = (m_allocatedPixmaps.totalMemory() - memoryLimit) / 2;
     } break;
     }
 
@@ -310,6 +304,8 @@ void DocumentPrivate::cleanupPixmapMemory(qulonglong memoryToFree)
     for (; vIt != vEnd; ++vIt)
         visibleRects.insert((*vIt)->pageNumber, (*vIt));
 
+    updateCompressedPixmapsBudget();
+
     // Free memory starting from pages that are farthest from the current one
     int pagesFreed = 0;
     while (memoryToFree > 0) {
@@ -319,16 +315,14 @@ void DocumentPrivate::cleanupPixmapMemory(qulonglong memoryToFree)
 
         qCDebug(OkularCoreDebug).nospace() << "Evicting cache pixmap observer=" << p->observer << " page=" << p->page;
 
-        // m_allocatedPixmapsTotalMemory can't underflow because we always add or remove
-        // the memory used by the AllocatedPixmap so at most it can reach zero
-        m_allocatedPixmapsTotalMemory -= p->memory;
         // Make sure memoryToFree does not underflow
         if (p->memory > memoryToFree)
             memoryToFree = 0;
         else
             memoryToFree -= p->memory;
         pagesFreed++;
-        // delete pixmap
+        // keep a compressed copy around, then delete pixmap
+        storeEvictedPixmap(p);
         m_pagesVector.at(p->page)->deletePixmap(p->observer);
         // delete allocation descriptor
         delete p;
@@ -361,7 +355,6 @@ void DocumentPrivate::cleanupPixmapMemory(qulonglong memoryToFree)
                 p->memory = tilesManager->totalMemory();
                 memoryDiff -= p->memory;
                 memoryToFree = (memoryDiff < memoryToFree) ? (memoryToFree - memoryDiff) : 0;
-                m_allocatedPixmapsTotalMemory -= memoryDiff;
 
                 if (p->memory > 0)
                     pixmapsToKeep.append(p);
@@ -375,45 +368,111 @@ void DocumentPrivate::cleanupPixmapMemory(qulonglong memoryToFree)
             break;
     }
 
-    m_allocatedPixmaps += pixmapsToKeep;
+    // put back the partially freed pixmaps, with their shrunk memory
+    for (AllocatedPixmap *p : qAsConst(pixmapsToKeep))
+        m_allocatedPixmaps.insert(p);
     // p--rintf("freeMemory A:[%d -%d = %d] \n", m_allocatedPixmaps.count() + pagesFreed, pagesFreed, m_allocatedPixmaps.count() );
 }
 
 /* Returns the next pixmap to evict from cache, or NULL if no suitable pixmap
  * if found. If unloadableOnly is set, only unloadable pixmaps are returned. If
  * thenRemoveIt is set, the pixmap is removed from m_allocatedPixmaps before
- * returning it
+ * returning it. The caller owns the removed pixmap
  */
 AllocatedPixmap *DocumentPrivate::searchLowestPriorityPixmap(bool unloadableOnly, bool thenRemoveIt, DocumentObserver *observer)
 {
-    QLinkedList<AllocatedPixmap *>::iterator pIt = m_allocatedPixmaps.begin();
-    QLinkedList<AllocatedPixmap *>::iterator pEnd = m_allocatedPixmaps.end();
-    QLinkedList<AllocatedPixmap *>::iterator farthestPixmap = pEnd;
     const int currentViewportPage = (*m_viewportIterator).pageNumber;
 
     /* Find the pixmap that is farthest from the current viewport */
-    int maxDistance = -1;
-    while (pIt != pEnd) {
-        const AllocatedPixmap *p = *pIt;
-        // Filter by observer
-        if (observer == nullptr || p->observer == observer) {
-            const int distance = qAbs(p->page - currentViewportPage);
-            if (maxDistance < distance && (!unloadableOnly || p->observer->canUnloadPixmap(p->page))) {
-                maxDistance = distance;
-                farthestPixmap = pIt;
-            }
+    if (thenRemoveIt)
+        return m_allocatedPixmaps.takeFarthest(currentViewportPage, unloadableOnly, observer);
+    return m_allocatedPixmaps.farthest(currentViewportPage, unloadableOnly, observer);
+}
+
+void DocumentPrivate::updateCompressedPixmapsBudget()
+{
+    // the 'low' profile wants pixmaps out of memory, not just compressed
+    if (SettingsCore::memoryLevel() == SettingsCore::EnumMemoryLevel::Low)
+        m_compressedPixmaps.setMaxMemory(0);
+    else
+        m_compressedPixmaps.setMaxMemory(qulonglong(SettingsCore::compressedPixmapCacheSize()) * 1024 * 1024);
+}
+
+void DocumentPrivate::storeEvictedPixmap(const AllocatedPixmap *p)
+{
+    if (m_compressedPixmaps.maxMemory() == 0)
+        return;
+
+    const Page *page = m_pagesVector.at(p->page);
+    // tiled pixmaps are only partially freed, see cleanupPixmapMemory
+    if (page->d->tilesManager(p->observer))
+        return;
+
+    QMap<DocumentObserver *, PagePrivate::PixmapObject>::const_iterator it = page->d->m_pixmaps.constFind(p->observer);
+    if (it == page->d->m_pixmaps.constEnd() || it.value().m_isPartialPixmap || it.value().m_rotation != m_rotation)
+        return;
+
+    m_compressedPixmaps.insert(p->observer, p->page, *it.value().m_pixmap, it.value().m_rotation);
+}
+
+bool DocumentPrivate::hasCachedPixmap(const PixmapRequest *request) const
+{
+    return m_compressedPixmaps.contains(request->observer(), request->pageNumber(), request->width(), request->height(), m_rotation) ||
+        m_thumbnailCache.contains(request->pageNumber(), request->width(), request->height(), m_rotation);
+}
+
+/* Serves request with the pixmap of the compressed cache or of the thumbnail
+ * cache, if there is one. Must be called with m_pixmapRequestsMutex unlocked
+ * and request not queued.
+ */
+bool DocumentPrivate::restoreCachedPixmap(PixmapRequest *request)
+{
+    QPixmap *pixmap = m_compressedPixmaps.take(request->observer(), request->pageNumber(), request->width(), request->height(), m_rotation);
+    if (pixmap) {
+        qCDebug(OkularCoreDebug).nospace() << "Restoring compressed pixmap observer=" << request->observer() << " page=" << request->pageNumber() << " hits=" << m_compressedPixmaps.hits() << " misses=" << m_compressedPixmaps.misses()
+                                           << " bytes=" << m_compressedPixmaps.totalMemory() << "/" << m_compressedPixmaps.uncompressedMemory();
+    } else {
+        const QImage image = m_thumbnailCache.image(request->pageNumber(), request->width(), request->height(), m_rotation);
+        if (image.isNull()) {
+            m_thumbnailCache.remove(request->pageNumber());
+            return false;
         }
-        ++pIt;
+        pixmap = new QPixmap(QPixmap::fromImage(image));
     }
 
-    /* No pixmap to remove */
-    if (farthestPixmap == pEnd)
-        return nullptr;
+    request->page()->d->setRotatedPixmap(request->observer(), pixmap);
+    requestDone(request);
+    return true;
+}
 
-    AllocatedPixmap *selectedPixmap = *farthestPixmap;
-    if (thenRemoveIt)
-        m_allocatedPixmaps.erase(farthestPixmap);
-    return selectedPixmap;
+void DocumentPrivate::storeThumbnailPixmap(const PixmapRequest *request)
+{
+    if (!m_thumbnailCache.isOpen() || request->isTile() || !ThumbnailCache::isCacheable(request->width(), request->height()) || m_editedPages.contains(request->pageNumber()))
+        return;
+
+    const PagePrivate *page = request->page()->d;
+    QMap<DocumentObserver *, PagePrivate::PixmapObject>::const_iterator it = page->m_pixmaps.constFind(request->observer());
+    if (it == page->m_pixmaps.constEnd() || it.value().m_isPartialPixmap || it.value().m_rotation != m_rotation)
+        return;
+
+    const QPixmap *pixmap = it.value().m_pixmap;
+    if (pixmap->width() == request->width() && pixmap->height() == request->height())
+        m_thumbnailCache.insert(request->pageNumber(), pixmap->toImage(), m_rotation);
+}
+
+/* Returns what, besides the page, size and rotation, changes the pixmaps
+ * rendered by the generator, so the thumbnail cache is not used with other
+ * settings than the ones it was written with.
+ */
+QByteArray DocumentPrivate::thumbnailRenderSettings() const
+{
+    QByteArray settings;
+    QDataStream stream(&settings, QIODevice::WriteOnly);
+    stream << m_generatorName << m_pageSize.name();
+    const Generator::DocumentMetaDataKey keys[] = {Generator::PaperColorMetaData, Generator::TextAntialiasMetaData, Generator::GraphicsAntialiasMetaData, Generator::TextHintingMetaData};
+    for (const Generator::DocumentMetaDataKey key : keys)
+        stream << documentMetaData(key, true);
+    return settings;
 }
 
 qulonglong DocumentPrivate::getTotalMemory()
@@ -1174,6 +1233,10 @@ void DocumentPrivate::saveDocumentInfo() const
     if (m_xmlFileName.isEmpty())
         return;
 
+    // the text index lives next to the docdata file
+    if (!m_textIndex.save())
+        qCWarning(OkularCoreDebug) << "Failed to write the text index of" << m_xmlFileName;
+
     QFile infoFile(m_xmlFileName);
     qCDebug(OkularCoreDebug) << "About to save document info to" << m_xmlFileName;
     if (!infoFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
@@ -1260,11 +1323,20 @@ void DocumentPrivate::saveDocumentInfo() const
 void DocumentPrivate::slotTimedMemoryCheck()
 {
     // [MEM] clean memory (for 'free mem dependent' profiles only)
-    if (SettingsCore::memoryLevel() != SettingsCore::EnumMemoryLevel::Low && m_allocatedPixmapsTotalMemory > 1024 * 1024)
+    if (SettingsCore::memoryLevel() != SettingsCore::EnumMemoryLevel::Low && m_allocatedPixmaps.totalMemory() > 1024 * 1024)
         cleanupPixmapMemory();
 }
 
 void DocumentPrivate::sendGeneratorPixmapRequest()
+{
+    // served in a loop rather than recursively, a long run of cached pixmaps would overflow the stack
+    while (dispatchPixmapRequest()) { }
+}
+
+/* Sends the next request to the generator, or serves it from the caches.
+ * Returns whether the next request can be dispatched right away.
+ */
+bool DocumentPrivate::dispatchPixmapRequest()
 {
     /* If the pixmap cache will have to be cleaned in order to make room for the
      * next request, get the distance from the current viewport of the page
@@ -1279,46 +1351,44 @@ void DocumentPrivate::sendGeneratorPixmapRequest()
             maxDistance = qAbs(pixmapToReplace->page - currentViewportPage);
     }
 
+    const QScreen *screen = nullptr;
+    if (m_widget) {
+        const QWindow *window = m_widget->window()->windowHandle();
+        if (window)
+            screen = window->screen();
+    }
+    if (!screen)
+        screen = QGuiApplication::primaryScreen();
+    const long screenSize = screen->devicePixelRatio() * screen->size().width() * screen->devicePixelRatio() * screen->size().height();
+
     // find a request
     PixmapRequest *request = nullptr;
     m_pixmapRequestsMutex.lock();
-    while (!m_pixmapRequestsStack.isEmpty() && !request) {
-        PixmapRequest *r = m_pixmapRequestsStack.last();
-        if (!r) {
-            m_pixmapRequestsStack.pop_back();
-            continue;
-        }
+    m_pixmapRequestsQueue.setViewportPage(currentViewportPage);
+    while (!m_pixmapRequestsQueue.isEmpty() && !request) {
+        PixmapRequest *r = m_pixmapRequestsQueue.top();
 
         QRect requestRect = r->isTile() ? r->normalizedRect().geometry(r->width(), r->height()) : QRect(0, 0, r->width(), r->height());
         TilesManager *tilesManager = r->d->tilesManager();
         const double normalizedArea = r->normalizedRect().width() * r->normalizedRect().height();
-        const QScreen *screen = nullptr;
-        if (m_widget) {
-            const QWindow *window = m_widget->window()->windowHandle();
-            if (window)
-                screen = window->screen();
-        }
-        if (!screen)
-            screen = QGuiApplication::primaryScreen();
-        const long screenSize = screen->devicePixelRatio() * screen->size().width() * screen->devicePixelRatio() * screen->size().height();
 
         // If it's a preload but the generator is not threaded no point in trying to preload
         if (r->preload() && !m_generator->hasFeature(Generator::Threaded)) {
-            m_pixmapRequestsStack.pop_back();
+            m_pixmapRequestsQueue.pop();
             delete r;
         }
         // request only if page isn't already present and request has valid id
         else if ((!r->d->mForce && r->page()->hasPixmap(r->observer(), r->width(), r->height(), r->normalizedRect())) || !m_observers.contains(r->observer())) {
-            m_pixmapRequestsStack.pop_back();
+            m_pixmapRequestsQueue.pop();
             delete r;
         } else if (!r->d->mForce && r->preload() && qAbs(r->pageNumber() - currentViewportPage) >= maxDistance) {
-            m_pixmapRequestsStack.pop_back();
+            m_pixmapRequestsQueue.pop();
             // qCDebug(OkularCoreDebug) << "Ignoring request that doesn't fit in cache";
             delete r;
         }
         // Ignore requests for pixmaps that are already being generated
         else if (tilesManager && tilesManager->isRequesting(r->normalizedRect(), r->width(), r->height())) {
-            m_pixmapRequestsStack.pop_back();
+            m_pixmapRequestsQueue.pop();
             delete r;
         }
         // If the requested area is above 4*screenSize pixels, and we're not rendering most of the page,  switch on the tile manager
@@ -1364,7 +1434,7 @@ void DocumentPrivate::sendGeneratorPixmapRequest()
                 // preload requests issued by PageView if the requested page is
                 // not visible and the user has just switched from a non-tiled
                 // zoom level to a tiled one
-                m_pixmapRequestsStack.pop_back();
+                m_pixmapRequestsQueue.pop();
                 delete r;
             }
         }
@@ -1378,22 +1448,48 @@ void DocumentPrivate::sendGeneratorPixmapRequest()
 
             request = r;
         } else if ((long)requestRect.width() * (long)requestRect.height() > 100L * screenSize && (SettingsCore::memoryLevel() != SettingsCore::EnumMemoryLevel::Greedy)) {
-            m_pixmapRequestsStack.pop_back();
+            m_pixmapRequestsQueue.pop();
             if (!m_warnedOutOfMemory) {
                 qCWarning(OkularCoreDebug).nospace() << "Running out of memory on page " << r->pageNumber() << " (" << r->width() << "x" << r->height() << " px);";
                 qCWarning(OkularCoreDebug) << "this message will be reported only once.";
                 m_warnedOutOfMemory = true;
             }
             delete r;
+        } else if (!r->isTile() && isPixmapBeingGenerated(r->observer(), r->pageNumber())) {
+            // Leave it queued until the running generation of the same pixmap finishes instead of
+            // rendering the page twice (possible when the generator renders in parallel), other
+            // pages can be sent meanwhile
+            m_pixmapRequestsQueue.skipTop();
         } else {
             request = r;
         }
     }
+    m_pixmapRequestsQueue.restoreSkipped();
 
     // if no request found (or already generated), return
     if (!request) {
         m_pixmapRequestsMutex.unlock();
-        return;
+        return false;
+    }
+
+    // a pixmap evicted earlier or stored on disk does not need to be rendered again
+    if (!request->isTile() && !request->d->mForce && hasCachedPixmap(request)) {
+        m_pixmapRequestsQueue.remove(request);
+        m_pixmapRequestsMutex.unlock();
+        m_restoringCachedPixmap = true;
+        const bool restored = restoreCachedPixmap(request);
+        m_restoringCachedPixmap = false;
+        if (!restored) {
+            // could not decompress it, render it after all
+            m_pixmapRequestsMutex.lock();
+            m_pixmapRequestsQueue.push(request);
+            m_pixmapRequestsMutex.unlock();
+            return true;
+        }
+        m_pixmapRequestsMutex.lock();
+        const bool hasPixmaps = !m_pixmapRequestsQueue.isEmpty();
+        m_pixmapRequestsMutex.unlock();
+        return hasPixmaps;
     }
 
     // [MEM] preventive memory freeing
@@ -1412,7 +1508,9 @@ void DocumentPrivate::sendGeneratorPixmapRequest()
         QRect requestRect = !request->isTile() ? QRect(0, 0, request->width(), request->height()) : request->normalizedRect().geometry(request->width(), request->height());
         qCDebug(OkularCoreDebug).nospace() << "sending request observer=" << request->observer() << " " << requestRect.width() << "x" << requestRect.height() << "@" << request->pageNumber() << " async == " << request->asynchronous()
                                            << " isTile == " << request->isTile();
-        m_pixmapRequestsStack.removeAll(request);
+        m_pixmapRequestsQueue.remove(request);
+        if (!tm && !request->d->mForce)
+            m_compressedPixmaps.recordMiss();
 
         if (tm)
             tm->setRequest(request->normalizedRect(), request->width(), request->height());
@@ -1434,11 +1532,29 @@ void DocumentPrivate::sendGeneratorPixmapRequest()
         m_executingPixmapRequests.push_back(request);
         m_pixmapRequestsMutex.unlock();
         m_generator->generatePixmap(request);
+
+        // generators rendering in parallel can start working on the next request right away
+        if (m_generator && m_generator->hasFeature(Generator::ParallelRendering) && m_generator->canGeneratePixmap()) {
+            m_pixmapRequestsMutex.lock();
+            const bool hasPixmaps = !m_pixmapRequestsQueue.isEmpty();
+            m_pixmapRequestsMutex.unlock();
+            return hasPixmaps;
+        }
     } else {
         m_pixmapRequestsMutex.unlock();
         // pino (7/4/2006): set the polling interval from 10 to 30
         QTimer::singleShot(30, m_parent, [this] { sendGeneratorPixmapRequest(); });
     }
+    return false;
+}
+
+bool DocumentPrivate::isPixmapBeingGenerated(DocumentObserver *observer, int pageNumber) const
+{
+    for (const PixmapRequest *executingRequest : m_executingPixmapRequests) {
+        if (executingRequest->observer() == observer && executingRequest->pageNumber() == pageNumber && !executingRequest->isTile())
+            return true;
+    }
+    return false;
 }
 
 void DocumentPrivate::rotationFinished(int page, Okular::Page *okularPage)
@@ -1496,9 +1612,9 @@ void DocumentPrivate::slotGeneratorConfigChanged()
         }
 
         // [MEM] remove allocation descriptors
-        qDeleteAll(m_allocatedPixmaps);
         m_allocatedPixmaps.clear();
-        m_allocatedPixmapsTotalMemory = 0;
+        m_compressedPixmaps.clear();
+        m_thumbnailCache.clear();
 
         // send reload signals to observers
         foreachObserverD(notifyContentsCleared(DocumentObserver::Pixmap));
@@ -1515,6 +1631,10 @@ void DocumentPrivate::refreshPixmaps(int pageNumber)
     if (!page)
         return;
 
+    m_compressedPixmaps.removePage(pageNumber);
+    m_thumbnailCache.remove(pageNumber);
+    m_editedPages.insert(pageNumber);
+
     QMap<DocumentObserver *, PagePrivate::PixmapObject>::ConstIterator it = page->d->m_pixmaps.constBegin(), itEnd = page->d->m_pixmaps.constEnd();
     QVector<Okular::PixmapRequest *> pixmapsToRequest;
     for (; it != itEnd; ++it) {
@@ -1613,12 +1733,17 @@ void DocumentPrivate::doContinueDirectionMatchSearch(void *doContinueDirectionMa
     if (doContinue) {
         // get page
         Page *page = m_pagesVector[searchStruct->currentPage];
-        // request search page if needed
-        if (!page->hasTextPage())
-            m_parent->requestTextPage(page->number());
+        // pages known not to contain the text need no text page
+        if (m_textIndex.hasPage(page->number()) && !m_textIndex.pageMatches(page->number(), search->cachedString)) {
+            searchStruct->match = nullptr;
+        } else {
+            // request search page if needed
+            if (!page->hasTextPage())
+                m_parent->requestTextPage(page->number());
 
-        // if found a match on the current page, end the loop
-        searchStruct->match = page->findText(searchStruct->searchID, search->cachedString, forward ? FromTop : FromBottom, search->cachedCaseSensitivity);
+            // if found a match on the current page, end the loop
+            searchStruct->match = page->findText(searchStruct->searchID, search->cachedString, forward ? FromTop : FromBottom, search->cachedCaseSensitivity);
+        }
         if (!searchStruct->match) {
             if (forward)
                 searchStruct->currentPage++;
@@ -1688,6 +1813,25 @@ void DocumentPrivate::doProcessSearchMatch(RegularAreaRect *match, RunningSearch
     delete pagesToNotify;
 }
 
+// Returns the matches of the whole document search on page
+static QVector<RegularAreaRect *> findAllMatches(const RunningSearch *search, const Page *page)
+{
+    if (search->cachedType == Document::RegularExpression)
+        return page->findAllText(search->cachedRegularExpression);
+
+    return page->findAllText(search->cachedString, search->cachedCaseSensitivity);
+}
+
+// Returns whether the text index tells the whole document search cannot match on page
+static bool indexExcludesPage(const RunningSearch *search, const TextIndex &textIndex, int pageNumber)
+{
+    // the words of an expression are unknown
+    if (search->cachedType == Document::RegularExpression)
+        return false;
+
+    return textIndex.hasPage(pageNumber) && !textIndex.pageMatches(pageNumber, search->cachedString);
+}
+
 void DocumentPrivate::doContinueAllDocumentSearch(void *pagesToNotifySet, void *pageMatchesMap, int currentPage, int searchID)
 {
     QMap<Page *, QVector<RegularAreaRect *>> *pageMatches = static_cast<QMap<Page *, QVector<RegularAreaRect *>> *>(pageMatchesMap);
@@ -1715,25 +1859,20 @@ void DocumentPrivate::doContinueAllDocumentSearch(void *pagesToNotifySet, void *
         Page *page = m_pagesVector.at(currentPage);
         int pageNumber = page->number(); // redundant? is it == currentPage ?
 
+        // pages known not to contain the text need no text page
+        if (indexExcludesPage(search, m_textIndex, pageNumber)) {
+            QTimer::singleShot(0, m_parent, [this, pagesToNotifySet, pageMatches, currentPage, searchID] { doContinueAllDocumentSearch(pagesToNotifySet, pageMatches, currentPage + 1, searchID); });
+            return;
+        }
+
         // request search page if needed
         if (!page->hasTextPage())
             m_parent->requestTextPage(pageNumber);
 
-        // loop on a page adding highlights for all found items
-        RegularAreaRect *lastMatch = nullptr;
-        while (true) {
-            if (lastMatch)
-                lastMatch = page->findText(searchID, search->cachedString, NextResult, search->cachedCaseSensitivity, lastMatch);
-            else
-                lastMatch = page->findText(searchID, search->cachedString, FromTop, search->cachedCaseSensitivity);
-
-            if (!lastMatch)
-                break;
-
-            // add highlight rect to the matches map
-            (*pageMatches)[page].append(lastMatch);
-        }
-        delete lastMatch;
+        // add highlight rects for all found items to the matches map
+        const QVector<RegularAreaRect *> matches = findAllMatches(search, page);
+        if (!matches.isEmpty())
+            (*pageMatches)[page] += matches;
 
         QTimer::singleShot(0, m_parent, [this, pagesToNotifySet, pageMatches, currentPage, searchID] { doContinueAllDocumentSearch(pagesToNotifySet, pageMatches, currentPage + 1, searchID); });
     } else {
@@ -1772,6 +1911,186 @@ void DocumentPrivate::doContinueAllDocumentSearch(void *pagesToNotifySet, void *
     }
 }
 
+bool DocumentPrivate::canExtractTextInBackground() const
+{
+    return m_generator && m_pageController && m_generator->hasFeature(Generator::TextExtraction) && m_generator->hasFeature(Generator::ParallelTextExtraction);
+}
+
+void DocumentPrivate::doIndexedAllDocumentSearch(int searchID, QSet<int> *pagesToNotify)
+{
+    RunningSearch *search = m_searches.value(searchID);
+
+    // the pages that lost their highlights are updated right away, the
+    // others as soon as their matches are found
+    foreach (int pageNumber, *pagesToNotify)
+        foreach (DocumentObserver *observer, m_observers)
+            observer->notifyPageChanged(pageNumber, DocumentObserver::Highlights);
+    delete pagesToNotify;
+
+    // text pages not indexed yet, such as the ones extracted by the generator on its own
+    for (const Page *page : qAsConst(m_pagesVector)) {
+        if (!m_textIndex.hasPage(page->number()) && page->hasTextPage())
+            m_textIndex.addPage(page->number(), page->text());
+    }
+
+    search->pagesPending.clear();
+    search->pagesToMatch.clear();
+    QVector<int> candidates;
+    if (search->cachedType == Document::RegularExpression) {
+        // any page may match an expression
+        candidates.reserve(m_pagesVector.count());
+        for (const Page *page : qAsConst(m_pagesVector))
+            candidates.append(page->number());
+    } else {
+        candidates = m_textIndex.pagesMatching(search->cachedString);
+    }
+    for (int pageNumber : qAsConst(candidates)) {
+        Page *page = m_pagesVector.at(pageNumber);
+        search->pagesPending.insert(pageNumber);
+        if (page->hasTextPage()) {
+            search->pagesToMatch.append(pageNumber);
+        } else {
+            m_pageController->extractText(m_generator, page);
+        }
+    }
+
+    for (Page *page : qAsConst(m_pagesVector)) {
+        if (!m_textIndex.hasPage(page->number())) {
+            search->pagesPending.insert(page->number());
+            m_pageController->extractText(m_generator, page);
+        }
+    }
+
+    // matching every page at once would block the user interface for long on large documents
+    if (!search->pagesToMatch.isEmpty())
+        QTimer::singleShot(0, m_parent, [this, searchID] { doContinueIndexedSearch(searchID); });
+    else if (search->pagesPending.isEmpty())
+        finishIndexedSearch(search, searchID, search->highlightedPages.isEmpty() ? Document::NoMatchFound : Document::MatchFound);
+}
+
+void DocumentPrivate::doContinueIndexedSearch(int searchID)
+{
+    RunningSearch *search = m_searches.value(searchID);
+    // ended, reset or restarted meanwhile
+    if (!search || search->pagesToMatch.isEmpty())
+        return;
+
+    const int pageNumber = search->pagesToMatch.takeFirst();
+    search->pagesPending.remove(pageNumber);
+    searchIndexedPage(search, searchID, m_pagesVector.at(pageNumber));
+
+    if (!search->pagesToMatch.isEmpty())
+        QTimer::singleShot(0, m_parent, [this, searchID] { doContinueIndexedSearch(searchID); });
+    else if (search->pagesPending.isEmpty())
+        finishIndexedSearch(search, searchID, search->highlightedPages.isEmpty() ? Document::NoMatchFound : Document::MatchFound);
+}
+
+void DocumentPrivate::searchIndexedPage(RunningSearch *search, int searchID, Page *page)
+{
+    if (!page->hasTextPage())
+        m_parent->requestTextPage(page->number());
+
+    const QVector<RegularAreaRect *> matches = findAllMatches(search, page);
+    if (matches.isEmpty())
+        return;
+
+    for (RegularAreaRect *match : qAsConst(matches))
+        page->d->setHighlight(searchID, match, search->cachedColor);
+    qDeleteAll(matches);
+    search->highlightedPages.insert(page->number());
+
+    foreach (DocumentObserver *observer, m_observers)
+        observer->notifyPageChanged(page->number(), DocumentObserver::Highlights);
+}
+
+void DocumentPrivate::finishIndexedSearch(RunningSearch *search, int searchID, Document::SearchStatus status)
+{
+    // reset cursor to previous shape
+    QApplication::restoreOverrideCursor();
+
+    search->isCurrentlySearching = false;
+    search->pagesPending.clear();
+    search->pagesToMatch.clear();
+
+    // views filtering on matches only need to be set up once at the end
+    foreach (DocumentObserver *observer, m_observers)
+        observer->notifySetup(m_pagesVector, 0);
+
+    emit m_parent->searchFinished(searchID, status);
+}
+
+void DocumentPrivate::openTextIndex()
+{
+    m_textIndex.close();
+    // the text of documents that needed a password must not end up on disk in plain text
+    if (m_archiveData || m_xmlFileName.isEmpty() || m_openedWithPassword || !SettingsCore::persistentTextIndex())
+        return;
+
+    QString indexFileName = m_xmlFileName;
+    indexFileName.replace(indexFileName.length() - 4, 4, QStringLiteral(".textindex"));
+    m_textIndex.open(indexFileName, m_docFileName, m_pagesVector.count());
+}
+
+void DocumentPrivate::cancelIndexedSearches()
+{
+    QVector<int> cancelledSearches;
+    QMap<int, RunningSearch *>::const_iterator it = m_searches.constBegin(), itEnd = m_searches.constEnd();
+    for (; it != itEnd; ++it) {
+        if (!(*it)->pagesPending.isEmpty())
+            cancelledSearches.append(it.key());
+    }
+    if (m_pageController)
+        m_pageController->cancelTextExtractions();
+
+    for (int searchID : qAsConst(cancelledSearches)) {
+        RunningSearch *search = m_searches.value(searchID);
+        if (search && !search->pagesPending.isEmpty())
+            finishIndexedSearch(search, searchID, Document::SearchCancelled);
+    }
+}
+
+void DocumentPrivate::textExtractionFinished(int pageNumber, TextPage *textPage)
+{
+    Page *page = m_pagesVector.value(pageNumber);
+    if (!page) {
+        delete textPage;
+        return;
+    }
+
+    if (textPage) {
+        if (page->hasTextPage()) {
+            // extracted meanwhile by someone else
+            delete textPage;
+        } else {
+            page->d->setOrderedTextPage(textPage);
+            textGenerationDone(page);
+        }
+        if (!m_textIndex.hasPage(pageNumber))
+            m_textIndex.addPage(pageNumber, page->text());
+    }
+
+    QVector<int> finishedSearches;
+    QMap<int, RunningSearch *>::const_iterator it = m_searches.constBegin(), itEnd = m_searches.constEnd();
+    for (; it != itEnd; ++it) {
+        RunningSearch *search = *it;
+        if (!search->pagesPending.remove(pageNumber))
+            continue;
+
+        if (page->hasTextPage() && !indexExcludesPage(search, m_textIndex, pageNumber))
+            searchIndexedPage(search, it.key(), page);
+
+        if (search->pagesPending.isEmpty())
+            finishedSearches.append(it.key());
+    }
+
+    // the receivers of searchFinished may start or reset searches
+    for (int searchID : qAsConst(finishedSearches)) {
+        RunningSearch *search = m_searches.value(searchID);
+        if (search)
+            finishIndexedSearch(search, searchID, search->highlightedPages.isEmpty() ? Document::NoMatchFound : Document::MatchFound);
+    }
+}
+
 void DocumentPrivate::doContinueGooglesDocumentSearch(void *pagesToNotifySet, void *pageMatchesMap, int currentPage, int searchID, const QStringList &words)
 {
     typedef QPair<RegularAreaRect *, QColor> MatchColor;
@@ -1820,22 +2139,13 @@ void DocumentPrivate::doContinueGooglesDocumentSearch(void *pagesToNotifySet, vo
             if (newHue < 0)
                 newHue += 360;
             QColor wordColor = QColor::fromHsv(newHue, baseSat, baseVal);
-            RegularAreaRect *lastMatch = nullptr;
             // add all highlights for current word
-            bool wordMatched = false;
-            while (true) {
-                if (lastMatch)
-                    lastMatch = page->findText(searchID, word, NextResult, search->cachedCaseSensitivity, lastMatch);
-                else
-                    lastMatch = page->findText(searchID, word, FromTop, search->cachedCaseSensitivity);
-
-                if (!lastMatch)
-                    break;
-
+            const QVector<RegularAreaRect *> matches = page->findAllText(word, search->cachedCaseSensitivity);
+            for (RegularAreaRect *match : matches) {
                 // add highligh rect to the matches map
-                (*pageMatches)[page].append(MatchColor(lastMatch, wordColor));
-                wordMatched = true;
+                (*pageMatches)[page].append(MatchColor(match, wordColor));
             }
+            const bool wordMatched = !matches.isEmpty();
             allMatched = allMatched && wordMatched;
             anyMatched = anyMatched || wordMatched;
         }
@@ -1933,6 +2243,9 @@ QVariant DocumentPrivate::documentMetaData(const Generator::DocumentMetaDataKey
             break;
         }
         break;
+
+    case Generator::ImageCacheSizeMetaData:
+        return Utils::imageCacheSize();
     }
     return QVariant();
 }
@@ -2060,11 +2373,7 @@ void DocumentPrivate::loadSyncFile(const QString &filePath)
 void DocumentPrivate::clearAndWaitForRequests()
 {
     m_pixmapRequestsMutex.lock();
-    QLinkedList<PixmapRequest *>::const_iterator sIt = m_pixmapRequestsStack.constBegin();
-    QLinkedList<PixmapRequest *>::const_iterator sEnd = m_pixmapRequestsStack.constEnd();
-    for (; sIt != sEnd; ++sIt)
-        delete *sIt;
-    m_pixmapRequestsStack.clear();
+    qDeleteAll(m_pixmapRequestsQueue.takeAll());
     m_pixmapRequestsMutex.unlock();
 
     QEventLoop loop;
@@ -2259,6 +2568,8 @@ KPluginMetaData DocumentPrivate::generatorForMimeType(const QMimeType &type, QWi
 
 Document::OpenResult Document::openDocument(const QString &docFile, const QUrl &url, const QMimeType &_mime, const QString &password)
 {
+    d->m_openedWithPassword = !password.isEmpty();
+
     QMimeDatabase db;
     QMimeType mime = _mime;
     QByteArray filedata;
@@ -2386,6 +2697,7 @@ Document::OpenResult Document::openDocument(const QString &docFile, const QUrl &
     d->m_generatorName = offer.pluginId();
     d->m_pageController = new PageController();
     connect(d->m_pageController, &PageController::rotationFinished, this, [this](int p, Okular::Page *op) { d->rotationFinished(p, op); });
+    connect(d->m_pageController, &PageController::textExtractionFinished, this, [this](int p, Okular::TextPage *tp) { d->textExtractionFinished(p, tp); });
 
     for (Page *p : qAsConst(d->m_pagesVector))
         p->d->m_doc = d;
@@ -2408,6 +2720,14 @@ Document::OpenResult Document::openDocument(const QString &docFile, const QUrl &
     d->m_metadataLoadingCompleted = true;
     d->m_bookmarkManager->setUrl(d->m_url);
 
+    // open the on-disk cache of small pixmaps, it lives next to the docdata file
+    if (!d->m_archiveData && !d->m_xmlFileName.isEmpty() && !d->m_openedWithPassword && SettingsCore::persistentThumbnailCache()) {
+        QString cacheFileName = d->m_xmlFileName;
+        cacheFileName.replace(cacheFileName.length() - 4, 4, QStringLiteral(".thumbnails"));
+        d->m_thumbnailCache.open(cacheFileName, d->m_docFileName, d->thumbnailRenderSettings());
+    }
+    d->openTextIndex();
+
     // 3. setup observers internal lists and data
     foreachObserver(notifySetup(d->m_pagesVector, DocumentObserver::DocumentChanged | DocumentObserver::UrlChanged));
 
@@ -2519,6 +2839,8 @@ void Document::closeDocument()
         d->saveDocumentInfo();
         d->m_generator->closeDocument();
     }
+    d->m_thumbnailCache.close();
+    d->m_editedPages.clear();
 
     if (d->m_synctex_scanner) {
         synctex_scanner_free(d->m_synctex_scanner);
@@ -2569,15 +2891,24 @@ void Document::closeDocument()
     d->m_pagesVector.clear();
 
     // clear 'memory allocation' descriptors
-    qDeleteAll(d->m_allocatedPixmaps);
     d->m_allocatedPixmaps.clear();
+    d->m_compressedPixmaps.clear();
 
     // clear 'running searches' descriptors
+    QVector<int> cancelledSearches;
     QMap<int, RunningSearch *>::const_iterator rIt = d->m_searches.constBegin();
     QMap<int, RunningSearch *>::const_iterator rEnd = d->m_searches.constEnd();
-    for (; rIt != rEnd; ++rIt)
+    for (; rIt != rEnd; ++rIt) {
+        if (!(*rIt)->pagesPending.isEmpty())
+            cancelledSearches.append(rIt.key());
         delete *rIt;
+    }
     d->m_searches.clear();
+    d->m_textIndex.close();
+    for (int searchID : qAsConst(cancelledSearches)) {
+        QApplication::restoreOverrideCursor();
+        emit searchFinished(searchID, SearchCancelled);
+    }
 
     // clear the visible areas and notify the observers
     QVector<VisiblePageRect *>::const_iterator vIt = d->m_pageRects.constBegin();
@@ -2592,7 +2923,6 @@ void Document::closeDocument()
     d->m_viewportHistory.clear();
     d->m_viewportHistory.append(DocumentViewport());
     d->m_viewportIterator = d->m_viewportHistory.begin();
-    d->m_allocatedPixmapsTotalMemory = 0;
     d->m_allocatedTextPagesFifo.clear();
     d->m_pageSize = PageSize();
     d->m_pageSizes.clear();
@@ -2635,16 +2965,8 @@ void Document::removeObserver(DocumentObserver *pObserver)
             (*it)->deletePixmap(pObserver);
 
         // [MEM] free observer's allocation descriptors
-        QLinkedList<AllocatedPixmap *>::iterator aIt = d->m_allocatedPixmaps.begin();
-        QLinkedList<AllocatedPixmap *>::iterator aEnd = d->m_allocatedPixmaps.end();
-        while (aIt != aEnd) {
-            AllocatedPixmap *p = *aIt;
-            if (p->observer == pObserver) {
-                aIt = d->m_allocatedPixmaps.erase(aIt);
-                delete p;
-            } else
-                ++aIt;
-        }
+        qDeleteAll(d->m_allocatedPixmaps.takeAll(pObserver));
+        d->m_compressedPixmaps.remove(pObserver);
 
         for (PixmapRequest *executingRequest : qAsConst(d->m_executingPixmapRequests)) {
             if (executingRequest->observer() == pObserver) {
@@ -2674,13 +2996,14 @@ void Document::reparseConfig()
         }
 
         // [MEM] remove allocation descriptors
-        qDeleteAll(d->m_allocatedPixmaps);
         d->m_allocatedPixmaps.clear();
-        d->m_allocatedPixmapsTotalMemory = 0;
+        d->m_compressedPixmaps.clear();
+        d->m_thumbnailCache.clear();
 
         // send reload signals to observers
         foreachObserver(notifyContentsCleared(DocumentObserver::Pixmap));
     }
+    d->m_thumbnailCache.setRenderSettings(d->thumbnailRenderSettings());
 
     // free memory if in 'low' profile
     if (SettingsCore::memoryLevel() == SettingsCore::EnumMemoryLevel::Low && !d->m_allocatedPixmaps.isEmpty() && !d->m_pagesVector.isEmpty())
@@ -3148,14 +3471,11 @@ void Document::requestPixmaps(const QLinkedList<PixmapRequest *> &requests, Pixm
     }
     const bool removeAllPrevious = reqOptions & RemoveAllPrevious;
     d->m_pixmapRequestsMutex.lock();
-    QLinkedList<PixmapRequest *>::iterator sIt = d->m_pixmapRequestsStack.begin(), sEnd = d->m_pixmapRequestsStack.end();
-    while (sIt != sEnd) {
-        if ((*sIt)->observer() == requesterObserver && (removeAllPrevious || requestedPages.contains((*sIt)->pageNumber()))) {
-            // delete request and remove it from stack
-            delete *sIt;
-            sIt = d->m_pixmapRequestsStack.erase(sIt);
-        } else
-            ++sIt;
+    if (removeAllPrevious) {
+        qDeleteAll(d->m_pixmapRequestsQueue.take(requesterObserver));
+    } else {
+        for (int requestedPage : qAsConst(requestedPages))
+            qDeleteAll(d->m_pixmapRequestsQueue.take(requesterObserver, requestedPage));
     }
 
     // 1.B [PREPROCESS REQUESTS] tweak some values of the requests
@@ -3221,20 +3541,10 @@ void Document::requestPixmaps(const QLinkedList<PixmapRequest *> &requests, Pixm
         }
     }
 
-    // 2. [ADD TO STACK] add requests to stack
+    // 2. [ADD TO QUEUE] add requests to the queue, it keeps them sorted by priority
+    d->m_pixmapRequestsQueue.setViewportPage((*d->m_viewportIterator).pageNumber);
     for (PixmapRequest *request : requests) {
-        // add request to the 'stack' at the right place
-        if (!request->priority())
-            // add priority zero requests to the top of the stack
-            d->m_pixmapRequestsStack.append(request);
-        else {
-            // insert in stack sorted by priority
-            sIt = d->m_pixmapRequestsStack.begin();
-            sEnd = d->m_pixmapRequestsStack.end();
-            while (sIt != sEnd && (*sIt)->priority() > request->priority())
-                ++sIt;
-            d->m_pixmapRequestsStack.insert(sIt, request);
-        }
+        d->m_pixmapRequestsQueue.push(request);
     }
     d->m_pixmapRequestsMutex.unlock();
 
@@ -3260,13 +3570,31 @@ void Document::requestTextPage(uint pageNumber)
     d->m_generator->generateTextPage(kp);
 }
 
+QString Document::pageText(int pageNumber)
+{
+    Page *page = d->m_pagesVector.value(pageNumber);
+    if (!page)
+        return QString();
+
+    if (d->m_textIndex.hasPage(pageNumber))
+        return d->m_textIndex.text(pageNumber);
+
+    if (!page->hasTextPage())
+        requestTextPage(pageNumber);
+    return page->text();
+}
+
 void DocumentPrivate::notifyAnnotationChanges(int page)
 {
+    m_editedPages.insert(page);
+    m_thumbnailCache.remove(page);
     foreachObserverD(notifyPageChanged(page, DocumentObserver::Annotations));
 }
 
-void DocumentPrivate::notifyFormChanges(int /*page*/)
+void DocumentPrivate::notifyFormChanges(int page)
 {
+    m_editedPages.insert(page);
+    m_thumbnailCache.remove(page);
     recalculateForms();
 }
 
@@ -3587,8 +3915,16 @@ void Document::searchText(int searchID, const QString &text, bool fromStart, Qt:
         return;
     }
 
-    // if searchID search not recorded, create new descriptor and init params
+    // an indexed search with the same id still waiting for pages ends here,
+    // so that its wait cursor is restored before the new search sets one
     QMap<int, RunningSearch *>::iterator searchIt = d->m_searches.find(searchID);
+    if (searchIt != d->m_searches.end() && !(*searchIt)->pagesPending.isEmpty()) {
+        d->finishIndexedSearch(*searchIt, searchID, SearchCancelled);
+        // the receivers of searchFinished may have reset the search
+        searchIt = d->m_searches.find(searchID);
+    }
+
+    // if searchID search not recorded, create new descriptor and init params
     if (searchIt == d->m_searches.end()) {
         RunningSearch *search = new RunningSearch();
         search->continueOnPage = -1;
@@ -3620,6 +3956,12 @@ void Document::searchText(int searchID, const QString &text, bool fromStart, Qt:
 
     // 1. ALLDOC - process all document marking pages
     if (type == AllDocument) {
+        if (d->canExtractTextInBackground()) {
+            // look the text up in the index, extracting the missing pages in parallel
+            d->doIndexedAllDocumentSearch(searchID, pagesToNotify);
+            return;
+        }
+
         QMap<Page *, QVector<RegularAreaRect *>> *pageMatches = new QMap<Page *, QVector<RegularAreaRect *>>;
 
         // search and highlight 'text' (as a solid phrase) on all pages
@@ -3670,6 +4012,32 @@ void Document::searchText(int searchID, const QString &text, bool fromStart, Qt:
         // search and highlight every word in 'text' on all pages
         QTimer::singleShot(0, this, [this, pagesToNotify, pageMatches, searchID, words] { d->doContinueGooglesDocumentSearch(pagesToNotify, pageMatches, 0, searchID, words); });
     }
+    // 5. REGULAREXPRESSION - like ALLDOC, with the matches of an expression
+    else if (type == RegularExpression) {
+        const QRegularExpression::PatternOptions options = QRegularExpression::UseUnicodePropertiesOption | (caseSensitivity == Qt::CaseSensitive ? QRegularExpression::NoPatternOption : QRegularExpression::CaseInsensitiveOption);
+        s->cachedRegularExpression = QRegularExpression(text, options);
+        if (!s->cachedRegularExpression.isValid()) {
+            // only the highlights of the previous search are to be cleared
+            QApplication::restoreOverrideCursor();
+            s->isCurrentlySearching = false;
+            foreach (int pageNumber, *pagesToNotify)
+                foreachObserver(notifyPageChanged(pageNumber, DocumentObserver::Highlights));
+            delete pagesToNotify;
+            emit searchFinished(searchID, NoMatchFound);
+            return;
+        }
+
+        if (d->canExtractTextInBackground()) {
+            // match the pages as their text is extracted in parallel
+            d->doIndexedAllDocumentSearch(searchID, pagesToNotify);
+            return;
+        }
+
+        QMap<Page *, QVector<RegularAreaRect *>> *pageMatches = new QMap<Page *, QVector<RegularAreaRect *>>;
+
+        // search and highlight the matches of the expression on all pages
+        QTimer::singleShot(0, this, [this, pagesToNotify, pageMatches, searchID] { d->doContinueAllDocumentSearch(pagesToNotify, pageMatches, 0, searchID); });
+    }
 }
 
 void Document::continueSearch(int searchID)
@@ -3716,6 +4084,12 @@ void Document::resetSearch(int searchID)
     // get previous parameters for search
     RunningSearch *s = *searchIt;
 
+    // an indexed search still waiting for pages ends here
+    if (!s->pagesPending.isEmpty()) {
+        QApplication::restoreOverrideCursor();
+        emit searchFinished(searchID, SearchCancelled);
+    }
+
     // unhighlight pages and inform observers about that
     for (const int pageNumber : qAsConst(s->highlightedPages)) {
         d->m_pagesVector.at(pageNumber)->d->deleteHighlights(searchID);
@@ -3733,6 +4107,9 @@ void Document::resetSearch(int searchID)
 void Document::cancelSearch()
 {
     d->m_searchCancelled = true;
+
+    // indexed searches are not polled, they end right away
+    d->cancelIndexedSearches();
 }
 
 void Document::undo()
@@ -4429,6 +4806,9 @@ bool Document::swapBackingFile(const QString &newFileName, const QUrl &url)
     // Save metadata about the file we're about to close
     d->saveDocumentInfo();
 
+    d->cancelIndexedSearches();
+    if (d->m_pageController)
+        d->m_pageController->waitForTextExtractions();
     d->clearAndWaitForRequests();
 
     qCDebug(OkularCoreDebug) << "Swapping backing file to" << newFileName;
@@ -4489,6 +4869,7 @@ bool Document::swapBackingFile(const QString &newFileName, const QUrl &url)
         d->m_url = url;
         d->m_docFileName = newFileName;
         d->updateMetadataXmlNameAndDocSize();
+        d->openTextIndex();
         d->m_bookmarkManager->setUrl(d->m_url);
         d->m_documentInfo = DocumentInfo();
         d->m_documentInfoAskedKeys.clear();
@@ -4963,16 +5344,8 @@ void DocumentPrivate::requestDone(PixmapRequest *req)
 
     if (!req->shouldAbortRender()) {
         // [MEM] 1.1 find and remove a previous entry for the same page and id
-        QLinkedList<AllocatedPixmap *>::iterator aIt = m_allocatedPixmaps.begin();
-        QLinkedList<AllocatedPixmap *>::iterator aEnd = m_allocatedPixmaps.end();
-        for (; aIt != aEnd; ++aIt)
-            if ((*aIt)->page == req->pageNumber() && (*aIt)->observer == req->observer()) {
-                AllocatedPixmap *p = *aIt;
-                m_allocatedPixmaps.erase(aIt);
-                m_allocatedPixmapsTotalMemory -= p->memory;
-                delete p;
-                break;
-            }
+        delete m_allocatedPixmaps.take(req->observer(), req->pageNumber());
+        m_compressedPixmaps.remove(req->observer(), req->pageNumber());
 
         DocumentObserver *observer = req->observer();
         if (m_observers.contains(observer)) {
@@ -4985,8 +5358,10 @@ void DocumentPrivate::requestDone(PixmapRequest *req)
                 memoryBytes = 4 * req->width() * req->height();
 
             AllocatedPixmap *memoryPage = new AllocatedPixmap(req->observer(), req->pageNumber(), memoryBytes);
-            m_allocatedPixmaps.append(memoryPage);
-            m_allocatedPixmapsTotalMemory += memoryBytes;
+            m_allocatedPixmaps.insert(memoryPage);
+
+            // [MEM] 1.3 keep small pixmaps around for the next time the document is opened
+            storeThumbnailPixmap(req);
 
             // 2. notify an observer that its pixmap changed
             observer->notifyPageChanged(req->pageNumber(), DocumentObserver::Pixmap);
@@ -5005,9 +5380,9 @@ void DocumentPrivate::requestDone(PixmapRequest *req)
 
     // 4. start a new generation if some is pending
     m_pixmapRequestsMutex.lock();
-    bool hasPixmaps = !m_pixmapRequestsStack.isEmpty();
+    bool hasPixmaps = !m_pixmapRequestsQueue.isEmpty();
     m_pixmapRequestsMutex.unlock();
-    if (hasPixmaps)
+    if (hasPixmaps && !m_restoringCachedPixmap)
         sendGeneratorPixmapRequest();
 }
 
@@ -5068,6 +5443,10 @@ void DocumentPrivate::textGenerationDone(Page *page)
 
     // 2. Add the page to the fifo of generated text pages
     m_allocatedTextPagesFifo.append(page->number());
+
+    // 3. Index its words, so whole document searches do not need it again
+    if (!m_textIndex.hasPage(page->number()) && page->hasTextPage())
+        m_textIndex.addPage(page->number(), page->text());
 }
 
 void Document::setRotation(int r)
@@ -5086,6 +5465,8 @@ void DocumentPrivate::setRotationInternal(int r, bool notify)
     QVector<Okular::Page *>::const_iterator pEnd = m_pagesVector.constEnd();
     for (; pIt != pEnd; ++pIt)
         (*pIt)->d->rotateAt(rotation);
+    // compressed pixmaps are stored rotated
+    m_compressedPixmaps.clear();
     if (notify) {
         // notify the generator that the current rotation has changed
         m_generator->rotationChanged(rotation, m_rotation);
@@ -5117,13 +5498,13 @@ void Document::setPageSize(const PageSize &size)
     for (; pIt != pEnd; ++pIt)
         (*pIt)->d->changeSize(size);
     // clear 'memory allocation' descriptors
-    qDeleteAll(d->m_allocatedPixmaps);
     d->m_allocatedPixmaps.clear();
-    d->m_allocatedPixmapsTotalMemory = 0;
+    d->m_compressedPixmaps.clear();
     // notify the generator that the current page size has changed
     d->m_generator->pageSizeChanged(size, d->m_pageSize);
     // set the new page size
     d->m_pageSize = size;
+    d->m_thumbnailCache.setRenderSettings(d->thumbnailRenderSettings());
 
     foreachObserver(notifySetup(d->m_pagesVector, DocumentObserver::NewLayoutForPages));
     foreachObserver(notifyContentsCleared(DocumentObserver::Pixmap | DocumentObserver::Highlights));
@@ -510,6 +510,16 @@ public:
      */
     void requestTextPage(uint pageNumber);
 
+    /**
+     * Returns the whole text of the page @p pageNumber.
+     *
+     * The text of the pages whose words are in the text index of the document
+     * is taken from there, the others are sent a request for text page generation.
+     *
+     * @since 21.04
+     */
+    QString pageText(int pageNumber);
+
     /**
      * Adds a new @p annotation to the given @p page.
      */
@@ -623,8 +633,9 @@ public:
         NextMatch,     ///< Search next match
         PreviousMatch, ///< Search previous match
         AllDocument,   ///< Search complete document
-        GoogleAll,     ///< Search complete document (all words in google style)
-        GoogleAny      ///< Search complete document (any words in google style)
+        GoogleAll,        ///< Search complete document (all words in google style)
+        GoogleAny,        ///< Search complete document (any words in google style)
+        RegularExpression ///< Search complete document for the matches of a regular expression, e.g. use \\b for whole words (@since 21.04)
     };
 
     /**
@@ -25,11 +25,17 @@
 #include <QMap>
 #include <QMutex>
 #include <QPointer>
+#include <QSet>
 #include <QUrl>
 
 // local includes
+#include "allocatedpixmapcache_p.h"
+#include "compressedpixmapcache_p.h"
 #include "fontinfo.h"
 #include "generator.h"
+#include "pixmaprequestqueue_p.h"
+#include "textindex_p.h"
+#include "thumbnailcache_p.h"
 
 class QUndoStack;
 class QEventLoop;
@@ -38,7 +44,6 @@ class QTimer;
 class QTemporaryFile;
 class KPluginMetaData;
 
-struct AllocatedPixmap;
 struct ArchiveData;
 struct RunningSearch;
 
@@ -112,9 +117,10 @@ public:
         : m_parent(parent)
         , m_tempFile(nullptr)
         , m_docSize(-1)
-        , m_allocatedPixmapsTotalMemory(0)
         , m_maxAllocatedTextPages(0)
         , m_warnedOutOfMemory(false)
+        , m_restoringCachedPixmap(false)
+        , m_openedWithPassword(false)
         , m_rotation(Rotation0)
         , m_exportCached(false)
         , m_bookmarkManager(nullptr)
@@ -145,8 +151,14 @@ public:
     void cleanupPixmapMemory();
     void cleanupPixmapMemory(qulonglong memoryToFree);
     AllocatedPixmap *searchLowestPriorityPixmap(bool unloadableOnly = false, bool thenRemoveIt = false, DocumentObserver *observer = nullptr /* any */);
+    void updateCompressedPixmapsBudget();
+    void storeEvictedPixmap(const AllocatedPixmap *p);
+    bool hasCachedPixmap(const PixmapRequest *request) const;
+    bool restoreCachedPixmap(PixmapRequest *request);
+    void storeThumbnailPixmap(const PixmapRequest *request);
+    QByteArray thumbnailRenderSettings() const;
     void calculateMaxTextPages();
-    qulonglong getTotalMemory();
+    static qulonglong getTotalMemory();
     qulonglong getFreeMemory(qulonglong *freeSwap = nullptr);
     bool loadDocumentInfo(LoadDocumentInfoFlags loadWhat);
     bool loadDocumentInfo(QFile &infoFile, LoadDocumentInfoFlags loadWhat);
@@ -173,6 +185,7 @@ public:
     bool canRemoveExternalAnnotations() const;
     OKULARCORE_EXPORT static QString docDataFileName(const QUrl &url, qint64 document_size);
     bool cancelRenderingBecauseOf(PixmapRequest *executingRequest, PixmapRequest *newRequest);
+    bool isPixmapBeingGenerated(DocumentObserver *observer, int pageNumber) const;
 
     // Methods that implement functionality needed by undo commands
     void performAddPageAnnotation(int page, Annotation *annotation);
@@ -186,6 +199,7 @@ public:
     void saveDocumentInfo() const;
     void slotTimedMemoryCheck();
     void sendGeneratorPixmapRequest();
+    bool dispatchPixmapRequest();
     void rotationFinished(int page, Okular::Page *okularPage);
     void slotFontReadingProgress(int page);
     void fontReadingGotFont(const Okular::FontInfo &font);
@@ -198,6 +212,26 @@ public:
 
     void doProcessSearchMatch(RegularAreaRect *match, RunningSearch *search, QSet<int> *pagesToNotify, int currentPage, int searchID, bool moveViewport, const QColor &color);
 
+    /**
+     * Whether the text of the pages can be extracted in the background,
+     * to run whole document searches with doIndexedAllDocumentSearch().
+     */
+    bool canExtractTextInBackground() const;
+
+    /**
+     * Highlights the matches of the whole document search @p searchID on
+     * the pages whose text is there, one page per event loop iteration with
+     * doContinueIndexedSearch(), and extracts the text of the other pages in
+     * the background to highlight their matches as they are done.
+     */
+    void doIndexedAllDocumentSearch(int searchID, QSet<int> *pagesToNotify);
+    void doContinueIndexedSearch(int searchID);
+    void searchIndexedPage(RunningSearch *search, int searchID, Page *page);
+    void finishIndexedSearch(RunningSearch *search, int searchID, Document::SearchStatus status);
+    void cancelIndexedSearches();
+    void openTextIndex();
+    void textExtractionFinished(int pageNumber, TextPage *textPage);
+
     /**
      * Executes a JavaScript script from the setInterval function.
      *
@@ -270,14 +304,24 @@ public:
 
     // observers / requests / allocator stuff
     QSet<DocumentObserver *> m_observers;
-    QLinkedList<PixmapRequest *> m_pixmapRequestsStack;
+    PixmapRequestQueue m_pixmapRequestsQueue;
     QLinkedList<PixmapRequest *> m_executingPixmapRequests;
     QMutex m_pixmapRequestsMutex;
-    QLinkedList<AllocatedPixmap *> m_allocatedPixmaps;
-    qulonglong m_allocatedPixmapsTotalMemory;
+    AllocatedPixmapCache m_allocatedPixmaps;
+    CompressedPixmapCache m_compressedPixmaps;
+    ThumbnailCache m_thumbnailCache;
+    // pages whose annotations or forms were edited since the document was opened, their pixmaps are not stored on disk
+    QSet<int> m_editedPages;
+    // the decrypted contents of documents that needed a password are never stored on disk
+    bool m_openedWithPassword;
+
+    // words of the pages whose text has been extracted, for whole document searches
+    TextIndex m_textIndex;
     QList<int> m_allocatedTextPagesFifo;
     int m_maxAllocatedTextPages;
     bool m_warnedOutOfMemory;
+    // requestDone() must not dispatch the next request while a cached pixmap is restored
+    bool m_restoringCachedPixmap;
 
     // the rotation applied to the document
     Rotation m_rotation;
@@ -32,6 +32,7 @@
 #include "document_p.h"
 #include "page.h"
 #include "page_p.h"
+#include "settings_core.h"
 #include "textpage.h"
 #include "utils.h"
 
@@ -39,9 +40,8 @@ using namespace Okular;
 
 GeneratorPrivate::GeneratorPrivate()
     : m_document(nullptr)
-    , mPixmapGenerationThread(nullptr)
     , mTextPageGenerationThread(nullptr)
-    , mPixmapReady(true)
+    , mRunningPixmapGenerations(0)
     , mTextPageReady(true)
     , m_closing(false)
     , m_closingLoop(nullptr)
@@ -52,10 +52,10 @@ GeneratorPrivate::GeneratorPrivate()
 
 GeneratorPrivate::~GeneratorPrivate()
 {
-    if (mPixmapGenerationThread)
-        mPixmapGenerationThread->wait();
-
-    delete mPixmapGenerationThread;
+    for (PixmapGenerationThread *thread : qAsConst(mPixmapGenerationThreads)) {
+        thread->wait();
+        delete thread;
+    }
 
     if (mTextPageGenerationThread)
         mTextPageGenerationThread->wait();
@@ -65,15 +65,22 @@ GeneratorPrivate::~GeneratorPrivate()
 
 PixmapGenerationThread *GeneratorPrivate::pixmapGenerationThread()
 {
-    if (mPixmapGenerationThread)
-        return mPixmapGenerationThread;
+    // a thread is busy from startGeneration() until pixmapGenerationFinished() ran
+    for (PixmapGenerationThread *thread : qAsConst(mPixmapGenerationThreads)) {
+        if (!thread->request())
+            return thread;
+    }
+
+    if (mPixmapGenerationThreads.count() >= maxPixmapGenerationThreads())
+        return nullptr;
 
     Q_Q(Generator);
-    mPixmapGenerationThread = new PixmapGenerationThread(q);
+    PixmapGenerationThread *thread = new PixmapGenerationThread(q);
     QObject::connect(
-        mPixmapGenerationThread, &PixmapGenerationThread::finished, q, [this] { pixmapGenerationFinished(); }, Qt::QueuedConnection);
+        thread, &PixmapGenerationThread::finished, q, [this, thread] { pixmapGenerationFinished(thread); }, Qt::QueuedConnection);
+    mPixmapGenerationThreads.append(thread);
 
-    return mPixmapGenerationThread;
+    return thread;
 }
 
 TextPageGenerationThread *GeneratorPrivate::textPageGenerationThread()
@@ -89,19 +96,31 @@ TextPageGenerationThread *GeneratorPrivate::textPageGenerationThread()
     return mTextPageGenerationThread;
 }
 
-void GeneratorPrivate::pixmapGenerationFinished()
+int GeneratorPrivate::maxPixmapGenerationThreads() const
+{
+    if (!m_features.contains(Generator::ParallelRendering) || !m_document)
+        return 1;
+
+    const int configuredThreads = SettingsCore::renderingThreads();
+    if (configuredThreads > 0)
+        return configuredThreads;
+
+    return qBound(1, QThread::idealThreadCount(), 8);
+}
+
+void GeneratorPrivate::pixmapGenerationFinished(PixmapGenerationThread *thread)
 {
     Q_Q(Generator);
-    PixmapRequest *request = mPixmapGenerationThread->request();
-    const QImage &img = mPixmapGenerationThread->image();
-    mPixmapGenerationThread->endGeneration();
+    PixmapRequest *request = thread->request();
+    const QImage img = thread->image();
+    thread->endGeneration();
 
     QMutexLocker locker(threadsLock());
 
     if (m_closing) {
-        mPixmapReady = true;
+        --mRunningPixmapGenerations;
         delete request;
-        if (mTextPageReady) {
+        if (mRunningPixmapGenerations == 0 && mTextPageReady) {
             locker.unlock();
             m_closingLoop->quit();
         }
@@ -112,17 +131,17 @@ void GeneratorPrivate::pixmapGenerationFinished()
         request->page()->setPixmap(request->observer(), new QPixmap(QPixmap::fromImage(img)), request->normalizedRect());
         const int pageNumber = request->page()->number();
 
-        if (mPixmapGenerationThread->calcBoundingBox())
-            q->updatePageBoundingBox(pageNumber, mPixmapGenerationThread->boundingBox());
+        if (thread->calcBoundingBox())
+            q->updatePageBoundingBox(pageNumber, thread->boundingBox());
     } else {
         // Cancel the text page generation too if it's still running
-        if (mTextPageGenerationThread && mTextPageGenerationThread->isRunning()) {
+        if (mTextPageGenerationThread && mTextPageGenerationThread->isRunning() && mTextPageGenerationThread->page() == request->page()) {
             mTextPageGenerationThread->abortExtraction();
             mTextPageGenerationThread->wait();
         }
     }
 
-    mPixmapReady = true;
+    --mRunningPixmapGenerations;
     q->signalPixmapRequestDone(request);
 }
 
@@ -137,7 +156,7 @@ void GeneratorPrivate::textpageGenerationFinished()
 
     if (m_closing) {
         delete mTextPageGenerationThread->textPage();
-        if (mPixmapReady) {
+        if (mRunningPixmapGenerations == 0) {
             locker.unlock();
             m_closingLoop->quit();
         }
@@ -146,7 +165,8 @@ void GeneratorPrivate::textpageGenerationFinished()
 
     if (mTextPageGenerationThread->textPage()) {
         TextPage *tp = mTextPageGenerationThread->textPage();
-        page->setTextPage(tp);
+        // the text order was already corrected by the thread
+        PagePrivate::get(page)->setOrderedTextPage(tp);
         q->signalTextGenerationDone(page, tp);
     }
 }
@@ -220,7 +240,7 @@ bool Generator::closeDocument()
     d->m_closing = true;
 
     d->threadsLock()->lock();
-    if (!(d->mPixmapReady && d->mTextPageReady)) {
+    if (d->mRunningPixmapGenerations > 0 || !d->mTextPageReady) {
         QEventLoop loop;
         d->m_closingLoop = &loop;
 
@@ -243,7 +263,7 @@ bool Generator::closeDocument()
 bool Generator::canGeneratePixmap() const
 {
     Q_D(const Generator);
-    return d->mPixmapReady;
+    return d->mRunningPixmapGenerations < d->maxPixmapGenerationThreads();
 }
 
 bool Generator::canSign() const
@@ -264,7 +284,7 @@ CertificateStore *Generator::certificateStore() const
 void Generator::generatePixmap(PixmapRequest *request)
 {
     Q_D(Generator);
-    d->mPixmapReady = false;
+    ++d->mRunningPixmapGenerations;
 
     const bool calcBoundingBox = !request->isTile() && !request->page()->isBoundingBoxKnown();
 
@@ -273,10 +293,17 @@ void Generator::generatePixmap(PixmapRequest *request)
             // It can happen that the text generation has already finished but
             // mTextPageReady is still false because textpageGenerationFinished
             // didn't have time to run, if so queue ourselves
-            QTimer::singleShot(0, this, [this, request] { generatePixmap(request); });
+            // (keeping our generation slot reserved in the meantime)
+            QTimer::singleShot(0, this, [this, request] {
+                --d_ptr->mRunningPixmapGenerations;
+                generatePixmap(request);
+            });
             return;
         }
 
+        PixmapGenerationThread *pixmapThread = d->pixmapGenerationThread();
+        Q_ASSERT(pixmapThread);
+
         /**
          * We create the text page for every page that is visible to the
          * user, so he can use the text extraction tools without a delay.
@@ -288,13 +315,13 @@ void Generator::generatePixmap(PixmapRequest *request)
             // dummy is used as a way to make sure the lambda gets disconnected each time it is executed
             // since not all the times the pixmap generation thread starts we want the text generation thread to also start
             QObject *dummy = new QObject();
-            connect(d_ptr->pixmapGenerationThread(), &QThread::started, dummy, [this, dummy] {
+            connect(pixmapThread, &QThread::started, dummy, [this, dummy] {
                 delete dummy;
                 d_ptr->textPageGenerationThread()->startGeneration();
             });
         }
         // pixmap generation thread must be started *after* connect(), else we may miss the start signal and get lock-ups (see bug 396137)
-        d->pixmapGenerationThread()->startGeneration(request, calcBoundingBox);
+        pixmapThread->startGeneration(request, calcBoundingBox);
 
         return;
     }
@@ -303,7 +330,7 @@ void Generator::generatePixmap(PixmapRequest *request)
     request->page()->setPixmap(request->observer(), new QPixmap(QPixmap::fromImage(img)), request->normalizedRect());
     const int pageNumber = request->page()->number();
 
-    d->mPixmapReady = true;
+    --d->mRunningPixmapGenerations;
 
     signalPixmapRequestDone(request);
     if (calcBoundingBox)
@@ -578,6 +605,7 @@ PixmapRequest::PixmapRequest(DocumentObserver *observer, int pageNumber, int wid
     d->mHeight = ceil(height * qApp->devicePixelRatio());
     d->mPriority = priority;
     d->mFeatures = features;
+    d->mQueueIndex = -1;
     d->mForce = false;
     d->mTile = false;
     d->mNormalizedRect = NormalizedRect();
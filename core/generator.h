@@ -192,6 +192,7 @@ class OKULARCORE_EXPORT Generator : public QObject
     /// @cond PRIVATE
     friend class PixmapGenerationThread;
     friend class TextPageGenerationThread;
+    friend class TextExtractionJobInternal;
     /// @endcond
 
     Q_OBJECT
@@ -202,17 +203,19 @@ public:
      * provide.
      */
     enum GeneratorFeature {
-        Threaded,          ///< Whether the Generator supports asynchronous generation of pictures or text pages
-        TextExtraction,    ///< Whether the Generator can extract text from the document in the form of TextPage's
-        ReadRawData,       ///< Whether the Generator can read a document directly from its raw data.
-        FontInfo,          ///< Whether the Generator can provide information about the fonts used in the document
-        PageSizes,         ///< Whether the Generator can change the size of the document pages.
-        PrintNative,       ///< Whether the Generator supports native cross-platform printing (QPainter-based).
-        PrintPostscript,   ///< Whether the Generator supports postscript-based file printing.
-        PrintToFile,       ///< Whether the Generator supports export to PDF & PS through the Print Dialog
-        TiledRendering,    ///< Whether the Generator can render tiles @since 0.16 (KDE 4.10)
-        SwapBackingFile,   ///< Whether the Generator can hot-swap the file it's reading from @since 1.3
-        SupportsCancelling ///< Whether the Generator can cancel requests @since 1.4
+        Threaded,              ///< Whether the Generator supports asynchronous generation of pictures or text pages
+        TextExtraction,        ///< Whether the Generator can extract text from the document in the form of TextPage's
+        ReadRawData,           ///< Whether the Generator can read a document directly from its raw data.
+        FontInfo,              ///< Whether the Generator can provide information about the fonts used in the document
+        PageSizes,             ///< Whether the Generator can change the size of the document pages.
+        PrintNative,           ///< Whether the Generator supports native cross-platform printing (QPainter-based).
+        PrintPostscript,       ///< Whether the Generator supports postscript-based file printing.
+        PrintToFile,           ///< Whether the Generator supports export to PDF & PS through the Print Dialog
+        TiledRendering,        ///< Whether the Generator can render tiles @since 0.16 (KDE 4.10)
+        SwapBackingFile,       ///< Whether the Generator can hot-swap the file it's reading from @since 1.3
+        SupportsCancelling,    ///< Whether the Generator can cancel requests @since 1.4
+        ParallelRendering,     ///< Whether the Generator can render several pixmap requests at the same time from different threads @since 21.04
+        ParallelTextExtraction ///< Whether the Generator can extract the text of several pages at the same time from different threads @since 21.04
     };
 
     /**
@@ -305,6 +308,9 @@ public:
     /**
      * This method returns whether the generator is ready to
      * handle a new pixmap request.
+     *
+     * Generators with the @ref ParallelRendering feature are ready as long as
+     * one of their rendering threads is idle.
      */
     virtual bool canGeneratePixmap() const;
 
@@ -525,6 +531,9 @@ protected:
      *
      * @warning this method may be executed in its own separated thread if the
      * @ref Threaded is enabled!
+     *
+     * @warning if @ref ParallelRendering is enabled this method may be executed
+     * by several threads at the same time, each one with a different request.
      */
     virtual QImage image(PixmapRequest *request);
 
@@ -536,6 +545,9 @@ protected:
      * @warning this method may be executed in its own separated thread if the
      * @ref Threaded is enabled!
      *
+     * @warning if @ref ParallelTextExtraction is enabled this method may be executed
+     * by several threads at the same time, each one with a different request.
+     *
      * @since 1.4
      */
     virtual TextPage *textPage(TextRequest *request);
@@ -557,7 +569,8 @@ protected:
         PaperColorMetaData,        ///< Returns (QColor) the paper color if set in Settings or the default color (white) if option is true (otherwise returns a non initialized QColor)
         TextAntialiasMetaData,     ///< Returns (bool) text antialias from Settings (option is not used)
         GraphicsAntialiasMetaData, ///< Returns (bool)graphic antialias from Settings (option is not used)
-        TextHintingMetaData        ///< Returns (bool)text hinting from Settings (option is not used)
+        TextHintingMetaData,       ///< Returns (bool)text hinting from Settings (option is not used)
+        ImageCacheSizeMetaData     ///< Returns (qulonglong) how many bytes of decoded images the generator may keep cached, following the memory level in Settings (option is not used) @since 21.04
     };
 
     /**
@@ -12,6 +12,7 @@
 #include <QDebug>
 
 #include "fontinfo.h"
+#include "page_p.h"
 #include "utils.h"
 
 using namespace Okular;
@@ -69,6 +70,8 @@ void PixmapGenerationThread::run()
 TextPageGenerationThread::TextPageGenerationThread(Generator *generator)
     : mGenerator(generator)
     , mTextPage(nullptr)
+    , mPageWidth(0)
+    , mPageHeight(0)
 {
     TextRequestPrivate *treqPriv = TextRequestPrivate::get(&mTextRequest);
     treqPriv->mPage = nullptr;
@@ -94,6 +97,12 @@ void TextPageGenerationThread::setPage(Page *page)
     TextRequestPrivate *treqPriv = TextRequestPrivate::get(&mTextRequest);
     treqPriv->mPage = page;
     treqPriv->mShouldAbortExtraction = 0;
+
+    if (page) {
+        mPageWidth = page->width();
+        mPageHeight = page->height();
+        mPageBoundingBox = page->boundingBox();
+    }
 }
 
 Page *TextPageGenerationThread::page() const
@@ -132,6 +141,11 @@ void TextPageGenerationThread::run()
         delete mTextPage;
         mTextPage = nullptr;
     }
+
+    // the layout analysis of dense pages is slow, do it here rather than
+    // when the text is handed over to the page in the main thread
+    if (mTextPage)
+        PagePrivate::correctTextOrder(page(), mTextPage, mPageWidth, mPageHeight, mPageBoundingBox);
 }
 
 FontExtractionThread::FontExtractionThread(Generator *generator, int pages)
@@ -19,6 +19,7 @@
 #include <QMutex>
 #include <QSet>
 #include <QThread>
+#include <QVector>
 
 class QEventLoop;
 
@@ -50,8 +51,9 @@ public:
 
     PixmapGenerationThread *pixmapGenerationThread();
     TextPageGenerationThread *textPageGenerationThread();
+    int maxPixmapGenerationThreads() const;
 
-    void pixmapGenerationFinished();
+    void pixmapGenerationFinished(PixmapGenerationThread *thread);
     void textpageGenerationFinished();
 
     QMutex *threadsLock();
@@ -63,11 +65,12 @@ public:
     // NOTE: the following should be a QSet< GeneratorFeature >,
     // but it is not to avoid #include'ing generator.h
     QSet<int> m_features;
-    PixmapGenerationThread *mPixmapGenerationThread;
+    // only one of them is used unless the generator has the ParallelRendering feature
+    QVector<PixmapGenerationThread *> mPixmapGenerationThreads;
     TextPageGenerationThread *mTextPageGenerationThread;
     mutable QMutex m_mutex;
     QMutex m_threadsMutex;
-    bool mPixmapReady : 1;
+    int mRunningPixmapGenerations;
     bool mTextPageReady : 1;
     bool m_closing : 1;
     QEventLoop *m_closingLoop;
@@ -88,6 +91,7 @@ public:
     int mHeight;
     int mPriority;
     int mFeatures;
+    int mQueueIndex; // position in the PixmapRequestQueue, -1 if not queued
     bool mForce : 1;
     bool mTile : 1;
     bool mPartialUpdatesWanted : 1;
@@ -160,6 +164,10 @@ private:
     Generator *mGenerator;
     TextPage *mTextPage;
     TextRequest mTextRequest;
+    // the geometry of the page, copied by setPage() in the main thread which may change it during the generation
+    double mPageWidth;
+    double mPageHeight;
+    NormalizedRect mPageBoundingBox;
 };
 
 class FontExtractionThread : public QThread
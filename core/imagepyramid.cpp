@@ -0,0 +1,134 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by the Okular developers                           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include "imagepyramid.h"
+
+#include <QMutex>
+#include <QPainter>
+#include <QVector>
+
+using namespace Okular;
+
+static QSize halfSize(const QSize &size)
+{
+    return QSize(qMax(1, size.width() / 2), qMax(1, size.height() / 2));
+}
+
+class ImagePyramid::Private
+{
+public:
+    Private()
+        : m_levelCount(0)
+    {
+    }
+
+    QMutex m_mutex;
+    // the levels built so far, the first one is the image itself
+    QVector<QImage> m_levels;
+    int m_levelCount;
+};
+
+ImagePyramid::ImagePyramid()
+    : d(new Private)
+{
+}
+
+ImagePyramid::~ImagePyramid()
+{
+    delete d;
+}
+
+void ImagePyramid::setImage(const QImage &image)
+{
+    QMutexLocker locker(&d->m_mutex);
+
+    d->m_levels.clear();
+    d->m_levelCount = 0;
+    if (image.isNull())
+        return;
+
+    d->m_levels.append(image);
+    QSize size = image.size();
+    d->m_levelCount = 1;
+    while (size.width() > 1 || size.height() > 1) {
+        size = halfSize(size);
+        ++d->m_levelCount;
+    }
+}
+
+QImage ImagePyramid::image() const
+{
+    QMutexLocker locker(&d->m_mutex);
+    return d->m_levels.isEmpty() ? QImage() : d->m_levels.first();
+}
+
+int ImagePyramid::levelCount() const
+{
+    QMutexLocker locker(&d->m_mutex);
+    return d->m_levelCount;
+}
+
+QImage ImagePyramid::level(int index) const
+{
+    QMutexLocker locker(&d->m_mutex);
+    if (index < 0 || index >= d->m_levelCount)
+        return QImage();
+
+    // each level is built from the previous one, which is cheaper than
+    // scaling the full image and averages the same pixels
+    while (d->m_levels.count() <= index) {
+        const QImage previous = d->m_levels.last();
+        d->m_levels.append(previous.scaled(halfSize(previous.size()), Qt::IgnoreAspectRatio, Qt::SmoothTransformation));
+    }
+    return d->m_levels.at(index);
+}
+
+QImage ImagePyramid::scaled(const QSize &size, const QRect &rect) const
+{
+    if (size.isEmpty())
+        return QImage();
+
+    const QRect wholeRect(QPoint(0, 0), size);
+    const QRect targetRect = rect.isNull() ? wholeRect : rect;
+
+    // the smallest level that is still at least as large as the result
+    int index = 0;
+    QSize levelSize = image().size();
+    if (levelSize.isEmpty())
+        return QImage();
+    const int count = levelCount();
+    while (index + 1 < count) {
+        const QSize nextSize = halfSize(levelSize);
+        if (nextSize.width() < size.width() || nextSize.height() < size.height())
+            break;
+        levelSize = nextSize;
+        ++index;
+    }
+    const QImage source = level(index);
+
+    if (source.size() == size)
+        return targetRect == wholeRect ? source : source.copy(targetRect);
+
+    if (targetRect == wholeRect)
+        return source.scaled(size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+
+    const qreal xScale = qreal(source.width()) / size.width();
+    const qreal yScale = qreal(source.height()) / size.height();
+    const QRectF sourceRect(targetRect.x() * xScale, targetRect.y() * yScale, targetRect.width() * xScale, targetRect.height() * yScale);
+
+    QImage result(targetRect.size(), source.hasAlphaChannel() ? QImage::Format_ARGB32_Premultiplied : QImage::Format_RGB32);
+    result.fill(source.hasAlphaChannel() ? Qt::transparent : Qt::white);
+    QPainter painter(&result);
+    painter.setRenderHint(QPainter::SmoothPixmapTransform);
+    painter.drawImage(QRectF(result.rect()), source, sourceRect);
+    painter.end();
+    return result;
+}
+
+/* kate: replace-tabs on; indent-width 4; */
@@ -0,0 +1,96 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by the Okular developers                           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef _OKULAR_IMAGEPYRAMID_H_
+#define _OKULAR_IMAGEPYRAMID_H_
+
+#include <QImage>
+#include <QRect>
+
+#include "okularcore_export.h"
+
+namespace Okular
+{
+/**
+ * @short Scales a large image quickly, using copies of it at lower resolutions.
+ *
+ * The pyramid holds the image at its own resolution, level 0, and at each
+ * half of the previous resolution down to a single pixel. Levels are built
+ * from the previous one the first time they are needed, and then kept.
+ *
+ * scaled() starts from the smallest level at least as large as the
+ * requested size, so the cost of a request depends on the requested size
+ * rather than on the size of the image. Generators showing a single large
+ * image can serve both whole page and tile requests with it:
+ *
+ * @code
+ * QImage MyGenerator::image(Okular::PixmapRequest *request)
+ * {
+ *     const QSize size(request->width(), request->height());
+ *     const QRect rect = request->isTile() ? request->normalizedRect().geometry(size.width(), size.height()) : QRect(QPoint(0, 0), size);
+ *     return m_pyramid.scaled(size, rect);
+ * }
+ * @endcode
+ *
+ * All methods are thread safe.
+ *
+ * @since 21.04
+ */
+class OKULARCORE_EXPORT ImagePyramid
+{
+public:
+    /**
+     * Creates an empty pyramid.
+     */
+    ImagePyramid();
+
+    ~ImagePyramid();
+
+    /**
+     * Sets the full resolution @p image, dropping the levels of the previous one.
+     */
+    void setImage(const QImage &image);
+
+    /**
+     * Returns the full resolution image.
+     */
+    QImage image() const;
+
+    /**
+     * Returns the number of levels, including the full resolution one.
+     */
+    int levelCount() const;
+
+    /**
+     * Returns the level @p index, which is the image reduced @p index times by half.
+     *
+     * The level is built if needed.
+     */
+    QImage level(int index) const;
+
+    /**
+     * Returns the part @p rect of the image scaled to @p size.
+     *
+     * @p rect is in the coordinates of the scaled image; by default, the
+     * whole scaled image is returned.
+     */
+    QImage scaled(const QSize &size, const QRect &rect = QRect()) const;
+
+private:
+    class Private;
+    Private *const d;
+
+    Q_DISABLE_COPY(ImagePyramid)
+};
+
+}
+
+#endif
+
+/* kate: replace-tabs on; indent-width 4; */
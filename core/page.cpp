@@ -315,6 +315,22 @@ RegularAreaRect *Page::findText(int id, const QString &text, SearchDirection dir
     return rect;
 }
 
+QVector<RegularAreaRect *> Page::findAllText(const QString &text, Qt::CaseSensitivity caseSensitivity) const
+{
+    if (text.isEmpty() || !d->m_text)
+        return QVector<RegularAreaRect *>();
+
+    return d->m_text->findAllText(text, caseSensitivity);
+}
+
+QVector<RegularAreaRect *> Page::findAllText(const QRegularExpression &expression) const
+{
+    if (!d->m_text)
+        return QVector<RegularAreaRect *>();
+
+    return d->m_text->findAllText(expression);
+}
+
 QString Page::text(const RegularAreaRect *area) const
 {
     return text(area, TextPage::AnyPixelTextAreaInclusionBehaviour);
@@ -555,16 +571,24 @@ void PagePrivate::setPixmap(DocumentObserver *observer, QPixmap *pixmap, const N
     }
 }
 
-void Page::setTextPage(TextPage *textPage)
+void PagePrivate::setRotatedPixmap(DocumentObserver *observer, QPixmap *pixmap)
 {
-    delete d->m_text;
-
-    d->m_text = textPage;
-    if (d->m_text) {
-        d->m_text->d->m_page = this;
-        // Correct/optimize text order for search and text selection
-        d->m_text->d->correctTextOrder();
+    QMap<DocumentObserver *, PagePrivate::PixmapObject>::iterator it = m_pixmaps.find(observer);
+    if (it != m_pixmaps.end()) {
+        delete it.value().m_pixmap;
+    } else {
+        it = m_pixmaps.insert(observer, PagePrivate::PixmapObject());
     }
+    it.value().m_pixmap = pixmap;
+    it.value().m_rotation = m_rotation;
+    it.value().m_isPartialPixmap = false;
+}
+
+void Page::setTextPage(TextPage *textPage)
+{
+    if (textPage)
+        PagePrivate::correctTextOrder(this, textPage, width(), height(), boundingBox());
+    d->setOrderedTextPage(textPage);
 }
 
 void Page::setObjectRects(const QLinkedList<ObjectRect *> &rects)
@@ -752,6 +776,20 @@ void Page::deleteRects()
     deleteObjectRects(m_rects, which);
 }
 
+void PagePrivate::correctTextOrder(Page *page, TextPage *textPage, double width, double height, const NormalizedRect &boundingBox)
+{
+    textPage->d->m_page = page;
+    // Correct/optimize text order for search and text selection
+    textPage->d->correctTextOrder(width, height, boundingBox);
+}
+
+void PagePrivate::setOrderedTextPage(TextPage *textPage)
+{
+    delete m_text;
+
+    m_text = textPage;
+}
+
 void PagePrivate::deleteHighlights(int s_id)
 {
     // delete highlights by ID
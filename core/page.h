@@ -187,6 +187,20 @@ public:
      */
     RegularAreaRect *findText(int id, const QString &text, SearchDirection direction, Qt::CaseSensitivity caseSensitivity, const RegularAreaRect *lastRect = nullptr) const;
 
+    /**
+     * Returns the bounding rects of all the occurrences of @p text in the page.
+     * @see TextPage::findAllText()
+     * @since 21.04
+     */
+    QVector<RegularAreaRect *> findAllText(const QString &text, Qt::CaseSensitivity caseSensitivity) const;
+
+    /**
+     * Returns the bounding rects of all the matches of @p expression in the page.
+     * @see TextPage::findAllText()
+     * @since 21.04
+     */
+    QVector<RegularAreaRect *> findAllText(const QRegularExpression &expression) const;
+
     /**
      * Returns the page text (or part of it).
      * @see TextPage::text()
@@ -107,6 +107,22 @@ public:
      */
     void setHighlight(int id, RegularAreaRect *rect, const QColor &color);
 
+    /**
+     * Makes @p textPage the text of @p page, correcting its text order as
+     * Page::setTextPage() does for a page of the given @p width, @p height
+     * and @p boundingBox.
+     *
+     * It does not read @p page, whose geometry may change in the main thread
+     * meanwhile, so it can be run outside of it with the geometry copied
+     * beforehand, then the text is handed over with setOrderedTextPage().
+     */
+    static void correctTextOrder(Page *page, TextPage *textPage, double width, double height, const NormalizedRect &boundingBox);
+
+    /**
+     * Sets @p textPage, already passed to correctTextOrder(), as the text of the page.
+     */
+    void setOrderedTextPage(TextPage *textPage);
+
     /**
      * Deletes all highlight objects for the observer with the given @p id.
      */
@@ -140,6 +156,12 @@ public:
 
     void setPixmap(DocumentObserver *observer, QPixmap *pixmap, const NormalizedRect &rect, bool isPartialPixmap);
 
+    /**
+     * Sets the whole page @p pixmap of @p observer, already rotated to the
+     * current rotation of the page.
+     */
+    void setRotatedPixmap(DocumentObserver *observer, QPixmap *pixmap);
+
     class PixmapObject
     {
     public:
@@ -12,6 +12,10 @@
 // local includes
 #include "page_p.h"
 #include "rotationjob_p.h"
+#include "settings_core.h"
+#include "textextractionjob_p.h"
+
+#include <QThread>
 
 #include <threadweaver/queueing.h>
 
@@ -20,10 +24,15 @@ using namespace Okular;
 PageController::PageController()
     : QObject()
 {
+    const int configuredThreads = SettingsCore::renderingThreads();
+    m_textWeaver.setMaximumNumberOfThreads(configuredThreads > 0 ? configuredThreads : qBound(1, QThread::idealThreadCount(), 8));
 }
 
 PageController::~PageController()
 {
+    // the generator is closed right after, no extraction may be left running
+    cancelTextExtractions();
+    waitForTextExtractions();
 }
 
 void PageController::addRotationJob(RotationJob *job)
@@ -42,3 +51,55 @@ void PageController::imageRotationDone(const ThreadWeaver::JobPointer &j)
         emit rotationFinished(job->page()->m_number, job->page()->m_page);
     }
 }
+
+void PageController::extractText(Generator *generator, Page *page)
+{
+    if (m_textJobs.contains(page->number()))
+        return;
+
+    TextExtractionJob *job = new TextExtractionJob(generator, page);
+    const ThreadWeaver::JobPointer jobPointer(job);
+    connect(job, &TextExtractionJob::done, this, &PageController::textExtractionDone);
+    m_textJobs.insert(page->number(), jobPointer);
+    m_textWeaver.enqueue(jobPointer);
+}
+
+void PageController::cancelTextExtractions()
+{
+    if (m_textJobs.isEmpty())
+        return;
+
+    m_textWeaver.dequeue();
+    for (const ThreadWeaver::JobPointer &job : qAsConst(m_textJobs))
+        static_cast<TextExtractionJob *>(job.data())->abort();
+
+    // the running jobs return as soon as the generator does, their done
+    // notifications find no job and are ignored
+    m_textJobs.clear();
+}
+
+void PageController::waitForTextExtractions()
+{
+    m_textWeaver.finish();
+}
+
+bool PageController::isExtractingText() const
+{
+    return !m_textJobs.isEmpty();
+}
+
+void PageController::textExtractionDone(const ThreadWeaver::JobPointer &j)
+{
+    TextExtractionJob *job = static_cast<TextExtractionJob *>(j.data());
+    const int pageNumber = job->page()->number();
+
+    const QHash<int, ThreadWeaver::JobPointer>::iterator it = m_textJobs.find(pageNumber);
+    if (it == m_textJobs.end() || it->data() != job)
+        return;
+
+    // keep the job alive until it is done with
+    const ThreadWeaver::JobPointer jobPointer = *it;
+    m_textJobs.erase(it);
+
+    emit textExtractionFinished(pageNumber, job->takeTextPage());
+}
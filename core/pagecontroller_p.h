@@ -10,17 +10,20 @@
 #ifndef _OKULAR_PAGECONTROLLER_P_H_
 #define _OKULAR_PAGECONTROLLER_P_H_
 
+#include <QHash>
 #include <QObject>
 
 #include <threadweaver/queue.h>
 
 namespace Okular
 {
+class Generator;
 class Page;
 class RotationJob;
+class TextPage;
 
 /* There is one PageController per document. It receives notifications of
- * completed RotationJobs */
+ * completed RotationJobs and TextExtractionJobs */
 class PageController : public QObject
 {
     Q_OBJECT
@@ -31,14 +34,34 @@ public:
 
     void addRotationJob(RotationJob *job);
 
+    /* Extracts the text of page with generator in the background, unless it is
+     * already being extracted */
+    void extractText(Generator *generator, Page *page);
+
+    /* Drops the pending text extractions and aborts the running ones, without
+     * waiting for them: their results are ignored */
+    void cancelTextExtractions();
+
+    /* Waits for the aborted text extractions that are still running */
+    void waitForTextExtractions();
+
+    bool isExtractingText() const;
+
 Q_SIGNALS:
     void rotationFinished(int page, Okular::Page *okularPage);
 
+    /* The receiver owns textPage, which is null if the extraction failed */
+    void textExtractionFinished(int page, Okular::TextPage *textPage);
+
 private Q_SLOTS:
     void imageRotationDone(const ThreadWeaver::JobPointer &job);
+    void textExtractionDone(const ThreadWeaver::JobPointer &job);
 
 private:
     ThreadWeaver::Queue m_weaver;
+    // text extraction gets its own threads so it does not delay rotations
+    ThreadWeaver::Queue m_textWeaver;
+    QHash<int, ThreadWeaver::JobPointer> m_textJobs;
 };
 
 }
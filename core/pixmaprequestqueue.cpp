@@ -0,0 +1,240 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by the Okular developers                           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include "pixmaprequestqueue_p.h"
+
+#include "generator.h"
+#include "generator_p.h"
+
+using namespace Okular;
+
+PixmapRequestQueue::PixmapRequestQueue()
+    : m_viewportPage(0)
+    , m_sequence(0)
+{
+}
+
+bool PixmapRequestQueue::isEmpty() const
+{
+    return m_heap.isEmpty();
+}
+
+int PixmapRequestQueue::count() const
+{
+    return m_heap.count();
+}
+
+void PixmapRequestQueue::setViewportPage(int page)
+{
+    if (m_viewportPage == page)
+        return;
+
+    m_viewportPage = page;
+    rebuild();
+}
+
+int PixmapRequestQueue::viewportPage() const
+{
+    return m_viewportPage;
+}
+
+void PixmapRequestQueue::push(PixmapRequest *request)
+{
+    Entry entry;
+    entry.request = request;
+    entry.priority = request->priority();
+    entry.distance = distanceOf(request);
+    entry.sequence = m_sequence++;
+
+    m_heap.append(entry);
+    PixmapRequestPrivate::get(request)->mQueueIndex = m_heap.count() - 1;
+    siftUp(m_heap.count() - 1);
+
+    m_pageIndex.insert(qMakePair(request->observer(), request->pageNumber()), request);
+}
+
+PixmapRequest *PixmapRequestQueue::top() const
+{
+    return m_heap.isEmpty() ? nullptr : m_heap.first().request;
+}
+
+PixmapRequest *PixmapRequestQueue::pop()
+{
+    if (m_heap.isEmpty())
+        return nullptr;
+
+    PixmapRequest *request = m_heap.first().request;
+    remove(request);
+    return request;
+}
+
+void PixmapRequestQueue::skipTop()
+{
+    if (m_heap.isEmpty())
+        return;
+
+    // still indexed by page, it is only out of the heap for a while
+    m_skipped.append(m_heap.first());
+    removeAt(0);
+}
+
+void PixmapRequestQueue::restoreSkipped()
+{
+    for (Entry entry : qAsConst(m_skipped)) {
+        entry.distance = distanceOf(entry.request);
+        m_heap.append(entry);
+        siftUp(m_heap.count() - 1);
+    }
+    m_skipped.clear();
+}
+
+bool PixmapRequestQueue::remove(PixmapRequest *request)
+{
+    PixmapRequestPrivate *requestPrivate = PixmapRequestPrivate::get(request);
+    const int index = requestPrivate->mQueueIndex;
+    if (index < 0 || index >= m_heap.count() || m_heap.at(index).request != request)
+        return false;
+
+    m_pageIndex.remove(qMakePair(request->observer(), request->pageNumber()), request);
+    removeAt(index);
+    return true;
+}
+
+bool PixmapRequestQueue::contains(DocumentObserver *observer, int page) const
+{
+    return m_pageIndex.contains(qMakePair(observer, page));
+}
+
+QList<PixmapRequest *> PixmapRequestQueue::take(DocumentObserver *observer, int page)
+{
+    const QList<PixmapRequest *> requests = m_pageIndex.values(qMakePair(observer, page));
+    for (PixmapRequest *request : requests)
+        remove(request);
+    return requests;
+}
+
+QList<PixmapRequest *> PixmapRequestQueue::take(DocumentObserver *observer)
+{
+    QList<PixmapRequest *> requests;
+    QVector<Entry> kept;
+    kept.reserve(m_heap.count());
+    for (const Entry &entry : qAsConst(m_heap)) {
+        if (entry.request->observer() == observer) {
+            requests.append(entry.request);
+            m_pageIndex.remove(qMakePair(observer, entry.request->pageNumber()), entry.request);
+            PixmapRequestPrivate::get(entry.request)->mQueueIndex = -1;
+        } else {
+            kept.append(entry);
+        }
+    }
+
+    if (!requests.isEmpty()) {
+        m_heap = kept;
+        rebuild();
+    }
+    return requests;
+}
+
+QList<PixmapRequest *> PixmapRequestQueue::takeAll()
+{
+    QList<PixmapRequest *> requests;
+    requests.reserve(m_heap.count());
+    for (const Entry &entry : qAsConst(m_heap)) {
+        PixmapRequestPrivate::get(entry.request)->mQueueIndex = -1;
+        requests.append(entry.request);
+    }
+    m_heap.clear();
+    m_pageIndex.clear();
+    return requests;
+}
+
+bool PixmapRequestQueue::goesBefore(const Entry &a, const Entry &b)
+{
+    if (a.priority != b.priority)
+        return a.priority < b.priority;
+    if (a.distance != b.distance)
+        return a.distance < b.distance;
+    // synchronous requests are served newest first, everything else oldest first
+    if (a.priority == 0)
+        return a.sequence > b.sequence;
+    return a.sequence < b.sequence;
+}
+
+int PixmapRequestQueue::distanceOf(const PixmapRequest *request) const
+{
+    return qAbs(request->pageNumber() - m_viewportPage);
+}
+
+void PixmapRequestQueue::place(int index, const Entry &entry)
+{
+    m_heap[index] = entry;
+    PixmapRequestPrivate::get(entry.request)->mQueueIndex = index;
+}
+
+void PixmapRequestQueue::siftUp(int index)
+{
+    const Entry entry = m_heap.at(index);
+    while (index > 0) {
+        const int parent = (index - 1) / 2;
+        if (!goesBefore(entry, m_heap.at(parent)))
+            break;
+        place(index, m_heap.at(parent));
+        index = parent;
+    }
+    place(index, entry);
+}
+
+void PixmapRequestQueue::siftDown(int index)
+{
+    const int size = m_heap.count();
+    const Entry entry = m_heap.at(index);
+    while (true) {
+        int child = 2 * index + 1;
+        if (child >= size)
+            break;
+        if (child + 1 < size && goesBefore(m_heap.at(child + 1), m_heap.at(child)))
+            ++child;
+        if (!goesBefore(m_heap.at(child), entry))
+            break;
+        place(index, m_heap.at(child));
+        index = child;
+    }
+    place(index, entry);
+}
+
+void PixmapRequestQueue::removeAt(int index)
+{
+    PixmapRequestPrivate::get(m_heap.at(index).request)->mQueueIndex = -1;
+
+    const int last = m_heap.count() - 1;
+    if (index != last) {
+        const Entry moved = m_heap.at(last);
+        m_heap.removeLast();
+        place(index, moved);
+        // the moved entry may belong either above or below its new position
+        if (index > 0 && goesBefore(moved, m_heap.at((index - 1) / 2)))
+            siftUp(index);
+        else
+            siftDown(index);
+    } else {
+        m_heap.removeLast();
+    }
+}
+
+void PixmapRequestQueue::rebuild()
+{
+    for (int i = 0; i < m_heap.count(); ++i) {
+        m_heap[i].distance = distanceOf(m_heap.at(i).request);
+        PixmapRequestPrivate::get(m_heap.at(i).request)->mQueueIndex = i;
+    }
+    for (int i = m_heap.count() / 2 - 1; i >= 0; --i)
+        siftDown(i);
+}
+
+/* kate: replace-tabs on; indent-width 4; */
@@ -0,0 +1,139 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by the Okular developers                           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef _OKULAR_PIXMAPREQUESTQUEUE_P_H_
+#define _OKULAR_PIXMAPREQUESTQUEUE_P_H_
+
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QVector>
+
+#include "okularcore_export.h"
+
+namespace Okular
+{
+class DocumentObserver;
+class PixmapRequest;
+
+/**
+ * Pending pixmap requests of a Document, ordered by the time they have to be
+ * sent to the generator.
+ *
+ * The queue is a binary heap keyed by (priority, distance from the viewport
+ * page, age of the request), so the request to send next is available in
+ * constant time and insertions and removals are O(log n). Requests are also
+ * indexed by (observer, page) so duplicated or cancelled requests can be
+ * found without walking the whole queue.
+ *
+ * Lower priority values go first, as documented in PixmapRequest::priority().
+ * Among requests with the same priority and distance the oldest one goes
+ * first, except for priority zero (synchronous) requests where the newest
+ * one does.
+ *
+ * The queue does not own the requests, it is up to the caller to delete the
+ * requests it takes out of it.
+ */
+class OKULARCORE_EXPORT PixmapRequestQueue
+{
+public:
+    PixmapRequestQueue();
+
+    bool isEmpty() const;
+    int count() const;
+
+    /**
+     * Sets the page the distances of the requests are computed from.
+     * The queue is reordered if the page changed.
+     */
+    void setViewportPage(int page);
+    int viewportPage() const;
+
+    /**
+     * Adds @p request to the queue.
+     */
+    void push(PixmapRequest *request);
+
+    /**
+     * Returns the request that has to be sent first, or nullptr if the queue is empty.
+     */
+    PixmapRequest *top() const;
+
+    /**
+     * Removes the request returned by top() from the queue and returns it.
+     */
+    PixmapRequest *pop();
+
+    /**
+     * Sets the request returned by top() aside, so top() returns the next one.
+     * The request keeps its place among the others once restoreSkipped() is
+     * called, which has to happen before the queue is used for anything else.
+     */
+    void skipTop();
+
+    /**
+     * Puts back into the queue the requests set aside by skipTop().
+     */
+    void restoreSkipped();
+
+    /**
+     * Removes @p request from the queue, returns whether it was in the queue.
+     */
+    bool remove(PixmapRequest *request);
+
+    /**
+     * Returns whether there is a queued request for @p page of @p observer.
+     */
+    bool contains(DocumentObserver *observer, int page) const;
+
+    /**
+     * Removes from the queue and returns all the requests for @p page of @p observer.
+     */
+    QList<PixmapRequest *> take(DocumentObserver *observer, int page);
+
+    /**
+     * Removes from the queue and returns all the requests of @p observer.
+     */
+    QList<PixmapRequest *> take(DocumentObserver *observer);
+
+    /**
+     * Removes from the queue and returns all the requests.
+     */
+    QList<PixmapRequest *> takeAll();
+
+private:
+    struct Entry {
+        PixmapRequest *request;
+        int priority;
+        int distance;
+        quint64 sequence;
+    };
+
+    typedef QPair<DocumentObserver *, int> PageKey;
+
+    static bool goesBefore(const Entry &a, const Entry &b);
+    int distanceOf(const PixmapRequest *request) const;
+    void place(int index, const Entry &entry);
+    void siftUp(int index);
+    void siftDown(int index);
+    void removeAt(int index);
+    void rebuild();
+
+    QVector<Entry> m_heap;
+    QVector<Entry> m_skipped;
+    QMultiHash<PageKey, PixmapRequest *> m_pageIndex;
+    int m_viewportPage;
+    quint64 m_sequence;
+};
+
+}
+
+#endif
+
+/* kate: replace-tabs on; indent-width 4; */
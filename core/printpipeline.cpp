@@ -0,0 +1,179 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by the Okular developers                           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include "printpipeline.h"
+
+#include <QHash>
+#include <QMutex>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+#include <QWaitCondition>
+
+#include "settings_core.h"
+
+using namespace Okular;
+
+class PrintPipeline::Private
+{
+public:
+    explicit Private(const RenderFunction &render)
+        : m_render(render)
+        , m_threadCount(0)
+        , m_queueDepth(0)
+    {
+    }
+
+    RenderFunction m_render;
+    int m_threadCount;
+    int m_queueDepth;
+};
+
+/**
+ * What the threads rendering pages and the one painting them share during PrintPipeline::run().
+ */
+class PrintPipelineState
+{
+public:
+    PrintPipelineState(const QList<int> &pageNumbers, const PrintPipeline::RenderFunction &render, int queueDepth)
+        : pageNumbers(pageNumbers)
+        , render(render)
+        , queueDepth(queueDepth)
+        , nextToRender(0)
+        , nextToPaint(0)
+        , cancelled(false)
+    {
+    }
+
+    const QList<int> &pageNumbers;
+    const PrintPipeline::RenderFunction &render;
+    const int queueDepth;
+
+    QMutex mutex;
+    QWaitCondition changed;
+    // indexes in pageNumbers
+    int nextToRender;
+    int nextToPaint;
+    bool cancelled;
+    QHash<int, QImage> rendered;
+};
+
+class PrintPipelineWorker : public QRunnable
+{
+public:
+    explicit PrintPipelineWorker(PrintPipelineState *state)
+        : m_state(state)
+    {
+    }
+
+    void run() override
+    {
+        QMutexLocker locker(&m_state->mutex);
+        while (true) {
+            // wait while the queue is full
+            while (!m_state->cancelled && m_state->nextToRender < m_state->pageNumbers.count() && m_state->nextToRender >= m_state->nextToPaint + m_state->queueDepth)
+                m_state->changed.wait(&m_state->mutex);
+
+            if (m_state->cancelled || m_state->nextToRender >= m_state->pageNumbers.count())
+                return;
+
+            const int index = m_state->nextToRender++;
+            locker.unlock();
+            const QImage image = m_state->render(m_state->pageNumbers.at(index));
+            locker.relock();
+
+            m_state->rendered.insert(index, image);
+            m_state->changed.wakeAll();
+        }
+    }
+
+private:
+    PrintPipelineState *m_state;
+};
+
+PrintPipeline::PrintPipeline(const RenderFunction &render)
+    : d(new Private(render))
+{
+}
+
+PrintPipeline::~PrintPipeline()
+{
+    delete d;
+}
+
+void PrintPipeline::setThreadCount(int threads)
+{
+    d->m_threadCount = threads;
+}
+
+int PrintPipeline::threadCount() const
+{
+    if (d->m_threadCount > 0)
+        return d->m_threadCount;
+
+    const int configuredThreads = SettingsCore::renderingThreads();
+    if (configuredThreads > 0)
+        return configuredThreads;
+
+    return qBound(1, QThread::idealThreadCount(), 8);
+}
+
+void PrintPipeline::setQueueDepth(int depth)
+{
+    d->m_queueDepth = depth;
+}
+
+int PrintPipeline::queueDepth() const
+{
+    return d->m_queueDepth > 0 ? d->m_queueDepth : 2 * threadCount();
+}
+
+bool PrintPipeline::run(const QList<int> &pageNumbers, const PaintFunction &paint)
+{
+    if (pageNumbers.isEmpty())
+        return true;
+
+    // more threads than pages in the queue would only wait
+    const int depth = queueDepth();
+    const int threads = qMin(qMin(threadCount(), depth), pageNumbers.count());
+
+    PrintPipelineState state(pageNumbers, d->m_render, depth);
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(threads);
+    for (int i = 0; i < threads; ++i)
+        pool.start(new PrintPipelineWorker(&state));
+
+    bool completed = true;
+    for (int index = 0; index < pageNumbers.count(); ++index) {
+        QImage image;
+        {
+            QMutexLocker locker(&state.mutex);
+            while (!state.rendered.contains(index))
+                state.changed.wait(&state.mutex);
+            image = state.rendered.take(index);
+        }
+
+        const bool proceed = paint(pageNumbers.at(index), image);
+
+        QMutexLocker locker(&state.mutex);
+        state.nextToPaint = index + 1;
+        state.cancelled = !proceed;
+        state.changed.wakeAll();
+        if (!proceed) {
+            completed = false;
+            break;
+        }
+    }
+
+    pool.waitForDone();
+    return completed;
+}
+
+/* kate: replace-tabs on; indent-width 4; */
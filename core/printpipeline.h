@@ -0,0 +1,118 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by the Okular developers                           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef _OKULAR_PRINTPIPELINE_H_
+#define _OKULAR_PRINTPIPELINE_H_
+
+#include <QImage>
+#include <QList>
+
+#include <functional>
+
+#include "okularcore_export.h"
+
+namespace Okular
+{
+/**
+ * @short Rasterizes pages on worker threads while they are printed in order.
+ *
+ * Generators printing pages as images can hand the rasterization of each
+ * page to a PrintPipeline: pages are rendered by up to threadCount()
+ * threads, while the thread calling run() paints them, one by one and in
+ * the order they were given, as soon as they are ready.
+ *
+ * At most queueDepth() pages are rendered ahead of the page being painted,
+ * which bounds the memory used by the images waiting to be painted.
+ *
+ * Example:
+ *
+ * @code
+ * QPainter painter(&printer);
+ * Okular::PrintPipeline pipeline([this](int pageNumber) { return renderPage(pageNumber); });
+ * pipeline.run(pageNumbers, [&](int pageNumber, const QImage &image) {
+ *     if (pageNumber != pageNumbers.first())
+ *         printer.newPage();
+ *     painter.drawImage(0, 0, image);
+ *     return true;
+ * });
+ * @endcode
+ *
+ * @since 21.04
+ */
+class OKULARCORE_EXPORT PrintPipeline
+{
+public:
+    /**
+     * Returns the image of the page @p pageNumber.
+     *
+     * It is called from several threads at the same time, so it must be
+     * thread safe. It may return a null image for a page that could not be
+     * rendered.
+     */
+    typedef std::function<QImage(int pageNumber)> RenderFunction;
+
+    /**
+     * Paints the @p image of the page @p pageNumber.
+     *
+     * It is always called from the thread calling run(), in page order.
+     * Returning @c false cancels the pages not painted yet.
+     */
+    typedef std::function<bool(int pageNumber, const QImage &image)> PaintFunction;
+
+    /**
+     * Creates a pipeline rendering pages with @p render.
+     */
+    explicit PrintPipeline(const RenderFunction &render);
+
+    ~PrintPipeline();
+
+    /**
+     * Sets the number of threads rendering pages.
+     *
+     * By default as many as for rendering the pages on screen are used.
+     */
+    void setThreadCount(int threads);
+
+    /**
+     * Returns the number of threads rendering pages.
+     */
+    int threadCount() const;
+
+    /**
+     * Sets the maximum number of pages rendered ahead of the page being painted.
+     *
+     * The default is twice the number of threads.
+     */
+    void setQueueDepth(int depth);
+
+    /**
+     * Returns the maximum number of pages rendered ahead of the page being painted.
+     */
+    int queueDepth() const;
+
+    /**
+     * Renders the pages @p pageNumbers and paints them with @p paint,
+     * returning when all of them have been painted or painting was cancelled.
+     *
+     * Returns whether all the pages were painted.
+     */
+    bool run(const QList<int> &pageNumbers, const PaintFunction &paint);
+
+private:
+    class Private;
+    Private *const d;
+
+    Q_DISABLE_COPY(PrintPipeline)
+};
+
+}
+
+#endif
+
+/* kate: replace-tabs on; indent-width 4; */
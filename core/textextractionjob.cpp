@@ -0,0 +1,76 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by the Okular developers                           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include "textextractionjob_p.h"
+
+#include "generator_p.h"
+#include "page.h"
+#include "page_p.h"
+#include "textpage.h"
+
+using namespace Okular;
+
+TextExtractionJobInternal::TextExtractionJobInternal(Generator *generator, Page *page)
+    : mGenerator(generator)
+    , mRequest(page)
+    , mTextPage(nullptr)
+    , mPageWidth(page->width())
+    , mPageHeight(page->height())
+    , mPageBoundingBox(page->boundingBox())
+{
+}
+
+TextExtractionJobInternal::~TextExtractionJobInternal()
+{
+    delete mTextPage;
+}
+
+void TextExtractionJobInternal::run(ThreadWeaver::JobPointer self, ThreadWeaver::Thread *thread)
+{
+    Q_UNUSED(self);
+    Q_UNUSED(thread);
+
+    if (mRequest.shouldAbortExtraction())
+        return;
+
+    mTextPage = mGenerator->textPage(&mRequest);
+
+    if (mTextPage && mRequest.shouldAbortExtraction()) {
+        delete mTextPage;
+        mTextPage = nullptr;
+    }
+
+    if (mTextPage)
+        PagePrivate::correctTextOrder(mRequest.page(), mTextPage, mPageWidth, mPageHeight, mPageBoundingBox);
+}
+
+TextExtractionJob::TextExtractionJob(Generator *generator, Page *page)
+    : ThreadWeaver::QObjectDecorator(new TextExtractionJobInternal(generator, page))
+{
+}
+
+Page *TextExtractionJob::page() const
+{
+    return static_cast<const TextExtractionJobInternal *>(job())->mRequest.page();
+}
+
+TextPage *TextExtractionJob::takeTextPage()
+{
+    TextExtractionJobInternal *internal = static_cast<TextExtractionJobInternal *>(job());
+    TextPage *textPage = internal->mTextPage;
+    internal->mTextPage = nullptr;
+    return textPage;
+}
+
+void TextExtractionJob::abort()
+{
+    TextRequestPrivate::get(&static_cast<TextExtractionJobInternal *>(job())->mRequest)->mShouldAbortExtraction = 1;
+}
+
+/* kate: replace-tabs on; indent-width 4; */
@@ -0,0 +1,75 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by the Okular developers                           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef _OKULAR_TEXTEXTRACTIONJOB_P_H_
+#define _OKULAR_TEXTEXTRACTIONJOB_P_H_
+
+#include <threadweaver/job.h>
+#include <threadweaver/qobjectdecorator.h>
+
+#include "core/area.h"
+#include "core/generator.h"
+
+namespace Okular
+{
+class Page;
+class TextPage;
+
+class TextExtractionJobInternal : public ThreadWeaver::Job
+{
+    friend class TextExtractionJob;
+
+public:
+    ~TextExtractionJobInternal() override;
+
+    TextExtractionJobInternal(const TextExtractionJobInternal &) = delete;
+    TextExtractionJobInternal &operator=(const TextExtractionJobInternal &) = delete;
+
+protected:
+    void run(ThreadWeaver::JobPointer self, ThreadWeaver::Thread *thread) override;
+
+private:
+    TextExtractionJobInternal(Generator *generator, Page *page);
+
+    Generator *mGenerator;
+    TextRequest mRequest;
+    TextPage *mTextPage;
+    // the geometry of the page, copied in the main thread which may change it while the job runs
+    double mPageWidth;
+    double mPageHeight;
+    NormalizedRect mPageBoundingBox;
+};
+
+/* Extracts the text of a page with a Generator having the ParallelTextExtraction
+ * feature, and corrects its text order, outside of the main thread */
+class TextExtractionJob : public ThreadWeaver::QObjectDecorator
+{
+    Q_OBJECT
+public:
+    TextExtractionJob(Generator *generator, Page *page);
+
+    Page *page() const;
+
+    /**
+     * Returns the extracted text, which is no longer owned by the job.
+     * It is null if the extraction failed or was aborted.
+     */
+    TextPage *takeTextPage();
+
+    /**
+     * Asks the generator to stop the extraction if it is running.
+     */
+    void abort();
+};
+
+}
+
+#endif
+
+/* kate: replace-tabs on; indent-width 4; */
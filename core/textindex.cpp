@@ -0,0 +1,445 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by the Okular developers                           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include "textindex_p.h"
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QSet>
+
+#include <algorithm>
+
+#include "debug_p.h"
+#include "thumbnailcache_p.h"
+
+using namespace Okular;
+
+static const QChar hyphen = QLatin1Char('-');
+
+static const quint32 indexMagic = 0x4f4b5449; // "OKTI"
+static const quint32 indexVersion = 1;
+
+/**
+ * Tells whether the words of the index match the words of a query.
+ *
+ * A query of one word matches any word containing it. In queries of more
+ * words the first one matches the end of a word, the last one the beginning
+ * of a word, and the ones in between whole words.
+ *
+ * Whether each word of the index matches is only computed once per query.
+ */
+class TextIndex::Matcher
+{
+public:
+    Matcher(const TextIndex *index, const QString &query)
+        : m_index(index)
+        , m_query(TextIndex::words(query))
+        , m_matches(m_query.count())
+    {
+    }
+
+    bool isEmpty() const
+    {
+        return m_query.isEmpty();
+    }
+
+    bool matches(int queryWord, int word)
+    {
+        QHash<int, bool> &matches = m_matches[queryWord];
+        const QHash<int, bool>::const_iterator it = matches.constFind(word);
+        if (it != matches.constEnd())
+            return *it;
+
+        const QString &indexWord = m_index->m_words.at(word);
+        const QString &wanted = m_query.at(queryWord);
+        bool match;
+        if (m_query.count() == 1)
+            match = indexWord.contains(wanted);
+        else if (queryWord == 0)
+            match = indexWord.endsWith(wanted);
+        else if (queryWord == m_query.count() - 1)
+            match = indexWord.startsWith(wanted);
+        else
+            match = indexWord == wanted;
+
+        matches.insert(word, match);
+        return match;
+    }
+
+    bool pageMatches(const QVector<Occurrence> &occurrences)
+    {
+        for (int i = 0; i < occurrences.count(); ++i) {
+            if (matches(0, occurrences.at(i).word) && followingMatch(occurrences, i, 1))
+                return true;
+        }
+        return false;
+    }
+
+private:
+    // whether the rest of the query, from queryWord on, matches the words following occurrences[index]
+    bool followingMatch(const QVector<Occurrence> &occurrences, int index, int queryWord)
+    {
+        if (queryWord == m_query.count())
+            return true;
+
+        const Occurrence &current = occurrences.at(index);
+        const quint32 next = current.position + (current.joined ? 2 : 1);
+        // there are at most a word and its joined form at each position
+        for (int i = index + 1; i < occurrences.count() && occurrences.at(i).position <= next; ++i) {
+            if (occurrences.at(i).position == next && matches(queryWord, occurrences.at(i).word) && followingMatch(occurrences, i, queryWord + 1))
+                return true;
+        }
+        return false;
+    }
+
+    const TextIndex *m_index;
+    const QStringList m_query;
+    QVector<QHash<int, bool>> m_matches;
+};
+
+TextIndex::TextIndex()
+    : m_documentModified(0)
+    , m_modified(false)
+{
+}
+
+TextIndex::~TextIndex()
+{
+}
+
+QStringList TextIndex::words(const QString &text)
+{
+    const QString normalized = text.normalized(QString::NormalizationForm_KC);
+
+    QStringList words;
+    QString word;
+    for (const QChar c : normalized) {
+        if (c.isSpace()) {
+            if (!word.isEmpty())
+                words.append(word);
+            word.clear();
+        } else {
+            word.append(c.toCaseFolded());
+        }
+    }
+    if (!word.isEmpty())
+        words.append(word);
+    return words;
+}
+
+void TextIndex::addPage(int page, const QString &text)
+{
+    removePage(page);
+
+    const QStringList pageWords = words(text);
+    QVector<Occurrence> occurrences;
+    occurrences.reserve(pageWords.count());
+
+    auto addOccurrence = [this, page, &occurrences](const QString &word, quint32 position, bool joined) {
+        const int id = wordId(word);
+        QVector<int> &pages = m_wordPages[id];
+        if (pages.isEmpty() || pages.last() != page)
+            pages.append(page);
+        Occurrence occurrence;
+        occurrence.word = id;
+        occurrence.position = position;
+        occurrence.joined = joined;
+        occurrences.append(occurrence);
+    };
+
+    // hyphens are dropped, as TextPage::findText() may skip the ones breaking
+    // words and words containing them still match queries with or without them
+    quint32 position = 0;
+    for (int i = 0; i < pageWords.count(); ++i) {
+        QString word = pageWords.at(i);
+        const bool hyphenated = word.endsWith(hyphen);
+        word.remove(hyphen);
+        if (word.isEmpty())
+            continue;
+
+        addOccurrence(word, position, false);
+        if (hyphenated && i + 1 < pageWords.count()) {
+            QString next = pageWords.at(i + 1);
+            next.remove(hyphen);
+            if (!next.isEmpty())
+                addOccurrence(word + next, position, true);
+        }
+        ++position;
+    }
+
+    m_pages.insert(page, occurrences);
+    m_texts.insert(page, qCompress(text.toUtf8()));
+    m_modified = true;
+}
+
+void TextIndex::removePage(int page)
+{
+    const QHash<int, QVector<Occurrence>>::iterator it = m_pages.find(page);
+    if (it == m_pages.end())
+        return;
+
+    for (const Occurrence &occurrence : qAsConst(*it))
+        m_wordPages[occurrence.word].removeOne(page);
+    m_pages.erase(it);
+    m_texts.remove(page);
+    m_modified = true;
+}
+
+bool TextIndex::hasPage(int page) const
+{
+    return m_pages.contains(page);
+}
+
+QString TextIndex::text(int page) const
+{
+    const QHash<int, QByteArray>::const_iterator it = m_texts.constFind(page);
+    if (it == m_texts.constEnd())
+        return QString();
+    return QString::fromUtf8(qUncompress(*it));
+}
+
+int TextIndex::pageCount() const
+{
+    return m_pages.count();
+}
+
+int TextIndex::wordCount() const
+{
+    return m_words.count();
+}
+
+void TextIndex::clear()
+{
+    if (!m_pages.isEmpty())
+        m_modified = true;
+
+    m_words.clear();
+    m_wordIds.clear();
+    m_wordPages.clear();
+    m_pages.clear();
+    m_texts.clear();
+}
+
+bool TextIndex::open(const QString &fileName, const QString &documentFileName, int pageCount)
+{
+    close();
+
+    const QFileInfo documentInfo(documentFileName);
+    if (fileName.isEmpty() || !documentInfo.isFile())
+        return false;
+
+    m_fileName = fileName;
+    m_documentModified = documentInfo.lastModified().toMSecsSinceEpoch();
+    m_documentHash = ThumbnailCache::documentHash(documentFileName);
+
+    if (!load(pageCount)) {
+        clear();
+        // get rid of the stale file when saving
+        m_modified = QFile::exists(m_fileName);
+    } else {
+        m_modified = false;
+    }
+
+    qCDebug(OkularCoreDebug) << "Text index" << m_fileName << "has" << m_pages.count() << "pages";
+    return true;
+}
+
+void TextIndex::close()
+{
+    clear();
+    m_fileName.clear();
+    m_documentModified = 0;
+    m_documentHash.clear();
+    m_modified = false;
+}
+
+bool TextIndex::isOpen() const
+{
+    return !m_fileName.isEmpty();
+}
+
+bool TextIndex::load(int pageCount)
+{
+    QFile file(m_fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_12);
+
+    quint32 magic, version;
+    in >> magic >> version;
+    if (in.status() != QDataStream::Ok || magic != indexMagic || version != indexVersion)
+        return false;
+
+    qint64 modified;
+    QByteArray hash;
+    in >> modified >> hash;
+    if (in.status() != QDataStream::Ok || modified != m_documentModified || hash != m_documentHash)
+        return false;
+
+    // counts are checked against the bytes left before reserving anything,
+    // a corrupt file could ask for gigabytes: words take at least 4 bytes
+    quint32 words;
+    in >> words;
+    if (in.status() != QDataStream::Ok || words > quint64(file.size() - file.pos()) / 4)
+        return false;
+    m_words.reserve(words);
+    for (quint32 id = 0; id < words; ++id) {
+        QString word;
+        in >> word;
+        if (in.status() != QDataStream::Ok)
+            return false;
+        m_words.append(word);
+        m_wordIds.insert(word, id);
+    }
+    m_wordPages.resize(m_words.count());
+
+    qint32 pages;
+    in >> pages;
+    if (in.status() != QDataStream::Ok || pages < 0 || pages > pageCount)
+        return false;
+
+    for (int i = 0; i < pages; ++i) {
+        qint32 page, count;
+        in >> page >> count;
+        if (in.status() != QDataStream::Ok || page < 0 || page >= pageCount || count < 0 || m_pages.contains(page))
+            return false;
+        // and occurrences take 8 bytes
+        if (count > (file.size() - file.pos()) / 8)
+            return false;
+
+        QVector<Occurrence> occurrences;
+        occurrences.reserve(count);
+        for (int j = 0; j < count; ++j) {
+            quint32 word, position;
+            in >> word >> position;
+            if (in.status() != QDataStream::Ok || word >= quint32(m_words.count()))
+                return false;
+
+            Occurrence occurrence;
+            occurrence.word = word;
+            occurrence.position = position >> 1;
+            occurrence.joined = position & 1;
+            occurrences.append(occurrence);
+
+            QVector<int> &wordPages = m_wordPages[word];
+            if (wordPages.isEmpty() || wordPages.last() != page)
+                wordPages.append(page);
+        }
+
+        QByteArray text;
+        in >> text;
+        if (in.status() != QDataStream::Ok)
+            return false;
+
+        m_pages.insert(page, occurrences);
+        m_texts.insert(page, text);
+    }
+
+    return true;
+}
+
+bool TextIndex::save() const
+{
+    if (!isOpen() || !m_modified)
+        return true;
+
+    if (m_pages.isEmpty()) {
+        m_modified = false;
+        return !QFile::exists(m_fileName) || QFile::remove(m_fileName);
+    }
+
+    QSaveFile out(m_fileName);
+    if (!out.open(QIODevice::WriteOnly))
+        return false;
+
+    QDataStream stream(&out);
+    stream.setVersion(QDataStream::Qt_5_12);
+    stream << indexMagic << indexVersion << m_documentModified << m_documentHash << m_words << qint32(m_pages.count());
+
+    QHash<int, QVector<Occurrence>>::const_iterator it = m_pages.constBegin(), itEnd = m_pages.constEnd();
+    for (; it != itEnd; ++it) {
+        stream << qint32(it.key()) << qint32(it->count());
+        for (const Occurrence &occurrence : *it)
+            stream << quint32(occurrence.word) << quint32(occurrence.position << 1 | occurrence.joined);
+        stream << m_texts.value(it.key());
+    }
+
+    if (stream.status() != QDataStream::Ok) {
+        out.cancelWriting();
+        return false;
+    }
+
+    if (!out.commit())
+        return false;
+
+    m_modified = false;
+    return true;
+}
+
+int TextIndex::wordId(const QString &word)
+{
+    const QHash<QString, int>::const_iterator it = m_wordIds.constFind(word);
+    if (it != m_wordIds.constEnd())
+        return *it;
+
+    const int id = m_words.count();
+    m_words.append(word);
+    m_wordIds.insert(word, id);
+    m_wordPages.append(QVector<int>());
+    return id;
+}
+
+QVector<int> TextIndex::pagesMatching(const QString &query) const
+{
+    QString stripped = query;
+    stripped.remove(hyphen);
+    Matcher matcher(this, stripped);
+
+    QVector<int> pages;
+    if (matcher.isEmpty()) {
+        pages = m_pages.keys().toVector();
+    } else {
+        // the pages with words matching the first one of the query are the
+        // candidates, the other words are only looked for in them
+        QSet<int> candidates;
+        for (int word = 0; word < m_words.count(); ++word) {
+            if (matcher.matches(0, word)) {
+                for (int page : m_wordPages.at(word))
+                    candidates.insert(page);
+            }
+        }
+
+        for (int page : qAsConst(candidates)) {
+            if (matcher.pageMatches(m_pages.value(page)))
+                pages.append(page);
+        }
+    }
+
+    std::sort(pages.begin(), pages.end());
+    return pages;
+}
+
+bool TextIndex::pageMatches(int page, const QString &query) const
+{
+    const QHash<int, QVector<Occurrence>>::const_iterator it = m_pages.constFind(page);
+    if (it == m_pages.constEnd())
+        return false;
+
+    QString stripped = query;
+    stripped.remove(hyphen);
+    Matcher matcher(this, stripped);
+    return matcher.isEmpty() || matcher.pageMatches(*it);
+}
+
+/* kate: replace-tabs on; indent-width 4; */
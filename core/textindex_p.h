@@ -0,0 +1,150 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by the Okular developers                           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef _OKULAR_TEXTINDEX_P_H_
+#define _OKULAR_TEXTINDEX_P_H_
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "okularcore_export.h"
+
+namespace Okular
+{
+/**
+ * Inverted index of the words of the pages of a document, used to know
+ * which pages a whole document search has to look at without asking the
+ * generator for the text of every page.
+ *
+ * Words are case folded and split on white space, the index remembers the
+ * position of every word in its page to match queries of several words.
+ * Words hyphenated at the end of a line are also indexed joined with the
+ * next word, as TextPage::findText() finds them either way.
+ *
+ * The pages returned for a query are the ones that may contain it: they
+ * still have to be searched with TextPage::findText() to get the areas of
+ * the matches, and the ones whose case differs from a case sensitive query.
+ *
+ * The whole text of the indexed pages is kept compressed, and the index can
+ * be stored on disk next to the docdata file of the document, so it is
+ * available without the generator the next time the document is opened.
+ * Like the ThumbnailCache, the stored index is only used if the document
+ * did not change since it was written.
+ */
+class OKULARCORE_EXPORT TextIndex
+{
+public:
+    TextIndex();
+    ~TextIndex();
+
+    /**
+     * Indexes the words in @p text as the ones of @p page, replacing the
+     * words previously indexed for it.
+     */
+    void addPage(int page, const QString &text);
+
+    bool hasPage(int page) const;
+
+    /**
+     * Returns the text the indexed @p page was added with.
+     */
+    QString text(int page) const;
+
+    /**
+     * Returns the number of indexed pages.
+     */
+    int pageCount() const;
+
+    /**
+     * Returns the number of different words in the indexed pages.
+     */
+    int wordCount() const;
+
+    /**
+     * Discards the indexed pages.
+     */
+    void clear();
+
+    /**
+     * Replaces the indexed pages with the ones stored in @p fileName for the
+     * document in @p documentFileName of @p pageCount pages, unless the
+     * document changed since they were stored. save() will write them back
+     * there.
+     */
+    bool open(const QString &fileName, const QString &documentFileName, int pageCount);
+
+    /**
+     * Writes the index to the file it was opened from, if it changed since.
+     */
+    bool save() const;
+
+    /**
+     * Discards the indexed pages and forgets the file the index was opened from,
+     * without saving it.
+     */
+    void close();
+
+    bool isOpen() const;
+
+    /**
+     * Returns the indexed pages that may contain @p query, sorted.
+     */
+    QVector<int> pagesMatching(const QString &query) const;
+
+    /**
+     * Returns whether the indexed @p page may contain @p query.
+     */
+    bool pageMatches(int page, const QString &query) const;
+
+    /**
+     * Splits @p text in the normalized words the index is made of.
+     */
+    static QStringList words(const QString &text);
+
+private:
+    struct Occurrence {
+        quint32 word;
+        quint32 position : 31;
+        // a hyphenated word joined with the next one, it spans two positions
+        quint32 joined : 1;
+    };
+
+    class Matcher;
+
+    int wordId(const QString &word);
+    void removePage(int page);
+    bool load(int pageCount);
+
+    // all the words ever indexed, their id is their position in the vector
+    QVector<QString> m_words;
+    QHash<QString, int> m_wordIds;
+    // pages each word appears on
+    QVector<QVector<int>> m_wordPages;
+    // words of each page, in order of position
+    QHash<int, QVector<Occurrence>> m_pages;
+    // compressed text of each page
+    QHash<int, QByteArray> m_texts;
+
+    QString m_fileName;
+    qint64 m_documentModified;
+    QByteArray m_documentHash;
+    // pages were added or removed since the index was opened or saved
+    mutable bool m_modified;
+
+    Q_DISABLE_COPY(TextIndex)
+};
+
+}
+
+#endif
+
+/* kate: replace-tabs on; indent-width 4; */
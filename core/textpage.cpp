@@ -11,6 +11,7 @@
 #include "textpage_p.h"
 
 #include <QDebug>
+#include <QRegularExpression>
 
 #include "area.h"
 #include "debug_p.h"
@@ -18,7 +19,7 @@
 #include "page.h"
 #include "page_p.h"
 
-#include <cstring>
+#include <algorithm>
 
 #include <QVarLengthArray>
 #include <QtAlgorithms>
@@ -29,44 +30,39 @@ class SearchPoint
 {
 public:
     SearchPoint()
-        : offset_begin(-1)
-        , offset_end(-1)
+        : begin(-1)
+        , end(-1)
     {
     }
 
-    /** The TinyTextEntity containing the first character of the match. */
-    TextList::ConstIterator it_begin;
+    /** The position of the first character of the match in the text of the page. */
+    int begin;
 
-    /** The TinyTextEntity containing the last character of the match. */
-    TextList::ConstIterator it_end;
-
-    /** The index of the first character of the match in (*it_begin)->text().
-     *  Satisfies 0 <= offset_begin < (*it_begin)->text().length().
-     */
-    int offset_begin;
-
-    /** One plus the index of the last character of the match in (*it_end)->text().
-     *  Satisfies 0 < offset_end <= (*it_end)->text().length().
-     */
-    int offset_end;
+    /** One plus the position of the last character of the match in the text of the page. */
+    int end;
 };
 
-/* text comparison functions */
-
-static bool CaseInsensitiveCmpFn(const QStringRef &from, const QStringRef &to)
-{
-#ifdef DEBUG_TEXTPAGE
-    qDebug(OkularCoreDebug) << from << ":" << to << "(case insensitive)";
-#endif
-    return from.compare(to, Qt::CaseInsensitive) == 0;
-}
-
-static bool CaseSensitiveCmpFn(const QStringRef &from, const QStringRef &to)
+/**
+ * Returns @p text case folded one character to one, so that the positions
+ * in the folded text are the same as in @p text.
+ */
+static QString caseFolded(const QString &text)
 {
-#ifdef DEBUG_TEXTPAGE
-    qDebug(OkularCoreDebug) << from << ":" << to << "(case sensitive)";
-#endif
-    return from.compare(to, Qt::CaseSensitive) == 0;
+    QString folded = text;
+    QChar *data = folded.data();
+    const int length = folded.length();
+
+    for (int i = 0; i < length; ++i) {
+        if (data[i].isHighSurrogate() && i + 1 < length && data[i + 1].isLowSurrogate()) {
+            const uint ucs4 = QChar::toCaseFolded(QChar::surrogateToUcs4(data[i], data[i + 1]));
+            data[i] = QChar(QChar::highSurrogate(ucs4));
+            data[i + 1] = QChar(QChar::lowSurrogate(ucs4));
+            ++i;
+        } else {
+            data[i] = data[i].toCaseFolded();
+        }
+    }
+    return folded;
 }
 
 /**
@@ -107,79 +103,60 @@ static bool doesConsumeY(const NormalizedRect &first, const NormalizedRect &seco
     return segmentsOverlap(first.top, first.bottom, second.top, second.bottom, threshold);
 }
 
-/*
-  Rationale behind TinyTextEntity:
-
-  instead of storing directly a QString for the text of an entity,
-  we store the UTF-16 data and their length. This way, we save about
-  4 int's wrt a QString, and we can create a new string from that
-  raw data (that's the only penalty of that).
-  Even better, if the string we need to store has at most
-  MaxStaticChars characters, then we store those in place of the QChar*
-  that would be used (with new[] + free[]) for the data.
- */
-class TinyTextEntity
+void TextList::reserve(int size)
 {
-    static const int MaxStaticChars = sizeof(void *) / sizeof(QChar);
+    m_offsets.reserve(size);
+    m_boxes.reserve(size);
+}
 
-public:
-    TinyTextEntity(const QString &text, const NormalizedRect &rect)
-        : area(rect)
-    {
-        Q_ASSERT_X(!text.isEmpty(), "TinyTextEntity", "empty string");
-        Q_ASSERT_X(sizeof(d) == sizeof(void *), "TinyTextEntity", "internal storage is wider than QChar*, fix it!");
-        length = text.length();
-        switch (length) {
-#if QT_POINTER_SIZE >= 8
-        case 4:
-            d.qc[3] = text.at(3).unicode();
-            // fall through
-        case 3:
-            d.qc[2] = text.at(2).unicode();
-#endif
-            // fall through
-        case 2:
-            d.qc[1] = text.at(1).unicode();
-            // fall through
-        case 1:
-            d.qc[0] = text.at(0).unicode();
-            break;
-        default:
-            d.data = new QChar[length];
-            std::memcpy(d.data, text.constData(), length * sizeof(QChar));
-        }
-    }
+void TextList::append(const QString &text, const NormalizedRect &area)
+{
+    Q_ASSERT_X(!text.isEmpty(), "TextList", "empty string");
+    m_offsets.append(m_text.length());
+    m_text.append(text);
+    const Box box = {(float)area.left, (float)area.top, (float)area.right, (float)area.bottom};
+    m_boxes.append(box);
+}
 
-    ~TinyTextEntity()
-    {
-        if (length > MaxStaticChars) {
-            delete[] d.data;
-        }
-    }
+void TextList::append(const TextList &list, int index)
+{
+    const QStringRef text = list.text(index);
+    m_offsets.append(m_text.length());
+    m_text.append(text.constData(), text.length());
+    m_boxes.append(list.m_boxes.at(index));
+}
 
-    inline QString text() const
-    {
-        return length <= MaxStaticChars ? QString::fromRawData((const QChar *)&d.qc[0], length) : QString::fromRawData(d.data, length);
-    }
+void TextList::removeLast()
+{
+    m_text.truncate(m_offsets.last());
+    m_offsets.removeLast();
+    m_boxes.removeLast();
+}
 
-    inline NormalizedRect transformedArea(const QTransform &matrix) const
-    {
-        NormalizedRect transformed_area = area;
-        transformed_area.transform(matrix);
-        return transformed_area;
-    }
+QStringRef TextList::text(int index) const
+{
+    const int begin = m_offsets.at(index);
+    const int end = index + 1 < m_offsets.count() ? m_offsets.at(index + 1) : m_text.length();
+    return QStringRef(&m_text, begin, end - begin);
+}
 
-    NormalizedRect area;
+int TextList::indexAt(int position) const
+{
+    return std::upper_bound(m_offsets.constBegin(), m_offsets.constEnd(), position) - m_offsets.constBegin() - 1;
+}
 
-private:
-    Q_DISABLE_COPY(TinyTextEntity)
+NormalizedRect TextList::area(int index) const
+{
+    const Box &box = m_boxes.at(index);
+    return NormalizedRect(box.left, box.top, box.right, box.bottom);
+}
 
-    union {
-        QChar *data;
-        ushort qc[MaxStaticChars];
-    } d;
-    int length;
-};
+NormalizedRect TextList::transformedArea(int index, const QTransform &matrix) const
+{
+    NormalizedRect transformed_area = area(index);
+    transformed_area.transform(matrix);
+    return transformed_area;
+}
 
 TextEntity::TextEntity(const QString &text, NormalizedRect *area)
     : m_text(text)
@@ -218,7 +195,6 @@ TextPagePrivate::TextPagePrivate()
 TextPagePrivate::~TextPagePrivate()
 {
     qDeleteAll(m_searchPoints);
-    qDeleteAll(m_words);
 }
 
 TextPage::TextPage()
@@ -233,7 +209,7 @@ TextPage::TextPage(const TextEntity::List &words)
     for (; it != itEnd; ++it) {
         TextEntity *e = *it;
         if (!e->text().isEmpty())
-            d->m_words.append(new TinyTextEntity(e->text(), *e->area()));
+            d->m_words.append(e->text(), *e->area());
         delete e;
     }
 }
@@ -247,43 +223,52 @@ void TextPage::append(const QString &text, NormalizedRect *area)
 {
     if (!text.isEmpty()) {
         if (!d->m_words.isEmpty()) {
-            TinyTextEntity *lastEntity = d->m_words.last();
-            const QString concatText = lastEntity->text() + text.normalized(QString::NormalizationForm_KC);
+            const int last = d->m_words.count() - 1;
+            const QString concatText = d->m_words.text(last).toString() + text.normalized(QString::NormalizationForm_KC);
             if (concatText != concatText.normalized(QString::NormalizationForm_KC)) {
                 // If this happens it means that the new text + old one have combined, for example A and ◌̊  form Å
-                NormalizedRect newArea = *area | lastEntity->area;
+                NormalizedRect newArea = *area | d->m_words.area(last);
                 delete area;
-                delete lastEntity;
                 d->m_words.removeLast();
-                d->m_words.append(new TinyTextEntity(concatText.normalized(QString::NormalizationForm_KC), newArea));
+                d->m_words.append(concatText.normalized(QString::NormalizationForm_KC), newArea);
+                d->m_foldedText.clear();
                 return;
             }
         }
 
-        d->m_words.append(new TinyTextEntity(text.normalized(QString::NormalizationForm_KC), *area));
+        d->m_words.append(text.normalized(QString::NormalizationForm_KC), *area);
+        d->m_foldedText.clear();
     }
     delete area;
 }
 
+/**
+ * A word made while correcting the text order, with the range its characters
+ * take in the TextList they were copied to.
+ */
 struct WordWithCharacters {
-    WordWithCharacters(TinyTextEntity *w, const TextList &c)
-        : word(w)
-        , characters(c)
+    WordWithCharacters(const QString &t, const NormalizedRect &a, int first, int count)
+        : wordText(t)
+        , wordArea(a)
+        , firstCharacter(first)
+        , characterCount(count)
     {
     }
 
     inline QString text() const
     {
-        return word->text();
+        return wordText;
     }
 
     inline const NormalizedRect &area() const
     {
-        return word->area;
+        return wordArea;
     }
 
-    TinyTextEntity *word;
-    TextList characters;
+    QString wordText;
+    NormalizedRect wordArea;
+    int firstCharacter;
+    int characterCount;
 };
 typedef QList<WordWithCharacters> WordsWithCharacters;
 
@@ -383,7 +368,7 @@ RegularAreaRect *TextPage::textArea(TextSelection *sel) const
     const double maxY = content.bottom();
 
     /**
-     * We will now find out the TinyTextEntity for the startRectangle and TinyTextEntity for
+     * We will now find out the entity for the startRectangle and the entity for
      * the endRectangle. We have four cases:
      *
      * Case 1(a): both startpoint and endpoint are out of the bounding Rectangle and at one side, so the rectangle made of start
@@ -405,7 +390,7 @@ RegularAreaRect *TextPage::textArea(TextSelection *sel) const
      * text within them. so, we need to search for the best suitable textposition for start and end.
      *
      * Case 3(a): We search the nearest rectangle consisting of some
-     * TinyTextEntity right to or bottom of the startPoint for selection 01.
+     * entity right to or bottom of the startPoint for selection 01.
      * And, for selection 02, we have to search for right and top
      *
      * Case 3(b): For endpoint, we have to find the point top of or left to
@@ -446,54 +431,54 @@ RegularAreaRect *TextPage::textArea(TextSelection *sel) const
             endC.y = minY / scaleY;
     }
 
-    TextList::ConstIterator it = d->m_words.constBegin(), itEnd = d->m_words.constEnd();
-    TextList::ConstIterator start = it, end = itEnd, tmpIt = it; //, tmpItEnd = itEnd;
+    const TextList &words = d->m_words;
+    const int count = words.count();
+    int start = 0, end = count;
     const MergeSide side = d->m_page ? (MergeSide)d->m_page->totalOrientation() : MergeRight;
 
     NormalizedRect tmp;
     // case 2(a)
-    for (; it != itEnd; ++it) {
-        tmp = (*it)->area;
+    for (int i = 0; i < count; ++i) {
+        tmp = words.area(i);
         if (tmp.contains(startC.x, startC.y)) {
-            start = it;
+            start = i;
         }
         if (tmp.contains(endC.x, endC.y)) {
-            end = it;
+            end = i;
         }
     }
 
     // case 2(b)
-    it = tmpIt;
-    if (start == it && end == itEnd) {
-        for (; it != itEnd; ++it) {
+    if (start == 0 && end == count) {
+        int i = 0;
+        for (; i < count; ++i) {
             // is there any text rectangle within the start_end rect
-            tmp = (*it)->area;
+            tmp = words.area(i);
             if (start_end.intersects(tmp))
                 break;
         }
 
         // we have searched every text entities, but none is within the rectangle created by start and end
         // so, no selection should be done
-        if (it == itEnd) {
+        if (i == count) {
             return ret;
         }
     }
-    it = tmpIt;
     bool selection_two_start = false;
 
     // case 3.a
-    if (start == it) {
+    if (start == 0) {
         bool flagV = false;
         NormalizedRect rect;
 
         // selection type 01
         if (startC.y <= endC.y) {
-            for (; it != itEnd; ++it) {
-                rect = (*it)->area;
+            for (int i = 0; i < count; ++i) {
+                rect = words.area(i);
                 rect.isBottom(startC) ? flagV = false : flagV = true;
 
                 if (flagV && rect.isRight(startC)) {
-                    start = it;
+                    start = i;
                     break;
                 }
             }
@@ -503,13 +488,11 @@ RegularAreaRect *TextPage::textArea(TextSelection *sel) const
         else {
             selection_two_start = true;
             int distance = scaleX + scaleY + 100;
-            int count = 0;
 
-            for (; it != itEnd; ++it) {
-                rect = (*it)->area;
+            for (int i = 0; i < count; ++i) {
+                rect = words.area(i);
 
                 if (rect.isBottomOrLevel(startC) && rect.isRight(startC)) {
-                    count++;
                     QRect entRect = rect.geometry(scaleX, scaleY);
                     int xdist, ydist;
                     xdist = entRect.center().x() - startC.x * scaleX;
@@ -523,7 +506,7 @@ RegularAreaRect *TextPage::textArea(TextSelection *sel) const
 
                     if ((xdist + ydist) < distance) {
                         distance = xdist + ydist;
-                        start = it;
+                        start = i;
                     }
                 }
             }
@@ -531,20 +514,17 @@ RegularAreaRect *TextPage::textArea(TextSelection *sel) const
     }
 
     // case 3.b
-    if (end == itEnd) {
-        it = tmpIt;
-        itEnd = itEnd - 1;
-
+    if (end == count) {
         bool flagV = false;
         NormalizedRect rect;
 
         if (startC.y <= endC.y) {
-            for (; itEnd >= it; itEnd--) {
-                rect = (*itEnd)->area;
+            for (int i = count - 1; i >= 0; --i) {
+                rect = words.area(i);
                 rect.isTop(endC) ? flagV = false : flagV = true;
 
                 if (flagV && rect.isLeft(endC)) {
-                    end = itEnd;
+                    end = i;
                     break;
                 }
             }
@@ -552,8 +532,8 @@ RegularAreaRect *TextPage::textArea(TextSelection *sel) const
 
         else {
             int distance = scaleX + scaleY + 100;
-            for (; itEnd >= it; itEnd--) {
-                rect = (*itEnd)->area;
+            for (int i = count - 1; i >= 0; --i) {
+                rect = words.area(i);
 
                 if (rect.isTopOrLevel(endC) && rect.isLeft(endC)) {
                     QRect entRect = rect.geometry(scaleX, scaleY);
@@ -569,7 +549,7 @@ RegularAreaRect *TextPage::textArea(TextSelection *sel) const
 
                     if ((xdist + ydist) < distance) {
                         distance = xdist + ydist;
-                        end = itEnd;
+                        end = i;
                     }
                 }
             }
@@ -588,17 +568,15 @@ RegularAreaRect *TextPage::textArea(TextSelection *sel) const
 
     // if start is less than end swap them
     if (start > end) {
-        it = start;
-        start = end;
-        end = it;
+        qSwap(start, end);
     }
 
     // removes the possibility of crash, in case none of 1 to 3 is true
-    if (end == d->m_words.constEnd())
+    if (end == count)
         end--;
 
     for (; start <= end; start++) {
-        ret->appendShape((*start)->transformedArea(matrix), side);
+        ret->appendShape(words.transformedArea(start, matrix), side);
     }
 
     return ret;
@@ -610,11 +588,8 @@ RegularAreaRect *TextPage::findText(int searchID, const QString &query, SearchDi
     // invalid search request
     if (d->m_words.isEmpty() || query.isEmpty() || (area && area->isNull()))
         return nullptr;
-    TextList::ConstIterator start;
-    int start_offset = 0;
-    TextList::ConstIterator end;
-    const QMap<int, SearchPoint *>::const_iterator sIt = d->m_searchPoints.constFind(searchID);
-    if (sIt == d->m_searchPoints.constEnd()) {
+    QMap<int, SearchPoint *>::iterator sIt = d->m_searchPoints.find(searchID);
+    if (sIt == d->m_searchPoints.end()) {
         // if no previous run of this search is found, then set it to start
         // from the beginning (respecting the search direction)
         if (dir == NextResult)
@@ -622,46 +597,78 @@ RegularAreaRect *TextPage::findText(int searchID, const QString &query, SearchDi
         else if (dir == PreviousResult)
             dir = FromBottom;
     }
-    bool forward = true;
+
+    const QString &text = d->searchText(caseSensitivity);
+    const QString searchQuery = TextPagePrivate::searchQuery(query, caseSensitivity);
+    int begin = -1, end = 0;
     switch (dir) {
     case FromTop:
-        start = d->m_words.constBegin();
-        start_offset = 0;
-        end = d->m_words.constEnd();
+        begin = d->findForward(text, searchQuery, 0, &end);
         break;
     case FromBottom:
-        start = d->m_words.constEnd();
-        start_offset = 0;
-        end = d->m_words.constBegin();
-        forward = false;
+        begin = d->findBackward(text, searchQuery, text.length(), &end);
         break;
     case NextResult:
-        start = (*sIt)->it_end;
-        start_offset = (*sIt)->offset_end;
-        end = d->m_words.constEnd();
+        begin = d->findForward(text, searchQuery, (*sIt)->end, &end);
         break;
     case PreviousResult:
-        start = (*sIt)->it_begin;
-        start_offset = (*sIt)->offset_begin;
-        end = d->m_words.constBegin();
-        forward = false;
+        begin = d->findBackward(text, searchQuery, (*sIt)->begin, &end);
         break;
     };
-    RegularAreaRect *ret = nullptr;
-    const TextComparisonFunction cmpFn = caseSensitivity == Qt::CaseSensitive ? CaseSensitiveCmpFn : CaseInsensitiveCmpFn;
-    if (forward) {
-        ret = d->findTextInternalForward(searchID, query, cmpFn, start, start_offset, end);
-    } else {
-        ret = d->findTextInternalBackward(searchID, query, cmpFn, start, start_offset, end);
+
+    if (begin == -1) {
+        if (sIt != d->m_searchPoints.end()) {
+            delete *sIt;
+            d->m_searchPoints.erase(sIt);
+        }
+        return nullptr;
     }
-    return ret;
+
+    // save or update the search point for the current searchID
+    if (sIt == d->m_searchPoints.end()) {
+        sIt = d->m_searchPoints.insert(searchID, new SearchPoint);
+    }
+    (*sIt)->begin = begin;
+    (*sIt)->end = end;
+    return d->rangeToArea(begin, end);
+}
+
+QVector<RegularAreaRect *> TextPage::findAllText(const QString &query, Qt::CaseSensitivity caseSensitivity) const
+{
+    QVector<RegularAreaRect *> matches;
+    if (d->m_words.isEmpty() || query.isEmpty())
+        return matches;
+
+    const QString &text = d->searchText(caseSensitivity);
+    const QString searchQuery = TextPagePrivate::searchQuery(query, caseSensitivity);
+    int end = 0;
+    for (int begin = d->findForward(text, searchQuery, 0, &end); begin != -1; begin = d->findForward(text, searchQuery, end, &end)) {
+        matches.append(d->rangeToArea(begin, end));
+    }
+    return matches;
+}
+
+QVector<RegularAreaRect *> TextPage::findAllText(const QRegularExpression &expression) const
+{
+    QVector<RegularAreaRect *> matches;
+    if (d->m_words.isEmpty() || !expression.isValid())
+        return matches;
+
+    QRegularExpressionMatchIterator it = expression.globalMatch(d->m_words.string());
+    while (it.hasNext()) {
+        const QRegularExpressionMatch match = it.next();
+        // an empty match has no area
+        if (match.capturedLength() > 0)
+            matches.append(d->rangeToArea(match.capturedStart(), match.capturedEnd()));
+    }
+    return matches;
 }
 
 // hyphenated '-' must be at the end of a word, so hyphenation means
 // we have a '-' just followed by a '\n' character
 // check if the string contains a '-' character
 // if the '-' is the last entry
-static int stringLengthAdaptedWithHyphen(const QString &str, const TextList::ConstIterator &it, const TextList::ConstIterator &textListEnd)
+static int stringLengthAdaptedWithHyphen(const QStringRef &str, const TextList &words, int index)
 {
     const int len = str.length();
 
@@ -670,17 +677,17 @@ static int stringLengthAdaptedWithHyphen(const QString &str, const TextList::Con
     // check if the string contains a '-' character
     // if the '-' is the last entry
     if (str.endsWith(QLatin1Char('-'))) {
-        // validity chek of it + 1
-        if ((it + 1) != textListEnd) {
+        // validity chek of index + 1
+        if (index + 1 < words.count()) {
             // 1. if the next character is '\n'
-            const QString &lookahedStr = (*(it + 1))->text();
+            const QStringRef lookahedStr = words.text(index + 1);
             if (lookahedStr.startsWith(QLatin1Char('\n'))) {
                 return len - 1;
             }
 
             // 2. if the next word is in a different line or not
-            const NormalizedRect &hyphenArea = (*it)->area;
-            const NormalizedRect &lookaheadArea = (*(it + 1))->area;
+            const NormalizedRect hyphenArea = words.area(index);
+            const NormalizedRect lookaheadArea = words.area(index + 1);
 
             // lookahead to check whether both the '-' rect and next character rect overlap
             if (!doesConsumeY(hyphenArea, lookaheadArea, 70)) {
@@ -696,230 +703,115 @@ static int stringLengthAdaptedWithHyphen(const QString &str, const TextList::Con
     return len;
 }
 
-RegularAreaRect *TextPagePrivate::searchPointToArea(const SearchPoint *sp)
+const QString &TextPagePrivate::searchText(Qt::CaseSensitivity caseSensitivity) const
 {
-    PagePrivate *pagePrivate = PagePrivate::get(m_page);
-    const QTransform matrix = pagePrivate ? pagePrivate->rotationMatrix() : QTransform();
-    RegularAreaRect *ret = new RegularAreaRect;
-
-    for (TextList::ConstIterator it = sp->it_begin;; it++) {
-        const TinyTextEntity *curEntity = *it;
-        ret->append(curEntity->transformedArea(matrix));
-
-        if (it == sp->it_end) {
-            break;
-        }
-    }
+    if (caseSensitivity == Qt::CaseSensitive)
+        return m_words.string();
 
-    ret->simplify();
-    return ret;
+    if (m_foldedText.isNull())
+        m_foldedText = caseFolded(m_words.string());
+    return m_foldedText;
 }
 
-RegularAreaRect *TextPagePrivate::findTextInternalForward(int searchID, const QString &_query, TextComparisonFunction comparer, const TextList::ConstIterator &start, int start_offset, const TextList::ConstIterator &end)
+QString TextPagePrivate::searchQuery(const QString &query, Qt::CaseSensitivity caseSensitivity)
 {
     // normalize query search all unicode (including glyphs)
-    const QString query = _query.normalized(QString::NormalizationForm_KC);
+    const QString normalized = query.normalized(QString::NormalizationForm_KC);
+    return caseSensitivity == Qt::CaseSensitive ? normalized : caseFolded(normalized);
+}
 
+/**
+ * Returns whether @p query matches @p text from @p position on, and if so
+ * sets @p end to the position after the match.
+ */
+bool TextPagePrivate::matchAt(const QString &text, const QString &query, int position, int *end) const
+{
     // j is the current position in our query
     // queryLeft is the length of the query we have left to match
     int j = 0, queryLeft = query.length();
 
-    TextList::ConstIterator it = start;
-    int offset = start_offset;
-
-    TextList::ConstIterator it_begin = TextList::ConstIterator();
-    int offset_begin = 0; // dummy initial value to suppress compiler warnings
+    const int count = m_words.count();
+    int it = m_words.indexAt(position);
+    int offset = position - m_words.offset(it);
 
-    while (it != end) {
-        const TinyTextEntity *curEntity = *it;
-        const QString &str = curEntity->text();
+    for (; it < count; ++it, offset = 0) {
+        const QStringRef str = m_words.text(it);
+        const int strBegin = m_words.offset(it);
         const int strLen = str.length();
-        const int adjustedLen = stringLengthAdaptedWithHyphen(str, it, m_words.constEnd());
+        const int adjustedLen = stringLengthAdaptedWithHyphen(str, m_words, it);
         // adjustedLen <= strLen
 
-        if (offset >= strLen) {
-            it++;
-            offset = 0;
-            continue;
-        }
-
-        if (it_begin == TextList::ConstIterator()) {
-            it_begin = it;
-            offset_begin = offset;
-        }
-
         // Let the user write the hyphen or not when searching for text
         int matchedLen = -1;
         for (int matchingLen = strLen; matchingLen >= adjustedLen; matchingLen--) {
             // we have equal (or less than) area of the query left as the length of the current
             // entity
             const int min = qMin(queryLeft, matchingLen - offset);
-            if (comparer(str.midRef(offset, min), query.midRef(j, min))) {
+            if (min >= 0 && QStringRef(&text, strBegin + offset, min) == query.midRef(j, min)) {
                 matchedLen = min;
                 break;
             }
         }
 
         if (matchedLen == -1) {
-            // we have not matched
-            // this means we do not have a complete match
-            // we need to get back to query start
-            // and continue the search from this place
 #ifdef DEBUG_TEXTPAGE
             qCDebug(OkularCoreDebug) << "\tnot matched";
 #endif
-            j = 0;
-            queryLeft = query.length();
-            it = it_begin;
-            offset = offset_begin + 1;
-            it_begin = TextList::ConstIterator();
-        } else {
-            // we have a match
-            // move the current position in the query
-            // to the position after the length of this string
-            // we matched
-            // subtract the length of the current entity from
-            // the left length of the query
+            return false;
+        }
+
 #ifdef DEBUG_TEXTPAGE
-            qCDebug(OkularCoreDebug) << "\tmatched" << matchedLen;
+        qCDebug(OkularCoreDebug) << "\tmatched" << matchedLen;
 #endif
-            j += matchedLen;
-            queryLeft -= matchedLen;
-
-            if (queryLeft == 0) {
-                // save or update the search point for the current searchID
-                QMap<int, SearchPoint *>::iterator sIt = m_searchPoints.find(searchID);
-                if (sIt == m_searchPoints.end()) {
-                    sIt = m_searchPoints.insert(searchID, new SearchPoint);
-                }
-                SearchPoint *sp = *sIt;
-                sp->it_begin = it_begin;
-                sp->it_end = it;
-                sp->offset_begin = offset_begin;
-                sp->offset_end = offset + matchedLen;
-                return searchPointToArea(sp);
-            }
+        j += matchedLen;
+        queryLeft -= matchedLen;
 
-            it++;
-            offset = 0;
+        if (queryLeft == 0) {
+            *end = strBegin + offset + matchedLen;
+            return true;
         }
     }
-    // end of loop - it means that we've ended the textentities
+    return false;
+}
 
-    const QMap<int, SearchPoint *>::iterator sIt = m_searchPoints.find(searchID);
-    if (sIt != m_searchPoints.end()) {
-        SearchPoint *sp = *sIt;
-        m_searchPoints.erase(sIt);
-        delete sp;
+int TextPagePrivate::findForward(const QString &text, const QString &query, int from, int *end) const
+{
+    // only the positions of the first character of the query can start a match,
+    // looking for them is much faster than trying to match at every position
+    const QChar first = query.at(0);
+    for (int position = text.indexOf(first, from); position != -1; position = text.indexOf(first, position + 1)) {
+        if (matchAt(text, query, position, end))
+            return position;
     }
-    return nullptr;
+    return -1;
 }
 
-RegularAreaRect *TextPagePrivate::findTextInternalBackward(int searchID, const QString &_query, TextComparisonFunction comparer, const TextList::ConstIterator &start, int start_offset, const TextList::ConstIterator &end)
+int TextPagePrivate::findBackward(const QString &text, const QString &query, int before, int *end) const
 {
-    // normalize query to search all unicode (including glyphs)
-    const QString query = _query.normalized(QString::NormalizationForm_KC);
-
-    // j is the current position in our query
-    // len is the length of the string in TextEntity
-    // queryLeft is the length of the query we have left
-    int j = query.length(), queryLeft = query.length();
-
-    TextList::ConstIterator it = start;
-    int offset = start_offset;
-
-    TextList::ConstIterator it_begin = TextList::ConstIterator();
-    int offset_begin = 0; // dummy initial value to suppress compiler warnings
-
-    while (true) {
-        if (offset <= 0) {
-            if (it == end) {
-                break;
-            }
-            it--;
+    const QChar first = query.at(0);
+    for (int position = before > 0 ? text.lastIndexOf(first, before - 1) : -1; position != -1; position = position > 0 ? text.lastIndexOf(first, position - 1) : -1) {
+        int matchEnd;
+        if (matchAt(text, query, position, &matchEnd) && matchEnd <= before) {
+            *end = matchEnd;
+            return position;
         }
+    }
+    return -1;
+}
 
-        const TinyTextEntity *curEntity = *it;
-        const QString &str = curEntity->text();
-        const int strLen = str.length();
-        const int adjustedLen = stringLengthAdaptedWithHyphen(str, it, m_words.constEnd());
-        // adjustedLen <= strLen
-
-        if (offset <= 0) {
-            offset = strLen;
-        }
-
-        if (it_begin == TextList::ConstIterator()) {
-            it_begin = it;
-            offset_begin = offset;
-        }
-
-        // Let the user write the hyphen or not when searching for text
-        int matchedLen = -1;
-        // we have equal (or less than) area of the query left as the length of the current
-        // entity
-        for (int matchingLen = strLen; matchingLen >= adjustedLen; matchingLen--) {
-            const int hyphenOffset = (strLen - matchingLen);
-            const int min = qMin(queryLeft + hyphenOffset, offset);
-            if (comparer(str.midRef(offset - min, min - hyphenOffset), query.midRef(j - min + hyphenOffset, min - hyphenOffset))) {
-                matchedLen = min - hyphenOffset;
-                break;
-            }
-        }
-
-        if (matchedLen == -1) {
-            // we have not matched
-            // this means we do not have a complete match
-            // we need to get back to query start
-            // and continue the search from this place
-#ifdef DEBUG_TEXTPAGE
-            qCDebug(OkularCoreDebug) << "\tnot matched";
-#endif
-
-            j = query.length();
-            queryLeft = query.length();
-            it = it_begin;
-            offset = offset_begin - 1;
-            it_begin = TextList::ConstIterator();
-        } else {
-            // we have a match
-            // move the current position in the query
-            // to the position after the length of this string
-            // we matched
-            // subtract the length of the current entity from
-            // the left length of the query
-#ifdef DEBUG_TEXTPAGE
-            qCDebug(OkularCoreDebug) << "\tmatched";
-#endif
-            j -= matchedLen;
-            queryLeft -= matchedLen;
-
-            if (queryLeft == 0) {
-                // save or update the search point for the current searchID
-                QMap<int, SearchPoint *>::iterator sIt = m_searchPoints.find(searchID);
-                if (sIt == m_searchPoints.end()) {
-                    sIt = m_searchPoints.insert(searchID, new SearchPoint);
-                }
-                SearchPoint *sp = *sIt;
-                sp->it_begin = it;
-                sp->it_end = it_begin;
-                sp->offset_begin = offset - matchedLen;
-                sp->offset_end = offset_begin;
-                return searchPointToArea(sp);
-            }
+RegularAreaRect *TextPagePrivate::rangeToArea(int begin, int end) const
+{
+    PagePrivate *pagePrivate = PagePrivate::get(m_page);
+    const QTransform matrix = pagePrivate ? pagePrivate->rotationMatrix() : QTransform();
+    RegularAreaRect *ret = new RegularAreaRect;
 
-            offset = 0;
-        }
+    const int last = m_words.indexAt(end - 1);
+    for (int i = m_words.indexAt(begin); i <= last; ++i) {
+        ret->append(m_words.transformedArea(i, matrix));
     }
-    // end of loop - it means that we've ended the textentities
 
-    const QMap<int, SearchPoint *>::iterator sIt = m_searchPoints.find(searchID);
-    if (sIt != m_searchPoints.end()) {
-        SearchPoint *sp = *sIt;
-        m_searchPoints.erase(sIt);
-        delete sp;
-    }
-    return nullptr;
+    ret->simplify();
+    return ret;
 }
 
 QString TextPage::text(const RegularAreaRect *area) const
@@ -932,29 +824,29 @@ QString TextPage::text(const RegularAreaRect *area, TextAreaInclusionBehaviour b
     if (area && area->isNull())
         return QString();
 
-    TextList::ConstIterator it = d->m_words.constBegin(), itEnd = d->m_words.constEnd();
+    const int count = d->m_words.count();
     QString ret;
     if (area) {
-        for (; it != itEnd; ++it) {
+        for (int i = 0; i < count; ++i) {
             if (b == AnyPixelTextAreaInclusionBehaviour) {
-                if (area->intersects((*it)->area)) {
-                    ret += (*it)->text();
+                if (area->intersects(d->m_words.area(i))) {
+                    ret += d->m_words.text(i);
                 }
             } else {
-                NormalizedPoint center = (*it)->area.center();
+                NormalizedPoint center = d->m_words.area(i).center();
                 if (area->contains(center.x, center.y)) {
-                    ret += (*it)->text();
+                    ret += d->m_words.text(i);
                 }
             }
         }
     } else {
-        for (; it != itEnd; ++it)
-            ret += (*it)->text();
+        for (int i = 0; i < count; ++i)
+            ret += d->m_words.text(i);
     }
     return ret;
 }
 
-static bool compareTinyTextEntityX(const WordWithCharacters &first, const WordWithCharacters &second)
+static bool compareWordsX(const WordWithCharacters &first, const WordWithCharacters &second)
 {
     QRect firstArea = first.area().roundedGeometry(1000, 1000);
     QRect secondArea = second.area().roundedGeometry(1000, 1000);
@@ -962,7 +854,7 @@ static bool compareTinyTextEntityX(const WordWithCharacters &first, const WordWi
     return firstArea.left() < secondArea.left();
 }
 
-static bool compareTinyTextEntityY(const WordWithCharacters &first, const WordWithCharacters &second)
+static bool compareWordsY(const WordWithCharacters &first, const WordWithCharacters &second)
 {
     const QRect firstArea = first.area().roundedGeometry(1000, 1000);
     const QRect secondArea = second.area().roundedGeometry(1000, 1000);
@@ -971,46 +863,44 @@ static bool compareTinyTextEntityY(const WordWithCharacters &first, const WordWi
 }
 
 /**
- * Sets a new world list. Deleting the contents of the old one
+ * Sets a new world list, replacing the old one
  */
 void TextPagePrivate::setWordList(const TextList &list)
 {
-    qDeleteAll(m_words);
     m_words = list;
+    m_foldedText.clear();
 }
 
 /**
  * Remove all the spaces in between texts. It will make all the generators
  * same, whether they save spaces(like pdf) or not(like djvu).
  */
-static void removeSpace(TextList *words)
+static TextList removeSpace(const TextList &words)
 {
-    TextList::Iterator it = words->begin();
-    const QString str(QLatin1Char(' '));
+    TextList withoutSpaces;
+    withoutSpaces.reserve(words.count());
 
-    while (it != words->end()) {
-        if ((*it)->text() == str) {
-            it = words->erase(it);
-        } else {
-            ++it;
+    for (int i = 0; i < words.count(); ++i) {
+        if (words.text(i) != QLatin1String(" ")) {
+            withoutSpaces.append(words, i);
         }
     }
+    return withoutSpaces;
 }
 
 /**
- * We will read the TinyTextEntity from characters and try to create words from there.
+ * We will read the entities from characters and try to create words from there.
  * Note: characters might be already characters for some generators, but we will keep
- * the nomenclature characters for the generator produced data. The resulting
- * WordsWithCharacters memory has to be managed by the caller, both the
- * WordWithCharacters::word and WordWithCharacters::characters contents
+ * the nomenclature characters for the generator produced data. The characters of
+ * the resulting words are appended to @p wordCharacters.
  */
-static WordsWithCharacters makeWordFromCharacters(const TextList &characters, int pageWidth, int pageHeight)
+static WordsWithCharacters makeWordFromCharacters(const TextList &characters, int pageWidth, int pageHeight, TextList *wordCharacters)
 {
     /**
-     * We will traverse characters and try to create words from the TinyTextEntities in it.
-     * We will search TinyTextEntity blocks and merge them until we get a
-     * space between two consecutive TinyTextEntities. When we get a space
-     * we can take it as a end of word. Then we store the word as a TinyTextEntity
+     * We will traverse characters and try to create words from the entities in it.
+     * We will search entity blocks and merge them until we get a
+     * space between two consecutive entities. When we get a space
+     * we can take it as a end of word. Then we store the word
      * and keep it in newList.
 
      * We create a RegionText named regionWord that contains the word and the characters associated with it and
@@ -1019,15 +909,16 @@ static WordsWithCharacters makeWordFromCharacters(const TextList &characters, in
      */
     WordsWithCharacters wordsWithCharacters;
 
-    TextList::ConstIterator it = characters.begin(), itEnd = characters.end(), tmpIt;
+    const int itEnd = characters.count();
+    int it = 0, tmpIt;
     int newLeft, newRight, newTop, newBottom;
     int index = 0;
 
     for (; it != itEnd; it++) {
-        QString textString = (*it)->text();
+        QString textString = characters.text(it).toString();
         QString newString;
-        QRect lineArea = (*it)->area.roundedGeometry(pageWidth, pageHeight), elementArea;
-        TextList wordCharacters;
+        QRect lineArea = characters.area(it).roundedGeometry(pageWidth, pageHeight), elementArea;
+        const int firstCharacter = wordCharacters->count();
         tmpIt = it;
         int space = 0;
 
@@ -1038,10 +929,10 @@ static WordsWithCharacters makeWordFromCharacters(const TextList &characters, in
                 // when textString is the start of the word
                 if (tmpIt == it) {
                     NormalizedRect newRect(lineArea, pageWidth, pageHeight);
-                    wordCharacters.append(new TinyTextEntity(textString.normalized(QString::NormalizationForm_KC), newRect));
+                    wordCharacters->append(textString.normalized(QString::NormalizationForm_KC), newRect);
                 } else {
                     NormalizedRect newRect(elementArea, pageWidth, pageHeight);
-                    wordCharacters.append(new TinyTextEntity(textString.normalized(QString::NormalizationForm_KC), newRect));
+                    wordCharacters->append(textString.normalized(QString::NormalizationForm_KC), newRect);
                 }
             }
 
@@ -1053,7 +944,7 @@ static WordsWithCharacters makeWordFromCharacters(const TextList &characters, in
              */
             if (it == itEnd)
                 break;
-            elementArea = (*it)->area.roundedGeometry(pageWidth, pageHeight);
+            elementArea = characters.area(it).roundedGeometry(pageWidth, pageHeight);
             if (!doesConsumeY(elementArea, lineArea, 60)) {
                 --it;
                 break;
@@ -1079,14 +970,13 @@ static WordsWithCharacters makeWordFromCharacters(const TextList &characters, in
             lineArea.setWidth(newRight - newLeft);
             lineArea.setHeight(newBottom - newTop);
 
-            textString = (*it)->text();
+            textString = characters.text(it).toString();
         }
 
         // if newString is not empty, save it
         if (!newString.isEmpty()) {
             const NormalizedRect newRect(lineArea, pageWidth, pageHeight);
-            TinyTextEntity *word = new TinyTextEntity(newString.normalized(QString::NormalizationForm_KC), newRect);
-            wordsWithCharacters.append(WordWithCharacters(word, wordCharacters));
+            wordsWithCharacters.append(WordWithCharacters(newString.normalized(QString::NormalizationForm_KC), newRect, firstCharacter, wordCharacters->count() - firstCharacter));
 
             index++;
         }
@@ -1110,20 +1000,16 @@ QList<QPair<WordsWithCharacters, QRect>> makeAndSortLines(const WordsWithCharact
      * So, we need to:
      **
      * 1. Sort rectangles/boxes containing texts by y0(top)
-     * 2. Create textline where there is y overlap between TinyTextEntity 's
-     * 3. Within each line sort the TinyTextEntity 's by x0(left)
+     * 2. Create textline where there is y overlap between words
+     * 3. Within each line sort the words by x0(left)
      */
 
     QList<QPair<WordsWithCharacters, QRect>> lines;
 
-    /*
-     Make a new copy of the TextList in the words, so that the wordsTmp and lines do
-     not contain same pointers for all the TinyTextEntity.
-     */
     QList<WordWithCharacters> words = wordsTmp;
 
     // Step 1
-    std::sort(words.begin(), words.end(), compareTinyTextEntityY);
+    std::sort(words.begin(), words.end(), compareWordsY);
 
     // Step 2
     QList<WordWithCharacters>::Iterator it = words.begin(), itEnd = words.end();
@@ -1176,7 +1062,7 @@ QList<QPair<WordsWithCharacters, QRect>> makeAndSortLines(const WordsWithCharact
     // Step 3
     for (QPair<WordsWithCharacters, QRect> &line : lines) {
         WordsWithCharacters &list = line.first;
-        std::sort(list.begin(), list.end(), compareTinyTextEntityX);
+        std::sort(list.begin(), list.end(), compareWordsX);
     }
 
     return lines;
@@ -1247,7 +1133,7 @@ static void calculateStatisticalInformation(const QList<WordWithCharacters> &wor
         QList<QRect> line_space_rects;
         int maxSpace = 0, minSpace = pageWidth;
 
-        // for every TinyTextEntity element in the line
+        // for every word in the line
         WordsWithCharacters::ConstIterator it = list.begin(), itEnd = list.end();
         QRect max_area1, max_area2;
         QString before_max, after_max;
@@ -1353,8 +1239,7 @@ static void calculateStatisticalInformation(const QList<WordWithCharacters> &wor
 
 /**
  * Implements the XY Cut algorithm for textpage segmentation
- * The resulting RegionTextList will contain RegionText whose WordsWithCharacters::word and
- * WordsWithCharacters::characters are reused from wordsWithCharacters (i.e. no new nor delete happens in this function)
+ * The resulting RegionTextList will contain RegionText whose WordsWithCharacters are copied from wordsWithCharacters
  */
 static RegionTextList XYCutForBoundingBoxes(const QList<WordWithCharacters> &wordsWithCharacters, const NormalizedRect &boundingBox, int pageWidth, int pageHeight)
 {
@@ -1402,8 +1287,7 @@ static RegionTextList XYCutForBoundingBoxes(const QList<WordWithCharacters> &wor
 
         // for every text in the region
         for (const WordWithCharacters &wwc : list) {
-            TinyTextEntity *ent = wwc.word;
-            const QRect entRect = ent->area.geometry(pageWidth, pageHeight);
+            const QRect entRect = wwc.area().geometry(pageWidth, pageHeight);
 
             // calculate vertical projection profile proj_on_xaxis1
             for (int k = entRect.left(); k <= entRect.left() + entRect.width(); ++k) {
@@ -1587,9 +1471,9 @@ static RegionTextList XYCutForBoundingBoxes(const QList<WordWithCharacters> &wor
 }
 
 /**
- * Add spaces in between words in a line. It reuses the pointers passed in tree and might add new ones. You will need to take care of deleting them if needed
+ * Add spaces in between words in a line. The characters of the spaces are appended to @p wordCharacters
  */
-WordsWithCharacters addNecessarySpace(RegionTextList tree, int pageWidth, int pageHeight)
+WordsWithCharacters addNecessarySpace(RegionTextList tree, int pageWidth, int pageHeight, TextList *wordCharacters)
 {
     /**
      * 1. Call makeAndSortLines before adding spaces in between words in a line
@@ -1614,7 +1498,7 @@ WordsWithCharacters addNecessarySpace(RegionTextList tree, int pageWidth, int pa
                 const int space = area2.left() - area1.right();
 
                 if (space != 0) {
-                    // Make a TinyTextEntity of string space and push it between it and it+1
+                    // Make a word of string space and push it between it and it+1
                     const int left = area1.right();
                     const int right = area2.left();
                     const int top = area2.top() < area1.top() ? area2.top() : area1.top();
@@ -1623,9 +1507,8 @@ WordsWithCharacters addNecessarySpace(RegionTextList tree, int pageWidth, int pa
                     const QString spaceStr(QStringLiteral(" "));
                     const QRect rect(QPoint(left, top), QPoint(right, bottom));
                     const NormalizedRect entRect(rect, pageWidth, pageHeight);
-                    TinyTextEntity *ent1 = new TinyTextEntity(spaceStr, entRect);
-                    TinyTextEntity *ent2 = new TinyTextEntity(spaceStr, entRect);
-                    WordWithCharacters word(ent1, QList<TinyTextEntity *>() << ent2);
+                    wordCharacters->append(spaceStr, entRect);
+                    WordWithCharacters word(spaceStr, entRect, wordCharacters->count() - 1, 1);
 
                     list.insert(k + 1, word);
 
@@ -1653,45 +1536,47 @@ WordsWithCharacters addNecessarySpace(RegionTextList tree, int pageWidth, int pa
 /**
  * Correct the textOrder, all layout recognition works here
  */
-void TextPagePrivate::correctTextOrder()
+void TextPagePrivate::correctTextOrder(double width, double height, const NormalizedRect &boundingBox)
 {
-    // m_page->width() and m_page->height() are in pixels at
+    // width and height of the page are in pixels at
     // 100% zoom level, and thus depend on display DPI.
     // To avoid Okular failing on lowDPI displays,
     // we scale pageWidth and pageHeight so their sum equals 2000.
-    const double scalingFactor = 2000.0 / (m_page->width() + m_page->height());
-    const int pageWidth = (int)(scalingFactor * m_page->width());
-    const int pageHeight = (int)(scalingFactor * m_page->height());
-
-    TextList characters = m_words;
+    const double scalingFactor = 2000.0 / (width + height);
+    const int pageWidth = (int)(scalingFactor * width);
+    const int pageHeight = (int)(scalingFactor * height);
 
     /**
      * Remove spaces from the text
      */
-    removeSpace(&characters);
+    const TextList characters = removeSpace(m_words);
 
     /**
      * Construct words from characters
      */
-    const QList<WordWithCharacters> wordsWithCharacters = makeWordFromCharacters(characters, pageWidth, pageHeight);
+    TextList wordCharacters;
+    wordCharacters.reserve(characters.count());
+    const QList<WordWithCharacters> wordsWithCharacters = makeWordFromCharacters(characters, pageWidth, pageHeight, &wordCharacters);
 
     /**
      * Make a XY Cut tree for segmentation of the texts
      */
-    const RegionTextList tree = XYCutForBoundingBoxes(wordsWithCharacters, m_page->boundingBox(), pageWidth, pageHeight);
+    const RegionTextList tree = XYCutForBoundingBoxes(wordsWithCharacters, boundingBox, pageWidth, pageHeight);
 
     /**
      * Add spaces to the word
      */
-    const WordsWithCharacters listWithWordsAndSpaces = addNecessarySpace(tree, pageWidth, pageHeight);
+    const WordsWithCharacters listWithWordsAndSpaces = addNecessarySpace(tree, pageWidth, pageHeight, &wordCharacters);
 
     /**
      * Break the words into characters
      */
     TextList listOfCharacters;
+    listOfCharacters.reserve(wordCharacters.count());
     for (const WordWithCharacters &word : listWithWordsAndSpaces) {
-        delete word.word;
-        listOfCharacters.append(word.characters);
+        for (int i = word.firstCharacter; i < word.firstCharacter + word.characterCount; ++i) {
+            listOfCharacters.append(wordCharacters, i);
+        }
     }
     setWordList(listOfCharacters);
 }
@@ -1702,22 +1587,24 @@ TextEntity::List TextPage::words(const RegularAreaRect *area, TextAreaInclusionB
         return TextEntity::List();
 
     TextEntity::List ret;
+    const int count = d->m_words.count();
     if (area) {
-        for (const TinyTextEntity *te : qAsConst(d->m_words)) {
+        for (int i = 0; i < count; ++i) {
+            const NormalizedRect teArea = d->m_words.area(i);
             if (b == AnyPixelTextAreaInclusionBehaviour) {
-                if (area->intersects(te->area)) {
-                    ret.append(new TextEntity(te->text(), new Okular::NormalizedRect(te->area)));
+                if (area->intersects(teArea)) {
+                    ret.append(new TextEntity(d->m_words.text(i).toString(), new Okular::NormalizedRect(teArea)));
                 }
             } else {
-                const NormalizedPoint center = te->area.center();
+                const NormalizedPoint center = teArea.center();
                 if (area->contains(center.x, center.y)) {
-                    ret.append(new TextEntity(te->text(), new Okular::NormalizedRect(te->area)));
+                    ret.append(new TextEntity(d->m_words.text(i).toString(), new Okular::NormalizedRect(teArea)));
                 }
             }
         }
     } else {
-        for (const TinyTextEntity *te : qAsConst(d->m_words)) {
-            ret.append(new TextEntity(te->text(), new Okular::NormalizedRect(te->area)));
+        for (int i = 0; i < count; ++i) {
+            ret.append(new TextEntity(d->m_words.text(i).toString(), new Okular::NormalizedRect(d->m_words.area(i))));
         }
     }
     return ret;
@@ -1725,24 +1612,24 @@ TextEntity::List TextPage::words(const RegularAreaRect *area, TextAreaInclusionB
 
 RegularAreaRect *TextPage::wordAt(const NormalizedPoint &p, QString *word) const
 {
-    TextList::ConstIterator itBegin = d->m_words.constBegin(), itEnd = d->m_words.constEnd();
-    TextList::ConstIterator it = itBegin;
-    TextList::ConstIterator posIt = itEnd;
-    for (; it != itEnd; ++it) {
-        if ((*it)->area.contains(p.x, p.y)) {
+    const TextList &words = d->m_words;
+    const int itBegin = 0, itEnd = words.count();
+    int posIt = itEnd;
+    for (int it = itBegin; it != itEnd; ++it) {
+        if (words.area(it).contains(p.x, p.y)) {
             posIt = it;
             break;
         }
     }
     QString text;
     if (posIt != itEnd) {
-        if ((*posIt)->text().simplified().isEmpty()) {
+        if (words.text(posIt).toString().simplified().isEmpty()) {
             return nullptr;
         }
-        // Find the first TinyTextEntity of the word
+        // Find the first entity of the word
         while (posIt != itBegin) {
             --posIt;
-            const QString itText = (*posIt)->text();
+            const QStringRef itText = words.text(posIt);
             if (itText.right(1).at(0).isSpace()) {
                 if (itText.endsWith(QLatin1String("-\n"))) {
                     // Is an hyphenated word
@@ -1752,7 +1639,7 @@ RegularAreaRect *TextPage::wordAt(const NormalizedPoint &p, QString *word) const
 
                 if (itText == QLatin1String("\n") && posIt != itBegin) {
                     --posIt;
-                    if ((*posIt)->text().endsWith(QLatin1String("-"))) {
+                    if (words.text(posIt).endsWith(QLatin1String("-"))) {
                         // Is an hyphenated word
                         // continue searching the start of the word back
                         continue;
@@ -1766,13 +1653,13 @@ RegularAreaRect *TextPage::wordAt(const NormalizedPoint &p, QString *word) const
         }
         RegularAreaRect *ret = new RegularAreaRect();
         for (; posIt != itEnd; ++posIt) {
-            const QString itText = (*posIt)->text();
-            if (itText.simplified().isEmpty()) {
+            const QStringRef itText = words.text(posIt);
+            if (itText.toString().simplified().isEmpty()) {
                 break;
             }
 
-            ret->appendShape((*posIt)->area);
-            text += (*posIt)->text();
+            ret->appendShape(words.area(posIt));
+            text += itText;
             if (itText.right(1).at(0).isSpace()) {
                 if (!text.endsWith(QLatin1String("-\n"))) {
                     break;
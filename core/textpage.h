@@ -12,10 +12,12 @@
 
 #include <QList>
 #include <QString>
+#include <QVector>
 
 #include "global.h"
 #include "okularcore_export.h"
 
+class QRegularExpression;
 class QTransform;
 
 namespace Okular
@@ -157,6 +159,31 @@ public:
      */
     RegularAreaRect *findText(int searchID, const QString &query, SearchDirection direction, Qt::CaseSensitivity caseSensitivity, const RegularAreaRect *area);
 
+    /**
+     * Returns the bounding rects of all the occurrences of @p query in the
+     * page, in reading order, as successive NextResult searches would find
+     * them. The caller takes ownership of the returned rects.
+     *
+     * @param query The search text.
+     * @param caseSensitivity If Qt::CaseSensitive, the search is case sensitive; otherwise
+     *                        the search is case insensitive.
+     *
+     * @since 21.04
+     */
+    QVector<RegularAreaRect *> findAllText(const QString &query, Qt::CaseSensitivity caseSensitivity) const;
+
+    /**
+     * Returns the bounding rects of all the matches of @p expression in the
+     * text of the page, in reading order. Empty matches are skipped.
+     * The caller takes ownership of the returned rects.
+     *
+     * Unlike with findAllText() for a query, the hyphens at the end of the
+     * lines are part of the text the expression is matched against.
+     *
+     * @since 21.04
+     */
+    QVector<RegularAreaRect *> findAllText(const QRegularExpression &expression) const;
+
     /**
      * Text extraction function. Looks for text in the given @p area.
      *
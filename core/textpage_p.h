@@ -14,31 +14,110 @@
 #include <QList>
 #include <QMap>
 #include <QPair>
+#include <QString>
 #include <QTransform>
+#include <QVector>
 
-class SearchPoint;
+#include "okularcore_export.h"
 
-/**
- * Memory-optimized storage of a TextEntity. Stores a string and its bounding box.
- *
- * When a generator adds a TextEntity to a TextPage, it is internally stored as TinyTextEntity.
- * TinyTextEntity is also internally used to get the geometry of text selections and highlight areas.
- *
- * @see TextEntity
- */
-class TinyTextEntity;
 class RegionText;
+class SearchPoint;
 
 namespace Okular
 {
+class NormalizedRect;
 class PagePrivate;
-typedef QList<TinyTextEntity *> TextList;
 
 /**
- * Returns whether the two strings match.
- * Satisfies the condition that if two strings match then their lengths are equal.
+ * Memory-optimized storage of a list of TextEntity. Stores strings and their bounding boxes.
+ *
+ * When a generator adds a TextEntity to a TextPage, it is internally stored in a TextList.
+ * The text of all the entities is kept back to back in a single UTF-16 buffer and their
+ * bounding boxes as floats in a single array, so a page costs a few allocations
+ * however many glyphs it has, and walking it does not chase a pointer per glyph.
+ *
+ * TextList is also internally used to get the geometry of text selections and highlight areas.
+ *
+ * @see TextEntity
  */
-typedef bool (*TextComparisonFunction)(const QStringRef &from, const QStringRef &to);
+class OKULARCORE_EXPORT TextList
+{
+public:
+    inline int count() const
+    {
+        return m_boxes.count();
+    }
+
+    inline bool isEmpty() const
+    {
+        return m_boxes.isEmpty();
+    }
+
+    void reserve(int size);
+
+    /**
+     * Appends an entity with the given @p text and @p area.
+     */
+    void append(const QString &text, const NormalizedRect &area);
+
+    /**
+     * Appends a copy of the entity at @p index in @p list.
+     */
+    void append(const TextList &list, int index);
+
+    void removeLast();
+
+    /**
+     * Returns the text of the entity at @p index. It is only valid as long as the list is not modified.
+     */
+    QStringRef text(int index) const;
+
+    /**
+     * Returns the text of all the entities, one after the other.
+     */
+    inline const QString &string() const
+    {
+        return m_text;
+    }
+
+    /**
+     * Returns where the text of the entity at @p index starts in string().
+     */
+    inline int offset(int index) const
+    {
+        return m_offsets.at(index);
+    }
+
+    /**
+     * Returns the index of the entity whose text has the character at @p position in string().
+     */
+    int indexAt(int position) const;
+
+    NormalizedRect area(int index) const;
+
+    NormalizedRect transformedArea(int index, const QTransform &matrix) const;
+
+    /**
+     * Returns the bytes allocated for the text, offsets and boxes of the entities.
+     */
+    inline qint64 memoryUsage() const
+    {
+        return qint64(m_text.capacity()) * sizeof(QChar) + qint64(m_offsets.capacity()) * sizeof(int) + qint64(m_boxes.capacity()) * sizeof(Box);
+    }
+
+private:
+    struct Box {
+        float left;
+        float top;
+        float right;
+        float bottom;
+    };
+
+    QString m_text;
+    // where the text of each entity starts in m_text
+    QVector<int> m_offsets;
+    QVector<Box> m_boxes;
+};
 
 /**
  * A list of RegionText. It keeps a bunch of TextList with their bounding rectangles
@@ -51,27 +130,55 @@ public:
     TextPagePrivate();
     ~TextPagePrivate();
 
-    RegularAreaRect *findTextInternalForward(int searchID, const QString &query, TextComparisonFunction comparer, const TextList::ConstIterator &start, int start_offset, const TextList::ConstIterator &end);
-    RegularAreaRect *findTextInternalBackward(int searchID, const QString &query, TextComparisonFunction comparer, const TextList::ConstIterator &start, int start_offset, const TextList::ConstIterator &end);
+    /**
+     * Returns the text of the page searches with @p caseSensitivity are run on.
+     * Case insensitive searches run on a case folded copy of the text, whose
+     * positions are those of the text of m_words.
+     */
+    const QString &searchText(Qt::CaseSensitivity caseSensitivity) const;
+
+    /**
+     * Returns @p query as it is looked for in searchText().
+     */
+    static QString searchQuery(const QString &query, Qt::CaseSensitivity caseSensitivity);
+
+    /**
+     * Returns the position in @p text of the first match of @p query starting
+     * from @p from on, or -1, and sets @p end to the position after the match.
+     */
+    int findForward(const QString &text, const QString &query, int from, int *end) const;
+
+    /**
+     * Returns the position in @p text of the last match of @p query ending
+     * before @p before, or -1, and sets @p end to the position after the match.
+     */
+    int findBackward(const QString &text, const QString &query, int before, int *end) const;
+
+    /**
+     * Returns the area of the text between the positions @p begin and @p end.
+     */
+    RegularAreaRect *rangeToArea(int begin, int end) const;
 
     /**
-     * Copy a TextList to m_words, the pointers of list are adopted
+     * Copy a TextList to m_words
      */
     void setWordList(const TextList &list);
 
     /**
      * Make necessary modifications in the TextList to make the text order correct, so
-     * that textselection works fine
+     * that textselection works fine, for a page of the given @p width, @p height and @p boundingBox
      */
-    void correctTextOrder();
+    void correctTextOrder(double width, double height, const NormalizedRect &boundingBox);
 
     // variables those can be accessed directly from TextPage
     TextList m_words;
     QMap<int, SearchPoint *> m_searchPoints;
     Page *m_page;
+    // case folded m_words text, built on the first case insensitive search
+    mutable QString m_foldedText;
 
 private:
-    RegularAreaRect *searchPointToArea(const SearchPoint *sp);
+    bool matchAt(const QString &text, const QString &query, int position, int *end) const;
 };
 
 }
@@ -0,0 +1,323 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by the Okular developers                           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include "thumbnailcache_p.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QVector>
+
+#include "compressedpixmapcache_p.h"
+#include "debug_p.h"
+
+using namespace Okular;
+
+static const quint32 cacheMagic = 0x4f4b5448; // "OKTH"
+static const quint32 cacheVersion = 2;
+
+// roughly the size of the biggest thumbnails, bigger pixmaps are not stored
+static const qint64 maxCachedPixels = 512 * 512;
+
+// bytes read from each end of the document to compute its hash
+static const qint64 hashedBlockSize = 1024 * 1024;
+
+// bytes of each entry of the index: page, width, height, rotation, format, original format and size
+static const qint64 indexEntrySize = 7 * sizeof(qint32);
+
+// Returns whether pixmaps in @p format are stored, formats read from a cache file are checked against it
+static bool isStoredFormat(QImage::Format format)
+{
+    switch (format) {
+    case QImage::Format_Mono:
+    case QImage::Format_MonoLSB:
+    case QImage::Format_Grayscale8:
+    case QImage::Format_RGB16:
+    case QImage::Format_RGB888:
+    case QImage::Format_RGB32:
+    case QImage::Format_ARGB32:
+    case QImage::Format_ARGB32_Premultiplied:
+    case QImage::Format_RGBX8888:
+    case QImage::Format_RGBA8888:
+    case QImage::Format_RGBA8888_Premultiplied:
+        return true;
+    default:
+        return false;
+    }
+}
+
+ThumbnailCache::ThumbnailCache()
+    : m_documentModified(0)
+    , m_mapped(nullptr)
+    , m_mappedSize(0)
+    , m_open(false)
+    , m_dirty(false)
+{
+}
+
+ThumbnailCache::~ThumbnailCache()
+{
+    close();
+}
+
+bool ThumbnailCache::open(const QString &cacheFileName, const QString &documentFileName, const QByteArray &renderSettings)
+{
+    close();
+
+    const QFileInfo documentInfo(documentFileName);
+    if (cacheFileName.isEmpty() || !documentInfo.isFile())
+        return false;
+
+    m_cacheFileName = cacheFileName;
+    m_documentFileName = documentFileName;
+    m_documentModified = documentInfo.lastModified().toMSecsSinceEpoch();
+    m_documentHash = documentHash(documentFileName);
+    m_renderSettings = renderSettings;
+    m_open = true;
+    m_dirty = false;
+
+    if (!load()) {
+        m_entries.clear();
+        if (m_mapped)
+            m_file.unmap(const_cast<uchar *>(m_mapped));
+        m_mapped = nullptr;
+        m_mappedSize = 0;
+        m_file.close();
+        // get rid of the stale file when closing
+        m_dirty = QFile::exists(m_cacheFileName);
+    }
+
+    qCDebug(OkularCoreDebug) << "Thumbnail cache" << m_cacheFileName << "has" << m_entries.count() << "pixmaps";
+    return true;
+}
+
+void ThumbnailCache::close()
+{
+    if (m_open && m_dirty && !save())
+        qCWarning(OkularCoreDebug) << "Failed to write the thumbnail cache" << m_cacheFileName;
+
+    if (m_mapped)
+        m_file.unmap(const_cast<uchar *>(m_mapped));
+    m_mapped = nullptr;
+    m_mappedSize = 0;
+    m_file.close();
+
+    m_entries.clear();
+    m_cacheFileName.clear();
+    m_documentFileName.clear();
+    m_documentHash.clear();
+    m_renderSettings.clear();
+    m_open = false;
+    m_dirty = false;
+}
+
+bool ThumbnailCache::isOpen() const
+{
+    return m_open;
+}
+
+bool ThumbnailCache::isCacheable(int width, int height)
+{
+    return width > 0 && height > 0 && qint64(width) * height <= maxCachedPixels;
+}
+
+bool ThumbnailCache::contains(int page, int width, int height, Rotation rotation) const
+{
+    const QHash<int, Entry>::const_iterator it = m_entries.constFind(page);
+    return it != m_entries.constEnd() && it->width == width && it->height == height && it->rotation == rotation;
+}
+
+QImage ThumbnailCache::image(int page, int width, int height, Rotation rotation) const
+{
+    if (!contains(page, width, height, rotation))
+        return QImage();
+
+    const Entry &entry = m_entries[page];
+    return CompressedPixmapCache::uncompressImage(entryData(entry), entry.size, entry.width, entry.height, entry.format, entry.originalFormat);
+}
+
+void ThumbnailCache::insert(int page, const QImage &image, Rotation rotation)
+{
+    if (!m_open || !isCacheable(image.width(), image.height()) || !isStoredFormat(image.format()) || contains(page, image.width(), image.height(), rotation))
+        return;
+
+    Entry entry;
+    entry.width = image.width();
+    entry.height = image.height();
+    entry.rotation = rotation;
+    entry.data = CompressedPixmapCache::compressImage(image, &entry.format);
+    entry.originalFormat = image.format();
+    entry.offset = -1;
+    entry.size = entry.data.size();
+    if (entry.data.isEmpty() || !isStoredFormat(entry.format))
+        return;
+
+    m_entries.insert(page, entry);
+    m_dirty = true;
+}
+
+void ThumbnailCache::remove(int page)
+{
+    if (m_entries.remove(page) > 0)
+        m_dirty = true;
+}
+
+void ThumbnailCache::clear()
+{
+    if (m_entries.isEmpty())
+        return;
+
+    m_entries.clear();
+    m_dirty = true;
+}
+
+void ThumbnailCache::setRenderSettings(const QByteArray &renderSettings)
+{
+    if (renderSettings == m_renderSettings)
+        return;
+
+    m_renderSettings = renderSettings;
+    clear();
+}
+
+int ThumbnailCache::count() const
+{
+    return m_entries.count();
+}
+
+QByteArray ThumbnailCache::documentHash(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return QByteArray();
+
+    // hashing the beginning and the end is enough to notice a rewritten
+    // document, and keeps opening huge documents fast
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    const qint64 size = file.size();
+    hash.addData(QByteArray::number(size));
+    hash.addData(file.read(hashedBlockSize));
+    if (size > hashedBlockSize) {
+        file.seek(qMax(hashedBlockSize, size - hashedBlockSize));
+        hash.addData(file.read(hashedBlockSize));
+    }
+    return hash.result();
+}
+
+const char *ThumbnailCache::entryData(const Entry &entry) const
+{
+    if (entry.offset < 0)
+        return entry.data.constData();
+    return reinterpret_cast<const char *>(m_mapped + entry.offset);
+}
+
+bool ThumbnailCache::load()
+{
+    m_file.setFileName(m_cacheFileName);
+    if (!m_file.open(QIODevice::ReadOnly))
+        return false;
+
+    m_mappedSize = m_file.size();
+    m_mapped = m_file.map(0, m_mappedSize);
+    if (!m_mapped)
+        return false;
+
+    QDataStream in(QByteArray::fromRawData(reinterpret_cast<const char *>(m_mapped), m_mappedSize));
+    in.setVersion(QDataStream::Qt_5_12);
+
+    quint32 magic, version;
+    in >> magic >> version;
+    if (in.status() != QDataStream::Ok || magic != cacheMagic || version != cacheVersion)
+        return false;
+
+    qint64 modified;
+    QByteArray hash, renderSettings;
+    qint32 count;
+    in >> modified >> hash >> renderSettings >> count;
+    if (in.status() != QDataStream::Ok || modified != m_documentModified || hash != m_documentHash || renderSettings != m_renderSettings || count < 0)
+        return false;
+
+    // do not trust the count of a corrupt file to reserve the index
+    if (count > (m_mappedSize - in.device()->pos()) / indexEntrySize)
+        return false;
+
+    QVector<QPair<int, Entry>> index;
+    index.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        qint32 page, width, height, rotation, format, originalFormat, size;
+        in >> page >> width >> height >> rotation >> format >> originalFormat >> size;
+        if (in.status() != QDataStream::Ok || size < 0 || !isCacheable(width, height))
+            return false;
+        if (!isStoredFormat(static_cast<QImage::Format>(format)) || !isStoredFormat(static_cast<QImage::Format>(originalFormat)))
+            return false;
+
+        Entry entry;
+        entry.width = width;
+        entry.height = height;
+        entry.rotation = static_cast<Rotation>(rotation);
+        entry.format = static_cast<QImage::Format>(format);
+        entry.originalFormat = static_cast<QImage::Format>(originalFormat);
+        entry.size = size;
+        index.append(qMakePair(page, entry));
+    }
+
+    // the compressed pixels follow the index, in the same order
+    qint64 offset = in.device()->pos();
+    for (QPair<int, Entry> &pageEntry : index) {
+        pageEntry.second.offset = offset;
+        offset += pageEntry.second.size;
+        if (offset > m_mappedSize)
+            return false;
+        m_entries.insert(pageEntry.first, pageEntry.second);
+    }
+
+    return true;
+}
+
+bool ThumbnailCache::save()
+{
+    if (m_entries.isEmpty()) {
+        if (m_mapped)
+            m_file.unmap(const_cast<uchar *>(m_mapped));
+        m_mapped = nullptr;
+        m_file.close();
+        return !QFile::exists(m_cacheFileName) || QFile::remove(m_cacheFileName);
+    }
+
+    QSaveFile out(m_cacheFileName);
+    if (!out.open(QIODevice::WriteOnly))
+        return false;
+
+    QDataStream stream(&out);
+    stream.setVersion(QDataStream::Qt_5_12);
+    stream << cacheMagic << cacheVersion << m_documentModified << m_documentHash << m_renderSettings << qint32(m_entries.count());
+
+    QHash<int, Entry>::const_iterator it = m_entries.constBegin(), itEnd = m_entries.constEnd();
+    for (; it != itEnd; ++it)
+        stream << qint32(it.key()) << qint32(it->width) << qint32(it->height) << qint32(it->rotation) << qint32(it->format) << qint32(it->originalFormat) << qint32(it->size);
+    for (it = m_entries.constBegin(); it != itEnd; ++it)
+        stream.writeRawData(entryData(*it), it->size);
+
+    if (stream.status() != QDataStream::Ok) {
+        out.cancelWriting();
+        return false;
+    }
+
+    // pixmaps still in the old file have been copied, it can go now
+    if (m_mapped)
+        m_file.unmap(const_cast<uchar *>(m_mapped));
+    m_mapped = nullptr;
+    m_file.close();
+
+    return out.commit();
+}
+
+/* kate: replace-tabs on; indent-width 4; */
@@ -0,0 +1,137 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by the Okular developers                           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef _OKULAR_THUMBNAILCACHE_P_H_
+#define _OKULAR_THUMBNAILCACHE_P_H_
+
+#include <QByteArray>
+#include <QFile>
+#include <QHash>
+#include <QImage>
+#include <QString>
+
+#include "global.h"
+#include "okularcore_export.h"
+
+namespace Okular
+{
+/**
+ * On-disk cache of the low resolution pixmaps of a document, such as the
+ * ones of the thumbnails, so they are available without the generator the
+ * next time the document is opened.
+ *
+ * The cache file lives next to the docdata file of the document and is named
+ * after it. It is only used if the modification time and the hash of the
+ * document, and the render settings, still match the ones it was written for.
+ *
+ * The file is memory mapped when opened, pixmaps are decompressed straight
+ * from the mapping when requested. New pixmaps are kept in memory and the
+ * file is rewritten by close().
+ *
+ * There is at most one pixmap for each page.
+ */
+class OKULARCORE_EXPORT ThumbnailCache
+{
+public:
+    ThumbnailCache();
+    ~ThumbnailCache();
+
+    /**
+     * Opens the cache in @p cacheFileName for the document in @p documentFileName,
+     * rendered with @p renderSettings. The cached pixmaps are discarded if the
+     * document or the render settings changed since they were stored.
+     */
+    bool open(const QString &cacheFileName, const QString &documentFileName, const QByteArray &renderSettings);
+
+    /**
+     * Writes the cache back to disk if it changed, and closes it.
+     */
+    void close();
+
+    bool isOpen() const;
+
+    /**
+     * Returns whether pixmaps of @p width x @p height are small enough to be stored.
+     */
+    static bool isCacheable(int width, int height);
+
+    bool contains(int page, int width, int height, Rotation rotation) const;
+
+    /**
+     * Returns the pixmap of @p page of @p width x @p height rendered with
+     * @p rotation, or a null image if there is none.
+     */
+    QImage image(int page, int width, int height, Rotation rotation) const;
+
+    /**
+     * Stores @p image as the pixmap of @p page rendered with @p rotation,
+     * replacing any other stored for the page.
+     */
+    void insert(int page, const QImage &image, Rotation rotation);
+
+    /**
+     * Discards the pixmap of @p page.
+     */
+    void remove(int page);
+
+    /**
+     * Discards all the pixmaps.
+     */
+    void clear();
+
+    /**
+     * Sets the render settings the pixmaps are stored for, discarding all
+     * the pixmaps if they changed.
+     */
+    void setRenderSettings(const QByteArray &renderSettings);
+
+    int count() const;
+
+    /**
+     * Returns a hash identifying the contents of the file @p fileName.
+     */
+    static QByteArray documentHash(const QString &fileName);
+
+private:
+    struct Entry {
+        int width;
+        int height;
+        Rotation rotation;
+        QImage::Format format;
+        QImage::Format originalFormat;
+        // compressed pixels, either in the mapped file or in data
+        qint64 offset;
+        int size;
+        QByteArray data;
+    };
+
+    const char *entryData(const Entry &entry) const;
+    bool load();
+    bool save();
+
+    QString m_cacheFileName;
+    QString m_documentFileName;
+    qint64 m_documentModified;
+    QByteArray m_documentHash;
+    QByteArray m_renderSettings;
+    QFile m_file;
+    const uchar *m_mapped;
+    qint64 m_mappedSize;
+    QHash<int, Entry> m_entries;
+    bool m_open;
+    bool m_dirty;
+
+    Q_DISABLE_COPY(ThumbnailCache)
+};
+
+}
+
+#endif
+
+/* kate: replace-tabs on; indent-width 4; */
@@ -12,6 +12,7 @@
 #include "utils_p.h"
 
 #include "debug_p.h"
+#include "document_p.h"
 #include "settings_core.h"
 
 #include <QApplication>
@@ -124,6 +125,21 @@ got_bottom:
     return bbox;
 }
 
+qulonglong Utils::imageCacheSize()
+{
+    switch (SettingsCore::memoryLevel()) {
+    case SettingsCore::EnumMemoryLevel::Low:
+        return 0;
+    case SettingsCore::EnumMemoryLevel::Normal:
+        return DocumentPrivate::getTotalMemory() / 32;
+    case SettingsCore::EnumMemoryLevel::Aggressive:
+        return DocumentPrivate::getTotalMemory() / 16;
+    case SettingsCore::EnumMemoryLevel::Greedy:
+        return DocumentPrivate::getTotalMemory() / 8;
+    }
+    return 0;
+}
+
 void Okular::copyQIODevice(QIODevice *from, QIODevice *to)
 {
     QByteArray buffer(65536, '\0');
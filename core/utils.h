@@ -50,6 +50,16 @@ public:
      * @since 0.7 (KDE 4.1)
      */
     static NormalizedRect imageBoundingBox(const QImage *image);
+
+    /**
+     * Returns how many bytes of decoded images, e.g. pixmaps derived from
+     * the ones of the pages, may be kept cached following the memory level
+     * in the settings: none for the low level, a growing share of the total
+     * memory for the other ones.
+     *
+     * @since 21.04
+     */
+    static qulonglong imageCacheSize();
 };
 
 }
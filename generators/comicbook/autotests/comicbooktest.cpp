@@ -25,6 +25,8 @@ class ComicBookGeneratorTest : public QObject
 private slots:
     void initTestCase();
     void testRotatedImage();
+    void testPageSizes();
+    void testPageCache();
     void cleanupTestCase();
 };
 
@@ -53,6 +55,51 @@ void ComicBookGeneratorTest::testRotatedImage()
     QVERIFY(image.height() > image.width());
 }
 
+void ComicBookGeneratorTest::testPageSizes()
+{
+    ComicBook::Document document;
+    const QString testFile = QStringLiteral(KDESRCDIR "autotests/data/rotated_cb.cbz");
+    QVERIFY(document.open(testFile));
+
+    QVector<Okular::Page *> pagesVector;
+    document.pages(&pagesVector);
+    QVERIFY(!pagesVector.isEmpty());
+
+    // the sizes probed from the headers are the ones of the decoded pages
+    for (int i = 0; i < pagesVector.count(); ++i) {
+        const QImage image = document.pageImage(i);
+        QCOMPARE(pagesVector[i]->number(), i);
+        QCOMPARE(int(pagesVector[i]->width()), image.width());
+        QCOMPARE(int(pagesVector[i]->height()), image.height());
+    }
+
+    document.close();
+    qDeleteAll(pagesVector);
+}
+
+void ComicBookGeneratorTest::testPageCache()
+{
+    ComicBook::Document document;
+    const QString testFile = QStringLiteral(KDESRCDIR "autotests/data/rotated_cb.cbz");
+    QVERIFY(document.open(testFile));
+
+    QVector<Okular::Page *> pagesVector;
+    document.pages(&pagesVector);
+
+    // nothing is cached by default
+    const QImage decoded = document.pageImage(0);
+    QVERIFY(!decoded.isNull());
+    QVERIFY(document.pageImage(0).cacheKey() != decoded.cacheKey());
+
+    document.setCacheSize(64 * 1024 * 1024);
+    const QImage cached = document.pageImage(0);
+    QCOMPARE(cached, decoded);
+    QCOMPARE(document.pageImage(0).cacheKey(), cached.cacheKey());
+
+    document.close();
+    qDeleteAll(pagesVector);
+}
+
 QTEST_MAIN(ComicBookGeneratorTest)
 #include "comicbooktest.moc"
 
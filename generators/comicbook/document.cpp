@@ -9,9 +9,11 @@
 
 #include "document.h"
 
+#include <QBuffer>
 #include <QImage>
 #include <QImageReader>
 #include <QScopedPointer>
+#include <QThread>
 
 #include <KLocalizedString>
 #include <KTar>
@@ -31,8 +33,71 @@
 #include "qnatsort.h"
 #include "unrar.h"
 
+#include <limits.h>
+
 using namespace ComicBook;
 
+namespace ComicBook
+{
+/**
+ * Decodes pages ahead of time, until a newer read-ahead supersedes it.
+ */
+class PrefetchJob : public QRunnable
+{
+public:
+    PrefetchJob(Document *document, int page, int count, int generation)
+        : mDocument(document)
+        , mPage(page)
+        , mCount(count)
+        , mGeneration(generation)
+    {
+    }
+
+    void run() override
+    {
+        for (int page = mPage; page < mPage + mCount && page < mDocument->mPageMap.count(); ++page) {
+            if (mDocument->mPrefetchGeneration.loadAcquire() != mGeneration)
+                return;
+            mDocument->pageImage(page);
+        }
+    }
+
+private:
+    Document *mDocument;
+    const int mPage;
+    const int mCount;
+    const int mGeneration;
+};
+
+/**
+ * Finds out the size of pages, taking the next page not probed yet until none is left.
+ */
+class ProbeJob : public QRunnable
+{
+public:
+    ProbeJob(const Document *document, const KArchiveFile *const *entries, QSize *sizes, QAtomicInt *next)
+        : mDocument(document)
+        , mEntries(entries)
+        , mSizes(sizes)
+        , mNext(next)
+    {
+    }
+
+    void run() override
+    {
+        int index;
+        while ((index = mNext->fetchAndAddOrdered(1)) < mDocument->mEntries.count())
+            mSizes[index] = mDocument->probePage(mDocument->mEntries.at(index), mEntries[index]);
+    }
+
+private:
+    const Document *mDocument;
+    const KArchiveFile *const *mEntries;
+    QSize *mSizes;
+    QAtomicInt *mNext;
+};
+}
+
 static void imagesInArchive(const QString &prefix, const KArchiveDirectory *dir, QStringList *entries)
 {
     const QStringList entryList = dir->entries();
@@ -50,11 +115,14 @@ Document::Document()
     : mDirectory(nullptr)
     , mUnrar(nullptr)
     , mArchive(nullptr)
+    , mCache(0)
 {
+    mPrefetchPool.setMaxThreadCount(1);
 }
 
 Document::~Document()
 {
+    cancelPrefetch();
 }
 
 bool Document::open(const QString &fileName)
@@ -85,6 +153,8 @@ bool Document::open(const QString &fileName)
 #ifdef WITH_K7ZIP
         /**
          * We have a 7z archive
+         *
+         * K7Zip decompresses it whole when opening, its pages are then read from memory
          */
     } else if (mime.inherits(QStringLiteral("application/x-cb7")) || mime.inherits(QStringLiteral("application/x-7z-compressed"))) {
         mArchive = new K7Zip(fileName);
@@ -106,6 +176,10 @@ bool Document::open(const QString &fileName)
 
         /**
          * We have a rar archive
+         *
+         * It is extracted whole when opening: unrar and unar can extract single
+         * files, but each run decompresses a solid archive from its start, so
+         * extracting pages on demand would make reading them quadratic
          */
         mUnrar = new Unrar();
 
@@ -143,6 +217,11 @@ void Document::close()
     if (!(mArchive || mUnrar || mDirectory))
         return;
 
+    cancelPrefetch();
+    mCacheMutex.lock();
+    mCache.clear();
+    mCacheMutex.unlock();
+
     delete mArchive;
     mArchive = nullptr;
     delete mDirectory;
@@ -150,6 +229,7 @@ void Document::close()
     delete mUnrar;
     mUnrar = nullptr;
     mPageMap.clear();
+    mPageEntries.clear();
     mEntries.clear();
 }
 
@@ -180,48 +260,104 @@ bool Document::processArchive()
 void Document::pages(QVector<Okular::Page *> *pagesVector)
 {
     std::sort(mEntries.begin(), mEntries.end(), caseSensitiveNaturalOrderLessThen);
-    QScopedPointer<QIODevice> dev;
+
+    QVector<const KArchiveFile *> entries(mEntries.count());
+    if (mArchive) {
+        for (int i = 0; i < mEntries.count(); ++i)
+            entries[i] = static_cast<const KArchiveFile *>(mArchiveDir->entry(mEntries.at(i)));
+    }
+
+    // most pages only need their header read, but images without a size in
+    // their header are decoded whole, so the pages are probed by several threads
+    QVector<QSize> sizes(mEntries.count());
+    {
+        QAtomicInt next;
+        QThreadPool pool;
+        pool.setMaxThreadCount(qBound(1, QThread::idealThreadCount(), qMax(1, mEntries.count())));
+        for (int i = 0; i < pool.maxThreadCount(); ++i)
+            pool.start(new ProbeJob(this, entries.constData(), sizes.data(), &next));
+        pool.waitForDone();
+    }
 
     int count = 0;
     pagesVector->clear();
     pagesVector->resize(mEntries.size());
-    QImageReader reader;
-    reader.setAutoTransform(true);
-    for (const QString &file : qAsConst(mEntries)) {
-        if (mArchive) {
-            const KArchiveFile *entry = static_cast<const KArchiveFile *>(mArchiveDir->entry(file));
-            if (entry) {
-                dev.reset(entry->createDevice());
-            }
-        } else if (mDirectory) {
-            dev.reset(mDirectory->createDevice(file));
-        } else {
-            dev.reset(mUnrar->createDevice(file));
+    for (int i = 0; i < mEntries.count(); ++i) {
+        const QSize &pageSize = sizes.at(i);
+        if (pageSize.isValid()) {
+            pagesVector->replace(count, new Okular::Page(count, pageSize.width(), pageSize.height(), Okular::Rotation0));
+            mPageMap.append(mEntries.at(i));
+            mPageEntries.append(entries.at(i));
+            count++;
         }
+    }
+    pagesVector->resize(count);
+}
+
+static QSize imageSize(QIODevice *device, const QString &file)
+{
+    QImageReader reader(device);
+    reader.setAutoTransform(true);
+    if (!reader.canRead())
+        return QSize();
+
+    QSize pageSize = reader.size();
+    if (reader.transformation() & QImageIOHandler::TransformationRotate90) {
+        pageSize.transpose();
+    }
+    if (!pageSize.isValid()) {
+        const QImage i = reader.read();
+        if (!i.isNull())
+            pageSize = i.size();
+    }
+    if (!pageSize.isValid()) {
+        qCDebug(OkularComicbookDebug) << "Ignoring" << file << "doesn't seem to be an image even if QImageReader::canRead returned true";
+    }
+    return pageSize;
+}
 
-        if (!dev.isNull()) {
-            reader.setDevice(dev.data());
-            if (reader.canRead()) {
-                QSize pageSize = reader.size();
-                if (reader.transformation() & QImageIOHandler::TransformationRotate90) {
-                    pageSize.transpose();
-                }
-                if (!pageSize.isValid()) {
-                    const QImage i = reader.read();
-                    if (!i.isNull())
-                        pageSize = i.size();
-                }
-                if (pageSize.isValid()) {
-                    pagesVector->replace(count, new Okular::Page(count, pageSize.width(), pageSize.height(), Okular::Rotation0));
-                    mPageMap.append(file);
-                    count++;
-                } else {
-                    qCDebug(OkularComicbookDebug) << "Ignoring" << file << "doesn't seem to be an image even if QImageReader::canRead returned true";
-                }
+QSize Document::probePage(const QString &file, const KArchiveFile *entry) const
+{
+    if (mDirectory) {
+        QScopedPointer<QIODevice> dev(mDirectory->createDevice(file));
+        return dev.isNull() ? QSize() : imageSize(dev.data(), file);
+    }
+
+    if (mUnrar) {
+        QScopedPointer<QIODevice> dev(mUnrar->createDevice(file));
+        return dev.isNull() ? QSize() : imageSize(dev.data(), file);
+    }
+
+    if (!entry)
+        return QSize();
+
+    QByteArray data;
+    {
+        QMutexLocker locker(&mArchiveMutex);
+        QScopedPointer<QIODevice> dev(entry->createDevice());
+        if (dev.isNull())
+            return QSize();
+
+        QImageReader reader(dev.data());
+        reader.setAutoTransform(true);
+        if (!reader.canRead())
+            return QSize();
+
+        QSize pageSize = reader.size();
+        if (pageSize.isValid()) {
+            if (reader.transformation() & QImageIOHandler::TransformationRotate90) {
+                pageSize.transpose();
             }
+            return pageSize;
         }
+
+        // the image is decoded without holding the archive
+        data = entry->data();
     }
-    pagesVector->resize(count);
+
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::ReadOnly);
+    return imageSize(&buffer, file);
 }
 
 QStringList Document::pageTitles() const
@@ -231,21 +367,85 @@ QStringList Document::pageTitles() const
 
 QImage Document::pageImage(int page) const
 {
-    if (mArchive) {
-        const KArchiveFile *entry = static_cast<const KArchiveFile *>(mArchiveDir->entry(mPageMap[page]));
-        if (entry) {
-            std::unique_ptr<QIODevice> dev(entry->createDevice());
-            QImageReader reader(dev.get());
-            reader.setAutoTransform(true);
-            return reader.read();
-        }
-    } else if (mDirectory) {
-        return QImage(mPageMap[page]);
+    {
+        QMutexLocker locker(&mCacheMutex);
+        if (const QImage *cached = mCache.object(page))
+            return *cached;
+    }
+
+    const QImage image = decodePage(page);
+
+    QMutexLocker locker(&mCacheMutex);
+    // QCache drops right away what is larger than the whole cache
+    if (!image.isNull() && mCache.maxCost() > 0)
+        mCache.insert(page, new QImage(image), qMax(1, int(image.sizeInBytes() / 1024)));
+    return image;
+}
+
+QImage Document::decodePage(int page) const
+{
+    if (page < 0 || page >= mPageMap.count())
+        return QImage();
+
+    if (mDirectory) {
+        QImageReader reader(mPageMap[page]);
+        reader.setAutoTransform(true);
+        return reader.read();
+    }
+
+    QByteArray data;
+    if (mUnrar) {
+        // the files were extracted when opening the archive
+        data = mUnrar->contentOf(mPageMap[page]);
     } else {
-        return QImage::fromData(mUnrar->contentOf(mPageMap[page]));
+        QMutexLocker locker(&mArchiveMutex);
+        const KArchiveFile *entry = mPageEntries.at(page);
+        if (!entry)
+            return QImage();
+        data = entry->data();
     }
 
-    return QImage();
+    // only reading needs the archive, pages are decoded in parallel
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::ReadOnly);
+    QImageReader reader(&buffer);
+    reader.setAutoTransform(true);
+    return reader.read();
+}
+
+void Document::setCacheSize(qulonglong bytes)
+{
+    QMutexLocker locker(&mCacheMutex);
+    mCache.setMaxCost(int(qMin<qulonglong>(bytes / 1024, INT_MAX)));
+}
+
+void Document::prefetch(int page, int count)
+{
+    {
+        QMutexLocker locker(&mCacheMutex);
+        if (mCache.maxCost() == 0)
+            return;
+
+        while (count > 0 && page < mPageMap.count() && mCache.contains(page)) {
+            ++page;
+            --count;
+        }
+    }
+
+    if (count <= 0 || page < 0 || page >= mPageMap.count())
+        return;
+
+    // the read-ahead of the page being viewed replaces the previous one
+    const int generation = mPrefetchGeneration.fetchAndAddOrdered(1) + 1;
+    mPrefetchPool.clear();
+    mPrefetchPool.start(new PrefetchJob(this, page, count, generation));
+}
+
+void Document::cancelPrefetch()
+{
+    mPrefetchGeneration.fetchAndAddOrdered(1);
+    mPrefetchPool.clear();
+    mPrefetchPool.waitForDone();
 }
 
 QString Document::lastErrorString() const
@@ -10,11 +10,18 @@
 #ifndef COMICBOOK_DOCUMENT_H
 #define COMICBOOK_DOCUMENT_H
 
+#include <QAtomicInt>
+#include <QCache>
+#include <QImage>
+#include <QMutex>
+#include <QSize>
 #include <QStringList>
+#include <QThreadPool>
+#include <QVector>
 
 class KArchiveDirectory;
+class KArchiveFile;
 class KArchive;
-class QImage;
 class Unrar;
 class Directory;
 
@@ -37,20 +44,52 @@ public:
     void pages(QVector<Okular::Page *> *pagesVector);
     QStringList pageTitles() const;
 
+    /**
+     * Returns the image of @p page, decoding it unless it is cached.
+     *
+     * It can be called from several threads at the same time.
+     */
     QImage pageImage(int page) const;
 
+    /**
+     * Sets how many bytes of decoded page images are kept.
+     */
+    void setCacheSize(qulonglong bytes);
+
+    /**
+     * Decodes the @p count pages after @p page in the background,
+     * so they are cached when requested.
+     */
+    void prefetch(int page, int count);
+
     QString lastErrorString() const;
 
 private:
+    friend class PrefetchJob;
+    friend class ProbeJob;
+
     bool processArchive();
+    QSize probePage(const QString &file, const KArchiveFile *entry) const;
+    QImage decodePage(int page) const;
+    void cancelPrefetch();
 
     QStringList mPageMap;
+    // the archive entries of the pages, so they are not looked up by name
+    QVector<const KArchiveFile *> mPageEntries;
     Directory *mDirectory;
     Unrar *mUnrar;
     KArchive *mArchive;
     const KArchiveDirectory *mArchiveDir;
     QString mLastErrorString;
     QStringList mEntries;
+
+    // serializes reading from the archive, which shares a single device
+    mutable QMutex mArchiveMutex;
+    mutable QMutex mCacheMutex;
+    // decoded images by page, the cost is in KiB
+    mutable QCache<int, QImage> mCache;
+    QThreadPool mPrefetchPool;
+    QAtomicInt mPrefetchGeneration;
 };
 
 }
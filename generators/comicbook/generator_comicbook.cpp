@@ -18,9 +18,13 @@
 #include <core/document.h>
 #include <core/fileprinter.h>
 #include <core/page.h>
+#include <core/printpipeline.h>
 
 #include "debug_comicbook.h"
 
+// pages decoded ahead of the one requested
+#define PREFETCH_PAGES 2
+
 OKULAR_EXPORT_PLUGIN(ComicBookGenerator, "libokularGenerator_comicbook.json")
 
 ComicBookGenerator::ComicBookGenerator(QObject *parent, const QVariantList &args)
@@ -60,8 +64,13 @@ QImage ComicBookGenerator::image(Okular::PixmapRequest *request)
     int width = request->width();
     int height = request->height();
 
+    mDocument.setCacheSize(documentMetaData(ImageCacheSizeMetaData).toULongLong());
     QImage image = mDocument.pageImage(request->pageNumber());
 
+    // decode the next pages while this one is read
+    if (!request->preload())
+        mDocument.prefetch(request->pageNumber() + 1, PREFETCH_PAGES);
+
     return image.scaled(width, height, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
 }
 
@@ -71,18 +80,28 @@ bool ComicBookGenerator::print(QPrinter &printer)
 
     QList<int> pageList = Okular::FilePrinter::pageList(printer, document()->pages(), document()->currentPage() + 1, document()->bookmarkedPageList());
 
-    for (int i = 0; i < pageList.count(); ++i) {
-        QImage image = mDocument.pageImage(pageList[i] - 1);
+    const int printerWidth = printer.width();
+    const int printerHeight = printer.height();
+
+    Okular::PrintPipeline pipeline([this, printerWidth, printerHeight](int pageNumber) {
+        QImage image = mDocument.pageImage(pageNumber - 1);
 
-        if ((image.width() > printer.width()) || (image.height() > printer.height()))
+        if ((image.width() > printerWidth) || (image.height() > printerHeight))
 
-            image = image.scaled(printer.width(), printer.height(), Qt::KeepAspectRatio, Qt::SmoothTransformation);
+            image = image.scaled(printerWidth, printerHeight, Qt::KeepAspectRatio, Qt::SmoothTransformation);
 
-        if (i != 0)
+        return image;
+    });
+
+    bool firstPage = true;
+    pipeline.run(pageList, [&](int, const QImage &image) {
+        if (!firstPage)
             printer.newPage();
+        firstPage = false;
 
         p.drawImage(0, 0, image);
-    }
+        return true;
+    });
 
     return true;
 }
@@ -11,7 +11,6 @@
 
 #include <QEventLoop>
 #include <QFile>
-#include <QFileInfo>
 #include <QGlobalStatic>
 #include <QTemporaryDir>
 
@@ -118,19 +117,21 @@ bool Unrar::open(const QString &fileName)
 
     delete mTempDir;
     mTempDir = new QTemporaryDir();
+    if (!mTempDir->isValid())
+        return false;
 
     mFileName = fileName;
 
     /**
-     * Extract the archive to a temporary directory
+     * Extract the archive to a temporary directory, in a single run: files of
+     * solid archives could not be extracted one by one without decompressing
+     * all the files before them every time
      */
     mStdOutData.clear();
     mStdErrData.clear();
 
     const int ret = startSyncProcess(helper->kind->processOpenArchiveArgs(mFileName, mTempDir->path()));
-    bool ok = ret == 0;
-
-    return ok;
+    return ret == 0;
 }
 
 QStringList Unrar::list()
@@ -143,24 +144,16 @@ QStringList Unrar::list()
 
     startSyncProcess(helper->kind->processListArgs(mFileName));
 
-    QStringList listFiles = helper->kind->processListing(QString::fromLocal8Bit(mStdOutData).split(QLatin1Char('\n'), QString::SkipEmptyParts));
-
-    QString subDir;
-
-    if (listFiles.last().endsWith(QLatin1Char('/')) && helper->kind->name() == QLatin1String("unar")) {
-        // Subfolder detected. The unarchiver is unable to extract all files into a single folder
-        subDir = listFiles.last();
-        listFiles.removeLast();
-    }
+    const QStringList listFiles = helper->kind->processListing(QString::fromLocal8Bit(mStdOutData).split(QLatin1Char('\n'), QString::SkipEmptyParts));
 
     QStringList newList;
-    for (const QString &f : qAsConst(listFiles)) {
-        // Extract all the files to mTempDir regardless of their path inside the archive
-        // This will break if ever an arvhice with two files with the same name in different subfolders
-        QFileInfo fi(f);
-        if (QFile::exists(mTempDir->path() + QLatin1Char('/') + subDir + fi.fileName())) {
-            newList.append(subDir + fi.fileName());
-        }
+    for (const QString &f : listFiles) {
+        // the unarchiver lists folders with a trailing slash
+        if (f.endsWith(QLatin1Char('/')))
+            continue;
+
+        if (QFile::exists(mTempDir->path() + QLatin1Char('/') + f))
+            newList.append(f);
     }
     return newList;
 }
@@ -227,6 +220,7 @@ void Unrar::readFromStderr()
 
 void Unrar::finished(int exitCode, QProcess::ExitStatus exitStatus)
 {
+    // unrar exits with 1 for warnings, e.g. about a locked archive, the files are extracted anyway
     Q_UNUSED(exitCode)
     if (mLoop) {
         mLoop->exit(exitStatus == QProcess::CrashExit ? 1 : 0);
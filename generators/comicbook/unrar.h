@@ -39,7 +39,7 @@ public:
     ~Unrar() override;
 
     /**
-     * Opens given rar archive.
+     * Opens given rar archive, extracting all its files at once.
      */
     bool open(const QString &fileName);
 
@@ -50,6 +50,8 @@ public:
 
     /**
      * Returns the content of the file with the given name.
+     *
+     * It can be called from several threads at the same time.
      */
     QByteArray contentOf(const QString &fileName) const;
 
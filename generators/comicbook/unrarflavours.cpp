@@ -62,7 +62,7 @@ ProcessArgs NonFreeUnrarFlavour::processListArgs(const QString &fileName) const
 
 ProcessArgs NonFreeUnrarFlavour::processOpenArchiveArgs(const QString &fileName, const QString &path) const
 {
-    return ProcessArgs(QStringList() << QStringLiteral("e") << fileName << path + QLatin1Char('/'), false);
+    return ProcessArgs(QStringList() << QStringLiteral("x") << QStringLiteral("-p-") << QStringLiteral("--") << fileName << path + QLatin1Char('/'), false);
 }
 
 FreeUnrarFlavour::FreeUnrarFlavour()
@@ -125,5 +125,6 @@ ProcessArgs UnarFlavour::processListArgs(const QString &fileName) const
 
 ProcessArgs UnarFlavour::processOpenArchiveArgs(const QString &fileName, const QString &path) const
 {
-    return ProcessArgs(QStringList() << fileName << QStringLiteral("-o") << path + QLatin1Char('/'), false);
+    // no containing directory, so the files are where lsar lists them
+    return ProcessArgs(QStringList() << QStringLiteral("-q") << QStringLiteral("-D") << QStringLiteral("-o") << path << fileName, false);
 }
@@ -35,6 +35,10 @@ public:
     virtual QString name() const = 0;
 
     virtual ProcessArgs processListArgs(const QString &fileName) const = 0;
+    /**
+     * Returns the arguments extracting all the files of the archive @p fileName
+     * to the directory @p path, keeping the paths listed by processListArgs().
+     */
     virtual ProcessArgs processOpenArchiveArgs(const QString &fileName, const QString &path) const = 0;
 
     void setFileName(const QString &fileName);
@@ -0,0 +1,127 @@
+// -*- Mode: C++; c-basic-offset: 2; indent-tabs-mode: nil; c-brace-offset: 0; -*-
+// dviDisplayList.cpp
+//
+// Part of KDVI - A DVI previewer for the KDE desktop environment
+//
+// Distributed under the GPL
+
+#include <config.h>
+
+#include "dviDisplayList.h"
+
+#include <QPainter>
+#include <QPolygon>
+
+#include <algorithm>
+
+void dviDisplayList::drawGlyph(int x, int y, int sheet, const QRect &source)
+{
+    Glyph glyph;
+    glyph.position = QPoint(x, y);
+    glyph.sheet = sheet;
+    glyph.source = source;
+    m_glyphs.append(glyph);
+    m_operations.append(GlyphOperation);
+}
+
+void dviDisplayList::fillRect(int x, int y, int w, int h, const QColor &color)
+{
+    Rule rule;
+    rule.rect = QRect(x, y, w, h);
+    rule.color = color;
+    m_rules.append(rule);
+    m_operations.append(RuleOperation);
+}
+
+void dviDisplayList::record(const std::function<void(QPainter *)> &operation)
+{
+    m_otherOperations.append(operation);
+    m_operations.append(OtherOperation);
+}
+
+void dviDisplayList::drawImage(int x, int y, const QImage &image)
+{
+    record([x, y, image](QPainter *painter) { painter->drawImage(x, y, image); });
+}
+
+void dviDisplayList::save()
+{
+    record([](QPainter *painter) { painter->save(); });
+}
+
+void dviDisplayList::restore()
+{
+    record([](QPainter *painter) { painter->restore(); });
+}
+
+void dviDisplayList::translate(qreal dx, qreal dy)
+{
+    record([dx, dy](QPainter *painter) { painter->translate(dx, dy); });
+}
+
+void dviDisplayList::rotate(qreal angle)
+{
+    record([angle](QPainter *painter) { painter->rotate(angle); });
+}
+
+void dviDisplayList::setPen(const QPen &pen)
+{
+    record([pen](QPainter *painter) { painter->setPen(pen); });
+}
+
+void dviDisplayList::setPen(const QColor &color)
+{
+    record([color](QPainter *painter) { painter->setPen(color); });
+}
+
+void dviDisplayList::setBrush(const QBrush &brush)
+{
+    record([brush](QPainter *painter) { painter->setBrush(brush); });
+}
+
+void dviDisplayList::setFont(const QFont &font)
+{
+    record([font](QPainter *painter) { painter->setFont(font); });
+}
+
+void dviDisplayList::drawRoundedRect(const QRect &rect, qreal xRadius, qreal yRadius)
+{
+    record([rect, xRadius, yRadius](QPainter *painter) { painter->drawRoundedRect(rect, xRadius, yRadius); });
+}
+
+void dviDisplayList::drawText(const QRect &rect, int flags, const QString &text)
+{
+    record([rect, flags, text](QPainter *painter) { painter->drawText(rect, flags, text); });
+}
+
+void dviDisplayList::drawPolyline(const QPoint *points, int pointCount)
+{
+    QPolygon polyline(pointCount);
+    std::copy(points, points + pointCount, polyline.begin());
+    record([polyline](QPainter *painter) { painter->drawPolyline(polyline); });
+}
+
+void dviDisplayList::replay(QPainter *painter) const
+{
+    int glyphIndex = 0;
+    int ruleIndex = 0;
+    int otherIndex = 0;
+
+    for (const Operation operation : m_operations) {
+        switch (operation) {
+        case GlyphOperation: {
+            const Glyph &glyph = m_glyphs[glyphIndex++];
+            painter->drawImage(glyph.position, m_glyphSheets[glyph.sheet], glyph.source);
+            break;
+        }
+        case RuleOperation: {
+            const Rule &rule = m_rules[ruleIndex++];
+            painter->fillRect(rule.rect, rule.color);
+            break;
+        }
+        case OtherOperation:
+            m_otherOperations[otherIndex++](painter);
+            break;
+        }
+    }
+}
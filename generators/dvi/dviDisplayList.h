@@ -0,0 +1,97 @@
+// -*- Mode: C++; c-basic-offset: 2; indent-tabs-mode: nil; c-brace-offset: 0; -*-
+// dviDisplayList.h
+//
+// Part of KDVI - A DVI previewer for the KDE desktop environment
+//
+// Distributed under the GPL
+
+#ifndef _DVIDISPLAYLIST_H
+#define _DVIDISPLAYLIST_H
+
+#include <QColor>
+#include <QImage>
+#include <QRect>
+#include <QVector>
+
+#include <functional>
+
+class QBrush;
+class QFont;
+class QPainter;
+class QPen;
+
+/**
+ *  The drawing operations of a DVI page
+ *
+ * The dviRenderer records what a page draws while it interprets the
+ * page, which needs the state of the renderer and of the fonts, and
+ * replays it once that state is no longer needed. Several pages can
+ * so be painted at the same time.
+ *
+ * Glyphs and rules, which make up nearly all of a page, are stored
+ * compactly; the rare other operations, used by specials, are stored
+ * as functions.
+ */
+
+class dviDisplayList
+{
+public:
+    /** Sets the sheets of the glyph atlas that the glyphs refer to */
+    void setGlyphSheets(const QVector<QImage> &sheets)
+    {
+        m_glyphSheets = sheets;
+    }
+
+    /** Draws the part source of the glyph atlas sheet at x, y */
+    void drawGlyph(int x, int y, int sheet, const QRect &source);
+
+    void fillRect(int x, int y, int w, int h, const QColor &color);
+    void fillRect(const QRect &rect, const QColor &color)
+    {
+        fillRect(rect.x(), rect.y(), rect.width(), rect.height(), color);
+    }
+
+    void drawImage(int x, int y, const QImage &image);
+
+    void save();
+    void restore();
+    void translate(qreal dx, qreal dy);
+    void rotate(qreal angle);
+    void setPen(const QPen &pen);
+    void setPen(const QColor &color);
+    void setBrush(const QBrush &brush);
+    void setFont(const QFont &font);
+    void drawRoundedRect(const QRect &rect, qreal xRadius, qreal yRadius);
+    void drawText(const QRect &rect, int flags, const QString &text);
+    void drawPolyline(const QPoint *points, int pointCount);
+
+    /** Draws the operations recorded so far */
+    void replay(QPainter *painter) const;
+
+private:
+    enum Operation { GlyphOperation, RuleOperation, OtherOperation };
+
+    struct Glyph {
+        QPoint position;
+        int sheet;
+        QRect source;
+    };
+
+    struct Rule {
+        QRect rect;
+        QColor color;
+    };
+
+    void record(const std::function<void(QPainter *)> &operation);
+
+    // Order of the operations; the n-th GlyphOperation is the n-th
+    // entry of m_glyphs, etc.
+    QVector<Operation> m_operations;
+    QVector<Glyph> m_glyphs;
+    QVector<Rule> m_rules;
+    QVector<std::function<void(QPainter *)>> m_otherOperations;
+
+    QVector<QImage> m_glyphSheets;
+};
+
+#endif // ifndef _DVIDISPLAYLIST_H
@@ -59,7 +59,8 @@ dviRenderer::dviRenderer(bool useFontHinting)
     , number_of_elements_in_path(0)
     , currentlyDrawnPage(nullptr)
     , m_eventLoop(nullptr)
-    , foreGroundPainter(nullptr)
+    , foreGroundDisplayList(nullptr)
+    , currentGlyphAtlas(nullptr)
     , fontpoolLocateFontsDone(false)
 {
 #ifdef DEBUG_DVIRENDERER
@@ -86,6 +87,11 @@ dviRenderer::~dviRenderer()
 //------ this function calls the dvi interpreter ----------
 
 void dviRenderer::drawPage(RenderedDocumentPagePixmap *page)
+{
+    renderPage(page, false);
+}
+
+void dviRenderer::renderPage(RenderedDocumentPagePixmap *page, bool textOnly)
 {
 #ifdef DEBUG_DVIRENDERER
     // qCDebug(OkularDviDebug) << "dviRenderer::drawPage(documentPage *) called, page number " << page->pageNumber;
@@ -146,18 +152,19 @@ void dviRenderer::drawPage(RenderedDocumentPagePixmap *page)
     int pageWidth = page->width;
     int pageHeight = page->height;
 
-    QImage img(pageWidth, pageHeight, QImage::Format_RGB32);
-    foreGroundPainter = new QPainter(&img);
-    if (foreGroundPainter != nullptr) {
-        errorMsg.clear();
-        draw_page();
-        delete foreGroundPainter;
-        foreGroundPainter = nullptr;
-    } else {
-        qCDebug(OkularDviDebug) << "painter creation failed.";
-    }
-    page->img = img;
-    // page->setImage(img);
+    dviDisplayList displayList;
+    foreGroundDisplayList = &displayList;
+    currentGlyphAtlas = font_pool.currentGlyphAtlas();
+    errorMsg.clear();
+    const bool postscriptBackup = _postscript;
+    // Disable postscript-specials temporarily to speed up text extraction.
+    if (textOnly)
+        _postscript = false;
+    draw_page();
+    _postscript = postscriptBackup;
+    displayList.setGlyphSheets(currentGlyphAtlas->sheets());
+    foreGroundDisplayList = nullptr;
+    currentGlyphAtlas = nullptr;
 
     // Postprocess hyperlinks
     // Without that, based on the way TeX draws certain characters like german "Umlaute",
@@ -199,21 +206,27 @@ void dviRenderer::drawPage(RenderedDocumentPagePixmap *page)
     if (errorMsg.isEmpty() != true) {
         emit error(i18n("File corruption. %1", errorMsg), -1);
         errorMsg.clear();
-        currentlyDrawnPage = nullptr;
-        return;
     }
     currentlyDrawnPage = nullptr;
+
+    // Everything the page depends on is in the display list now, so
+    // other pages can be interpreted while this one is painted.
+    locker.unlock();
+
+    if (textOnly)
+        return;
+
+    QImage img(pageWidth, pageHeight, QImage::Format_RGB32);
+    QPainter painter(&img);
+    displayList.replay(&painter);
+    painter.end();
+    page->img = img;
+    // page->setImage(img);
 }
 
 void dviRenderer::getText(RenderedDocumentPagePixmap *page)
 {
-    bool postscriptBackup = _postscript;
-    // Disable postscript-specials temporarily to speed up text extraction.
-    _postscript = false;
-
-    drawPage(page);
-
-    _postscript = postscriptBackup;
+    renderPage(page, true);
 }
 
 /*
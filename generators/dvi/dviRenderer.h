@@ -15,6 +15,7 @@
 #include "dviexport.h"
 //#include "dvisourceeditor.h"
 #include "anchor.h"
+#include "dviDisplayList.h"
 #include "dviPageInfo.h"
 #include "fontpool.h"
 #include "pageSize.h"
@@ -214,6 +215,11 @@ private:
 
     void setResolution(double resolution_in_DPI);
 
+    /** Interprets the page and paints it. If textOnly is true, the
+        PostScript specials are skipped and nothing is painted: only the
+        text and links of the page are extracted. */
+    void renderPage(RenderedDocumentPagePixmap *page, bool textOnly);
+
     fontPool font_pool;
 
     double resolutionInDPI;
@@ -331,7 +337,12 @@ private:
 
     QEventLoop *m_eventLoop;
 
-    QPainter *foreGroundPainter;
+    // What the page being interpreted draws. It is painted after the
+    // mutex is released, so that several pages can be painted at once.
+    dviDisplayList *foreGroundDisplayList;
+
+    // The glyphs at the resolution of the page being interpreted
+    glyphAtlas *currentGlyphAtlas;
 
     // was the locateFonts method of font pool executed?
     bool fontpoolLocateFontsDone;
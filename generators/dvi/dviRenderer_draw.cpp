@@ -78,22 +78,35 @@ void dviRenderer::set_char(unsigned int cmd, unsigned int ch)
     qCDebug(OkularDviDebug) << "set_char #" << ch;
 #endif
 
+    TeXFont *font = (TeXFont *)(currinf.fontp->font);
+    const QRgb color = colorStack.isEmpty() ? globalColor.rgba() : colorStack.top().rgba();
+
+    // Glyphs are rendered once per resolution and color, into the glyph
+    // atlas, which all pages share.
     glyph *g;
-    if (colorStack.isEmpty())
-        g = ((TeXFont *)(currinf.fontp->font))->getGlyph(ch, true, globalColor);
-    else
-        g = ((TeXFont *)(currinf.fontp->font))->getGlyph(ch, true, colorStack.top());
-    if (g == nullptr)
-        return;
+    glyphAtlas::Entry entry;
+    if (currentGlyphAtlas->find(font, ch, color, &entry)) {
+        g = font->getGlyph(ch);
+        if (g == nullptr)
+            return;
+    } else {
+        g = font->getGlyph(ch, true, QColor::fromRgba(color));
+        if (g == nullptr)
+            return;
+        entry = currentGlyphAtlas->insert(font, ch, color, g->shrunkenCharacter, g->x2, g->y2);
+        // The atlas has its own copy
+        g->shrunkenCharacter = QImage();
+    }
 
     long dvi_h_sav = currinf.data.dvi_h;
 
-    QImage pix = g->shrunkenCharacter;
-    int x = ((int)((currinf.data.dvi_h) / (shrinkfactor * 65536))) - g->x2;
-    int y = currinf.data.pxl_v - g->y2;
+    const QSize pix = entry.rect.size();
+    int x = ((int)((currinf.data.dvi_h) / (shrinkfactor * 65536))) - entry.x2;
+    int y = currinf.data.pxl_v - entry.y2;
 
     // Draw the character.
-    foreGroundPainter->drawImage(x, y, pix);
+    if (entry.sheet >= 0)
+        foreGroundDisplayList->drawGlyph(x, y, entry.sheet, entry.rect);
 
     // Are we drawing text for a hyperlink? And are hyperlinks
     // enabled?
@@ -308,9 +321,9 @@ void dviRenderer::draw_part(double current_dimconv, bool is_vfmacro)
                     int w = ((int)ROUNDUP(b, shrinkfactor * 65536));
 
                     if (colorStack.isEmpty())
-                        foreGroundPainter->fillRect(((int)((currinf.data.dvi_h) / (shrinkfactor * 65536))), currinf.data.pxl_v - h + 1, w ? w : 1, h ? h : 1, globalColor);
+                        foreGroundDisplayList->fillRect(((int)((currinf.data.dvi_h) / (shrinkfactor * 65536))), currinf.data.pxl_v - h + 1, w ? w : 1, h ? h : 1, globalColor);
                     else
-                        foreGroundPainter->fillRect(((int)((currinf.data.dvi_h) / (shrinkfactor * 65536))), currinf.data.pxl_v - h + 1, w ? w : 1, h ? h : 1, colorStack.top());
+                        foreGroundDisplayList->fillRect(((int)((currinf.data.dvi_h) / (shrinkfactor * 65536))), currinf.data.pxl_v - h + 1, w ? w : 1, h ? h : 1, colorStack.top());
                 }
                 currinf.data.dvi_h += b;
                 break;
@@ -328,9 +341,9 @@ void dviRenderer::draw_part(double current_dimconv, bool is_vfmacro)
                     int h = ((int)ROUNDUP(a, shrinkfactor * 65536));
                     int w = ((int)ROUNDUP(b, shrinkfactor * 65536));
                     if (colorStack.isEmpty())
-                        foreGroundPainter->fillRect(((int)((currinf.data.dvi_h) / (shrinkfactor * 65536))), currinf.data.pxl_v - h + 1, w ? w : 1, h ? h : 1, globalColor);
+                        foreGroundDisplayList->fillRect(((int)((currinf.data.dvi_h) / (shrinkfactor * 65536))), currinf.data.pxl_v - h + 1, w ? w : 1, h ? h : 1, globalColor);
                     else
-                        foreGroundPainter->fillRect(((int)((currinf.data.dvi_h) / (shrinkfactor * 65536))), currinf.data.pxl_v - h + 1, w ? w : 1, h ? h : 1, colorStack.top());
+                        foreGroundDisplayList->fillRect(((int)((currinf.data.dvi_h) / (shrinkfactor * 65536))), currinf.data.pxl_v - h + 1, w ? w : 1, h ? h : 1, colorStack.top());
                 }
                 break;
 
@@ -617,13 +630,16 @@ void dviRenderer::draw_page()
     qCDebug(OkularDviDebug) << "draw_page";
 #endif
 
-    foreGroundPainter->fillRect(foreGroundPainter->viewport(), PS_interface->getBackgroundColor(current_page));
+    const QSize pageSize(currentlyDrawnPage->width, currentlyDrawnPage->height);
+    foreGroundDisplayList->fillRect(QRect(QPoint(0, 0), pageSize), PS_interface->getBackgroundColor(current_page));
 
     // Render the PostScript background, if there is one.
     if (_postscript) {
         PS_interface->restoreBackgroundColor(current_page);
 
-        PS_interface->graphics(current_page, resolutionInDPI, dviFile->getMagnification(), foreGroundPainter);
+        const QImage graphics = PS_interface->graphics(current_page, resolutionInDPI, dviFile->getMagnification(), pageSize);
+        if (!graphics.isNull())
+            foreGroundDisplayList->drawImage(0, 0, graphics);
     }
 
     // Now really write the text
@@ -581,7 +581,8 @@ void dviRenderer::prescan_setChar(unsigned int ch)
         return;
 
     if (currinf.set_char_p == &dviRenderer::set_char) {
-        glyph *g = ((TeXFont *)(currinf.fontp->font))->getGlyph(ch, true, globalColor);
+        // Only the advance width is needed here, no pixmap
+        glyph *g = ((TeXFont *)(currinf.fontp->font))->getGlyph(ch);
         if (g == nullptr)
             return;
         currinf.data.dvi_h += (int)(currinf.fontp->scaled_size_in_DVI_units * dviFile->getCmPerDVIunit() * (1200.0 / 2.54) / 16.0 * g->dvi_advance_in_units_of_design_size_by_2e20 + 0.5);
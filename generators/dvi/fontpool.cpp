@@ -21,6 +21,9 @@
 
 //#define DEBUG_FONTPOOL
 
+// Number of display resolutions whose glyph atlas is kept
+#define GLYPH_ATLAS_RESOLUTIONS 4
+
 // List of permissible MetaFontModes which are supported by kdvi.
 
 // const char *MFModes[]       = { "cx", "ljfour", "lexmarks" };
@@ -44,6 +47,7 @@ fontPool::fontPool(bool useFontHinting)
     useFontHints = useFontHinting;
     CMperDVIunit = 0;
     extraSearchPath.clear();
+    glyphAtlases.setMaxCost(GLYPH_ATLAS_RESOLUTIONS);
 
 #ifdef HAVE_FREETYPE
     // Initialize the Freetype Library
@@ -110,6 +114,7 @@ void fontPool::setParameters(bool _useFontHints)
             TeXFontDefinition *fontp = *it_fontp;
             fontp->setDisplayResolution(displayResolution * fontp->enlargement);
         }
+        clearGlyphAtlases();
     }
 
     useFontHints = _useFontHints;
@@ -209,6 +214,9 @@ void fontPool::locateFonts()
                         kpsewhichOutput.replace(QLatin1String("\n"), QLatin1String("<br/>"))),
                    -1);
     }
+
+    // Fonts may have been loaded, or replaced by others
+    clearGlyphAtlases();
 }
 
 void fontPool::locateFonts(bool makePK, bool locateTFMonly, bool *virtualFontsFound)
@@ -355,6 +363,7 @@ void fontPool::setCMperDVIunit(double _CMperDVI)
         TeXFontDefinition *fontp = *it_fontp;
         fontp->setDisplayResolution(displayResolution_in_dpi * fontp->enlargement);
     }
+    clearGlyphAtlases();
 }
 
 void fontPool::setDisplayResolution(double _displayResolution_in_dpi)
@@ -389,6 +398,28 @@ void fontPool::setDisplayResolution(double _displayResolution_in_dpi)
     */
 }
 
+glyphAtlas *fontPool::currentGlyphAtlas()
+{
+    // Fonts render their glyphs at the resolution of the font pool, so
+    // that is what the glyphs of an atlas depend on.
+    const int key = (int)(displayResolution_in_dpi * 100.0 + 0.5);
+
+    glyphAtlas *atlas = glyphAtlases.object(key);
+    if (atlas == nullptr) {
+#ifdef DEBUG_FONTPOOL
+        qCDebug(OkularDviDebug) << "fontPool::currentGlyphAtlas(): new atlas for" << displayResolution_in_dpi << "dpi";
+#endif
+        atlas = new glyphAtlas();
+        glyphAtlases.insert(key, atlas);
+    }
+    return atlas;
+}
+
+void fontPool::clearGlyphAtlases()
+{
+    glyphAtlases.clear();
+}
+
 void fontPool::markFontsAsLocated()
 {
     QList<TeXFontDefinition *>::iterator it_fontp = fontList.begin();
@@ -425,6 +456,9 @@ void fontPool::release_fonts()
             it_fontp.remove();
         }
     }
+
+    // The atlases might refer to the fonts just deleted
+    clearGlyphAtlases();
 }
 
 void fontPool::mf_output_receiver()
@@ -10,7 +10,9 @@
 #include "TeXFontDefinition.h"
 #include "fontEncodingPool.h"
 #include "fontMap.h"
+#include "glyphAtlas.h"
 
+#include <QCache>
 #include <QList>
 #include <QObject>
 #include <QProcess>
@@ -69,6 +71,12 @@ public:
     /** Sets the resolution of the output device. */
     void setDisplayResolution(double _displayResolution_in_dpi);
 
+    /** Returns the atlas of the glyphs rendered at the current display
+        resolution. The atlases of a few resolutions are kept, so that
+        switching between e.g. thumbnails and pages does not render all
+        glyphs again each time. */
+    glyphAtlas *currentGlyphAtlas();
+
     /** Sets the number of centimeters per DVI unit. */
     void setCMperDVIunit(double CMperDVI);
     double getCMperDVIunit() const
@@ -161,6 +169,13 @@ private:
     // true if that is so.
     bool areFontsLocated();
 
+    // Removes all glyph atlases. Must be called whenever fonts are
+    // loaded, deleted, or render their glyphs differently.
+    void clearGlyphAtlases();
+
+    // The glyph atlases, by display resolution in 1/100 dpi
+    QCache<int, glyphAtlas> glyphAtlases;
+
     // This flag is used by PFB fonts to determine if the FREETYPE engine
     // should use hinted fonts or not
     bool useFontHints;
@@ -49,6 +49,7 @@ DviGenerator::DviGenerator(QObject *parent, const QVariantList &args)
     , m_dviRenderer(nullptr)
 {
     setFeature(Threaded);
+    setFeature(ParallelRendering);
     setFeature(TextExtraction);
     setFeature(FontInfo);
     setFeature(PrintPostscript);
@@ -187,8 +188,8 @@ QImage DviGenerator::image(Okular::PixmapRequest *request)
 
     //  pageInfo->resolution = m_resolution;
 
-    QMutexLocker lock(userMutex());
-
+    // dviRenderer::drawPage() only keeps other pages waiting while it
+    // interprets the page, painting it happens concurrently
     if (m_dviRenderer) {
         SimplePageSize s = m_dviRenderer->sizeOfPage(pageInfo->pageNumber);
 
@@ -209,6 +210,7 @@ QImage DviGenerator::image(Okular::PixmapRequest *request)
 
             ret = pageInfo->img;
 
+            QMutexLocker lock(userMutex());
             if (!m_linkGenerated[request->pageNumber()]) {
                 request->page()->setObjectRects(generateDviLinks(pageInfo));
                 m_linkGenerated[request->pageNumber()] = true;
@@ -216,8 +218,6 @@ QImage DviGenerator::image(Okular::PixmapRequest *request)
         }
     }
 
-    lock.unlock();
-
     delete pageInfo;
 
     return ret;
@@ -0,0 +1,94 @@
+// -*- Mode: C++; c-basic-offset: 2; indent-tabs-mode: nil; c-brace-offset: 0; -*-
+// glyphAtlas.cpp
+//
+// Part of KDVI - A DVI previewer for the KDE desktop environment
+//
+// Distributed under the GPL
+
+#include <config.h>
+
+#include "debug_dvi.h"
+#include "glyphAtlas.h"
+
+#include <QPainter>
+
+//#define DEBUG_GLYPHATLAS
+
+// Width and height of the sheets, in pixels. Glyphs that are larger
+// get a sheet of their own.
+#define GLYPH_ATLAS_SHEET_SIZE 512
+
+glyphAtlas::glyphAtlas()
+{
+    m_currentSheet = -1;
+    m_nextX = 0;
+    m_nextY = 0;
+    m_rowHeight = 0;
+}
+
+bool glyphAtlas::find(const TeXFont *font, quint16 character, QRgb color, Entry *entry) const
+{
+    const glyphAtlasKey key = {font, character, color};
+    QHash<glyphAtlasKey, Entry>::const_iterator it = m_entries.constFind(key);
+    if (it == m_entries.constEnd())
+        return false;
+
+    *entry = it.value();
+    return true;
+}
+
+glyphAtlas::Entry glyphAtlas::insert(const TeXFont *font, quint16 character, QRgb color, const QImage &image, short x2, short y2)
+{
+    Entry entry;
+    entry.x2 = x2;
+    entry.y2 = y2;
+
+    const int width = image.width();
+    const int height = image.height();
+
+    if (image.isNull()) {
+        // Nothing to draw, but remember the offsets anyway
+    } else if ((width > GLYPH_ATLAS_SHEET_SIZE) || (height > GLYPH_ATLAS_SHEET_SIZE)) {
+        m_sheets.append(image.convertToFormat(QImage::Format_ARGB32_Premultiplied));
+        entry.sheet = m_sheets.count() - 1;
+        entry.rect = QRect(0, 0, width, height);
+    } else {
+        // Start a new row if the glyph does not fit into the current
+        // one, and a new sheet if the row does not fit into the sheet
+        if ((m_currentSheet >= 0) && (m_nextX + width > GLYPH_ATLAS_SHEET_SIZE)) {
+            m_nextX = 0;
+            m_nextY += m_rowHeight;
+            m_rowHeight = 0;
+        }
+        if ((m_currentSheet < 0) || (m_nextY + height > GLYPH_ATLAS_SHEET_SIZE)) {
+#ifdef DEBUG_GLYPHATLAS
+            qCDebug(OkularDviDebug) << "glyphAtlas::insert(): adding sheet #" << m_sheets.count();
+#endif
+            QImage sheet(GLYPH_ATLAS_SHEET_SIZE, GLYPH_ATLAS_SHEET_SIZE, QImage::Format_ARGB32_Premultiplied);
+            sheet.fill(Qt::transparent);
+            m_sheets.append(sheet);
+            m_currentSheet = m_sheets.count() - 1;
+            m_nextX = 0;
+            m_nextY = 0;
+            m_rowHeight = 0;
+        }
+
+        // If a page being drawn still uses the sheet, painting detaches
+        // our copy from theirs
+        QPainter painter(&m_sheets[m_currentSheet]);
+        painter.setCompositionMode(QPainter::CompositionMode_Source);
+        painter.drawImage(m_nextX, m_nextY, image);
+        painter.end();
+
+        entry.sheet = m_currentSheet;
+        entry.rect = QRect(m_nextX, m_nextY, width, height);
+
+        // Leave one pixel between the glyphs
+        m_nextX += width + 1;
+        m_rowHeight = qMax(m_rowHeight, height + 1);
+    }
+
+    const glyphAtlasKey key = {font, character, color};
+    m_entries.insert(key, entry);
+    return entry;
+}
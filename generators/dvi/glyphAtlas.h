@@ -0,0 +1,98 @@
+// -*- Mode: C++; c-basic-offset: 2; indent-tabs-mode: nil; c-brace-offset: 0; -*-
+// glyphAtlas.h
+//
+// Part of KDVI - A DVI previewer for the KDE desktop environment
+//
+// Distributed under the GPL
+
+#ifndef _GLYPHATLAS_H
+#define _GLYPHATLAS_H
+
+#include <QHash>
+#include <QImage>
+#include <QRect>
+#include <QVector>
+
+class TeXFont;
+
+/** Identifies a glyph in a glyphAtlas: a character of a font, in a color */
+struct glyphAtlasKey {
+    const TeXFont *font;
+    quint16 character;
+    QRgb color;
+
+    bool operator==(const glyphAtlasKey &other) const
+    {
+        return font == other.font && character == other.character && color == other.color;
+    }
+};
+
+inline uint qHash(const glyphAtlasKey &key, uint seed = 0)
+{
+    return qHash(quintptr(key.font), seed) ^ qHash((uint(key.character) << 16) ^ key.color, seed);
+}
+
+/**
+ *  The glyphs of all fonts rendered at one display resolution
+ *
+ * The glyphs are packed into a few large images, the "sheets", rather
+ * than kept in one image each. The atlas is filled while pages are
+ * interpreted, which the dviRenderer only does with its mutex held;
+ * pages drawn from the sheets keep their own copies of them (see
+ * sheets()), so adding glyphs never changes what is being drawn by
+ * another thread.
+ */
+
+class glyphAtlas
+{
+public:
+    /** Where a glyph is in the atlas */
+    struct Entry {
+        Entry()
+            : sheet(-1)
+            , x2(0)
+            , y2(0)
+        {
+        }
+
+        // Index of the sheet, or -1 if the glyph has no pixels
+        int sheet;
+        // Position of the glyph in the sheet
+        QRect rect;
+        // x and y offset in pixels, as in glyph::x2 and glyph::y2
+        short x2, y2;
+    };
+
+    glyphAtlas();
+
+    glyphAtlas(const glyphAtlas &) = delete;
+    glyphAtlas &operator=(const glyphAtlas &) = delete;
+
+    /** Looks up the glyph of the character of the font in the given
+        color. Returns false if it was never added to the atlas. */
+    bool find(const TeXFont *font, quint16 character, QRgb color, Entry *entry) const;
+
+    /** Copies the image of a glyph into the atlas, and returns where
+        it went. */
+    Entry insert(const TeXFont *font, quint16 character, QRgb color, const QImage &image, short x2, short y2);
+
+    /** The sheets the entries refer to */
+    QVector<QImage> sheets() const
+    {
+        return m_sheets;
+    }
+
+private:
+    QHash<glyphAtlasKey, Entry> m_entries;
+    QVector<QImage> m_sheets;
+
+    // Sheet that glyphs are currently added to, and where in that
+    // sheet the next glyph goes. Glyphs are placed in rows; rowHeight
+    // is the height of the tallest glyph in the current row.
+    int m_currentSheet;
+    int m_nextX;
+    int m_nextY;
+    int m_rowHeight;
+};
+
+#endif // ifndef _GLYPHATLAS_H
@@ -17,9 +17,11 @@
 
 #include <KLocalizedString>
 #include <KProcess>
+#include <QTemporaryDir>
 #include <QTemporaryFile>
 #include <QUrl>
 
+#include <QCryptographicHash>
 #include <QDir>
 #include <QLoggingCategory>
 #include <QPainter>
@@ -27,8 +29,17 @@
 #include <QTextStream>
 #include <QTimer>
 
+#include <algorithm>
+
 //#define DEBUG_PSGS
 
+// Maximal size of the rendered graphics kept in memory, in kilobytes
+#define PS_CACHE_SIZE (64 * 1024)
+
+// Maximal number of pages whose graphics are rendered in one run of
+// ghostscript
+#define PS_BATCH_SIZE 4
+
 // extern char psheader[];
 
 pageInfo::pageInfo(const QString &_PostScriptString)
@@ -55,6 +66,8 @@ ghostscript_interface::ghostscript_interface()
     knownDevices.append(QStringLiteral("pnn"));
     knownDevices.append(QStringLiteral("pnnraw"));
     gsDevice = knownDevices.begin();
+
+    graphicsCache.setMaxCost(PS_CACHE_SIZE);
 }
 
 ghostscript_interface::~ghostscript_interface()
@@ -144,12 +157,30 @@ void ghostscript_interface::clear()
     // Deletes all items, removes temporary files, etc.
     qDeleteAll(pageList);
     pageList.clear();
+    graphicsCache.clear();
+}
+
+QString ghostscript_interface::graphicsCacheKey(const PageNumber page, long magnification) const
+{
+    const pageInfo *info = pageList.value(page);
+
+    // The key contains a hash of everything that goes into the
+    // PostScript file of the page, so that graphics rendered from
+    // outdated PostScript or with another background are never used.
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(PostScriptHeaderString->toLatin1());
+    if (info != nullptr) {
+        hash.addData(info->background.name().toLatin1());
+        hash.addData(info->PostScriptString->toUtf8());
+    }
+
+    return QStringLiteral("%1 %2x%3 %4 %5 ").arg(page).arg(pixel_page_w).arg(pixel_page_h).arg(resolution).arg(magnification) + QString::fromLatin1(hash.result().toHex());
 }
 
-void ghostscript_interface::gs_generate_graphics_file(const PageNumber page, const QString &filename, long magnification)
+void ghostscript_interface::gs_generate_graphics_files(const QList<PageNumber> &pages, const QString &directory, long magnification)
 {
 #ifdef DEBUG_PSGS
-    qCDebug(OkularDviDebug) << "ghostscript_interface::gs_generate_graphics_file( " << page << ", " << filename << " )";
+    qCDebug(OkularDviDebug) << "ghostscript_interface::gs_generate_graphics_files( " << pages.count() << " pages, " << directory << " )";
 #endif
 
     if (knownDevices.isEmpty()) {
@@ -157,10 +188,8 @@ void ghostscript_interface::gs_generate_graphics_file(const PageNumber page, con
         return;
     }
 
-    pageInfo *info = pageList.value(page);
-
-    // Generate a PNG-file
-    // Step 1: Write the PostScriptString to a File
+    // Generate PNG-files
+    // Step 1: Write the PostScriptStrings to a File, one page each
     QTemporaryFile PSfile(QDir::tempPath() + QLatin1String("/okular_XXXXXX.ps"));
     PSfile.setAutoRemove(false);
     PSfile.open();
@@ -170,7 +199,7 @@ void ghostscript_interface::gs_generate_graphics_file(const PageNumber page, con
     os << "%!PS-Adobe-2.0\n"
        << "%%Creator: kdvi\n"
        << "%%Title: KDVI temporary PostScript\n"
-       << "%%Pages: 1\n"
+       << "%%Pages: " << pages.count() << '\n'
        << "%%PageOrder: Ascend\n"
        // HSize and VSize in 1/72 inch
        << "%%BoundingBox: 0 0 " << (qint32)(72 * (pixel_page_w / resolution)) << ' ' << (qint32)(72 * (pixel_page_h / resolution)) << '\n'
@@ -190,36 +219,47 @@ void ghostscript_interface::gs_generate_graphics_file(const PageNumber page, con
        << " 300 300"
        // Name
        << " (test.dvi)"
-       << " @start end\n"
-       << "TeXDict begin\n"
-       // Start page
-       << "1 0 bop 0 0 a \n";
+       << " @start end\n";
 
-    if (!PostScriptHeaderString->toLatin1().isNull())
-        os << PostScriptHeaderString->toLatin1();
+    for (int i = 0; i < pages.count(); ++i) {
+        const pageInfo *info = pageList.value(pages[i]);
 
-    if (info->background != Qt::white) {
-        QString colorCommand = QStringLiteral("gsave %1 %2 %3 setrgbcolor clippath fill grestore\n").arg(info->background.red() / 255.0).arg(info->background.green() / 255.0).arg(info->background.blue() / 255.0);
-        os << colorCommand.toLatin1();
-    }
+        // Whatever the PostScript of one page defines must not leak
+        // into the next one, as if each page was rendered on its own.
+        os << "%%Page: " << i + 1 << ' ' << i + 1 << '\n'
+           << "userdict /kdviPageSave save put\n"
+           << "TeXDict begin\n"
+           // Start page
+           << "1 0 bop 0 0 a \n";
+
+        if (!PostScriptHeaderString->toLatin1().isNull())
+            os << PostScriptHeaderString->toLatin1();
+
+        if (info->background != Qt::white) {
+            QString colorCommand = QStringLiteral("gsave %1 %2 %3 setrgbcolor clippath fill grestore\n").arg(info->background.red() / 255.0).arg(info->background.green() / 255.0).arg(info->background.blue() / 255.0);
+            os << colorCommand.toLatin1();
+        }
 
-    if (!info->PostScriptString->isNull())
-        os << *(info->PostScriptString);
+        if (!info->PostScriptString->isNull())
+            os << *(info->PostScriptString);
 
-    os << "end\n"
-       << "showpage \n";
+        os << "end\n"
+           << "showpage \n"
+           << "userdict /kdviPageSave get restore\n";
+    }
 
     PSfile.close();
 
     // Step 2: Call GS with the File
-    QFile::remove(filename);
+    const QString firstFileName = directory + QStringLiteral("/page1");
+    QFile::remove(firstFileName);
     KProcess proc;
     proc.setOutputChannelMode(KProcess::SeparateChannels);
     QStringList argus;
     argus << QStringLiteral("gs");
     argus << QStringLiteral("-dSAFER") << QStringLiteral("-dPARANOIDSAFER") << QStringLiteral("-dDELAYSAFER") << QStringLiteral("-dNOPAUSE") << QStringLiteral("-dBATCH");
     argus << QStringLiteral("-sDEVICE=%1").arg(*gsDevice);
-    argus << QStringLiteral("-sOutputFile=%1").arg(filename);
+    argus << QStringLiteral("-sOutputFile=%1/page%d").arg(directory);
     argus << QStringLiteral("-sExtraIncludePath=%1").arg(includePath);
     argus << QStringLiteral("-g%1x%2").arg(pixel_page_w).arg(pixel_page_h); // page size in pixels
     argus << QStringLiteral("-r%1").arg(resolution);                        // resolution in dpi
@@ -243,7 +283,7 @@ void ghostscript_interface::gs_generate_graphics_file(const PageNumber page, con
     PSfile.remove();
 
     // Check if gs has indeed produced a file.
-    if (QFile::exists(filename) == false) {
+    if (QFile::exists(firstFileName) == false) {
         qCCritical(OkularDviDebug) << "GS did not produce output." << endl;
 
         // No. Check is the reason is that the device is not compiled into
@@ -268,7 +308,7 @@ void ghostscript_interface::gs_generate_graphics_file(const PageNumber page, con
                                -1);
                 else {
                     qCDebug(OkularDviDebug) << QStringLiteral("Okular will now try to use the '%1' device driver.").arg(*gsDevice);
-                    gs_generate_graphics_file(page, filename, magnification);
+                    gs_generate_graphics_files(pages, directory, magnification);
                 }
                 return;
             }
@@ -276,21 +316,16 @@ void ghostscript_interface::gs_generate_graphics_file(const PageNumber page, con
     }
 }
 
-void ghostscript_interface::graphics(const PageNumber page, double dpi, long magnification, QPainter *paint)
+QImage ghostscript_interface::graphics(const PageNumber page, double dpi, long magnification, const QSize &pixelSize)
 {
 #ifdef DEBUG_PSGS
     qCDebug(OkularDviDebug) << "ghostscript_interface::graphics( " << page << ", " << dpi << ", ... ) called.";
 #endif
 
-    if (paint == nullptr) {
-        qCCritical(OkularDviDebug) << "ghostscript_interface::graphics(PageNumber page, double dpi, long magnification, QPainter *paint) called with paint == 0" << endl;
-        return;
-    }
-
     resolution = dpi;
 
-    pixel_page_w = paint->viewport().width();
-    pixel_page_h = paint->viewport().height();
+    pixel_page_w = pixelSize.width();
+    pixel_page_h = pixelSize.height();
 
     pageInfo *info = pageList.value(page);
 
@@ -299,20 +334,53 @@ void ghostscript_interface::graphics(const PageNumber page, double dpi, long mag
 #ifdef DEBUG_PSGS
         qCDebug(OkularDviDebug) << "No PostScript found. Not drawing anything.";
 #endif
-        return;
+        return QImage();
+    }
+
+    const QString key = graphicsCacheKey(page, magnification);
+    if (const QImage *cached = graphicsCache.object(key)) {
+#ifdef DEBUG_PSGS
+        qCDebug(OkularDviDebug) << "Using cached graphics.";
+#endif
+        return *cached;
     }
 
-    QTemporaryFile gfxFile;
-    gfxFile.open();
-    const QString gfxFileName = gfxFile.fileName();
-    // We are want the filename, not the file.
-    gfxFile.close();
+    // Starting ghostscript is much more expensive than rendering a page,
+    // so render the graphics of the next pages that are not cached
+    // yet along with this one: they are likely to be asked for soon.
+    QList<PageNumber> pages;
+    pages << page;
+    QList<quint16> pagesWithPostScript = pageList.keys();
+    std::sort(pagesWithPostScript.begin(), pagesWithPostScript.end());
+    for (const quint16 nextPage : qAsConst(pagesWithPostScript)) {
+        if (pages.count() >= PS_BATCH_SIZE)
+            break;
+        if (nextPage <= page || pageList.value(nextPage)->PostScriptString->isEmpty())
+            continue;
+        if (!graphicsCache.contains(graphicsCacheKey(nextPage, magnification)))
+            pages << nextPage;
+    }
 
-    gs_generate_graphics_file(page, gfxFileName, magnification);
+    QTemporaryDir gfxDir;
+    if (!gfxDir.isValid()) {
+        qCCritical(OkularDviDebug) << "Could not create a temporary directory for the graphics" << endl;
+        return QImage();
+    }
+
+    gs_generate_graphics_files(pages, gfxDir.path(), magnification);
+
+    // QCache deletes right away what does not fit, so keep our own copy
+    QImage MemoryCopy;
+    for (int i = 0; i < pages.count(); ++i) {
+        const QImage image(gfxDir.filePath(QStringLiteral("page%1").arg(i + 1)));
+        if (image.isNull())
+            continue;
+        if (i == 0)
+            MemoryCopy = image;
+        graphicsCache.insert(graphicsCacheKey(pages[i], magnification), new QImage(image), image.sizeInBytes() / 1024);
+    }
 
-    QImage MemoryCopy(gfxFileName);
-    paint->drawImage(0, 0, MemoryCopy);
-    return;
+    return MemoryCopy;
 }
 
 QString ghostscript_interface::locateEPSfile(const QString &filename, const QUrl &base)
@@ -11,14 +11,15 @@
 #define _PSGS_H_
 
 #include <QApplication>
+#include <QCache>
 #include <QColor>
 #include <QEvent>
 #include <QHash>
+#include <QImage>
 #include <QObject>
 
 class QUrl;
 class PageNumber;
-class QPainter;
 
 class pageInfo
 {
@@ -60,9 +61,13 @@ public:
     // With option permanent = true.
     void restoreBackgroundColor(const PageNumber page);
 
-    // Draws the graphics of the page into the painter, if possible. If
-    // the page does not contain any graphics, nothing happens
-    void graphics(const PageNumber page, double dpi, long magnification, QPainter *paint);
+    // Returns the graphics of the page, rendered at the given size in
+    // pixels, if possible. If the page does not contain any graphics, a
+    // null image is returned. The graphics are cached, so that
+    // ghostscript only needs to be run again when the PostScript, the
+    // background color, the size or the magnification of the page
+    // change.
+    QImage graphics(const PageNumber page, double dpi, long magnification, const QSize &pixelSize);
 
     // Returns the background color for a certain page. If no color was
     // set, Qt::white is returned.
@@ -80,9 +85,20 @@ public:
     static QString locateEPSfile(const QString &filename, const QUrl &base);
 
 private:
-    void gs_generate_graphics_file(const PageNumber page, const QString &filename, long magnification);
+    // Renders the PostScript of all the given pages in one ghostscript
+    // run, into the files page1, page2, ... of the directory, in the
+    // order of the list.
+    void gs_generate_graphics_files(const QList<PageNumber> &pages, const QString &directory, long magnification);
+
+    // Returns the key under which the graphics of the page are stored
+    // in graphicsCache, for the current resolution and page size.
+    QString graphicsCacheKey(const PageNumber page, long magnification) const;
+
     QHash<quint16, pageInfo *> pageList;
 
+    // Rendered graphics, by graphicsCacheKey(), costs in kilobytes
+    QCache<QString, QImage> graphicsCache;
+
     double resolution; // in dots per inch
     int pixel_page_w;  // in pixels
     int pixel_page_h;  // in pixels
@@ -377,7 +377,7 @@ void dviRenderer::epsf_special(const QString &cp)
 
         QImage image(EPSfilename);
         image = image.scaled((int)(bbox_width), (int)(bbox_height), Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
-        foreGroundPainter->drawImage(((int)((currinf.data.dvi_h) / (shrinkfactor * 65536))), currinf.data.pxl_v - (int)bbox_height, image);
+        foreGroundDisplayList->drawImage(((int)((currinf.data.dvi_h) / (shrinkfactor * 65536))), currinf.data.pxl_v - (int)bbox_height, image);
         return;
     }
 
@@ -403,26 +403,26 @@ void dviRenderer::epsf_special(const QString &cp)
 
         QRect bbox(((int)((currinf.data.dvi_h) / (shrinkfactor * 65536))), currinf.data.pxl_v - (int)bbox_height, (int)bbox_width, (int)bbox_height);
 
-        foreGroundPainter->save();
+        foreGroundDisplayList->save();
 
         if (QFile::exists(EPSfilename))
-            foreGroundPainter->setBrush(Qt::lightGray);
+            foreGroundDisplayList->setBrush(Qt::lightGray);
         else
-            foreGroundPainter->setBrush(Qt::red);
-        foreGroundPainter->setPen(Qt::black);
-        foreGroundPainter->drawRoundedRect(bbox, 2, 2);
-        QFont f = foreGroundPainter->font();
+            foreGroundDisplayList->setBrush(Qt::red);
+        foreGroundDisplayList->setPen(Qt::black);
+        foreGroundDisplayList->drawRoundedRect(bbox, 2, 2);
+        QFont f;
         f.setPointSize(8);
-        foreGroundPainter->setFont(f);
+        foreGroundDisplayList->setFont(f);
         /* if the fonts are mapped for some reason to X bitmap fonts,
            the call to drawText() in the non-GUI thread will produce a crash.
            Ensure that the rendering of the text is performed only if
            the threaded font rendering is available */
         if (QFile::exists(EPSfilename))
-            foreGroundPainter->drawText(bbox, (int)(Qt::AlignCenter), EPSfilename);
+            foreGroundDisplayList->drawText(bbox, (int)(Qt::AlignCenter), EPSfilename);
         else
-            foreGroundPainter->drawText(bbox, (int)(Qt::AlignCenter), i18n("File not found: \n %1", EPSfilename_orig));
-        foreGroundPainter->restore();
+            foreGroundDisplayList->drawText(bbox, (int)(Qt::AlignCenter), i18n("File not found: \n %1", EPSfilename_orig));
+        foreGroundDisplayList->restore();
     }
 
     return;
@@ -440,8 +440,8 @@ void dviRenderer::TPIC_flushPath_special()
     }
 
     QPen pen(Qt::black, (int)(penWidth_in_mInch * resolutionInDPI / 1000.0 + 0.5)); // Sets the pen size in milli-inches
-    foreGroundPainter->setPen(pen);
-    foreGroundPainter->drawPolyline(TPIC_path.constData(), number_of_elements_in_path);
+    foreGroundDisplayList->setPen(pen);
+    foreGroundDisplayList->drawPolyline(TPIC_path.constData(), number_of_elements_in_path);
     number_of_elements_in_path = 0;
 }
 
@@ -655,11 +655,11 @@ void dviRenderer::applicationDoSpecial(char *cp)
             int x = ((int)((currinf.data.dvi_h) / (shrinkfactor * 65536)));
             int y = currinf.data.pxl_v;
 
-            foreGroundPainter->save();
+            foreGroundDisplayList->save();
             // Rotate about the current point
-            foreGroundPainter->translate(x, y);
-            foreGroundPainter->rotate(-angle);
-            foreGroundPainter->translate(-x, -y);
+            foreGroundDisplayList->translate(x, y);
+            foreGroundDisplayList->rotate(-angle);
+            foreGroundDisplayList->translate(-x, -y);
         } else
             printErrorMsgForSpecials(i18n("Error in DVIfile '%1', page %2. Could not interpret angle in text rotation special.", dviFile->filename, current_page));
     }
@@ -667,7 +667,7 @@ void dviRenderer::applicationDoSpecial(char *cp)
     // The graphicx package marks the end of rotated text with this
     // special. The state of the painter is restored.
     if (special_command == QLatin1String("ps: currentpoint grestore moveto")) {
-        foreGroundPainter->restore();
+        foreGroundDisplayList->restore();
     }
 
     // The following special commands are not used here; they are of
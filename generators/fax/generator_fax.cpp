@@ -24,6 +24,7 @@ FaxGenerator::FaxGenerator(QObject *parent, const QVariantList &args)
     : Generator(parent, args)
 {
     setFeature(Threaded);
+    setFeature(TiledRendering);
     setFeature(PrintNative);
     setFeature(PrintToFile);
 }
@@ -47,6 +48,7 @@ bool FaxGenerator::loadDocument(const QString &fileName, QVector<Okular::Page *>
     }
 
     m_img = faxDocument.image();
+    m_pyramid.setImage(m_img);
 
     pagesVector.resize(1);
 
@@ -59,19 +61,26 @@ bool FaxGenerator::loadDocument(const QString &fileName, QVector<Okular::Page *>
 bool FaxGenerator::doCloseDocument()
 {
     m_img = QImage();
+    m_pyramid.setImage(QImage());
 
     return true;
 }
 
 QImage FaxGenerator::image(Okular::PixmapRequest *request)
 {
-    // perform a smooth scaled generation
+    // scale from the nearest level of the pyramid rather than from the
+    // full image, which may be huge
+    if (request->isTile()) {
+        const QSize size(request->width(), request->height());
+        return m_pyramid.scaled(size, request->normalizedRect().geometry(size.width(), size.height()));
+    }
+
     int width = request->width();
     int height = request->height();
     if (request->page()->rotation() % 2 == 1)
         qSwap(width, height);
 
-    return m_img.scaled(width, height, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    return m_pyramid.scaled(QSize(width, height));
 }
 
 Okular::DocumentInfo FaxGenerator::generateDocumentInfo(const QSet<Okular::DocumentInfo::Key> &keys) const
@@ -11,6 +11,7 @@
 #define OKULAR_GENERATOR_FAX_H
 
 #include <core/generator.h>
+#include <core/imagepyramid.h>
 
 #include <QImage>
 
@@ -37,6 +38,7 @@ protected:
 
 private:
     QImage m_img;
+    Okular::ImagePyramid m_pyramid;
     FaxDocument::DocumentType m_type;
 };
 
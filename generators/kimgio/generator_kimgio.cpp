@@ -90,6 +90,8 @@ bool KIMGIOGenerator::loadDocumentInternal(const QByteArray &fileData, const QSt
         exifMetadata.rotateExifQImage(m_img, exifMetadata.getImageOrientation());
     }
 
+    m_pyramid.setImage(m_img);
+
     pagesVector.resize(1);
 
     Okular::Page *page = new Okular::Page(0, m_img.width(), m_img.height(), Okular::Rotation0);
@@ -108,32 +110,25 @@ KIMGIOGenerator::SwapBackingFileResult KIMGIOGenerator::swapBackingFile(QString
 bool KIMGIOGenerator::doCloseDocument()
 {
     m_img = QImage();
+    m_pyramid.setImage(QImage());
 
     return true;
 }
 
 QImage KIMGIOGenerator::image(Okular::PixmapRequest *request)
 {
-    // perform a smooth scaled generation
+    // scale from the nearest level of the pyramid rather than from the
+    // full image, which may be huge
     if (request->isTile()) {
-        const QRect srcRect = request->normalizedRect().geometry(m_img.width(), m_img.height());
-        const QRect destRect = request->normalizedRect().geometry(request->width(), request->height());
-
-        QImage destImg(destRect.size(), QImage::Format_RGB32);
-        destImg.fill(Qt::white);
-
-        QPainter p(&destImg);
-        p.setRenderHint(QPainter::SmoothPixmapTransform);
-        p.drawImage(destImg.rect(), m_img, srcRect);
-
-        return destImg;
+        const QSize size(request->width(), request->height());
+        return m_pyramid.scaled(size, request->normalizedRect().geometry(size.width(), size.height()));
     } else {
         int width = request->width();
         int height = request->height();
         if (request->page()->rotation() % 2 == 1)
             qSwap(width, height);
 
-        return m_img.scaled(width, height, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+        return m_pyramid.scaled(QSize(width, height));
     }
 }
 
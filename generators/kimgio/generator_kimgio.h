@@ -15,6 +15,7 @@
 
 #include <core/document.h>
 #include <core/generator.h>
+#include <core/imagepyramid.h>
 
 #include <QImage>
 
@@ -47,6 +48,7 @@ private:
 
 private:
     QImage m_img;
+    Okular::ImagePyramid m_pyramid;
     Okular::DocumentInfo docInfo;
 };
 
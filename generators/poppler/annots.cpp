@@ -56,10 +56,11 @@ static int maskExportedFlags(int flags)
 }
 
 // BEGIN PopplerAnnotationProxy implementation
-PopplerAnnotationProxy::PopplerAnnotationProxy(Poppler::Document *doc, QMutex *userMutex, QHash<Okular::Annotation *, Poppler::Annotation *> *annotsOnOpenHash)
+PopplerAnnotationProxy::PopplerAnnotationProxy(Poppler::Document *doc, QMutex *userMutex, QHash<Okular::Annotation *, Poppler::Annotation *> *annotsOnOpenHash, QSet<int> *modifiedPages)
     : ppl_doc(doc)
     , mutex(userMutex)
     , annotationsOnOpenHash(annotsOnOpenHash)
+    , annotationsModifiedPages(modifiedPages)
 {
 }
 
@@ -471,6 +472,7 @@ void PopplerAnnotationProxy::notifyAddition(Okular::Annotation *okl_ann, int pag
     Poppler::Page *ppl_page = ppl_doc->page(page);
     ppl_page->addAnnotation(ppl_ann);
     delete ppl_page;
+    annotationsModifiedPages->insert(page);
 
     // Set pointer to poppler annotation as native Id
     okl_ann->setNativeId(QVariant::fromValue(ppl_ann));
@@ -481,7 +483,6 @@ void PopplerAnnotationProxy::notifyAddition(Okular::Annotation *okl_ann, int pag
 
 void PopplerAnnotationProxy::notifyModification(const Okular::Annotation *okl_ann, int page, bool appearanceChanged)
 {
-    Q_UNUSED(page);
     Q_UNUSED(appearanceChanged);
 
     Poppler::Annotation *ppl_ann = qvariant_cast<Poppler::Annotation *>(okl_ann->nativeId());
@@ -490,6 +491,7 @@ void PopplerAnnotationProxy::notifyModification(const Okular::Annotation *okl_an
         return;
 
     QMutexLocker ml(mutex);
+    annotationsModifiedPages->insert(page);
 
     if (okl_ann->flags() & (Okular::Annotation::BeingMoved | Okular::Annotation::BeingResized)) {
         // Okular ui already renders the annotation on its own
@@ -567,6 +569,7 @@ void PopplerAnnotationProxy::notifyRemoval(Okular::Annotation *okl_ann, int page
     annotationsOnOpenHash->remove(okl_ann);
     ppl_page->removeAnnotation(ppl_ann); // Also destroys ppl_ann
     delete ppl_page;
+    annotationsModifiedPages->insert(page);
 
     okl_ann->setNativeId(QVariant::fromValue(0)); // So that we don't double-free in disposeAnnotation
 
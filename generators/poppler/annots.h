@@ -17,6 +17,7 @@
 #include <poppler-qt5.h>
 
 #include <QMutex>
+#include <QSet>
 
 #include "config-okular-poppler.h"
 #include "core/annotations.h"
@@ -26,7 +27,7 @@ extern Okular::Annotation *createAnnotationFromPopplerAnnotation(Poppler::Annota
 class PopplerAnnotationProxy : public Okular::AnnotationProxy
 {
 public:
-    PopplerAnnotationProxy(Poppler::Document *doc, QMutex *userMutex, QHash<Okular::Annotation *, Poppler::Annotation *> *annotsOnOpenHash);
+    PopplerAnnotationProxy(Poppler::Document *doc, QMutex *userMutex, QHash<Okular::Annotation *, Poppler::Annotation *> *annotsOnOpenHash, QSet<int> *modifiedPages);
     ~PopplerAnnotationProxy() override;
 
     bool supports(Capability capability) const override;
@@ -38,6 +39,8 @@ private:
     Poppler::Document *ppl_doc;
     QMutex *mutex;
     QHash<Okular::Annotation *, Poppler::Annotation *> *annotationsOnOpenHash;
+    // pages whose annotations differ from the ones in the file, protected by mutex
+    QSet<int> *annotationsModifiedPages;
 };
 
 #endif
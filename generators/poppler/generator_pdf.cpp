@@ -45,6 +45,7 @@
 #include <core/movie.h>
 #include <core/page.h>
 #include <core/pagetransition.h>
+#include <core/printpipeline.h>
 #include <core/signatureutils.h>
 #include <core/sound.h>
 #include <core/sourcereference.h>
@@ -547,6 +548,8 @@ static void PDFGeneratorPopplerDebugFunction(const QString &message, const QVari
 PDFGenerator::PDFGenerator(QObject *parent, const QVariantList &args)
     : Generator(parent, args)
     , pdfdoc(nullptr)
+    , renderInParallel(false)
+    , renderDocumentsGeneration(0)
     , docSynopsisDirty(true)
     , docEmbeddedFilesDirty(true)
     , nextFontPage(0)
@@ -567,6 +570,8 @@ PDFGenerator::PDFGenerator(QObject *parent, const QVariantList &args)
     setFeature(TiledRendering);
     setFeature(SwapBackingFile);
     setFeature(SupportsCancelling);
+    setFeature(ParallelRendering);
+    setFeature(ParallelTextExtraction);
 
     // You only need to do it once not for each of the documents but it is cheap enough
     // so doing it all the time won't hurt either
@@ -593,8 +598,14 @@ Okular::Document::OpenResult PDFGenerator::loadDocumentWithPassword(const QStrin
         return Okular::Document::OpenError;
     }
 #endif
-    // create PDFDoc for the given file
-    pdfdoc = Poppler::Document::load(filePath, nullptr, nullptr);
+    // create PDFDoc for the given file, from memory so the documents rendering
+    // in parallel are loaded from the very same data even if the file changes
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly))
+        return Okular::Document::OpenError;
+    renderDocumentData = file.readAll();
+    file.close();
+    pdfdoc = Poppler::Document::loadFromData(renderDocumentData, nullptr, nullptr);
     return init(pagesVector, password);
 }
 
@@ -608,6 +619,7 @@ Okular::Document::OpenResult PDFGenerator::loadDocumentFromDataWithPassword(cons
 #endif
     // create PDFDoc for the given file
     pdfdoc = Poppler::Document::loadFromData(fileData, nullptr, nullptr);
+    renderDocumentData = fileData;
     return init(pagesVector, password);
 }
 
@@ -637,6 +649,7 @@ Okular::Document::OpenResult PDFGenerator::init(QVector<Okular::Page *> &pagesVe
     rectsGenerated.fill(false, pageCount);
 
     annotationsOnOpenHash.clear();
+    annotationsModifiedPages.clear();
 
     loadPages(pagesVector, 0, false);
 
@@ -644,7 +657,11 @@ Okular::Document::OpenResult PDFGenerator::init(QVector<Okular::Page *> &pagesVe
     reparseConfig();
 
     // create annotation proxy
-    annotProxy = new PopplerAnnotationProxy(pdfdoc, userMutex(), &annotationsOnOpenHash);
+    annotProxy = new PopplerAnnotationProxy(pdfdoc, userMutex(), &annotationsOnOpenHash, &annotationsModifiedPages);
+
+    // toggling layers only affects pdfdoc, so those documents are always rendered from it
+    renderDocumentPassword = password.toLatin1();
+    renderInParallel = !pdfdoc->hasOptionalContent();
 
     // the file has been loaded correctly
     return Okular::Document::OpenSuccess;
@@ -687,6 +704,7 @@ bool PDFGenerator::doCloseDocument()
     annotProxy = nullptr;
     delete pdfdoc;
     pdfdoc = nullptr;
+    clearRenderDocuments();
     userMutex()->unlock();
     docSynopsisDirty = true;
     docSyn.clear();
@@ -1076,9 +1094,6 @@ QImage PDFGenerator::image(Okular::PixmapRequest *request)
     qreal fakeDpiX = request->width() / pageWidth * dpi().width();
     qreal fakeDpiY = request->height() / pageHeight * dpi().height();
 
-    // generate links rects only the first time
-    bool genObjectRects = !rectsGenerated.at(page->number());
-
     // 0. LOCK [waits for the thread end]
     userMutex()->lock();
 
@@ -1087,9 +1102,19 @@ QImage PDFGenerator::image(Okular::PixmapRequest *request)
         return QImage();
     }
 
+    // generate links rects only the first time
+    bool genObjectRects = !rectsGenerated.at(page->number());
+
+    // if possible render from a document of our own, so other threads can use pdfdoc meanwhile
+    int renderDocGeneration;
+    Poppler::Document *renderDoc = acquireRenderDocument(page, &renderDocGeneration);
+
     // 1. Set OutputDev parameters and Generate contents
     // note: thread safety is set on 'false' for the GUI (this) thread
-    Poppler::Page *p = pdfdoc->page(page->number());
+    Poppler::Page *p = (renderDoc ? renderDoc : pdfdoc)->page(page->number());
+
+    if (renderDoc)
+        userMutex()->unlock();
 
     // 2. Take data from outputdev and attach it to the Page
     QImage img;
@@ -1118,6 +1143,16 @@ QImage PDFGenerator::image(Okular::PixmapRequest *request)
         img.fill(Qt::white);
     }
 
+    if (renderDoc) {
+        delete p;
+        releaseRenderDocument(renderDoc, renderDocGeneration);
+
+        // links are resolved against the annotations of pdfdoc, so take them from there
+        userMutex()->lock();
+        genObjectRects = !rectsGenerated.at(page->number());
+        p = genObjectRects ? pdfdoc->page(page->number()) : nullptr;
+    }
+
     if (p && genObjectRects) {
         // TODO previously we extracted Image type rects too, but that needed porting to poppler
         // and as we are not doing anything with Image type rects i did not port it, have a look at
@@ -1224,7 +1259,12 @@ Okular::TextPage *PDFGenerator::textPage(Okular::TextRequest *request)
     QList<Poppler::TextBox *> textList;
     double pageWidth, pageHeight;
     userMutex()->lock();
-    Poppler::Page *pp = pdfdoc->page(page->number());
+    // if possible extract from a document of our own, so other threads can use pdfdoc meanwhile
+    int textDocGeneration;
+    Poppler::Document *textDoc = acquireRenderDocument(nullptr, &textDocGeneration);
+    if (textDoc)
+        userMutex()->unlock();
+    Poppler::Page *pp = (textDoc ? textDoc : pdfdoc)->page(page->number());
     if (pp) {
         TextExtractionPayload payload(request);
         textList = pp->textList(Poppler::Page::Rotate0, shouldAbortTextExtractionCallback, QVariant::fromValue(&payload));
@@ -1236,7 +1276,10 @@ Okular::TextPage *PDFGenerator::textPage(Okular::TextRequest *request)
         pageHeight = defaultPageHeight;
     }
     delete pp;
-    userMutex()->unlock();
+    if (textDoc)
+        releaseRenderDocument(textDoc, textDocGeneration);
+    else
+        userMutex()->unlock();
 
     if (textList.isEmpty() && request->shouldAbortExtraction())
         return nullptr;
@@ -1280,44 +1323,76 @@ bool PDFGenerator::print(QPrinter &printer)
             printer.setFullPage(pdfOptionsPage->ignorePrintMargins());
         }
 
+        QList<int> pageList = Okular::FilePrinter::pageList(printer, pdfdoc->numPages(), document()->currentPage() + 1, document()->bookmarkedPageList());
+
+#ifdef Q_OS_WIN
+        const double dpiX = printer.physicalDpiX();
+        const double dpiY = printer.physicalDpiY();
+#else
+        // UNIX: Same resolution as the postscript rasterizer; see discussion at https://git.reviewboard.kde.org/r/130218/
+        const double dpiX = 300;
+        const double dpiY = 300;
+#endif
+
+        // pages with changed annotations or with forms have to be rendered
+        // from pdfdoc, the others are rendered in parallel from documents of their own
+        QSet<int> sharedDocumentPages;
+        for (int i = 0; i < pageList.count(); ++i) {
+            const int page = pageList.at(i) - 1;
+            if (annotationsModifiedPages.contains(page) || !document()->page(page)->formFields().isEmpty())
+                sharedDocumentPages.insert(page);
+        }
+
+        Okular::PrintPipeline pipeline([this, dpiX, dpiY, &sharedDocumentPages](int pageNumber) {
+            const int page = pageNumber - 1;
+            QImage img;
+            userMutex()->lock();
+            int renderDocGeneration = 0;
+            Poppler::Document *renderDoc = sharedDocumentPages.contains(page) ? nullptr : acquireRenderDocument(nullptr, &renderDocGeneration);
+            if (renderDoc)
+                userMutex()->unlock();
+            std::unique_ptr<Poppler::Page> pp((renderDoc ? renderDoc : pdfdoc)->page(page));
+            if (pp)
+                img = pp->renderToImage(dpiX, dpiY);
+            pp.reset();
+            if (renderDoc)
+                releaseRenderDocument(renderDoc, renderDocGeneration);
+            else
+                userMutex()->unlock();
+            return img;
+        });
+
         QPainter painter;
         painter.begin(&printer);
 
-        QList<int> pageList = Okular::FilePrinter::pageList(printer, pdfdoc->numPages(), document()->currentPage() + 1, document()->bookmarkedPageList());
-        for (int i = 0; i < pageList.count(); ++i) {
-            if (i != 0)
+        bool firstPage = true;
+        pipeline.run(pageList, [&](int, const QImage &img) {
+            if (!firstPage)
                 printer.newPage();
+            firstPage = false;
 
-            const int page = pageList.at(i) - 1;
-            userMutex()->lock();
-            std::unique_ptr<Poppler::Page> pp(pdfdoc->page(page));
-            if (pp) {
-                QSizeF pageSize = pp->pageSizeF();      // Unit is 'points' (i.e., 1/72th of an inch)
-                QRect painterWindow = painter.window(); // Unit is 'QPrinter::DevicePixel'
+            if (img.isNull())
+                return true;
 
-                // Default: no scaling at all, but we need to go from DevicePixel units to 'points'
-                // Warning: We compute the horizontal scaling, and later assume that the vertical scaling will be the same.
-                double scaling = printer.paperRect(QPrinter::DevicePixel).width() / printer.paperRect(QPrinter::Point).width();
+            const QSizeF pageSize(img.width() * 72.0 / dpiX, img.height() * 72.0 / dpiY); // Unit is 'points' (i.e., 1/72th of an inch)
+            QRect painterWindow = painter.window();                                        // Unit is 'QPrinter::DevicePixel'
 
-                if (scaleMode != PDFOptionsPage::None) {
-                    // Get the two scaling factors needed to fit the page onto paper horizontally or vertically
-                    auto horizontalScaling = painterWindow.width() / pageSize.width();
-                    auto verticalScaling = painterWindow.height() / pageSize.height();
+            // Default: no scaling at all, but we need to go from DevicePixel units to 'points'
+            // Warning: We compute the horizontal scaling, and later assume that the vertical scaling will be the same.
+            double scaling = printer.paperRect(QPrinter::DevicePixel).width() / printer.paperRect(QPrinter::Point).width();
 
-                    // We use the smaller of the two for both directions, to keep the aspect ratio
-                    scaling = std::min(horizontalScaling, verticalScaling);
-                }
+            if (scaleMode != PDFOptionsPage::None) {
+                // Get the two scaling factors needed to fit the page onto paper horizontally or vertically
+                auto horizontalScaling = painterWindow.width() / pageSize.width();
+                auto verticalScaling = painterWindow.height() / pageSize.height();
 
-#ifdef Q_OS_WIN
-                QImage img = pp->renderToImage(printer.physicalDpiX(), printer.physicalDpiY());
-#else
-                // UNIX: Same resolution as the postscript rasterizer; see discussion at https://git.reviewboard.kde.org/r/130218/
-                QImage img = pp->renderToImage(300, 300);
-#endif
-                painter.drawImage(QRectF(QPointF(0, 0), scaling * pp->pageSizeF()), img);
+                // We use the smaller of the two for both directions, to keep the aspect ratio
+                scaling = std::min(horizontalScaling, verticalScaling);
             }
-            userMutex()->unlock();
-        }
+
+            painter.drawImage(QRectF(QPointF(0, 0), scaling * pageSize), img);
+            return true;
+        });
         painter.end();
         return true;
     }
@@ -1489,6 +1564,71 @@ void PDFGenerator::addPages(KConfigDialog *dlg)
 #endif
 }
 
+Poppler::Document *PDFGenerator::acquireRenderDocument(const Okular::Page *page, int *generation)
+{
+    // userMutex must be locked
+    // the text does not depend on annotations or forms, so pages are only checked for rendering
+    if (!renderInParallel || (page && (annotationsModifiedPages.contains(page->number()) || !page->formFields().isEmpty())))
+        return nullptr;
+
+    Poppler::Document *doc = nullptr;
+    renderDocumentsMutex.lock();
+    if (!idleRenderDocuments.isEmpty())
+        doc = idleRenderDocuments.takeLast();
+    *generation = renderDocumentsGeneration;
+    renderDocumentsMutex.unlock();
+
+    if (!doc) {
+        doc = Poppler::Document::loadFromData(renderDocumentData, renderDocumentPassword, renderDocumentPassword);
+
+        if (!doc || doc->isLocked()) {
+            qCDebug(OkularPdfDebug) << "Could not open a document for parallel rendering";
+            delete doc;
+            renderInParallel = false;
+            return nullptr;
+        }
+    }
+
+    // render exactly as pdfdoc would
+    doc->setPaperColor(pdfdoc->paperColor());
+    const Poppler::Document::RenderHints hints = pdfdoc->renderHints();
+    const Poppler::Document::RenderHint allHints[] = {Poppler::Document::Antialiasing,
+                                                      Poppler::Document::TextAntialiasing,
+                                                      Poppler::Document::TextHinting,
+                                                      Poppler::Document::TextSlightHinting,
+                                                      Poppler::Document::OverprintPreview,
+                                                      Poppler::Document::ThinLineSolid,
+                                                      Poppler::Document::ThinLineShape,
+                                                      Poppler::Document::IgnorePaperColor,
+                                                      Poppler::Document::HideAnnotations};
+    for (const Poppler::Document::RenderHint hint : allHints)
+        doc->setRenderHint(hint, hints.testFlag(hint));
+
+    return doc;
+}
+
+void PDFGenerator::releaseRenderDocument(Poppler::Document *doc, int generation)
+{
+    QMutexLocker locker(&renderDocumentsMutex);
+    // documents acquired before the pool was cleared belong to a closed document
+    if (generation != renderDocumentsGeneration) {
+        delete doc;
+        return;
+    }
+    idleRenderDocuments.append(doc);
+}
+
+void PDFGenerator::clearRenderDocuments()
+{
+    QMutexLocker locker(&renderDocumentsMutex);
+    qDeleteAll(idleRenderDocuments);
+    idleRenderDocuments.clear();
+    ++renderDocumentsGeneration;
+    renderDocumentData.clear();
+    renderDocumentPassword.clear();
+    renderInParallel = false;
+}
+
 bool PDFGenerator::setDocumentRenderHints()
 {
     bool changed = false;
@@ -20,7 +20,9 @@
 #include <poppler-qt5.h>
 
 #include <QBitArray>
+#include <QMutex>
 #include <QPointer>
+#include <QSet>
 
 #include <core/document.h>
 #include <core/generator.h>
@@ -133,9 +135,28 @@ private:
 
     bool setDocumentRenderHints();
 
+    // documents used to render pages in parallel with the shared pdfdoc, pages are not checked when null;
+    // they are given back with the generation of the pool they were acquired from
+    Poppler::Document *acquireRenderDocument(const Okular::Page *page, int *generation);
+    void releaseRenderDocument(Poppler::Document *doc, int generation);
+    void clearRenderDocuments();
+
     // poppler dependent stuff
     Poppler::Document *pdfdoc;
 
+    // Poppler::Document is not reentrant, so every thread rendering a page
+    // without the userMutex locked needs a Poppler::Document of its own,
+    // loaded from the same data as pdfdoc
+    QByteArray renderDocumentData;
+    QByteArray renderDocumentPassword;
+    bool renderInParallel;
+    QMutex renderDocumentsMutex;
+    QVector<Poppler::Document *> idleRenderDocuments;
+    // increased every time the pool is cleared
+    int renderDocumentsGeneration;
+    // pages whose annotations were changed in pdfdoc, they can't be rendered from the file anymore
+    QSet<int> annotationsModifiedPages;
+
     // misc variables for document info and synopsis caching
     bool docSynopsisDirty;
     Okular::DocumentSynopsis docSyn;
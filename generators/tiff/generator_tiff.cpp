@@ -10,13 +10,16 @@
 #include "generator_tiff.h"
 
 #include <QBuffer>
+#include <QCache>
 #include <QDateTime>
 #include <QFile>
 #include <QFileInfo>
 #include <QImage>
 #include <QList>
+#include <QMutex>
 #include <QPainter>
 #include <QPrinter>
+#include <QVector>
 
 #include <KAboutData>
 #include <KLocalizedString>
@@ -25,11 +28,15 @@
 #include <core/document.h>
 #include <core/fileprinter.h>
 #include <core/page.h>
+#include <core/printpipeline.h>
 #include <core/utils.h>
 
 #include <tiff.h>
 #include <tiffio.h>
 
+#include <math.h>
+#include <string.h>
+
 #define TiffDebug 4714
 
 tsize_t okular_tiffReadProc(thandle_t handle, tdata_t buf, tsize_t size)
@@ -83,20 +90,294 @@ void okular_tiffUnmapProc(thandle_t, tdata_t, toff_t)
 {
 }
 
+// budget of the cache of decoded strips and tiles, in KiB
+#define TIFF_BLOCK_CACHE_SIZE (64 * 1024)
+
+// the key of the whole image in the block cache, when it is decoded at once
+#define TIFF_WHOLE_IMAGE_BLOCK 0xffffffffu
+
+/**
+ * How the pixels of a directory are stored: in strips of rows, or in tiles.
+ */
+struct TiffLayout {
+    TiffLayout()
+        : width(0)
+        , height(0)
+        , tiled(false)
+        , wholeImage(false)
+        , blockWidth(0)
+        , blockHeight(0)
+    {
+    }
+
+    uint32 width;
+    uint32 height;
+    bool tiled;
+    // the strips or tiles can't be decoded one by one, only the whole image
+    bool wholeImage;
+    // the size of tiles, or the width of the image and the rows per strip
+    uint32 blockWidth;
+    uint32 blockHeight;
+};
+
 class TIFFGenerator::Private
 {
 public:
     Private()
         : tiff(nullptr)
         , dev(nullptr)
+        , blocks(TIFF_BLOCK_CACHE_SIZE)
     {
     }
 
+    bool setDirectory(int dir);
+    TiffLayout layout(int dir);
+    QImage block(int dir, TiffLayout *layout, uint32 x, uint32 y);
+    QImage readRegion(int dir, const QRect &region, int factor);
+    QImage render(int dir, int targetWidth, int targetHeight, const QRect &rect);
+    void clear();
+
     TIFF *tiff;
     QByteArray data;
     QIODevice *dev;
+
+    // protects tiff and the caches, images can be printed while rendered
+    QMutex mutex;
+    QHash<int, TiffLayout> layouts;
+    // decoded strips and tiles, ARGB and top to bottom
+    QCache<quint64, QImage> blocks;
 };
 
+// an image read by ReadRGBA* is ABGR, we need ARGB, so swap red and blue
+static inline uint32 abgrToArgb(uint32 pixel)
+{
+    return (pixel & 0xFF00FF00) | ((pixel & 0x00FF0000) >> 16) | ((pixel & 0x000000FF) << 16);
+}
+
+bool TIFFGenerator::Private::setDirectory(int dir)
+{
+    // setting the directory reads it again even if it is the current one
+    if (dir < 0)
+        return false;
+    if (int(TIFFCurrentDirectory(tiff)) == dir)
+        return true;
+    return TIFFSetDirectory(tiff, dir);
+}
+
+TiffLayout TIFFGenerator::Private::layout(int dir)
+{
+    QHash<int, TiffLayout>::const_iterator it = layouts.constFind(dir);
+    if (it != layouts.constEnd())
+        return *it;
+
+    TiffLayout layout;
+    if (!setDirectory(dir) || TIFFGetField(tiff, TIFFTAG_IMAGEWIDTH, &layout.width) != 1 || TIFFGetField(tiff, TIFFTAG_IMAGELENGTH, &layout.height) != 1) {
+        layouts.insert(dir, layout);
+        return layout;
+    }
+
+    uint16 orientation = ORIENTATION_TOPLEFT;
+    TIFFGetFieldDefaulted(tiff, TIFFTAG_ORIENTATION, &orientation);
+
+    layout.tiled = TIFFIsTiled(tiff);
+    if (layout.tiled) {
+        TIFFGetField(tiff, TIFFTAG_TILEWIDTH, &layout.blockWidth);
+        TIFFGetField(tiff, TIFFTAG_TILELENGTH, &layout.blockHeight);
+    } else {
+        uint32 rowsPerStrip = layout.height;
+        TIFFGetFieldDefaulted(tiff, TIFFTAG_ROWSPERSTRIP, &rowsPerStrip);
+        layout.blockWidth = layout.width;
+        layout.blockHeight = qBound<uint32>(1, rowsPerStrip, layout.height);
+    }
+
+    // ReadRGBAStrip and ReadRGBATile ignore the orientation, so other
+    // orientations are read at once as they always were
+    layout.wholeImage = orientation != ORIENTATION_TOPLEFT || layout.blockWidth == 0 || layout.blockHeight == 0;
+    if (layout.wholeImage) {
+        layout.blockWidth = layout.width;
+        layout.blockHeight = layout.height;
+    }
+
+    layouts.insert(dir, layout);
+    return layout;
+}
+
+QImage TIFFGenerator::Private::block(int dir, TiffLayout *layout, uint32 x, uint32 y)
+{
+    if (!setDirectory(dir))
+        return QImage();
+
+    const uint32 index = layout->wholeImage ? TIFF_WHOLE_IMAGE_BLOCK : layout->tiled ? TIFFComputeTile(tiff, x, y, 0, 0) : TIFFComputeStrip(tiff, y, 0);
+    const quint64 key = quint64(dir) << 32 | index;
+    if (const QImage *cached = blocks.object(key))
+        return *cached;
+
+    QImage image;
+    if (layout->wholeImage) {
+        uint16 orientation = ORIENTATION_TOPLEFT;
+        TIFFGetFieldDefaulted(tiff, TIFFTAG_ORIENTATION, &orientation);
+
+        image = QImage(layout->width, layout->height, QImage::Format_RGB32);
+        if (image.isNull())
+            return QImage();
+        uint32 *data = reinterpret_cast<uint32 *>(image.bits());
+        if (TIFFReadRGBAImageOriented(tiff, layout->width, layout->height, data, orientation) == 0)
+            return QImage();
+
+        const uint32 size = layout->width * layout->height;
+        for (uint32 i = 0; i < size; ++i)
+            data[i] = abgrToArgb(data[i]);
+    } else {
+        const uint32 width = qMin(layout->blockWidth, layout->width - x);
+        const uint32 height = qMin(layout->blockHeight, layout->height - y);
+
+        // the rasters are bottom to top; partial tiles are at the bottom of
+        // a whole tile raster, partial strips only have the rows read
+        QVector<uint32> raster(layout->blockWidth * layout->blockHeight);
+        const bool read = layout->tiled ? TIFFReadRGBATile(tiff, x, y, raster.data()) : TIFFReadRGBAStrip(tiff, y, raster.data());
+        if (!read) {
+            // e.g. the photometric interpretation is not supported in pieces
+            layout->wholeImage = true;
+            layout->blockWidth = layout->width;
+            layout->blockHeight = layout->height;
+            layouts.insert(dir, *layout);
+            return block(dir, layout, 0, 0);
+        }
+
+        const uint32 rasterRows = layout->tiled ? layout->blockHeight : height;
+        image = QImage(width, height, QImage::Format_RGB32);
+        for (uint32 row = 0; row < height; ++row) {
+            const uint32 *src = raster.constData() + (rasterRows - 1 - row) * layout->blockWidth;
+            uint32 *dst = reinterpret_cast<uint32 *>(image.scanLine(row));
+            for (uint32 col = 0; col < width; ++col)
+                dst[col] = abgrToArgb(src[col]);
+        }
+    }
+
+    // blocks larger than the whole cache are not kept by QCache
+    blocks.insert(key, new QImage(image), qMax(1, int(image.sizeInBytes() / 1024)));
+    return image;
+}
+
+QImage TIFFGenerator::Private::readRegion(int dir, const QRect &region, int factor)
+{
+    TiffLayout layout = this->layout(dir);
+    if (layout.width == 0 || layout.height == 0)
+        return QImage();
+
+    const int width = (region.width() + factor - 1) / factor;
+    const int height = (region.height() + factor - 1) / factor;
+    QImage result(width, height, QImage::Format_RGB32);
+    if (result.isNull())
+        return QImage();
+
+    // box filtered, so large images are never decoded whole at full resolution
+    QVector<quint32> sums;
+    if (factor > 1)
+        sums.fill(0, width * height * 3);
+
+    uint32 y = region.top() / layout.blockHeight * layout.blockHeight;
+    while (y <= uint32(region.bottom())) {
+        uint32 x = region.left() / layout.blockWidth * layout.blockWidth;
+        while (x <= uint32(region.right())) {
+            const QImage block = this->block(dir, &layout, x, y);
+            if (block.isNull())
+                return QImage();
+            if (layout.wholeImage && (x != 0 || y != 0)) {
+                // the layout changed, start over reading the whole image
+                return readRegion(dir, region, factor);
+            }
+
+            const QRect blockRegion = QRect(x, y, block.width(), block.height()) & region;
+            for (int row = blockRegion.top(); row <= blockRegion.bottom(); ++row) {
+                const QRgb *src = reinterpret_cast<const QRgb *>(block.constScanLine(row - y)) + (blockRegion.left() - x);
+                if (factor == 1) {
+                    QRgb *dst = reinterpret_cast<QRgb *>(result.scanLine(row - region.top())) + (blockRegion.left() - region.left());
+                    memcpy(dst, src, blockRegion.width() * sizeof(QRgb));
+                    continue;
+                }
+
+                quint32 *sum = sums.data() + ((row - region.top()) / factor * width + (blockRegion.left() - region.left()) / factor) * 3;
+                int column = (blockRegion.left() - region.left()) % factor;
+                for (int i = 0; i < blockRegion.width(); ++i) {
+                    sum[0] += qRed(src[i]);
+                    sum[1] += qGreen(src[i]);
+                    sum[2] += qBlue(src[i]);
+                    if (++column == factor) {
+                        column = 0;
+                        sum += 3;
+                    }
+                }
+            }
+
+            x += layout.blockWidth;
+        }
+        y += layout.blockHeight;
+    }
+
+    if (factor > 1) {
+        for (int row = 0; row < height; ++row) {
+            const int boxHeight = qMin(factor, region.height() - row * factor);
+            const quint32 *sum = sums.constData() + row * width * 3;
+            QRgb *dst = reinterpret_cast<QRgb *>(result.scanLine(row));
+            for (int col = 0; col < width; ++col, sum += 3) {
+                const quint32 count = boxHeight * qMin(factor, region.width() - col * factor);
+                dst[col] = qRgb(sum[0] / count, sum[1] / count, sum[2] / count);
+            }
+        }
+    }
+
+    return result;
+}
+
+QImage TIFFGenerator::Private::render(int dir, int targetWidth, int targetHeight, const QRect &rect)
+{
+    QMutexLocker locker(&mutex);
+
+    const TiffLayout layout = this->layout(dir);
+    if (layout.width == 0 || layout.height == 0 || targetWidth <= 0 || targetHeight <= 0 || rect.isEmpty())
+        return QImage();
+
+    // the pixels of the image under rect, reduced as much as possible
+    // without getting smaller than requested
+    const double xScale = double(layout.width) / targetWidth;
+    const double yScale = double(layout.height) / targetHeight;
+    const int factor = qBound(1, int(qMin(xScale, yScale)), 1024);
+
+    const int left = int(rect.left() * xScale) / factor * factor;
+    const int top = int(rect.top() * yScale) / factor * factor;
+    const int right = qMin<int>(layout.width, ceil((rect.right() + 1) * xScale));
+    const int bottom = qMin<int>(layout.height, ceil((rect.bottom() + 1) * yScale));
+    if (right <= left || bottom <= top)
+        return QImage();
+
+    const QRect region(left, top, right - left, bottom - top);
+    const QImage reduced = readRegion(dir, region, factor);
+    locker.unlock();
+
+    if (reduced.isNull())
+        return QImage();
+
+    // scale to the size of the region in the requested image, and cut out rect
+    const QRect scaledRegion = QRectF(left / xScale, top / yScale, region.width() / xScale, region.height() / yScale).toRect();
+    if (scaledRegion == rect)
+        return reduced.size() == rect.size() ? reduced : reduced.scaled(rect.size(), Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+
+    QImage result(rect.size(), QImage::Format_RGB32);
+    result.fill(qRgb(255, 255, 255));
+    QPainter p(&result);
+    p.drawImage(scaledRegion.topLeft() - rect.topLeft(), reduced.size() == scaledRegion.size() ? reduced : reduced.scaled(scaledRegion.size(), Qt::IgnoreAspectRatio, Qt::SmoothTransformation));
+    p.end();
+    return result;
+}
+
+void TIFFGenerator::Private::clear()
+{
+    QMutexLocker locker(&mutex);
+    layouts.clear();
+    blocks.clear();
+}
+
 static QDateTime convertTIFFDateTime(const char *tiffdate)
 {
     if (!tiffdate)
@@ -162,6 +443,7 @@ TIFFGenerator::TIFFGenerator(QObject *parent, const QVariantList &args)
     , d(new Private)
 {
     setFeature(Threaded);
+    setFeature(TiledRendering);
     setFeature(PrintNative);
     setFeature(PrintToFile);
     setFeature(ReadRawData);
@@ -219,6 +501,7 @@ bool TIFFGenerator::doCloseDocument()
         delete d->dev;
         d->dev = nullptr;
         d->data.clear();
+        d->clear();
         m_pageMapping.clear();
     }
 
@@ -227,45 +510,17 @@ bool TIFFGenerator::doCloseDocument()
 
 QImage TIFFGenerator::image(Okular::PixmapRequest *request)
 {
-    bool generated = false;
-    QImage img;
-
-    if (TIFFSetDirectory(d->tiff, mapPage(request->page()->number()))) {
-        int rotation = request->page()->rotation();
-        uint32 width = 1;
-        uint32 height = 1;
-        uint32 orientation = 0;
-        TIFFGetField(d->tiff, TIFFTAG_IMAGEWIDTH, &width);
-        TIFFGetField(d->tiff, TIFFTAG_IMAGELENGTH, &height);
-
-        if (!TIFFGetField(d->tiff, TIFFTAG_ORIENTATION, &orientation))
-            orientation = ORIENTATION_TOPLEFT;
-
-        QImage image(width, height, QImage::Format_RGB32);
-        uint32 *data = reinterpret_cast<uint32 *>(image.bits());
-
-        // read data
-        if (TIFFReadRGBAImageOriented(d->tiff, width, height, data, orientation) != 0) {
-            // an image read by ReadRGBAImage is ABGR, we need ARGB, so swap red and blue
-            uint32 size = width * height;
-            for (uint32 i = 0; i < size; ++i) {
-                uint32 red = (data[i] & 0x00FF0000) >> 16;
-                uint32 blue = (data[i] & 0x000000FF) << 16;
-                data[i] = (data[i] & 0xFF00FF00) + red + blue;
-            }
+    int reqwidth = request->width();
+    int reqheight = request->height();
+    if (request->page()->rotation() % 2 == 1)
+        qSwap(reqwidth, reqheight);
 
-            int reqwidth = request->width();
-            int reqheight = request->height();
-            if (rotation % 2 == 1)
-                qSwap(reqwidth, reqheight);
-            img = image.scaled(reqwidth, reqheight, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    // only the strips or tiles under the requested area are decoded
+    const QRect rect = request->isTile() ? request->normalizedRect().geometry(reqwidth, reqheight) : QRect(0, 0, reqwidth, reqheight);
+    QImage img = d->render(mapPage(request->page()->number()), reqwidth, reqheight, rect);
 
-            generated = true;
-        }
-    }
-
-    if (!generated) {
-        img = QImage(request->width(), request->height(), QImage::Format_RGB32);
+    if (img.isNull()) {
+        img = QImage(rect.size(), QImage::Format_RGB32);
         img.fill(qRgb(255, 255, 255));
     }
 
@@ -350,47 +605,39 @@ void TIFFGenerator::loadPages(QVector<Okular::Page *> &pagesVector)
 
 bool TIFFGenerator::print(QPrinter &printer)
 {
-    uint32 width = 0;
-    uint32 height = 0;
-
     QPainter p(&printer);
 
     QList<int> pageList = Okular::FilePrinter::pageList(printer, document()->pages(), document()->currentPage() + 1, document()->bookmarkedPageList());
 
-    for (int i = 0; i < pageList.count(); ++i) {
-        if (!TIFFSetDirectory(d->tiff, mapPage(pageList[i] - 1)))
-            continue;
+    const QSize targetSize = printer.pageRect().size();
 
-        if (TIFFGetField(d->tiff, TIFFTAG_IMAGEWIDTH, &width) != 1 || TIFFGetField(d->tiff, TIFFTAG_IMAGELENGTH, &height) != 1)
-            continue;
+    Okular::PrintPipeline pipeline([this, targetSize](int pageNumber) {
+        const int dir = mapPage(pageNumber - 1);
+        d->mutex.lock();
+        const TiffLayout layout = d->layout(dir);
+        d->mutex.unlock();
 
-        QImage image(width, height, QImage::Format_RGB32);
-        uint32 *data = reinterpret_cast<uint32 *>(image.bits());
+        QSize size(layout.width, layout.height);
+        if ((size.width() >= targetSize.width()) || (size.height() >= targetSize.height())) {
+            // fit to page
+            size = targetSize;
+        } // else draw small images at 100% (don't scale up)
 
-        // read data
-        if (TIFFReadRGBAImageOriented(d->tiff, width, height, data, ORIENTATION_TOPLEFT) != 0) {
-            // an image read by ReadRGBAImage is ABGR, we need ARGB, so swap red and blue
-            uint32 size = width * height;
-            for (uint32 j = 0; j < size; ++j) {
-                uint32 red = (data[j] & 0x00FF0000) >> 16;
-                uint32 blue = (data[j] & 0x000000FF) << 16;
-                data[j] = (data[j] & 0xFF00FF00) + red + blue;
-            }
-        }
+        return d->render(dir, size.width(), size.height(), QRect(QPoint(0, 0), size));
+    });
 
-        if (i != 0)
-            printer.newPage();
+    bool firstPage = true;
+    pipeline.run(pageList, [&](int, const QImage &image) {
+        if (image.isNull())
+            return true;
 
-        QSize targetSize = printer.pageRect().size();
+        if (!firstPage)
+            printer.newPage();
+        firstPage = false;
 
-        if ((image.width() < targetSize.width()) && (image.height() < targetSize.height())) {
-            // draw small images at 100% (don't scale up)
-            p.drawImage(0, 0, image);
-        } else {
-            // fit to page
-            p.drawImage(0, 0, image.scaled(targetSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation));
-        }
-    }
+        p.drawImage(0, 0, image);
+        return true;
+    });
 
     return true;
 }
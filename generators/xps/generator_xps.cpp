@@ -36,8 +36,13 @@
 #include <core/fileprinter.h>
 #include <core/page.h>
 
+#include <limits.h>
+
 OKULAR_EXPORT_PLUGIN(XpsGenerator, "libokularGenerator_xps.json")
 
+// the size of the caches until the document tells it, in KiB
+#define XPS_DEFAULT_CACHE_SIZE (64 * 1024)
+
 Q_DECLARE_METATYPE(QGradient *)
 Q_DECLARE_METATYPE(XpsPathFigure *)
 Q_DECLARE_METATYPE(XpsPathGeometry *)
@@ -691,10 +696,197 @@ static QString unicodeString(const QString &raw)
     return ret;
 }
 
+XpsDisplayList::XpsDisplayList()
+    : m_opacity(1.0)
+{
+}
+
+void XpsDisplayList::append(Operation operation, int index)
+{
+    Item item;
+    item.operation = operation;
+    item.index = index;
+    m_items.append(item);
+}
+
+void XpsDisplayList::save()
+{
+    m_savedOpacities.push(m_opacity);
+    append(Save, -1);
+}
+
+void XpsDisplayList::restore()
+{
+    if (!m_savedOpacities.isEmpty()) {
+        m_opacity = m_savedOpacities.pop();
+    }
+    append(Restore, -1);
+}
+
+void XpsDisplayList::setWorldTransform(const QTransform &matrix, bool combine)
+{
+    m_transforms.append(matrix);
+    append(combine ? CombineTransform : SetTransform, m_transforms.count() - 1);
+}
+
+void XpsDisplayList::setOpacity(qreal opacity)
+{
+    m_opacity = opacity;
+    m_opacities.append(opacity);
+    append(SetOpacity, m_opacities.count() - 1);
+}
+
+qreal XpsDisplayList::opacity() const
+{
+    return m_opacity;
+}
+
+void XpsDisplayList::setBrush(const QBrush &brush)
+{
+    m_brushes.append(brush);
+    append(SetBrush, m_brushes.count() - 1);
+}
+
+void XpsDisplayList::setPen(const QPen &pen)
+{
+    m_pens.append(pen);
+    append(SetPen, m_pens.count() - 1);
+}
+
+void XpsDisplayList::setClipPath(const QPainterPath &path)
+{
+    m_paths.append(path);
+    append(SetClipPath, m_paths.count() - 1);
+}
+
+void XpsDisplayList::setLayoutDirection(Qt::LayoutDirection direction)
+{
+    append(SetLayoutDirection, direction);
+}
+
+void XpsDisplayList::drawPath(const QPainterPath &path)
+{
+    m_paths.append(path);
+    append(DrawPath, m_paths.count() - 1);
+}
+
+void XpsDisplayList::drawGlyphRun(const XpsGlyphRun &run)
+{
+    m_glyphRuns.append(run);
+    append(DrawGlyphRun, m_glyphRuns.count() - 1);
+}
+
+void XpsDisplayList::replay(QPainter *painter) const
+{
+    // what SetTransform is relative to
+    const QTransform pageTransform = painter->worldTransform();
+
+    for (const Item &item : m_items) {
+        switch (item.operation) {
+        case Save:
+            painter->save();
+            break;
+        case Restore:
+            painter->restore();
+            break;
+        case SetTransform:
+            painter->setWorldTransform(m_transforms.at(item.index) * pageTransform);
+            break;
+        case CombineTransform:
+            painter->setWorldTransform(m_transforms.at(item.index), true);
+            break;
+        case SetOpacity:
+            painter->setOpacity(m_opacities.at(item.index));
+            break;
+        case SetBrush:
+            painter->setBrush(m_brushes.at(item.index));
+            break;
+        case SetPen:
+            painter->setPen(m_pens.at(item.index));
+            break;
+        case SetClipPath:
+            painter->setClipPath(m_paths.at(item.index));
+            break;
+        case SetLayoutDirection:
+            painter->setLayoutDirection(Qt::LayoutDirection(item.index));
+            break;
+        case DrawPath:
+            painter->drawPath(m_paths.at(item.index));
+            break;
+        case DrawGlyphRun: {
+            const XpsGlyphRun &run = m_glyphRuns.at(item.index);
+            if (!run.visible) {
+                break;
+            }
+            painter->setFont(run.font);
+            for (int i = 0; i < run.text.size(); ++i) {
+                painter->drawText(run.positions.at(i), QString(run.text.at(i)));
+            }
+            break;
+        }
+        }
+    }
+}
+
+void XpsDisplayList::extractText(Okular::TextPage *textPage, const QSizeF &pageSize) const
+{
+    // only the transforms matter for the position of the text
+    QTransform matrix;
+    QStack<QTransform> matrices;
+
+    for (const Item &item : m_items) {
+        switch (item.operation) {
+        case Save:
+            matrices.push(matrix);
+            break;
+        case Restore:
+            if (!matrices.isEmpty()) {
+                matrix = matrices.pop();
+            }
+            break;
+        case SetTransform:
+            matrix = m_transforms.at(item.index);
+            break;
+        case CombineTransform:
+            matrix = m_transforms.at(item.index) * matrix;
+            break;
+        case DrawGlyphRun: {
+            const XpsGlyphRun &run = m_glyphRuns.at(item.index);
+            const QFontMetricsF metrics(run.font);
+            for (int i = 0; i < run.text.size(); ++i) {
+                const QPointF &position = run.positions.at(i);
+                const qreal width = i + 1 < run.text.size() ? run.positions.at(i + 1).x() - position.x() : metrics.horizontalAdvance(run.text.at(i));
+                const QRectF rect = matrix.mapRect(QRectF(position.x(), position.y() - metrics.ascent(), width, metrics.height()).normalized());
+                textPage->append(run.text.mid(i, 1), new Okular::NormalizedRect(rect.left() / pageSize.width(), rect.top() / pageSize.height(), rect.right() / pageSize.width(), rect.bottom() / pageSize.height()));
+            }
+            break;
+        }
+        default:
+            break;
+        }
+    }
+}
+
+qint64 XpsDisplayList::memoryUsage() const
+{
+    qint64 bytes = m_items.count() * sizeof(Item) + m_transforms.count() * sizeof(QTransform) + m_opacities.count() * sizeof(qreal) + m_pens.count() * sizeof(QPen);
+    for (const QBrush &brush : m_brushes) {
+        // the image of an image brush, if any
+        bytes += sizeof(QBrush) + brush.textureImage().sizeInBytes();
+    }
+    for (const QPainterPath &path : m_paths) {
+        bytes += sizeof(QPainterPath) + path.elementCount() * sizeof(QPainterPath::Element);
+    }
+    for (const XpsGlyphRun &run : m_glyphRuns) {
+        bytes += sizeof(XpsGlyphRun) + run.text.size() * (sizeof(QChar) + sizeof(QPointF));
+    }
+    return bytes;
+}
+
 XpsHandler::XpsHandler(XpsPage *page)
     : m_page(page)
 {
-    m_painter = nullptr;
+    m_displayList = nullptr;
 }
 
 XpsHandler::~XpsHandler()
@@ -751,19 +943,23 @@ void XpsHandler::processGlyph(XpsRenderNode &node)
 
     QString att;
 
-    m_painter->save();
-
     // Get font (doesn't work well because qt doesn't allow to load font from file)
     // This works despite the fact that font size isn't specified in points as required by qt. It's because I set point size to be equal to drawing unit.
     float fontSize = node.attributes.value(QStringLiteral("FontRenderingEmSize")).toFloat();
     // qCWarning(OkularXpsDebug) << "Font Rendering EmSize:" << fontSize;
     // a value of 0.0 means the text is not visible (see XPS specs, chapter 12, "Glyphs")
     if (fontSize < 0.1) {
-        m_painter->restore();
         return;
     }
+
+    m_displayList->save();
+
     const QString absoluteFileName = absolutePath(entryPath(m_page->fileName()), node.attributes.value(QStringLiteral("FontUri")));
     QFont font = m_page->m_file->getFontByName(absoluteFileName, fontSize);
+    // one point is one drawing unit, on whatever device the page is replayed
+    if (font.pointSize() > 0) {
+        font.setPixelSize(font.pointSize());
+    }
     att = node.attributes.value(QStringLiteral("StyleSimulations"));
     if (!att.isEmpty()) {
         if (att == QLatin1String("ItalicSimulation")) {
@@ -775,11 +971,13 @@ void XpsHandler::processGlyph(XpsRenderNode &node)
             font.setBold(true);
         }
     }
-    m_painter->setFont(font);
 
     // Origin
     QPointF origin(node.attributes.value(QStringLiteral("OriginX")).toDouble(), node.attributes.value(QStringLiteral("OriginY")).toDouble());
 
+    // glyphs which are not shown still have text
+    bool visible = true;
+
     // Fill
     QBrush brush;
     att = node.attributes.value(QStringLiteral("Fill"));
@@ -790,56 +988,56 @@ void XpsHandler::processGlyph(XpsRenderNode &node)
         } else {
             // no "Fill" attribute and no "Glyphs.Fill" child, so show nothing
             // (see XPS specs, 5.10)
-            m_painter->restore();
-            return;
+            visible = false;
         }
     } else {
         brush = parseRscRefColorForBrush(att);
         if (brush.style() > Qt::NoBrush && brush.style() < Qt::LinearGradientPattern && brush.color().alpha() == 0) {
-            m_painter->restore();
-            return;
+            visible = false;
         }
     }
-    m_painter->setBrush(brush);
-    m_painter->setPen(QPen(brush, 0));
+    if (visible) {
+        m_displayList->setBrush(brush);
+        m_displayList->setPen(QPen(brush, 0));
+    }
 
     // Opacity
     att = node.attributes.value(QStringLiteral("Opacity"));
-    if (!att.isEmpty()) {
+    if (visible && !att.isEmpty()) {
         bool ok = true;
         double value = att.toDouble(&ok);
         if (ok && value >= 0.1) {
-            m_painter->setOpacity(value);
+            m_displayList->setOpacity(value);
         } else {
-            m_painter->restore();
-            return;
+            visible = false;
         }
     }
 
     // RenderTransform
     att = node.attributes.value(QStringLiteral("RenderTransform"));
     if (!att.isEmpty()) {
-        m_painter->setWorldTransform(parseRscRefMatrix(att), true);
+        m_displayList->setWorldTransform(parseRscRefMatrix(att), true);
     }
 
     // Clip
     att = node.attributes.value(QStringLiteral("Clip"));
-    if (!att.isEmpty()) {
+    if (visible && !att.isEmpty()) {
         QPainterPath clipPath = parseRscRefPath(att);
         if (!clipPath.isEmpty()) {
-            m_painter->setClipPath(clipPath);
+            m_displayList->setClipPath(clipPath);
         }
     }
 
     // BiDiLevel - default Left-to-Right
-    m_painter->setLayoutDirection(Qt::LeftToRight);
+    Qt::LayoutDirection direction = Qt::LeftToRight;
     att = node.attributes.value(QStringLiteral("BiDiLevel"));
     if (!att.isEmpty()) {
         if ((att.toInt() % 2) == 1) {
             // odd BiDiLevel, so Right-to-Left
-            m_painter->setLayoutDirection(Qt::RightToLeft);
+            direction = Qt::RightToLeft;
         }
     }
+    m_displayList->setLayoutDirection(direction);
 
     // Indices - partial handling only
     att = node.attributes.value(QStringLiteral("Indices"));
@@ -870,24 +1068,28 @@ void XpsHandler::processGlyph(XpsRenderNode &node)
     }
 
     // UnicodeString
-    QString stringToDraw(unicodeString(node.attributes.value(QStringLiteral("UnicodeString"))));
+    XpsGlyphRun run;
+    run.font = font;
+    run.text = unicodeString(node.attributes.value(QStringLiteral("UnicodeString")));
+    run.visible = visible;
+    run.positions.reserve(run.text.size());
     QPointF originAdvance(0, 0);
-    QFontMetrics metrics = m_painter->fontMetrics();
-    for (int i = 0; i < stringToDraw.size(); ++i) {
-        QChar thisChar = stringToDraw.at(i);
-        m_painter->drawText(origin + originAdvance, QString(thisChar));
+    QFontMetrics metrics(font);
+    for (int i = 0; i < run.text.size(); ++i) {
+        run.positions.append(origin + originAdvance);
         const qreal advanceWidth = advanceWidths.value(i, qreal(-1.0));
         if (advanceWidth > 0.0) {
             originAdvance.rx() += advanceWidth;
         } else {
-            originAdvance.rx() += metrics.horizontalAdvance(thisChar);
+            originAdvance.rx() += metrics.horizontalAdvance(run.text.at(i));
         }
     }
+    m_displayList->drawGlyphRun(run);
     // qCWarning(OkularXpsDebug) << "Glyphs: " << atts.value("Fill") << ", " << atts.value("FontUri");
     // qCWarning(OkularXpsDebug) << "    Origin: " << atts.value("OriginX") << "," << atts.value("OriginY");
     // qCWarning(OkularXpsDebug) << "    Unicode: " << atts.value("UnicodeString");
 
-    m_painter->restore();
+    m_displayList->restore();
 }
 
 void XpsHandler::processFill(XpsRenderNode &node)
@@ -954,7 +1156,7 @@ void XpsHandler::processPath(XpsRenderNode &node)
     // TODO Ignored attributes: Clip, OpacityMask, StrokeEndLineCap, StorkeStartLineCap, Name, FixedPage.NavigateURI, xml:lang, x:key, AutomationProperties.Name, AutomationProperties.HelpText, SnapsToDevicePixels
     // TODO Ignored child elements: RenderTransform, Clip, OpacityMask
     // Handled separately: RenderTransform
-    m_painter->save();
+    m_displayList->save();
 
     QString att;
     QVariant data;
@@ -970,7 +1172,7 @@ void XpsHandler::processPath(XpsRenderNode &node)
     }
     if (!pathdata) {
         // nothing to draw
-        m_painter->restore();
+        m_displayList->restore();
         return;
     }
 
@@ -985,7 +1187,7 @@ void XpsHandler::processPath(XpsRenderNode &node)
             brush = data.value<QBrush>();
         }
     }
-    m_painter->setBrush(brush);
+    m_displayList->setBrush(brush);
 
     // Stroke (pen)
     att = node.attributes.value(QStringLiteral("Stroke"));
@@ -1064,31 +1266,31 @@ void XpsHandler::processPath(XpsRenderNode &node)
             pen.setMiterLimit(limit / 2);
         }
     }
-    m_painter->setPen(pen);
+    m_displayList->setPen(pen);
 
     // Opacity
     att = node.attributes.value(QStringLiteral("Opacity"));
     if (!att.isEmpty()) {
-        m_painter->setOpacity(att.toDouble());
+        m_displayList->setOpacity(att.toDouble());
     }
 
     // RenderTransform
     att = node.attributes.value(QStringLiteral("RenderTransform"));
     if (!att.isEmpty()) {
-        m_painter->setWorldTransform(parseRscRefMatrix(att), true);
+        m_displayList->setWorldTransform(parseRscRefMatrix(att), true);
     }
     if (!pathdata->transform.isIdentity()) {
-        m_painter->setWorldTransform(pathdata->transform, true);
+        m_displayList->setWorldTransform(pathdata->transform, true);
     }
 
     for (const XpsPathFigure *figure : qAsConst(pathdata->paths)) {
-        m_painter->setBrush(figure->isFilled ? brush : QBrush());
-        m_painter->drawPath(figure->path);
+        m_displayList->setBrush(figure->isFilled ? brush : QBrush());
+        m_displayList->drawPath(figure->path);
     }
 
     delete pathdata;
 
-    m_painter->restore();
+    m_displayList->restore();
 }
 
 void XpsHandler::processPathData(XpsRenderNode &node)
@@ -1228,21 +1430,27 @@ void XpsHandler::processPathFigure(XpsRenderNode &node)
 
 void XpsHandler::processStartElement(XpsRenderNode &node)
 {
-    if (node.name == QLatin1String("Canvas")) {
-        m_painter->save();
+    if (node.name == QLatin1String("FixedPage")) {
+        // the page has the size its document told, which the content is fitted to
+        const QSizeF size(node.attributes.value(QStringLiteral("Width")).toDouble(), node.attributes.value(QStringLiteral("Height")).toDouble());
+        if (!size.isEmpty() && size != m_page->m_pageSize) {
+            m_displayList->setWorldTransform(QTransform::fromScale(m_page->m_pageSize.width() / size.width(), m_page->m_pageSize.height() / size.height()), true);
+        }
+    } else if (node.name == QLatin1String("Canvas")) {
+        m_displayList->save();
         QString att = node.attributes.value(QStringLiteral("RenderTransform"));
         if (!att.isEmpty()) {
-            m_painter->setWorldTransform(parseRscRefMatrix(att), true);
+            m_displayList->setWorldTransform(parseRscRefMatrix(att), true);
         }
         att = node.attributes.value(QStringLiteral("Opacity"));
         if (!att.isEmpty()) {
             double value = att.toDouble();
             if (value > 0.0 && value <= 1.0) {
-                m_painter->setOpacity(m_painter->opacity() * value);
+                m_displayList->setOpacity(m_displayList->opacity() * value);
             } else {
                 // setting manually to 0 is necessary to "disable"
                 // all the stuff inside
-                m_painter->setOpacity(0.0);
+                m_displayList->setOpacity(0.0);
             }
         }
     }
@@ -1260,10 +1468,10 @@ void XpsHandler::processEndElement(XpsRenderNode &node)
     } else if ((node.name == QLatin1String("Canvas.RenderTransform")) || (node.name == QLatin1String("Glyphs.RenderTransform")) || (node.name == QLatin1String("Path.RenderTransform"))) {
         QVariant data = node.getRequiredChildData(QStringLiteral("MatrixTransform"));
         if (data.canConvert<QTransform>()) {
-            m_painter->setWorldTransform(data.value<QTransform>(), true);
+            m_displayList->setWorldTransform(data.value<QTransform>(), true);
         }
     } else if (node.name == QLatin1String("Canvas")) {
-        m_painter->restore();
+        m_displayList->restore();
     } else if ((node.name == QLatin1String("Path.Fill")) || (node.name == QLatin1String("Glyphs.Fill"))) {
         processFill(node);
     } else if (node.name == QLatin1String("Path.Stroke")) {
@@ -1340,15 +1548,18 @@ void XpsHandler::processEndElement(XpsRenderNode &node)
     }
 }
 
-XpsPage::XpsPage(XpsFile *file, const QString &fileName)
+XpsPage::XpsPage(XpsFile *file, const QString &fileName, const QSizeF &pageSize)
     : m_file(file)
     , m_fileName(fileName)
-    , m_pageIsRendered(false)
+    , m_pageSize(pageSize)
 {
-    m_pageImage = nullptr;
-
     // qCWarning(OkularXpsDebug) << "page file name: " << fileName;
 
+    if (!m_pageSize.isEmpty()) {
+        // the page is read the first time it is rendered
+        return;
+    }
+
     const KZipFileEntry *pageFile = static_cast<const KZipFileEntry *>(m_file->xpsArchive()->directory()->entry(fileName));
 
     QXmlStreamReader xml;
@@ -1369,48 +1580,60 @@ XpsPage::XpsPage(XpsFile *file, const QString &fileName)
 
 XpsPage::~XpsPage()
 {
-    delete m_pageImage;
 }
 
 bool XpsPage::renderToImage(QImage *p)
 {
-    if ((m_pageImage == nullptr) || (m_pageImage->size() != p->size())) {
-        delete m_pageImage;
-        m_pageImage = new QImage(p->size(), QImage::Format_ARGB32);
-        // Set one point = one drawing unit. Useful for fonts, because xps specifies font size using drawing units, not points as usual
-        m_pageImage->setDotsPerMeterX(2835);
-        m_pageImage->setDotsPerMeterY(2835);
+    p->fill(qRgba(255, 255, 255, 255));
+    QPainter painter(p);
+    renderToPainter(&painter, p->size());
 
-        m_pageIsRendered = false;
-    }
-    if (!m_pageIsRendered) {
-        m_pageImage->fill(qRgba(255, 255, 255, 255));
-        QPainter painter(m_pageImage);
-        renderToPainter(&painter);
-        m_pageIsRendered = true;
-    }
+    return true;
+}
 
-    *p = *m_pageImage;
+bool XpsPage::renderToPainter(QPainter *painter)
+{
+    painter->setWorldTransform(QTransform());
+    renderToPainter(painter, QSizeF(painter->device()->width(), painter->device()->height()));
 
     return true;
 }
 
-bool XpsPage::renderToPainter(QPainter *painter)
+void XpsPage::renderToPainter(QPainter *painter, const QSizeF &size)
+{
+    const QSharedPointer<const XpsDisplayList> list = displayList();
+
+    painter->save();
+    painter->scale(size.width() / m_pageSize.width(), size.height() / m_pageSize.height());
+    list->replay(painter);
+    painter->restore();
+}
+
+QSharedPointer<const XpsDisplayList> XpsPage::displayList()
 {
+    QMutexLocker locker(&m_parseMutex);
+
+    QSharedPointer<const XpsDisplayList> cached = m_file->cachedDisplayList(m_fileName);
+    if (cached)
+        return cached;
+
+    XpsDisplayList *list = new XpsDisplayList();
+
     XpsHandler handler(this);
-    handler.m_painter = painter;
-    handler.m_painter->setWorldTransform(QTransform().scale((qreal)painter->device()->width() / size().width(), (qreal)painter->device()->height() / size().height()));
+    handler.m_displayList = list;
     QXmlSimpleReader parser;
     parser.setContentHandler(&handler);
     parser.setErrorHandler(&handler);
     const KZipFileEntry *pageFile = static_cast<const KZipFileEntry *>(m_file->xpsArchive()->directory()->entry(m_fileName));
-    QByteArray data = readFileOrDirectoryParts(pageFile);
+    QByteArray data = m_file->readPart(pageFile);
     QBuffer buffer(&data);
     QXmlInputSource source(&buffer);
     bool ok = parser.parse(source);
     qCWarning(OkularXpsDebug) << "Parse result: " << ok;
 
-    return true;
+    const QSharedPointer<const XpsDisplayList> parsed(list);
+    m_file->cacheDisplayList(m_fileName, parsed);
+    return parsed;
 }
 
 QSizeF XpsPage::size() const
@@ -1422,6 +1645,8 @@ QFont XpsFile::getFontByName(const QString &absoluteFileName, float size)
 {
     // qCWarning(OkularXpsDebug) << "trying to get font: " << fileName << ", size: " << size;
 
+    QMutexLocker locker(&m_fontMutex);
+
     int index = m_fontCache.value(absoluteFileName, -1);
     if (index == -1) {
         index = loadFontByName(absoluteFileName);
@@ -1456,7 +1681,7 @@ int XpsFile::loadFontByName(const QString &absoluteFileName)
         return -1;
     }
 
-    QByteArray fontData = readFileOrDirectoryParts(fontFile); // once per file, according to the docs
+    QByteArray fontData = readPart(fontFile); // once per file, according to the docs
 
     int result = m_fontDatabase.addApplicationFontFromData(fontData);
     if (-1 == result) {
@@ -1493,18 +1718,47 @@ KZip *XpsFile::xpsArchive()
     return m_xpsArchive;
 }
 
-QImage XpsPage::loadImageFromFile(const QString &fileName)
+QByteArray XpsFile::readPart(const KArchiveEntry *entry) const
 {
-    // qCWarning(OkularXpsDebug) << "image file name: " << fileName;
+    // the entries share the device of the archive
+    QMutexLocker locker(&m_archiveMutex);
+    return readFileOrDirectoryParts(entry);
+}
 
-    if (fileName.at(0) == QLatin1Char('{')) {
-        // for example: '{ColorConvertedBitmap /Resources/bla.wdp /Resources/foobar.icc}'
-        // TODO: properly read a ColorConvertedBitmap
-        return QImage();
+QSharedPointer<const XpsDisplayList> XpsFile::cachedDisplayList(const QString &pageFileName)
+{
+    QMutexLocker locker(&m_cacheMutex);
+    const QSharedPointer<const XpsDisplayList> *cached = m_displayListCache.object(pageFileName);
+    return cached ? *cached : QSharedPointer<const XpsDisplayList>();
+}
+
+void XpsFile::cacheDisplayList(const QString &pageFileName, const QSharedPointer<const XpsDisplayList> &list)
+{
+    const int cost = qMax(1, int(list->memoryUsage() / 1024));
+    QMutexLocker locker(&m_cacheMutex);
+    m_displayListCache.insert(pageFileName, new QSharedPointer<const XpsDisplayList>(list), cost);
+}
+
+void XpsFile::setCacheSize(qulonglong bytes)
+{
+    // half for the display lists, which hold the images they draw, and half
+    // for the images, so pages sharing them do not decode them again
+    const int cost = int(qMin<qulonglong>(bytes / 2 / 1024, INT_MAX));
+    QMutexLocker locker(&m_cacheMutex);
+    m_displayListCache.setMaxCost(cost);
+    m_imageCache.setMaxCost(cost);
+}
+
+QImage XpsFile::loadImage(const QString &absoluteFileName)
+{
+    {
+        QMutexLocker locker(&m_cacheMutex);
+        if (const QImage *cached = m_imageCache.object(absoluteFileName)) {
+            return *cached;
+        }
     }
 
-    QString absoluteFileName = absolutePath(entryPath(m_fileName), fileName);
-    const KZipFileEntry *imageFile = loadFile(m_file->xpsArchive(), absoluteFileName, Qt::CaseInsensitive);
+    const KZipFileEntry *imageFile = loadFile(m_xpsArchive, absoluteFileName, Qt::CaseInsensitive);
     if (!imageFile) {
         // image not found
         return QImage();
@@ -1514,124 +1768,66 @@ QImage XpsPage::loadImageFromFile(const QString &fileName)
         XPS standard requires to use 96dpi for images which doesn't have dpi specified (in file). When Qt loads such an image,
         it sets its dpi to qt_defaultDpi and doesn't allow to find out that it happend.
 
-        To workaround this I used this procedure: load image, set its dpi to 96, load image again. When dpi isn't set in file,
-        dpi set by me stays unchanged.
+        Qt keeps the dpi of the image it reads into when that image already has the size and format of the file,
+        so the image is allocated with 96dpi before reading it. When the header doesn't tell the size or format,
+        the image is loaded, its dpi set to 96, and loaded again.
 
         Trolltech task ID: 159527.
 
     */
 
     QImage image;
-    QByteArray data = imageFile->data();
+    QByteArray data = readPart(imageFile);
 
     QBuffer buffer(&data);
     buffer.open(QBuffer::ReadOnly);
 
     QImageReader reader(&buffer);
-    image = reader.read();
+    const QSize size = reader.size();
+    const QImage::Format format = reader.imageFormat();
+    const bool decodeTwice = !size.isValid() || format == QImage::Format_Invalid;
+    if (decodeTwice) {
+        image = reader.read();
+    } else {
+        image = QImage(size, format);
+    }
 
     image.setDotsPerMeterX(qRound(96 / 0.0254));
     image.setDotsPerMeterY(qRound(96 / 0.0254));
 
-    buffer.seek(0);
-    reader.setDevice(&buffer);
+    if (decodeTwice) {
+        buffer.seek(0);
+        reader.setDevice(&buffer);
+    }
     reader.read(&image);
 
+    if (!image.isNull()) {
+        QMutexLocker locker(&m_cacheMutex);
+        m_imageCache.insert(absoluteFileName, new QImage(image), qMax(1, int(image.sizeInBytes() / 1024)));
+    }
     return image;
 }
 
-Okular::TextPage *XpsPage::textPage()
+QImage XpsPage::loadImageFromFile(const QString &fileName)
 {
-    // qCWarning(OkularXpsDebug) << "Parsing XpsPage, text extraction";
-
-    Okular::TextPage *textPage = new Okular::TextPage();
-
-    const KZipFileEntry *pageFile = static_cast<const KZipFileEntry *>(m_file->xpsArchive()->directory()->entry(m_fileName));
-    QXmlStreamReader xml;
-    xml.addData(readFileOrDirectoryParts(pageFile));
-
-    QTransform matrix = QTransform();
-    QStack<QTransform> matrices;
-    matrices.push(QTransform());
-    bool useMatrix = false;
-    QXmlStreamAttributes glyphsAtts;
-
-    while (!xml.atEnd()) {
-        xml.readNext();
-        if (xml.isStartElement()) {
-            if (xml.name() == QStringLiteral("Canvas")) {
-                matrices.push(matrix);
-
-                QString att = xml.attributes().value(QStringLiteral("RenderTransform")).toString();
-                if (!att.isEmpty()) {
-                    matrix = parseRscRefMatrix(att) * matrix;
-                }
-            } else if ((xml.name() == QStringLiteral("Canvas.RenderTransform")) || (xml.name() == QStringLiteral("Glyphs.RenderTransform"))) {
-                useMatrix = true;
-            } else if (xml.name() == QStringLiteral("MatrixTransform")) {
-                if (useMatrix) {
-                    matrix = attsToMatrix(xml.attributes().value(QStringLiteral("Matrix")).toString()) * matrix;
-                }
-            } else if (xml.name() == QStringLiteral("Glyphs")) {
-                matrices.push(matrix);
-                glyphsAtts = xml.attributes();
-            } else if ((xml.name() == QStringLiteral("Path")) || (xml.name() == QStringLiteral("Path.Fill")) || (xml.name() == QStringLiteral("SolidColorBrush")) || (xml.name() == QStringLiteral("ImageBrush")) ||
-                       (xml.name() == QStringLiteral("ImageBrush.Transform")) || (xml.name() == QStringLiteral("Path.OpacityMask")) || (xml.name() == QStringLiteral("Path.Data")) || (xml.name() == QStringLiteral("PathGeometry")) ||
-                       (xml.name() == QStringLiteral("PathFigure")) || (xml.name() == QStringLiteral("PolyLineSegment"))) {
-                // those are only graphical - no use in text handling
-            } else if ((xml.name() == QStringLiteral("FixedPage")) || (xml.name() == QStringLiteral("FixedPage.Resources"))) {
-                // not useful for text extraction
-            } else {
-                qCWarning(OkularXpsDebug) << "Unhandled element in Text Extraction start: " << xml.name().toString();
-            }
-        } else if (xml.isEndElement()) {
-            if (xml.name() == QStringLiteral("Canvas")) {
-                matrix = matrices.pop();
-            } else if ((xml.name() == QStringLiteral("Canvas.RenderTransform")) || (xml.name() == QStringLiteral("Glyphs.RenderTransform"))) {
-                useMatrix = false;
-            } else if (xml.name() == QStringLiteral("MatrixTransform")) {
-                // not clear if we need to do anything here yet.
-            } else if (xml.name() == QStringLiteral("Glyphs")) {
-                QString att = glyphsAtts.value(QStringLiteral("RenderTransform")).toString();
-                if (!att.isEmpty()) {
-                    matrix = parseRscRefMatrix(att) * matrix;
-                }
-                QString text = unicodeString(glyphsAtts.value(QStringLiteral("UnicodeString")).toString());
-
-                // Get font (doesn't work well because qt doesn't allow to load font from file)
-                const QString absoluteFileName = absolutePath(entryPath(m_fileName), glyphsAtts.value(QStringLiteral("FontUri")).toString());
-                QFont font = m_file->getFontByName(absoluteFileName, glyphsAtts.value(QStringLiteral("FontRenderingEmSize")).toString().toFloat() * 72 / 96);
-                QFontMetrics metrics = QFontMetrics(font);
-                // Origin
-                QPointF origin(glyphsAtts.value(QStringLiteral("OriginX")).toString().toDouble(), glyphsAtts.value(QStringLiteral("OriginY")).toString().toDouble());
+    // qCWarning(OkularXpsDebug) << "image file name: " << fileName;
 
-                int lastWidth = 0;
-                for (int i = 0; i < text.length(); i++) {
-                    const int width = metrics.horizontalAdvance(text, i + 1);
+    if (fileName.at(0) == QLatin1Char('{')) {
+        // for example: '{ColorConvertedBitmap /Resources/bla.wdp /Resources/foobar.icc}'
+        // TODO: properly read a ColorConvertedBitmap
+        return QImage();
+    }
 
-                    Okular::NormalizedRect *rect =
-                        new Okular::NormalizedRect((origin.x() + lastWidth) / m_pageSize.width(), (origin.y() - metrics.height()) / m_pageSize.height(), (origin.x() + width) / m_pageSize.width(), origin.y() / m_pageSize.height());
-                    rect->transform(matrix);
-                    textPage->append(text.mid(i, 1), rect);
+    return m_file->loadImage(absolutePath(entryPath(m_fileName), fileName));
+}
 
-                    lastWidth = width;
-                }
+Okular::TextPage *XpsPage::textPage()
+{
+    // qCWarning(OkularXpsDebug) << "Parsing XpsPage, text extraction";
 
-                matrix = matrices.pop();
-            } else if ((xml.name() == QStringLiteral("Path")) || (xml.name() == QStringLiteral("Path.Fill")) || (xml.name() == QStringLiteral("SolidColorBrush")) || (xml.name() == QStringLiteral("ImageBrush")) ||
-                       (xml.name() == QStringLiteral("ImageBrush.Transform")) || (xml.name() == QStringLiteral("Path.OpacityMask")) || (xml.name() == QStringLiteral("Path.Data")) || (xml.name() == QStringLiteral("PathGeometry")) ||
-                       (xml.name() == QStringLiteral("PathFigure")) || (xml.name() == QStringLiteral("PolyLineSegment"))) {
-                // those are only graphical - no use in text handling
-            } else if ((xml.name() == QStringLiteral("FixedPage")) || (xml.name() == QStringLiteral("FixedPage.Resources"))) {
-                // not useful for text extraction
-            } else {
-                qCWarning(OkularXpsDebug) << "Unhandled element in Text Extraction end: " << xml.name().toString();
-            }
-        }
-    }
-    if (xml.error()) {
-        qCWarning(OkularXpsDebug) << "Error parsing XpsPage text: " << xml.errorString();
-    }
+    Okular::TextPage *textPage = new Okular::TextPage();
+    const QSharedPointer<const XpsDisplayList> list = displayList();
+    list->extractText(textPage, m_pageSize);
     return textPage;
 }
 
@@ -1641,9 +1837,13 @@ void XpsDocument::parseDocumentStructure(const QString &documentStructureFileNam
     m_haveDocumentStructure = false;
 
     const KZipFileEntry *documentStructureFile = static_cast<const KZipFileEntry *>(m_file->xpsArchive()->directory()->entry(documentStructureFileName));
+    if (!documentStructureFile) {
+        qCWarning(OkularXpsDebug) << "Could not open document structure file" << documentStructureFileName;
+        return;
+    }
 
     QXmlStreamReader xml;
-    xml.addData(documentStructureFile->data());
+    xml.addData(m_file->readPart(documentStructureFile));
 
     while (!xml.atEnd()) {
         xml.readNext();
@@ -1702,11 +1902,16 @@ void XpsDocument::parseDocumentStructure(const QString &documentStructureFileNam
 
 const Okular::DocumentSynopsis *XpsDocument::documentStructure()
 {
+    if (!m_documentStructureFileName.isEmpty()) {
+        parseDocumentStructure(m_documentStructureFileName);
+        m_documentStructureFileName.clear();
+    }
     return m_docStructure;
 }
 
 bool XpsDocument::hasDocumentStructure()
 {
+    documentStructure();
     return m_haveDocumentStructure;
 }
 
@@ -1727,9 +1932,12 @@ XpsDocument::XpsDocument(XpsFile *file, const QString &fileName)
         docXml.readNext();
         if (docXml.isStartElement()) {
             if (docXml.name() == QStringLiteral("PageContent")) {
-                QString pagePath = docXml.attributes().value(QStringLiteral("Source")).toString();
+                const QXmlStreamAttributes attributes = docXml.attributes();
+                QString pagePath = attributes.value(QStringLiteral("Source")).toString();
                 qCWarning(OkularXpsDebug) << "Page Path: " << pagePath;
-                XpsPage *page = new XpsPage(file, absolutePath(documentFilePath, pagePath));
+                // with the size of the page here, the page itself is not read when opening
+                const QSizeF pageSize(attributes.value(QStringLiteral("Width")).toString().toDouble(), attributes.value(QStringLiteral("Height")).toString().toDouble());
+                XpsPage *page = new XpsPage(file, absolutePath(documentFilePath, pagePath), pageSize);
                 m_pages.append(page);
             } else if (docXml.name() == QStringLiteral("PageContent.LinkTargets")) {
                 // do nothing - wait for the real LinkTarget elements
@@ -1786,7 +1994,8 @@ XpsDocument::XpsDocument(XpsFile *file, const QString &fileName)
         // make the document path absolute
         documentStructureFile = absolutePath(documentEntryPath, documentStructureFile);
         // qCWarning(OkularXpsDebug) << "Document structure absolute path: " << documentStructureFile;
-        parseDocumentStructure(documentStructureFile);
+        // parsed when the outline is asked for
+        m_documentStructureFileName = documentStructureFile;
     }
 }
 
@@ -1810,6 +2019,8 @@ XpsPage *XpsDocument::page(int pageNum) const
 }
 
 XpsFile::XpsFile()
+    : m_imageCache(XPS_DEFAULT_CACHE_SIZE)
+    , m_displayListCache(XPS_DEFAULT_CACHE_SIZE)
 {
 }
 
@@ -1920,7 +2131,7 @@ Okular::DocumentInfo XpsFile::generateDocumentInfo() const
         const KZipFileEntry *corepropsFile = static_cast<const KZipFileEntry *>(m_xpsArchive->directory()->entry(m_corePropertiesFileName));
 
         QXmlStreamReader xml;
-        xml.addData(corepropsFile->data());
+        xml.addData(readPart(corepropsFile));
         while (!xml.atEnd()) {
             xml.readNext();
             if (xml.isEndElement())
@@ -1965,6 +2176,8 @@ bool XpsFile::closeDocument()
 {
     qDeleteAll(m_documents);
     m_documents.clear();
+    m_imageCache.clear();
+    m_displayListCache.clear();
 
     delete m_xpsArchive;
 
@@ -1999,6 +2212,8 @@ XpsGenerator::XpsGenerator(QObject *parent, const QVariantList &args)
     setFeature(PrintNative);
     setFeature(PrintToFile);
     setFeature(Threaded);
+    setFeature(TiledRendering);
+    setFeature(ParallelRendering);
     userMutex();
 }
 
@@ -2038,17 +2253,24 @@ bool XpsGenerator::doCloseDocument()
 
 QImage XpsGenerator::image(Okular::PixmapRequest *request)
 {
-    QMutexLocker lock(userMutex());
+    // pages are rendered from their cached display lists, which are kept as
+    // long as the memory level allows, so no rendered image is kept here
+    m_xpsFile->setCacheSize(documentMetaData(ImageCacheSizeMetaData).toULongLong());
+
     QSize size((int)request->width(), (int)request->height());
-    QImage image(size, QImage::Format_RGB32);
     XpsPage *pageToRender = m_xpsFile->page(request->page()->number());
-    pageToRender->renderToImage(&image);
+
+    const QRect rect = request->isTile() ? request->normalizedRect().geometry(size.width(), size.height()) : QRect(QPoint(0, 0), size);
+    QImage image(rect.size(), QImage::Format_RGB32);
+    image.fill(qRgb(255, 255, 255));
+    QPainter painter(&image);
+    painter.translate(-rect.topLeft());
+    pageToRender->renderToPainter(&painter, size);
     return image;
 }
 
 Okular::TextPage *XpsGenerator::textPage(Okular::TextRequest *request)
 {
-    QMutexLocker lock(userMutex());
     XpsPage *xpsPage = m_xpsFile->page(request->page()->number());
     return xpsPage->textPage();
 }
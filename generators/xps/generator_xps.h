@@ -23,11 +23,16 @@
 #include <core/generator.h>
 #include <core/textpage.h>
 
+#include <QCache>
 #include <QColor>
 #include <QDomDocument>
 #include <QFontDatabase>
 #include <QImage>
 #include <QLoggingCategory>
+#include <QMutex>
+#include <QPainterPath>
+#include <QPen>
+#include <QSharedPointer>
 #include <QStack>
 #include <QVariant>
 #include <QXmlDefaultHandler>
@@ -110,6 +115,80 @@ struct XpsPathGeometry {
     XpsMatrixTransform transform;
 };
 
+/**
+    Characters drawn with the same font, each one at its own position
+*/
+struct XpsGlyphRun {
+    QFont font;
+    QString text;
+    QVector<QPointF> positions;
+    // invisible glyphs are not drawn, but still have text
+    bool visible;
+};
+
+/**
+    The drawing operations of a page, recorded once while its XML is parsed.
+
+    Replaying them renders the page at any size, or extracts its text.
+    Recording mirrors the QPainter calls XpsHandler used to make.
+*/
+class XpsDisplayList
+{
+public:
+    XpsDisplayList();
+
+    void save();
+    void restore();
+    void setWorldTransform(const QTransform &matrix, bool combine = false);
+    void setOpacity(qreal opacity);
+    qreal opacity() const;
+    void setBrush(const QBrush &brush);
+    void setPen(const QPen &pen);
+    void setClipPath(const QPainterPath &path);
+    void setLayoutDirection(Qt::LayoutDirection direction);
+    void drawPath(const QPainterPath &path);
+    void drawGlyphRun(const XpsGlyphRun &run);
+
+    /**
+       Draws the recorded operations on @p painter, in the coordinates of
+       the page as transformed by the current world transform of @p painter.
+    */
+    void replay(QPainter *painter) const;
+
+    /**
+       Appends the characters of the glyph runs to @p textPage, normalized to @p pageSize.
+    */
+    void extractText(Okular::TextPage *textPage, const QSizeF &pageSize) const;
+
+    /**
+       An estimate of the bytes used by the recorded operations, images included
+    */
+    qint64 memoryUsage() const;
+
+private:
+    enum Operation { Save, Restore, SetTransform, CombineTransform, SetOpacity, SetBrush, SetPen, SetClipPath, SetLayoutDirection, DrawPath, DrawGlyphRun };
+
+    struct Item {
+        Operation operation;
+        // the index of the argument in the vector of its type
+        int index;
+    };
+
+    void append(Operation operation, int index);
+
+    QVector<Item> m_items;
+    QVector<QTransform> m_transforms;
+    QVector<qreal> m_opacities;
+    QVector<QBrush> m_brushes;
+    QVector<QPen> m_pens;
+    QVector<QPainterPath> m_paths;
+    QVector<XpsGlyphRun> m_glyphRuns;
+
+    // the opacity while recording, saved and restored like the one of QPainter
+    qreal m_opacity;
+    QStack<qreal> m_savedOpacities;
+};
+
 class XpsPage;
 class XpsFile;
 
@@ -139,9 +218,7 @@ protected:
     void processPathGeometry(XpsRenderNode &node);
     void processPathFigure(XpsRenderNode &node);
 
-    QPainter *m_painter;
-
-    QImage m_image;
+    XpsDisplayList *m_displayList;
 
     QStack<XpsRenderNode> m_nodes;
 
@@ -151,7 +228,10 @@ protected:
 class XpsPage
 {
 public:
-    XpsPage(XpsFile *file, const QString &fileName);
+    /**
+       The page is only read here when @p pageSize is empty.
+    */
+    XpsPage(XpsFile *file, const QString &fileName, const QSizeF &pageSize = QSizeF());
     ~XpsPage();
 
     XpsPage(const XpsPage &) = delete;
@@ -160,6 +240,11 @@ public:
     QSizeF size() const;
     bool renderToImage(QImage *p);
     bool renderToPainter(QPainter *painter);
+
+    /**
+       Renders the page scaled to @p size, in the coordinates of @p painter.
+    */
+    void renderToPainter(QPainter *painter, const QSizeF &size);
     Okular::TextPage *textPage();
 
     QImage loadImageFromFile(const QString &filename);
@@ -169,19 +254,24 @@ public:
     }
 
 private:
+    /**
+       The drawing operations of the page, parsed unless the file still has them cached
+    */
+    QSharedPointer<const XpsDisplayList> displayList();
+
     XpsFile *m_file;
     const QString m_fileName;
 
     QSizeF m_pageSize;
 
+    // so a page is parsed by only one thread at a time
+    QMutex m_parseMutex;
+
     QString m_thumbnailFileName;
     bool m_thumbnailMightBeAvailable;
     QImage m_thumbnail;
     bool m_thumbnailIsLoaded;
 
-    QImage *m_pageImage;
-    bool m_pageIsRendered;
-
     friend class XpsHandler;
     friend class XpsTextExtractionHandler;
 };
@@ -228,6 +318,8 @@ private:
 
     QList<XpsPage *> m_pages;
     XpsFile *m_file;
+    // the document structure not parsed yet, if any
+    QString m_documentStructureFileName;
     bool m_haveDocumentStructure;
     Okular::DocumentSynopsis *m_docStructure;
     QMap<QString, int> m_docStructurePageMap;
@@ -286,6 +378,27 @@ public:
 
     QFont getFontByName(const QString &absoluteFileName, float size);
 
+    /**
+       The image @p absoluteFileName, decoded once for all the pages using it
+    */
+    QImage loadImage(const QString &absoluteFileName);
+
+    /**
+       The content of the part @p entry of the archive
+    */
+    QByteArray readPart(const KArchiveEntry *entry) const;
+
+    /**
+       The display list of the page @p pageFileName, if it is still cached
+    */
+    QSharedPointer<const XpsDisplayList> cachedDisplayList(const QString &pageFileName);
+    void cacheDisplayList(const QString &pageFileName, const QSharedPointer<const XpsDisplayList> &list);
+
+    /**
+       Sets how many bytes the decoded images and the display lists of the pages may use
+    */
+    void setCacheSize(qulonglong bytes);
+
     KZip *xpsArchive();
 
 private:
@@ -307,6 +420,16 @@ private:
 
     QMap<QString, int> m_fontCache;
     QFontDatabase m_fontDatabase;
+
+    // decoded images by file name, the cost is in KiB
+    QCache<QString, QImage> m_imageCache;
+    // display lists by page file name, the cost is in KiB
+    QCache<QString, QSharedPointer<const XpsDisplayList>> m_displayListCache;
+
+    // pages are rendered by several threads, which share these
+    mutable QMutex m_archiveMutex;
+    QMutex m_fontMutex;
+    QMutex m_cacheMutex;
 };
 
 class XpsGenerator : public Okular::Generator
@@ -0,0 +1,468 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by the Okular developers                           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include "colortransforms.h"
+
+#include <QVector>
+
+#include <stdint.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define OKULAR_COLORTRANSFORMS_SSE2
+#endif
+
+static void convertToPremultiplied(QImage *image)
+{
+    if (image->format() != QImage::Format_ARGB32_Premultiplied)
+        *image = image->convertToFormat(QImage::Format_ARGB32_Premultiplied);
+}
+
+#ifdef OKULAR_COLORTRANSFORMS_SSE2
+static inline __m128i loadPixels(const QRgb *data)
+{
+    return _mm_loadu_si128(reinterpret_cast<const __m128i *>(data));
+}
+
+static inline void storePixels(QRgb *data, __m128i pixels)
+{
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(data), pixels);
+}
+
+// the red, green or blue channel of four pixels, shifted to the low byte of each 32 bit lane
+static inline __m128i channel(__m128i pixels, int shift)
+{
+    return _mm_and_si128(_mm_srli_epi32(pixels, shift), _mm_set1_epi32(0xff));
+}
+
+// qGray() of four pixels
+static inline __m128i gray(__m128i pixels)
+{
+    // the products fit in the low 16 bits of each lane, whose high 16 bits are zero
+    __m128i sum = _mm_mullo_epi16(channel(pixels, 16), _mm_set1_epi32(11));
+    sum = _mm_add_epi32(sum, _mm_slli_epi32(channel(pixels, 8), 4));
+    sum = _mm_add_epi32(sum, _mm_mullo_epi16(channel(pixels, 0), _mm_set1_epi32(5)));
+    return _mm_srli_epi32(sum, 5);
+}
+#endif
+
+// replaces the color of each pixel with the one in table for its qGray() value, keeping its alpha
+static void applyGrayTable(QRgb *data, int pixels, const QRgb *table)
+{
+    int i = 0;
+#ifdef OKULAR_COLORTRANSFORMS_SSE2
+    alignas(16) quint32 grays[4];
+    for (; i + 4 <= pixels; i += 4) {
+        _mm_store_si128(reinterpret_cast<__m128i *>(grays), gray(loadPixels(data + i)));
+        for (int j = 0; j < 4; ++j)
+            data[i + j] = table[grays[j]] | (data[i + j] & 0xff000000);
+    }
+#endif
+    for (; i < pixels; ++i)
+        data[i] = table[qGray(data[i])] | (data[i] & 0xff000000);
+}
+
+void ColorTransforms::recolor(QImage *image, const QColor &foreground, const QColor &background, Implementation implementation)
+{
+    convertToPremultiplied(image);
+
+    const float scaleRed = background.redF() - foreground.redF();
+    const float scaleGreen = background.greenF() - foreground.greenF();
+    const float scaleBlue = background.blueF() - foreground.blueF();
+
+    const int foreground_red = foreground.red();
+    const int foreground_green = foreground.green();
+    const int foreground_blue = foreground.blue();
+
+    QRgb *data = reinterpret_cast<QRgb *>(image->bits());
+    const int pixels = image->width() * image->height();
+
+    if (implementation == Reference) {
+        for (int i = 0; i < pixels; ++i) {
+            const int lightness = qGray(data[i]);
+
+            const float r = scaleRed * lightness + foreground_red;
+            const float g = scaleGreen * lightness + foreground_green;
+            const float b = scaleBlue * lightness + foreground_blue;
+
+            const unsigned a = qAlpha(data[i]);
+            data[i] = qRgba(r, g, b, a);
+        }
+        return;
+    }
+
+    // the new color only depends on the lightness
+    QRgb table[256];
+    for (int lightness = 0; lightness < 256; ++lightness) {
+        const float r = scaleRed * lightness + foreground_red;
+        const float g = scaleGreen * lightness + foreground_green;
+        const float b = scaleBlue * lightness + foreground_blue;
+        table[lightness] = qRgba(r, g, b, 0);
+    }
+    applyGrayTable(data, pixels, table);
+}
+
+void ColorTransforms::blackWhite(QImage *image, int contrast, int threshold, Implementation implementation)
+{
+    convertToPremultiplied(image);
+
+    unsigned int *data = reinterpret_cast<unsigned int *>(image->bits());
+    int con = contrast;
+    int thr = 255 - threshold;
+
+    auto transform = [con, thr](int val) {
+        // Piecewise linear function of val, through (0, 0), (thr, 128), (255, 255)
+        if (val > thr)
+            val = 128 + (127 * (val - thr)) / (255 - thr);
+        else if (val < thr)
+            val = (128 * val) / thr;
+
+        // Linear contrast stretching through (thr, thr)
+        if (con > 2) {
+            val = thr + (val - thr) * con / 2;
+            val = qBound(0, val, 255);
+        }
+        return val;
+    };
+
+    int pixels = image->width() * image->height();
+
+    if (implementation == Reference) {
+        for (int i = 0; i < pixels; ++i) {
+            const int val = transform(qGray(data[i]));
+            const unsigned a = qAlpha(data[i]);
+            data[i] = qRgba(val, val, val, a);
+        }
+        return;
+    }
+
+    // the new gray only depends on the old one, so no division is left per pixel
+    QRgb table[256];
+    for (int val = 0; val < 256; ++val) {
+        const int newVal = transform(val);
+        table[val] = qRgba(newVal, newVal, newVal, 0);
+    }
+    applyGrayTable(data, pixels, table);
+}
+
+void ColorTransforms::invertLightness(QImage *image, Implementation implementation)
+{
+    convertToPremultiplied(image);
+
+    QRgb *data = reinterpret_cast<QRgb *>(image->bits());
+    int pixels = image->width() * image->height();
+    int i = 0;
+
+#ifdef OKULAR_COLORTRANSFORMS_SSE2
+    if (implementation == Optimized) {
+        // Adding m' - m to each component below is adding 255 - max - min,
+        // which never leaves the 0..255 range of the components.
+        const __m128i alphaMask = _mm_set1_epi32(0xff000000);
+        const __m128i full = _mm_set1_epi32(255);
+        for (; i + 4 <= pixels; i += 4) {
+            const __m128i p = loadPixels(data + i);
+            const __m128i r = channel(p, 16);
+            const __m128i g = channel(p, 8);
+            const __m128i b = channel(p, 0);
+
+            // the components are positive 16 bit values
+            const __m128i max = _mm_max_epi16(r, _mm_max_epi16(g, b));
+            const __m128i min = _mm_min_epi16(r, _mm_min_epi16(g, b));
+            const __m128i offset = _mm_sub_epi32(_mm_sub_epi32(full, max), min);
+
+            __m128i result = _mm_and_si128(p, alphaMask);
+            result = _mm_or_si128(result, _mm_slli_epi32(_mm_add_epi32(r, offset), 16));
+            result = _mm_or_si128(result, _mm_slli_epi32(_mm_add_epi32(g, offset), 8));
+            result = _mm_or_si128(result, _mm_add_epi32(b, offset));
+            storePixels(data + i, result);
+        }
+    }
+#else
+    Q_UNUSED(implementation);
+#endif
+
+    for (; i < pixels; ++i) {
+        // Invert lightness of the pixel using the cylindric HSL color model.
+        // Algorithm is based on https://en.wikipedia.org/wiki/HSL_and_HSV#HSL_to_RGB (2019-03-17).
+        // Important simplifications are that inverting lightness does not change chroma and hue.
+        // This means the sector (of the chroma/hue plane) is not changed,
+        // so we can use a linear calculation after determining the sector using qMin() and qMax().
+        uchar R = qRed(data[i]);
+        uchar G = qGreen(data[i]);
+        uchar B = qBlue(data[i]);
+
+        // Get only the needed HSL components. These are chroma C and the common component m.
+        // Get common component m
+        uchar m = qMin(R, qMin(G, B));
+        // Remove m from color components
+        R -= m;
+        G -= m;
+        B -= m;
+        // Get chroma C
+        uchar C = qMax(R, qMax(G, B));
+
+        // Get common component m' after inverting lightness L.
+        // Hint: Lightness L = m + C / 2; L' = 255 - L = 255 - (m + C / 2) => m' = 255 - C - m
+        uchar m_ = 255 - C - m;
+
+        // Add m' to color compontents
+        R += m_;
+        G += m_;
+        B += m_;
+
+        // Save new color
+        const unsigned A = qAlpha(data[i]);
+        data[i] = qRgba(R, G, B, A);
+    }
+}
+
+void ColorTransforms::invertLuma(QImage *image, float Y_R, float Y_G, float Y_B, Implementation implementation)
+{
+    convertToPremultiplied(image);
+
+    QRgb *data = reinterpret_cast<QRgb *>(image->bits());
+    int pixels = image->width() * image->height();
+
+    if (implementation == Reference) {
+        for (int i = 0; i < pixels; ++i) {
+            uchar R = qRed(data[i]);
+            uchar G = qGreen(data[i]);
+            uchar B = qBlue(data[i]);
+
+            invertLumaPixel(R, G, B, Y_R, Y_G, Y_B);
+
+            // Save new color
+            const unsigned A = qAlpha(data[i]);
+            data[i] = qRgba(R, G, B, A);
+        }
+        return;
+    }
+
+    // Pages are mostly gray, whose luma is just inverted. The few other
+    // colors repeat a lot, so their inverted value is remembered in a small
+    // direct mapped cache, keyed by the color with an opaque alpha.
+    struct CacheEntry {
+        QRgb color;
+        QRgb inverted;
+    };
+    QVector<CacheEntry> cache(4096, CacheEntry {0, 0});
+
+    auto invert = [&cache, Y_R, Y_G, Y_B](QRgb pixel) {
+        uchar R = qRed(pixel);
+        uchar G = qGreen(pixel);
+        uchar B = qBlue(pixel);
+        if (R == G && G == B)
+            return pixel ^ 0x00ffffff;
+
+        const QRgb color = pixel | 0xff000000;
+        CacheEntry &entry = cache[(color * 2654435761u) >> 20];
+        if (entry.color != color) {
+            invertLumaPixel(R, G, B, Y_R, Y_G, Y_B);
+            entry.color = color;
+            entry.inverted = qRgba(R, G, B, 0);
+        }
+        return entry.inverted | (pixel & 0xff000000);
+    };
+
+    int i = 0;
+#ifdef OKULAR_COLORTRANSFORMS_SSE2
+    const __m128i rgbMask = _mm_set1_epi32(0x00ffffff);
+    for (; i + 4 <= pixels; i += 4) {
+        const __m128i p = loadPixels(data + i);
+        // four gray pixels have their green byte in red and blue too
+        const __m128i g = channel(p, 8);
+        const __m128i grayRgb = _mm_or_si128(_mm_or_si128(_mm_slli_epi32(g, 16), _mm_slli_epi32(g, 8)), g);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(p, rgbMask), grayRgb)) == 0xffff) {
+            storePixels(data + i, _mm_xor_si128(p, rgbMask));
+            continue;
+        }
+
+        for (int j = i; j < i + 4; ++j)
+            data[j] = invert(data[j]);
+    }
+#endif
+    for (; i < pixels; ++i)
+        data[i] = invert(data[i]);
+}
+
+void ColorTransforms::invertLumaPixel(uchar &R, uchar &G, uchar &B, float Y_R, float Y_G, float Y_B)
+{
+    // Invert luma of the pixel using the bicone HCY color model, stretched to cylindric HSY.
+    // Algorithm is based on https://en.wikipedia.org/wiki/HSL_and_HSV#Luma,_chroma_and_hue_to_RGB (2019-03-19).
+    // For an illustration see https://experilous.com/1/product/make-it-colorful/ (2019-03-19).
+
+    // Special case: The algorithm does not work when hue is undefined.
+    if (R == G && G == B) {
+        R = 255 - R;
+        G = 255 - G;
+        B = 255 - B;
+        return;
+    }
+
+    // Get input and output luma Y, Y_inv in range 0..255
+    float Y = R * Y_R + G * Y_G + B * Y_B;
+    float Y_inv = 255 - Y;
+
+    // Get common component m and remove from color components.
+    // This moves us to the bottom faces of the HCY bicone, i. e. we get C and X in R, G, B.
+    uint_fast8_t m = qMin(R, qMin(G, B));
+    R -= m;
+    G -= m;
+    B -= m;
+
+    // We operate in a hue plane of the luma/chroma/hue bicone.
+    // The hue plane is a triangle.
+    // This bicone is distorted, so we can not simply mirror the triangle.
+    // We need to stretch it to a luma/saturation rectangle, so we need to stretch chroma C and the proportional X.
+
+    // First, we need to calculate luma Y_full_C for the outer corner of the triangle.
+    // Then we can interpolate the max chroma C_max, C_inv_max for our luma Y, Y_inv.
+    // Then we calculate C_inv and X_inv by scaling them by the ratio of C_max and C_inv_max.
+
+    // Calculate luma Y_full_C (in range equivalent to gray 0..255) for chroma = 1 at this hue.
+    // Piecewise linear, with the corners of the bicone at the sum of one or two luma coefficients.
+    float Y_full_C;
+    if (R >= B && B >= G) {
+        Y_full_C = 255 * Y_R + 255 * Y_B * B / R;
+    } else if (R >= G && G >= B) {
+        Y_full_C = 255 * Y_R + 255 * Y_G * G / R;
+    } else if (G >= R && R >= B) {
+        Y_full_C = 255 * Y_G + 255 * Y_R * R / G;
+    } else if (G >= B && B >= R) {
+        Y_full_C = 255 * Y_G + 255 * Y_B * B / G;
+    } else if (B >= G && G >= R) {
+        Y_full_C = 255 * Y_B + 255 * Y_G * G / B;
+    } else {
+        Y_full_C = 255 * Y_B + 255 * Y_R * R / B;
+    }
+
+    // Calculate C_max, C_inv_max, to scale C and X.
+    float C_max, C_inv_max;
+    if (Y >= Y_full_C) {
+        C_max = Y_inv / (255 - Y_full_C);
+    } else {
+        C_max = Y / Y_full_C;
+    }
+    if (Y_inv >= Y_full_C) {
+        C_inv_max = Y / (255 - Y_full_C);
+    } else {
+        C_inv_max = Y_inv / Y_full_C;
+    }
+
+    // Scale C and X. C and X already lie in R, G, B.
+    float C_scale = C_inv_max / C_max;
+    float R_ = R * C_scale;
+    float G_ = G * C_scale;
+    float B_ = B * C_scale;
+
+    // Calculate missing luma (in range 0..255), to get common component m_inv
+    float m_inv = Y_inv - (Y_R * R_ + Y_G * G_ + Y_B * B_);
+
+    // Add m_inv to color compontents
+    R_ += m_inv;
+    G_ += m_inv;
+    B_ += m_inv;
+
+    // Return colors rounded
+    R = R_ + 0.5;
+    G = G_ + 0.5;
+    B = B_ + 0.5;
+}
+
+// swaps the channels of the pixels in data with shuffle(), whose vectorized form is shuffle4()
+template<typename Shuffle, typename Shuffle4> static void shuffleChannels(QRgb *data, int pixels, Shuffle shuffle, Shuffle4 shuffle4)
+{
+    int i = 0;
+#ifdef OKULAR_COLORTRANSFORMS_SSE2
+    for (; i + 4 <= pixels; i += 4)
+        storePixels(data + i, shuffle4(loadPixels(data + i)));
+#else
+    Q_UNUSED(shuffle4);
+#endif
+    for (; i < pixels; ++i)
+        data[i] = shuffle(data[i]);
+}
+
+void ColorTransforms::hueShiftPositive(QImage *image, Implementation implementation)
+{
+    convertToPremultiplied(image);
+
+    QRgb *data = reinterpret_cast<QRgb *>(image->bits());
+    int pixels = image->width() * image->height();
+
+    if (implementation == Reference) {
+        for (int i = 0; i < pixels; ++i) {
+            uchar R = qRed(data[i]);
+            uchar G = qGreen(data[i]);
+            uchar B = qBlue(data[i]);
+
+            // Save new color
+            const unsigned A = qAlpha(data[i]);
+            data[i] = qRgba(B, R, G, A);
+        }
+        return;
+    }
+
+    // red <- blue, green <- red, blue <- green
+    shuffleChannels(
+        data,
+        pixels,
+        [](QRgb p) { return (p & 0xff000000) | ((p & 0xff) << 16) | ((p >> 8) & 0xffff); },
+#ifdef OKULAR_COLORTRANSFORMS_SSE2
+        [](__m128i p) {
+            const __m128i alpha = _mm_and_si128(p, _mm_set1_epi32(0xff000000));
+            const __m128i red = _mm_slli_epi32(_mm_and_si128(p, _mm_set1_epi32(0xff)), 16);
+            const __m128i greenBlue = _mm_and_si128(_mm_srli_epi32(p, 8), _mm_set1_epi32(0xffff));
+            return _mm_or_si128(alpha, _mm_or_si128(red, greenBlue));
+        }
+#else
+        nullptr
+#endif
+    );
+}
+
+void ColorTransforms::hueShiftNegative(QImage *image, Implementation implementation)
+{
+    convertToPremultiplied(image);
+
+    QRgb *data = reinterpret_cast<QRgb *>(image->bits());
+    int pixels = image->width() * image->height();
+
+    if (implementation == Reference) {
+        for (int i = 0; i < pixels; ++i) {
+            uchar R = qRed(data[i]);
+            uchar G = qGreen(data[i]);
+            uchar B = qBlue(data[i]);
+
+            // Save new color
+            const unsigned A = qAlpha(data[i]);
+            data[i] = qRgba(G, B, R, A);
+        }
+        return;
+    }
+
+    // red <- green, green <- blue, blue <- red
+    shuffleChannels(
+        data,
+        pixels,
+        [](QRgb p) { return (p & 0xff000000) | ((p & 0xffff) << 8) | ((p >> 16) & 0xff); },
+#ifdef OKULAR_COLORTRANSFORMS_SSE2
+        [](__m128i p) {
+            const __m128i alpha = _mm_and_si128(p, _mm_set1_epi32(0xff000000));
+            const __m128i redGreen = _mm_slli_epi32(_mm_and_si128(p, _mm_set1_epi32(0xffff)), 8);
+            const __m128i blue = _mm_and_si128(_mm_srli_epi32(p, 16), _mm_set1_epi32(0xff));
+            return _mm_or_si128(alpha, _mm_or_si128(redGreen, blue));
+        }
+#else
+        nullptr
+#endif
+    );
+}
+
+/* kate: replace-tabs on; indent-width 4; */
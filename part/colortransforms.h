@@ -0,0 +1,75 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by the Okular developers                           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef OKULAR_COLORTRANSFORMS_H
+#define OKULAR_COLORTRANSFORMS_H
+
+#include <QColor>
+#include <QImage>
+
+/**
+ * The color transforms of the accessibility render modes, applied by
+ * PagePainter to every painted page.
+ *
+ * Images are converted to QImage::Format_ARGB32_Premultiplied if needed.
+ *
+ * Each transform has a plain per-pixel implementation and a faster one,
+ * using SSE2 where available and lookup tables, that gives exactly the
+ * same result. The plain ones are kept as reference for the tests.
+ */
+namespace ColorTransforms
+{
+enum Implementation {
+    Reference, ///< Straightforward per-pixel loops
+    Optimized  ///< Vectorized and table driven, the default
+};
+
+/**
+ * Collapse color space (from white to black) to a line from @p foreground to @p background.
+ */
+void recolor(QImage *image, const QColor &foreground, const QColor &background, Implementation implementation = Optimized);
+
+/**
+ * Collapse color space to a line from white to black,
+ * then move from @p threshold to 128 and stretch the line by @p contrast.
+ */
+void blackWhite(QImage *image, int contrast, int threshold, Implementation implementation = Optimized);
+
+/**
+ * Invert the lightness axis of the HSL color cone.
+ */
+void invertLightness(QImage *image, Implementation implementation = Optimized);
+
+/**
+ * Inverts luma of @p image using the luma coefficients @p Y_R, @p Y_G, @p Y_B (should sum up to 1),
+ * and assuming linear 8bit RGB color space.
+ */
+void invertLuma(QImage *image, float Y_R, float Y_G, float Y_B, Implementation implementation = Optimized);
+
+/**
+ * Inverts luma of a pixel given in @p R, @p G, @p B,
+ * using the luma coefficients @p Y_R, @p Y_G, @p Y_B (should sum up to 1),
+ * and assuming linear 8bit RGB color space.
+ */
+void invertLumaPixel(uchar &R, uchar &G, uchar &B, float Y_R, float Y_G, float Y_B);
+
+/**
+ * Shifts hue of each pixel by 120 degrees, by simply swapping channels.
+ */
+void hueShiftPositive(QImage *image, Implementation implementation = Optimized);
+
+/**
+ * Shifts hue of each pixel by 240 degrees, by simply swapping channels.
+ */
+void hueShiftNegative(QImage *image, Implementation implementation = Optimized);
+}
+
+#endif
+
+/* kate: replace-tabs on; indent-width 4; */
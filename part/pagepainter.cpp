@@ -12,12 +12,14 @@
 // qt / kde includes
 #include <KIconLoader>
 #include <QApplication>
+#include <QCache>
 #include <QDebug>
 #include <QIcon>
 #include <QPainter>
 #include <QPalette>
 #include <QPixmap>
 #include <QRect>
+#include <QRegion>
 #include <QTransform>
 #include <QVarLengthArray>
 
@@ -29,9 +31,10 @@
 #include "core/page.h"
 #include "core/page_p.h"
 #include "core/tile.h"
+#include "colortransforms.h"
 #include "core/utils.h"
-#include "debug_ui.h"
 #include "guiutils.h"
+#include "scaledpixmapcache.h"
 #include "settings.h"
 #include "settings_core.h"
 
@@ -39,6 +42,46 @@ Q_GLOBAL_STATIC_WITH_ARGS(QPixmap, busyPixmap, (KIconLoader::global()->loadIcon(
 
 #define TEXTANNOTATION_ICONSIZE 24
 
+/**
+ * A page or tile pixmap with the accessibility color transform applied to
+ * the @p filtered region of it, which grows as more of the page is painted.
+ */
+struct AccessibilityPixmap {
+    QPixmap pixmap;
+    QRegion filtered;
+};
+
+/**
+ * Page and tile pixmaps with the accessibility color transform applied,
+ * keyed by the QPixmap::cacheKey() of their source pixmap, so painting
+ * the same pixmap again with the same render mode is only a blit.
+ *
+ * Replaced or modified source pixmaps have a new key, their stale entries
+ * are evicted as the cache fills up. The whole cache is dropped when the
+ * render mode settings change. Its budget, in KiB, follows the memory level.
+ */
+struct AccessibilityCache {
+    QString settings;
+    QCache<qint64, AccessibilityPixmap> pixmaps {0};
+};
+Q_GLOBAL_STATIC(AccessibilityCache, accessibilityCache)
+
+// scaled page pixmaps, with the budget of updatedScaledPixmapCache()
+Q_GLOBAL_STATIC_WITH_ARGS(ScaledPixmapCache, scaledPixmapCache, (0))
+
+// the accessibility and scaled pixmap caches get half of the image cache of the memory level each, in KiB
+static int derivedPixmapCacheSize()
+{
+    return int(qMin<qulonglong>(Okular::Utils::imageCacheSize() / 2 / 1024, INT_MAX));
+}
+
+static ScaledPixmapCache *updatedScaledPixmapCache()
+{
+    ScaledPixmapCache *cache = scaledPixmapCache();
+    cache->setMaxCost(derivedPixmapCacheSize());
+    return cache;
+}
+
 inline QPen buildPen(const Okular::Annotation *ann, double width, const QColor &color)
 {
     QColor c = color;
@@ -97,6 +140,7 @@ void PagePainter::paintCroppedPageOnPainter(QPainter *destPainter,
     }
     destPainter->fillRect(limits, backgroundColor);
 
+    const bool bufferAccessibility = (flags & Accessibility) && Okular::SettingsCore::changeColors() && (Okular::SettingsCore::renderMode() != Okular::SettingsCore::EnumRenderMode::Paper);
     const bool hasTilesManager = page->hasTilesManager(observer);
     QPixmap pixmap;
 
@@ -104,10 +148,9 @@ void PagePainter::paintCroppedPageOnPainter(QPainter *destPainter,
         /** 1 - RETRIEVE THE 'PAGE+ID' PIXMAP OR A SIMILAR 'PAGE' ONE **/
         const QPixmap *p = page->_o_nearestPixmap(observer, dScaledWidth, dScaledHeight);
 
-        if (p != nullptr) {
+        // keep the pixmap of the page as is, changing its device pixel ratio would detach it and change its cache key
+        if (p != nullptr)
             pixmap = *p;
-            pixmap.setDevicePixelRatio(qApp->devicePixelRatio());
-        }
 
         /** 1B - IF NO PIXMAP, DRAW EMPTY PAGE **/
         double pixmapRescaleRatio = !pixmap.isNull() ? dScaledWidth / (double)pixmap.width() : -1;
@@ -226,20 +269,39 @@ void PagePainter::paintCroppedPageOnPainter(QPainter *destPainter,
     }
 
     /** 3 - ENABLE BACKBUFFERING IF DIRECT IMAGE MANIPULATION IS NEEDED **/
-    bool bufferAccessibility = (flags & Accessibility) && Okular::SettingsCore::changeColors() && (Okular::SettingsCore::renderMode() != Okular::SettingsCore::EnumRenderMode::Paper);
-    bool useBackBuffer = bufferAccessibility || bufferedHighlights || bufferedAnnotations || viewPortPoint;
-    QPixmap *backPixmap = nullptr;
-    QPainter *mixedPainter = nullptr;
     QRect limitsInPixmap = limits.translated(scaledCrop.topLeft());
     QRect dLimitsInPixmap = dLimits.translated(dScaledCrop.topLeft());
 
     // limits within full (scaled but uncropped) pixmap
+    QList<Okular::Tile> tiles;
+    if (hasTilesManager)
+        tiles = page->tilesAt(observer, Okular::NormalizedRect(limitsInPixmap, scaledWidth, scaledHeight));
+
+    // 3.1. apply the accessibility transform to the painted part of the pixmaps, if not already cached,
+    // or to the back buffer as a whole if they are too large for the cache
+    bool filterBackBuffer = false;
+    if (bufferAccessibility) {
+        if (hasTilesManager) {
+            for (const Okular::Tile &tile : qAsConst(tiles))
+                filterBackBuffer = filterBackBuffer || !fitsAccessibilityCache(tile.pixmap()->size());
+        } else {
+            const double xScale = pixmap.width() / (double)dScaledWidth;
+            const double yScale = pixmap.height() / (double)dScaledHeight;
+            const QPixmap filtered = accessibilityPixmap(pixmap, QRectF(dLimitsInPixmap.x() * xScale, dLimitsInPixmap.y() * yScale, dLimitsInPixmap.width() * xScale, dLimitsInPixmap.height() * yScale).toAlignedRect());
+            if (filtered.isNull())
+                filterBackBuffer = true;
+            else
+                pixmap = filtered;
+        }
+    }
+
+    bool useBackBuffer = filterBackBuffer || bufferedHighlights || bufferedAnnotations || viewPortPoint;
+    QPixmap *backPixmap = nullptr;
+    QPainter *mixedPainter = nullptr;
 
     /** 4A -- REGULAR FLOW. PAINT PIXMAP NORMAL OR RESCALED USING GIVEN QPAINTER **/
     if (!useBackBuffer) {
         if (hasTilesManager) {
-            const Okular::NormalizedRect normalizedLimits(limitsInPixmap, scaledWidth, scaledHeight);
-            const QList<Okular::Tile> tiles = page->tilesAt(observer, normalizedLimits);
             QList<Okular::Tile>::const_iterator tIt = tiles.constBegin(), tEnd = tiles.constEnd();
             while (tIt != tEnd) {
                 const Okular::Tile &tile = *tIt;
@@ -251,17 +313,18 @@ void PagePainter::paintCroppedPageOnPainter(QPainter *destPainter,
                 if (!limitsInTile.isEmpty()) {
                     QPixmap *tilePixmap = tile.pixmap();
                     tilePixmap->setDevicePixelRatio(qApp->devicePixelRatio());
+                    const QPixmap tileContents = bufferAccessibility && !filterBackBuffer ? accessibilityPixmap(*tilePixmap, QRect(QPoint(0, 0), tilePixmap->size())) : *tilePixmap;
 
-                    if (tilePixmap->width() == dTileRect.width() && tilePixmap->height() == dTileRect.height()) {
-                        destPainter->drawPixmap(limitsInTile.topLeft(), *tilePixmap, dLimitsInTile.translated(-dTileRect.topLeft()));
+                    if (tileContents.width() == dTileRect.width() && tileContents.height() == dTileRect.height()) {
+                        destPainter->drawPixmap(limitsInTile.topLeft(), tileContents, dLimitsInTile.translated(-dTileRect.topLeft()));
                     } else {
-                        destPainter->drawPixmap(tileRect, *tilePixmap);
+                        destPainter->drawPixmap(tileRect, tileContents);
                     }
                 }
                 tIt++;
             }
         } else {
-            QPixmap scaledCroppedPixmap = pixmap.scaled(dScaledWidth, dScaledHeight).copy(dLimitsInPixmap);
+            QPixmap scaledCroppedPixmap = updatedScaledPixmapCache()->scaledRegion(pixmap, QSize(dScaledWidth, dScaledHeight), dLimitsInPixmap);
             scaledCroppedPixmap.setDevicePixelRatio(dpr);
             destPainter->drawPixmap(limits.topLeft(), scaledCroppedPixmap, QRectF(0, 0, dLimits.width(), dLimits.height()));
         }
@@ -278,8 +341,6 @@ void PagePainter::paintCroppedPageOnPainter(QPainter *destPainter,
         QPainter p(&backImage);
 
         if (hasTilesManager) {
-            const Okular::NormalizedRect normalizedLimits(limitsInPixmap, scaledWidth, scaledHeight);
-            const QList<Okular::Tile> tiles = page->tilesAt(observer, normalizedLimits);
             QList<Okular::Tile>::const_iterator tIt = tiles.constBegin(), tEnd = tiles.constEnd();
             while (tIt != tEnd) {
                 const Okular::Tile &tile = *tIt;
@@ -291,57 +352,31 @@ void PagePainter::paintCroppedPageOnPainter(QPainter *destPainter,
                 if (!limitsInTile.isEmpty()) {
                     QPixmap *tilePixmap = tile.pixmap();
                     tilePixmap->setDevicePixelRatio(qApp->devicePixelRatio());
+                    const QPixmap tileContents = bufferAccessibility && !filterBackBuffer ? accessibilityPixmap(*tilePixmap, QRect(QPoint(0, 0), tilePixmap->size())) : *tilePixmap;
 
-                    if (tilePixmap->width() == dTileRect.width() && tilePixmap->height() == dTileRect.height()) {
-                        p.drawPixmap(limitsInTile.translated(-limits.topLeft()).topLeft(), *tilePixmap, dLimitsInTile.translated(-dTileRect.topLeft()));
+                    if (tileContents.width() == dTileRect.width() && tileContents.height() == dTileRect.height()) {
+                        p.drawPixmap(limitsInTile.translated(-limits.topLeft()).topLeft(), tileContents, dLimitsInTile.translated(-dTileRect.topLeft()));
                     } else {
-                        double xScale = tilePixmap->width() / (double)dTileRect.width();
-                        double yScale = tilePixmap->height() / (double)dTileRect.height();
+                        double xScale = tileContents.width() / (double)dTileRect.width();
+                        double yScale = tileContents.height() / (double)dTileRect.height();
                         QTransform transform(xScale, 0, 0, yScale, 0, 0);
-                        p.drawPixmap(limitsInTile.translated(-limits.topLeft()), *tilePixmap, transform.mapRect(dLimitsInTile).translated(-transform.mapRect(dTileRect).topLeft()));
+                        p.drawPixmap(limitsInTile.translated(-limits.topLeft()), tileContents, transform.mapRect(dLimitsInTile).translated(-transform.mapRect(dTileRect).topLeft()));
                     }
                 }
                 ++tIt;
             }
         } else {
             // 4B.1. draw the page pixmap: normal or scaled
-            QPixmap scaledCroppedPixmap = pixmap.scaled(dScaledWidth, dScaledHeight).copy(dLimitsInPixmap);
+            QPixmap scaledCroppedPixmap = updatedScaledPixmapCache()->scaledRegion(pixmap, QSize(dScaledWidth, dScaledHeight), dLimitsInPixmap);
             scaledCroppedPixmap.setDevicePixelRatio(dpr);
             p.drawPixmap(0, 0, scaledCroppedPixmap);
         }
 
         p.end();
 
-        // 4B.2. modify pixmap following accessibility settings
-        if (bufferAccessibility) {
-            switch (Okular::SettingsCore::renderMode()) {
-            case Okular::SettingsCore::EnumRenderMode::Inverted:
-                // Invert image pixels using QImage internal function
-                backImage.invertPixels(QImage::InvertRgb);
-                break;
-            case Okular::SettingsCore::EnumRenderMode::Recolor:
-                recolor(&backImage, Okular::Settings::recolorForeground(), Okular::Settings::recolorBackground());
-                break;
-            case Okular::SettingsCore::EnumRenderMode::BlackWhite:
-                blackWhite(&backImage, Okular::Settings::bWContrast(), Okular::Settings::bWThreshold());
-                break;
-            case Okular::SettingsCore::EnumRenderMode::InvertLightness:
-                invertLightness(&backImage);
-                break;
-            case Okular::SettingsCore::EnumRenderMode::InvertLuma:
-                invertLuma(&backImage, 0.2126, 0.7152, 0.0722); // sRGB / Rec. 709 luma coefficients
-                break;
-            case Okular::SettingsCore::EnumRenderMode::InvertLumaSymmetric:
-                invertLuma(&backImage, 0.3333, 0.3334, 0.3333); // Symmetric coefficients, to keep colors saturated.
-                break;
-            case Okular::SettingsCore::EnumRenderMode::HueShiftPositive:
-                hueShiftPositive(&backImage);
-                break;
-            case Okular::SettingsCore::EnumRenderMode::HueShiftNegative:
-                hueShiftNegative(&backImage);
-                break;
-            }
-        }
+        // 4B.2. modify pixmap following accessibility settings, if not applied to the pixmaps already
+        if (filterBackBuffer)
+            applyAccessibility(&backImage);
 
         // 4B.3. highlight rects in page
         if (bufferedHighlights) {
@@ -692,260 +727,113 @@ void PagePainter::paintCroppedPageOnPainter(QPainter *destPainter,
     delete unbufferedAnnotations;
 }
 
-void PagePainter::recolor(QImage *image, const QColor &foreground, const QColor &background)
+QString PagePainter::accessibilitySettings()
 {
-    if (image->format() != QImage::Format_ARGB32_Premultiplied) {
-        qCWarning(OkularUiDebug) << "Wrong image format! Converting...";
-        *image = image->convertToFormat(QImage::Format_ARGB32_Premultiplied);
-    }
-
-    Q_ASSERT(image->format() == QImage::Format_ARGB32_Premultiplied);
-
-    const float scaleRed = background.redF() - foreground.redF();
-    const float scaleGreen = background.greenF() - foreground.greenF();
-    const float scaleBlue = background.blueF() - foreground.blueF();
-
-    const int foreground_red = foreground.red();
-    const int foreground_green = foreground.green();
-    const int foreground_blue = foreground.blue();
-
-    QRgb *data = reinterpret_cast<QRgb *>(image->bits());
-    const int pixels = image->width() * image->height();
-
-    for (int i = 0; i < pixels; ++i) {
-        const int lightness = qGray(data[i]);
-
-        const float r = scaleRed * lightness + foreground_red;
-        const float g = scaleGreen * lightness + foreground_green;
-        const float b = scaleBlue * lightness + foreground_blue;
-
-        const unsigned a = qAlpha(data[i]);
-        data[i] = qRgba(r, g, b, a);
+    const int renderMode = Okular::SettingsCore::renderMode();
+    switch (renderMode) {
+    case Okular::SettingsCore::EnumRenderMode::Recolor:
+        return QStringLiteral("%1 %2 %3").arg(renderMode).arg(Okular::Settings::recolorForeground().name(QColor::HexArgb), Okular::Settings::recolorBackground().name(QColor::HexArgb));
+    case Okular::SettingsCore::EnumRenderMode::BlackWhite:
+        return QStringLiteral("%1 %2 %3").arg(renderMode).arg(Okular::Settings::bWContrast()).arg(Okular::Settings::bWThreshold());
+    default:
+        return QString::number(renderMode);
     }
 }
 
-void PagePainter::blackWhite(QImage *image, int contrast, int threshold)
+void PagePainter::applyAccessibility(QImage *image)
 {
-    unsigned int *data = reinterpret_cast<unsigned int *>(image->bits());
-    int con = contrast;
-    int thr = 255 - threshold;
-
-    int pixels = image->width() * image->height();
-    for (int i = 0; i < pixels; ++i) {
-        // Piecewise linear function of val, through (0, 0), (thr, 128), (255, 255)
-        int val = qGray(data[i]);
-        if (val > thr)
-            val = 128 + (127 * (val - thr)) / (255 - thr);
-        else if (val < thr)
-            val = (128 * val) / thr;
-
-        // Linear contrast stretching through (thr, thr)
-        if (con > 2) {
-            val = thr + (val - thr) * con / 2;
-            val = qBound(0, val, 255);
-        }
-
-        const unsigned a = qAlpha(data[i]);
-        data[i] = qRgba(val, val, val, a);
-    }
-}
-
-void PagePainter::invertLightness(QImage *image)
-{
-    if (image->format() != QImage::Format_ARGB32_Premultiplied) {
-        qCWarning(OkularUiDebug) << "Wrong image format! Converting...";
-        *image = image->convertToFormat(QImage::Format_ARGB32_Premultiplied);
-    }
-
-    Q_ASSERT(image->format() == QImage::Format_ARGB32_Premultiplied);
-
-    QRgb *data = reinterpret_cast<QRgb *>(image->bits());
-    int pixels = image->width() * image->height();
-    for (int i = 0; i < pixels; ++i) {
-        // Invert lightness of the pixel using the cylindric HSL color model.
-        // Algorithm is based on https://en.wikipedia.org/wiki/HSL_and_HSV#HSL_to_RGB (2019-03-17).
-        // Important simplifications are that inverting lightness does not change chroma and hue.
-        // This means the sector (of the chroma/hue plane) is not changed,
-        // so we can use a linear calculation after determining the sector using qMin() and qMax().
-        uchar R = qRed(data[i]);
-        uchar G = qGreen(data[i]);
-        uchar B = qBlue(data[i]);
-
-        // Get only the needed HSL components. These are chroma C and the common component m.
-        // Get common component m
-        uchar m = qMin(R, qMin(G, B));
-        // Remove m from color components
-        R -= m;
-        G -= m;
-        B -= m;
-        // Get chroma C
-        uchar C = qMax(R, qMax(G, B));
-
-        // Get common component m' after inverting lightness L.
-        // Hint: Lightness L = m + C / 2; L' = 255 - L = 255 - (m + C / 2) => m' = 255 - C - m
-        uchar m_ = 255 - C - m;
-
-        // Add m' to color compontents
-        R += m_;
-        G += m_;
-        B += m_;
-
-        // Save new color
-        const unsigned A = qAlpha(data[i]);
-        data[i] = qRgba(R, G, B, A);
+    switch (Okular::SettingsCore::renderMode()) {
+    case Okular::SettingsCore::EnumRenderMode::Inverted:
+        // Invert image pixels using QImage internal function
+        image->invertPixels(QImage::InvertRgb);
+        break;
+    case Okular::SettingsCore::EnumRenderMode::Recolor:
+        ColorTransforms::recolor(image, Okular::Settings::recolorForeground(), Okular::Settings::recolorBackground());
+        break;
+    case Okular::SettingsCore::EnumRenderMode::BlackWhite:
+        ColorTransforms::blackWhite(image, Okular::Settings::bWContrast(), Okular::Settings::bWThreshold());
+        break;
+    case Okular::SettingsCore::EnumRenderMode::InvertLightness:
+        ColorTransforms::invertLightness(image);
+        break;
+    case Okular::SettingsCore::EnumRenderMode::InvertLuma:
+        ColorTransforms::invertLuma(image, 0.2126, 0.7152, 0.0722); // sRGB / Rec. 709 luma coefficients
+        break;
+    case Okular::SettingsCore::EnumRenderMode::InvertLumaSymmetric:
+        ColorTransforms::invertLuma(image, 0.3333, 0.3334, 0.3333); // Symmetric coefficients, to keep colors saturated.
+        break;
+    case Okular::SettingsCore::EnumRenderMode::HueShiftPositive:
+        ColorTransforms::hueShiftPositive(image);
+        break;
+    case Okular::SettingsCore::EnumRenderMode::HueShiftNegative:
+        ColorTransforms::hueShiftNegative(image);
+        break;
     }
 }
 
-void PagePainter::invertLuma(QImage *image, float Y_R, float Y_G, float Y_B)
+AccessibilityCache *PagePainter::updatedAccessibilityCache()
 {
-    if (image->format() != QImage::Format_ARGB32_Premultiplied) {
-        qCWarning(OkularUiDebug) << "Wrong image format! Converting...";
-        *image = image->convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    AccessibilityCache *cache = accessibilityCache();
+    const QString settings = accessibilitySettings();
+    if (cache->settings != settings) {
+        cache->pixmaps.clear();
+        cache->settings = settings;
     }
 
-    Q_ASSERT(image->format() == QImage::Format_ARGB32_Premultiplied);
-
-    QRgb *data = reinterpret_cast<QRgb *>(image->bits());
-    int pixels = image->width() * image->height();
-    for (int i = 0; i < pixels; ++i) {
-        uchar R = qRed(data[i]);
-        uchar G = qGreen(data[i]);
-        uchar B = qBlue(data[i]);
-
-        invertLumaPixel(R, G, B, Y_R, Y_G, Y_B);
-
-        // Save new color
-        const unsigned A = qAlpha(data[i]);
-        data[i] = qRgba(R, G, B, A);
-    }
+    const int maxCost = derivedPixmapCacheSize();
+    if (cache->pixmaps.maxCost() != maxCost)
+        cache->pixmaps.setMaxCost(maxCost);
+    return cache;
 }
 
-void PagePainter::invertLumaPixel(uchar &R, uchar &G, uchar &B, float Y_R, float Y_G, float Y_B)
+static int accessibilityCost(const QSize &size)
 {
-    // Invert luma of the pixel using the bicone HCY color model, stretched to cylindric HSY.
-    // Algorithm is based on https://en.wikipedia.org/wiki/HSL_and_HSV#Luma,_chroma_and_hue_to_RGB (2019-03-19).
-    // For an illustration see https://experilous.com/1/product/make-it-colorful/ (2019-03-19).
-
-    // Special case: The algorithm does not work when hue is undefined.
-    if (R == G && G == B) {
-        R = 255 - R;
-        G = 255 - G;
-        B = 255 - B;
-        return;
-    }
-
-    // Get input and output luma Y, Y_inv in range 0..255
-    float Y = R * Y_R + G * Y_G + B * Y_B;
-    float Y_inv = 255 - Y;
-
-    // Get common component m and remove from color components.
-    // This moves us to the bottom faces of the HCY bicone, i. e. we get C and X in R, G, B.
-    uint_fast8_t m = qMin(R, qMin(G, B));
-    R -= m;
-    G -= m;
-    B -= m;
-
-    // We operate in a hue plane of the luma/chroma/hue bicone.
-    // The hue plane is a triangle.
-    // This bicone is distorted, so we can not simply mirror the triangle.
-    // We need to stretch it to a luma/saturation rectangle, so we need to stretch chroma C and the proportional X.
-
-    // First, we need to calculate luma Y_full_C for the outer corner of the triangle.
-    // Then we can interpolate the max chroma C_max, C_inv_max for our luma Y, Y_inv.
-    // Then we calculate C_inv and X_inv by scaling them by the ratio of C_max and C_inv_max.
-
-    // Calculate luma Y_full_C (in range equivalent to gray 0..255) for chroma = 1 at this hue.
-    // Piecewise linear, with the corners of the bicone at the sum of one or two luma coefficients.
-    float Y_full_C;
-    if (R >= B && B >= G) {
-        Y_full_C = 255 * Y_R + 255 * Y_B * B / R;
-    } else if (R >= G && G >= B) {
-        Y_full_C = 255 * Y_R + 255 * Y_G * G / R;
-    } else if (G >= R && R >= B) {
-        Y_full_C = 255 * Y_G + 255 * Y_R * R / G;
-    } else if (G >= B && B >= R) {
-        Y_full_C = 255 * Y_G + 255 * Y_B * B / G;
-    } else if (B >= G && G >= R) {
-        Y_full_C = 255 * Y_B + 255 * Y_G * G / B;
-    } else {
-        Y_full_C = 255 * Y_B + 255 * Y_R * R / B;
-    }
-
-    // Calculate C_max, C_inv_max, to scale C and X.
-    float C_max, C_inv_max;
-    if (Y >= Y_full_C) {
-        C_max = Y_inv / (255 - Y_full_C);
-    } else {
-        C_max = Y / Y_full_C;
-    }
-    if (Y_inv >= Y_full_C) {
-        C_inv_max = Y / (255 - Y_full_C);
-    } else {
-        C_inv_max = Y_inv / Y_full_C;
-    }
-
-    // Scale C and X. C and X already lie in R, G, B.
-    float C_scale = C_inv_max / C_max;
-    float R_ = R * C_scale;
-    float G_ = G * C_scale;
-    float B_ = B * C_scale;
-
-    // Calculate missing luma (in range 0..255), to get common component m_inv
-    float m_inv = Y_inv - (Y_R * R_ + Y_G * G_ + Y_B * B_);
-
-    // Add m_inv to color compontents
-    R_ += m_inv;
-    G_ += m_inv;
-    B_ += m_inv;
-
-    // Return colors rounded
-    R = R_ + 0.5;
-    G = G_ + 0.5;
-    B = B_ + 0.5;
+    return qMax(1, int(qint64(size.width()) * size.height() * 4 / 1024));
 }
 
-void PagePainter::hueShiftPositive(QImage *image)
+bool PagePainter::fitsAccessibilityCache(const QSize &size)
 {
-    if (image->format() != QImage::Format_ARGB32_Premultiplied) {
-        qCWarning(OkularUiDebug) << "Wrong image format! Converting...";
-        *image = image->convertToFormat(QImage::Format_ARGB32_Premultiplied);
-    }
-
-    Q_ASSERT(image->format() == QImage::Format_ARGB32_Premultiplied);
-
-    QRgb *data = reinterpret_cast<QRgb *>(image->bits());
-    int pixels = image->width() * image->height();
-    for (int i = 0; i < pixels; ++i) {
-        uchar R = qRed(data[i]);
-        uchar G = qGreen(data[i]);
-        uchar B = qBlue(data[i]);
-
-        // Save new color
-        const unsigned A = qAlpha(data[i]);
-        data[i] = qRgba(B, R, G, A);
-    }
+    return accessibilityCost(size) <= updatedAccessibilityCache()->pixmaps.maxCost();
 }
 
-void PagePainter::hueShiftNegative(QImage *image)
+QPixmap PagePainter::accessibilityPixmap(const QPixmap &source, const QRect &region)
 {
-    if (image->format() != QImage::Format_ARGB32_Premultiplied) {
-        qCWarning(OkularUiDebug) << "Wrong image format! Converting...";
-        *image = image->convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    AccessibilityCache *cache = updatedAccessibilityCache();
+
+    const qint64 key = source.cacheKey();
+    AccessibilityPixmap *cached = cache->pixmaps.object(key);
+    if (!cached) {
+        const int cost = accessibilityCost(source.size());
+        if (cost > cache->pixmaps.maxCost())
+            return QPixmap();
+
+        cached = new AccessibilityPixmap;
+        cached->pixmap = QPixmap(source.size());
+        cached->pixmap.fill(Qt::white);
+        cached->pixmap.setDevicePixelRatio(source.devicePixelRatio());
+        cache->pixmaps.insert(key, cached, cost);
     }
 
-    Q_ASSERT(image->format() == QImage::Format_ARGB32_Premultiplied);
-
-    QRgb *data = reinterpret_cast<QRgb *>(image->bits());
-    int pixels = image->width() * image->height();
-    for (int i = 0; i < pixels; ++i) {
-        uchar R = qRed(data[i]);
-        uchar G = qGreen(data[i]);
-        uchar B = qBlue(data[i]);
-
-        // Save new color
-        const unsigned A = qAlpha(data[i]);
-        data[i] = qRgba(G, B, R, A);
+    // filter only what was not painted before, e.g. the strip uncovered by scrolling
+    const QRegion missing = QRegion(region & QRect(QPoint(0, 0), source.size())).subtracted(cached->filtered);
+    if (!missing.isEmpty()) {
+        const qreal dpr = source.devicePixelRatio();
+        QPainter destination(&cached->pixmap);
+        destination.setCompositionMode(QPainter::CompositionMode_Source);
+        for (const QRect &rect : missing) {
+            // transparent parts of the page are white paper, as in the back buffer
+            QImage image(rect.size(), QImage::Format_ARGB32_Premultiplied);
+            image.fill(Qt::white);
+            QPainter p(&image);
+            p.drawPixmap(QRectF(QPointF(0, 0), QSizeF(rect.size())), source, QRectF(rect));
+            p.end();
+            applyAccessibility(&image);
+            destination.drawImage(QRectF(rect.x() / dpr, rect.y() / dpr, rect.width() / dpr, rect.height() / dpr), image);
+        }
+        destination.end();
+        cached->filtered += missing;
     }
+    return cached->pixmap;
 }
 
 void PagePainter::drawShapeOnImage(QImage &image, const NormalizedPath &normPath, bool closeShape, const QPen &pen, const QBrush &brush, double penWidthMultiplier, RasterOperation op
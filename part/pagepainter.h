@@ -18,7 +18,10 @@
 #include "core/area.h" // for NormalizedPoint
 
 class QPainter;
+class QPixmap;
 class QRect;
+class QSize;
+struct AccessibilityCache;
 namespace Okular
 {
 class DocumentObserver;
@@ -72,44 +75,39 @@ public:
                                           Okular::NormalizedPoint *viewPortPoint);
 
 private:
-    // BEGIN Change Colors feature
-    /**
-     * Collapse color space (from white to black) to a line from @p foreground to @p background.
-     */
-    static void recolor(QImage *image, const QColor &foreground, const QColor &background);
-    /**
-     * Collapse color space to a line from white to black,
-     * then move from @p threshold to 128 and stretch the line by @p contrast.
-     */
-    static void blackWhite(QImage *image, int contrast, int threshold);
+    // my pretty dear raster function
+    typedef QList<Okular::NormalizedPoint> NormalizedPath;
+    enum RasterOperation { Normal, Multiply };
+
     /**
-     * Invert the lightness axis of the HSL color cone.
+     * Returns the settings the accessibility transform of the current render mode depends on.
      */
-    static void invertLightness(QImage *image);
+    static QString accessibilitySettings();
+
     /**
-     * Inverts luma of @p image using the luma coefficients @p Y_R, @p Y_G, @p Y_B (should sum up to 1),
-     * and assuming linear 8bit RGB color space.
+     * Apply the accessibility transform of the current render mode to @p image.
      */
-    static void invertLuma(QImage *image, float Y_R, float Y_G, float Y_B);
+    static void applyAccessibility(QImage *image);
+
     /**
-     * Inverts luma of a pixel given in @p R, @p G, @p B,
-     * using the luma coefficients @p Y_R, @p Y_G, @p Y_B (should sum up to 1),
-     * and assuming linear 8bit RGB color space.
+     * Returns the accessibility cache, emptied if the render mode settings
+     * changed and with the budget of the current memory level.
      */
-    static void invertLumaPixel(uchar &R, uchar &G, uchar &B, float Y_R, float Y_G, float Y_B);
+    static AccessibilityCache *updatedAccessibilityCache();
+
     /**
-     * Shifts hue of each pixel by 120 degrees, by simply swapping channels.
+     * Returns whether the accessibility cache can hold a pixmap of @p size.
      */
-    static void hueShiftPositive(QImage *image);
+    static bool fitsAccessibilityCache(const QSize &size);
+
     /**
-     * Shifts hue of each pixel by 240 degrees, by simply swapping channels.
+     * Returns @p source with the accessibility transform applied at least to
+     * @p region, cached as long as neither @p source nor the render mode settings
+     * change, so only the parts not painted before are transformed.
+     *
+     * Returns a null pixmap if @p source does not fit the cache.
      */
-    static void hueShiftNegative(QImage *image);
-    // END Change Colors feature
-
-    // my pretty dear raster function
-    typedef QList<Okular::NormalizedPoint> NormalizedPath;
-    enum RasterOperation { Normal, Multiply };
+    static QPixmap accessibilityPixmap(const QPixmap &source, const QRect &region);
 
     /**
      * Draw @p normPath on @p image.
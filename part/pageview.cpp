@@ -4975,10 +4975,8 @@ void PageView::slotSpeakDocument()
 {
     QString text;
     for (const PageViewItem *item : qAsConst(d->items)) {
-        Okular::RegularAreaRect *area = textSelectionForItem(item);
-        text.append(item->page()->text(area));
+        text.append(d->document->pageText(item->pageNumber()));
         text.append('\n');
-        delete area;
     }
 
     d->tts()->say(text);
@@ -4988,12 +4986,7 @@ void PageView::slotSpeakCurrentPage()
 {
     const int currentPage = d->document->viewport().pageNumber;
 
-    PageViewItem *item = d->items.at(currentPage);
-    Okular::RegularAreaRect *area = textSelectionForItem(item);
-    const QString text = item->page()->text(area);
-    delete area;
-
-    d->tts()->say(text);
+    d->tts()->say(d->document->pageText(currentPage));
 }
 
 void PageView::slotStopSpeaks()
@@ -0,0 +1,75 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by the Okular developers                           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include "scaledpixmapcache.h"
+
+#include <QPainter>
+
+// how many misses are remembered, more than the pages visible at once
+#define RECENT_MISSES 16
+
+ScaledPixmapCache::ScaledPixmapCache(int maxCost)
+    : m_pixmaps(maxCost)
+{
+}
+
+void ScaledPixmapCache::setMaxCost(int maxCost)
+{
+    if (m_pixmaps.maxCost() != maxCost)
+        m_pixmaps.setMaxCost(maxCost);
+}
+
+ScaledPixmapCache::Key ScaledPixmapCache::key(const QPixmap &source, const QSize &size)
+{
+    return Key(source.cacheKey(), (qint64(size.width()) << 32) | quint32(size.height()));
+}
+
+bool ScaledPixmapCache::contains(const QPixmap &source, const QSize &size) const
+{
+    return m_pixmaps.contains(key(source, size));
+}
+
+QPixmap ScaledPixmapCache::scaledRegion(const QPixmap &source, const QSize &size, const QRect &region)
+{
+    if (source.size() == size)
+        return source.copy(region);
+
+    const Key key = ScaledPixmapCache::key(source, size);
+    if (const QPixmap *cached = m_pixmaps.object(key))
+        return cached->copy(region);
+
+    const qint64 cost = qMax(qint64(1), qint64(size.width()) * size.height() * 4 / 1024);
+    const int missIndex = m_recentMisses.indexOf(key);
+    if (missIndex != -1 && cost <= m_pixmaps.maxCost()) {
+        m_recentMisses.remove(missIndex);
+        QPixmap *scaled = new QPixmap(source.scaled(size));
+        const QPixmap result = scaled->copy(region);
+        m_pixmaps.insert(key, scaled, int(cost));
+        return result;
+    }
+    if (missIndex == -1) {
+        if (m_recentMisses.size() == RECENT_MISSES)
+            m_recentMisses.removeFirst();
+        m_recentMisses.append(key);
+    }
+
+    // scale only the source pixels covering the region: QPixmap::scaled() paints the whole source
+    // with a scaling transform, paint it with the same one moved to the region, so the pixels are the same
+    QPixmap result(region.size());
+    result.fill(Qt::transparent);
+    QPainter p(&result);
+    p.setCompositionMode(QPainter::CompositionMode_Source);
+    p.translate(-region.topLeft());
+    p.scale(size.width() / (double)source.width(), size.height() / (double)source.height());
+    p.drawPixmap(QRectF(QPointF(0, 0), QSizeF(source.size())), source, QRectF(QPointF(0, 0), QSizeF(source.size())));
+    p.end();
+    return result;
+}
+
+/* kate: replace-tabs on; indent-width 4; */
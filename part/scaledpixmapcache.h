@@ -0,0 +1,71 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by the Okular developers                           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef OKULAR_SCALEDPIXMAPCACHE_H
+#define OKULAR_SCALEDPIXMAPCACHE_H
+
+#include <QCache>
+#include <QPair>
+#include <QPixmap>
+#include <QVector>
+
+/**
+ * Page pixmaps scaled to the size they are painted at, used by PagePainter
+ * while the pixmap of the exact size has not been generated yet.
+ *
+ * The scaled pixmaps are keyed by the QPixmap::cacheKey() of their source,
+ * which identifies the pixmap of a page for an observer, and by their size.
+ * Replaced source pixmaps have a new key, their stale entries are evicted
+ * as the cache fills up.
+ *
+ * A size painted only once, as in each step of a smooth zoom, would not
+ * pay back scaling the whole page: the first time only the requested
+ * region is scaled, the whole page is scaled and cached when the same
+ * size of the same page is painted again, e.g. when scrolling. The last
+ * few misses are remembered, so the pages visible at once, painted in
+ * turn, are all cached.
+ */
+class ScaledPixmapCache
+{
+public:
+    /**
+     * Creates a cache holding up to @p maxCost KiB of scaled pixmaps.
+     */
+    explicit ScaledPixmapCache(int maxCost);
+
+    /**
+     * Changes the budget of the cache to @p maxCost KiB, evicting scaled pixmaps if needed.
+     */
+    void setMaxCost(int maxCost);
+
+    /**
+     * Returns the @p region of @p source scaled to @p size.
+     *
+     * @p source must not be modified while it is cached, as it happens to
+     * the copies whose device pixel ratio is changed, or its key changes.
+     */
+    QPixmap scaledRegion(const QPixmap &source, const QSize &size, const QRect &region);
+
+    /**
+     * Returns whether @p source scaled to @p size is cached.
+     */
+    bool contains(const QPixmap &source, const QSize &size) const;
+
+private:
+    typedef QPair<qint64, qint64> Key;
+
+    static Key key(const QPixmap &source, const QSize &size);
+
+    QCache<Key, QPixmap> m_pixmaps;
+    QVector<Key> m_recentMisses;
+};
+
+#endif
+
+/* kate: replace-tabs on; indent-width 4; */
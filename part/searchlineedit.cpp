@@ -34,6 +34,7 @@ SearchLineEdit::SearchLineEdit(QWidget *parent, Okular::Document *document)
     , m_fromStart(true)
     , m_findAsYouType(true)
     , m_searchRunning(false)
+    , m_startingSearch(false)
 {
     setObjectName(QStringLiteral("SearchLineEdit"));
     setClearButtonEnabled(true);
@@ -233,7 +234,9 @@ void SearchLineEdit::startSearch()
     if (thistext.length() >= qMax(m_minLength, 1)) {
         emit searchStarted();
         m_searchRunning = true;
+        m_startingSearch = true;
         m_document->searchText(m_id, thistext, m_fromStart, m_caseSensitivity, m_searchType, m_moveViewport, m_color);
+        m_startingSearch = false;
     } else
         m_document->resetSearch(m_id);
 }
@@ -244,6 +247,10 @@ void SearchLineEdit::searchFinished(int id, Okular::Document::SearchStatus endSt
     if (id != m_id)
         return;
 
+    // the previous search, still running when the new one was started, was cancelled by it
+    if (m_startingSearch && endStatus == Okular::Document::SearchCancelled)
+        return;
+
     // if not found, use warning colors
     if (endStatus == Okular::Document::NoMatchFound) {
         QPalette pal = palette();
@@ -67,6 +67,7 @@ private:
     bool m_fromStart;
     bool m_findAsYouType;
     bool m_searchRunning;
+    bool m_startingSearch;
 
 private Q_SLOTS:
     void slotTextChanged(const QString &text);
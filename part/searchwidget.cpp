@@ -53,6 +53,7 @@ SearchWidget::SearchWidget(QWidget *parent, Okular::Document *document)
     m_matchPhraseAction = m_menu->addAction(i18n("Match Phrase"));
     m_marchAllWordsAction = m_menu->addAction(i18n("Match All Words"));
     m_marchAnyWordsAction = m_menu->addAction(i18n("Match Any Word"));
+    m_regularExpressionAction = m_menu->addAction(i18n("Regular Expression"));
 
     m_caseSensitiveAction->setCheckable(true);
     QActionGroup *actgrp = new QActionGroup(this);
@@ -62,6 +63,8 @@ SearchWidget::SearchWidget(QWidget *parent, Okular::Document *document)
     m_marchAllWordsAction->setActionGroup(actgrp);
     m_marchAnyWordsAction->setCheckable(true);
     m_marchAnyWordsAction->setActionGroup(actgrp);
+    m_regularExpressionAction->setCheckable(true);
+    m_regularExpressionAction->setActionGroup(actgrp);
 
     m_marchAllWordsAction->setChecked(true);
     connect(m_menu, &QMenu::triggered, this, &SearchWidget::slotMenuChaged);
@@ -92,6 +95,8 @@ void SearchWidget::slotMenuChaged(QAction *act)
         m_lineEdit->setSearchType(Okular::Document::GoogleAll);
     } else if (act == m_marchAnyWordsAction) {
         m_lineEdit->setSearchType(Okular::Document::GoogleAny);
+    } else if (act == m_regularExpressionAction) {
+        m_lineEdit->setSearchType(Okular::Document::RegularExpression);
     } else
         return;
 
@@ -39,7 +39,7 @@ public:
 
 private:
     QMenu *m_menu;
-    QAction *m_matchPhraseAction, *m_caseSensitiveAction, *m_marchAllWordsAction, *m_marchAnyWordsAction;
+    QAction *m_matchPhraseAction, *m_caseSensitiveAction, *m_marchAllWordsAction, *m_marchAnyWordsAction, *m_regularExpressionAction;
     SearchLineEdit *m_lineEdit;
 
 private Q_SLOTS: